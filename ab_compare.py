@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""Statistical A/B comparison of menu-open latency between two builds.
+
+Each side takes any number of trace logs (one run each) or replay
+summaries written with --json (one run per replay repetition). Episodes
+are aligned by their index within a run, i.e. the n-th menu open of every
+run is compared with the n-th menu open of the other side.
+
+For every metric, the difference of the candidate (B) and baseline (A)
+statistic gets a bootstrap confidence interval. Samples are whole runs,
+or whole episodes for the metrics over all episodes, never single
+readbacks: readbacks within a run share its state and are not independent.
+A change is significant if the interval excludes zero; lower is better for
+all metrics. Metrics with fewer than --min-samples samples on either side,
+and all metrics with fewer than --min-runs runs on either side, get no
+interval and no verdict.
+
+Usage: ab_compare.py --a FILE... --b FILE... [options]
+"""
+import argparse
+import random
+import statistics
+import sys
+
+from atfix_trace import load_runs
+
+
+def mean(values):
+    return sum(values) / len(values)
+
+
+def bootstrap_ci(a, b, stat, resamples, confidence, rng):
+    """Percentile bootstrap CI of stat(b) - stat(a), resampling each side
+    independently with replacement."""
+    deltas = []
+    for _ in range(resamples):
+        ra = [a[rng.randrange(len(a))] for _ in a]
+        rb = [b[rng.randrange(len(b))] for _ in b]
+        deltas.append(stat(rb) - stat(ra))
+    deltas.sort()
+    alpha = (1.0 - confidence) / 2.0
+    lo = deltas[int(alpha * (resamples - 1))]
+    hi = deltas[int((1.0 - alpha) * (resamples - 1))]
+    return lo, hi
+
+
+def compare(name, a, b, stat, args, rng, runs):
+    if not a or not b:
+        return None
+    delta = stat(b) - stat(a)
+    if len(a) < args.min_samples or len(b) < args.min_samples or runs < args.min_runs:
+        lo, hi = float('nan'), float('nan')
+        verdict = "too few samples"
+    else:
+        lo, hi = bootstrap_ci(a, b, stat, args.resamples, args.confidence, rng)
+        if hi < 0:
+            verdict = "improvement"
+        elif lo > 0:
+            verdict = "regression"
+        else:
+            verdict = "no significant change"
+    return (name, stat(a), stat(b), delta, lo, hi, verdict, len(a), len(b))
+
+
+def episode_value(episode, field, reduce):
+    """Reduces the readbacks of an episode to one sample, or None."""
+    value = getattr(episode, field)
+    if isinstance(value, list):
+        return reduce(value) if value else None
+    return value
+
+
+def collect(runs, index, field, reduce):
+    """One sample per run, from its episode at the given index."""
+    values = []
+    for run in runs:
+        if index < len(run):
+            value = episode_value(run[index], field, reduce)
+            if value is not None:
+                values.append(value)
+    return values
+
+
+def collect_all(runs, field, reduce):
+    """One sample per episode of every run."""
+    values = []
+    for run in runs:
+        for episode in run:
+            value = episode_value(episode, field, reduce)
+            if value is not None:
+                values.append(value)
+    return values
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__.strip().split('\n')[0],
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--a', nargs='+', required=True, metavar='FILE', help='baseline traces or summaries')
+    parser.add_argument('--b', nargs='+', required=True, metavar='FILE', help='candidate traces or summaries')
+    parser.add_argument('--episode-gap-ms', type=float, default=500.0, help='gap that separates episodes in traces (default 500)')
+    parser.add_argument('--resamples', type=int, default=2000, help='bootstrap resamples (default 2000)')
+    parser.add_argument('--confidence', type=float, default=0.95, help='confidence level (default 0.95)')
+    parser.add_argument('--seed', type=int, default=1, help='random seed (default 1)')
+    parser.add_argument('--min-samples', type=int, default=5, help='samples per side needed for a verdict (default 5)')
+    parser.add_argument('--min-runs', type=int, default=3, help='runs per side needed for any verdict (default 3)')
+    args = parser.parse_args()
+
+    gap_us = args.episode_gap_ms * 1000.0
+    runs_a = [run for path in args.a for run in load_runs(path, gap_us)]
+    runs_b = [run for path in args.b for run in load_runs(path, gap_us)]
+
+    rng = random.Random(args.seed)
+    runs = min(len(runs_a), len(runs_b))
+    rows = []
+
+    # Whole menu-open latency, one sample per run
+    total_a = [sum(e.latency_us for e in run) / 1000.0 for run in runs_a]
+    total_b = [sum(e.latency_us for e in run) / 1000.0 for run in runs_b]
+    rows.append(compare("all runs: latency ms (median)", total_a, total_b, statistics.median, args, rng, runs))
+
+    # Per-readback metrics, one sample per episode
+    stall_a = collect_all(runs_a, 'stalls_us', mean)
+    stall_b = collect_all(runs_b, 'stalls_us', mean)
+    rows.append(compare("all episodes: stall/readback us (mean)", stall_a, stall_b, mean, args, rng, runs))
+
+    interval_a = collect_all(runs_a, 'intervals_us', statistics.median)
+    interval_b = collect_all(runs_b, 'intervals_us', statistics.median)
+    rows.append(compare("all episodes: readback interval us (median)", interval_a, interval_b, statistics.median, args, rng, runs))
+
+    episodes = min(max(len(r) for r in runs_a), max(len(r) for r in runs_b))
+
+    for i in range(episodes):
+        latency_a = [v / 1000.0 for v in collect(runs_a, i, 'latency_us', None)]
+        latency_b = [v / 1000.0 for v in collect(runs_b, i, 'latency_us', None)]
+        rows.append(compare("episode %d: latency ms (median)" % i, latency_a, latency_b, statistics.median, args, rng, runs))
+
+        stall_a = collect(runs_a, i, 'stalls_us', mean)
+        stall_b = collect(runs_b, i, 'stalls_us', mean)
+        rows.append(compare("episode %d: stall/readback us (mean)" % i, stall_a, stall_b, mean, args, rng, runs))
+
+        interval_a = collect(runs_a, i, 'intervals_us', statistics.median)
+        interval_b = collect(runs_b, i, 'intervals_us', statistics.median)
+        rows.append(compare("episode %d: readback interval us (median)" % i, interval_a, interval_b, statistics.median, args, rng, runs))
+
+    print("A: %d run(s), B: %d run(s), %d aligned episode(s), %.0f%% bootstrap CI\n" % (
+        len(runs_a), len(runs_b), episodes, args.confidence * 100.0))
+    print("| metric | A | B | B - A | CI | verdict | n(A) | n(B) |")
+    print("|---|---:|---:|---:|---|---|---:|---:|")
+
+    regressions = 0
+    for row in rows:
+        if row is None:
+            continue
+        name, a, b, delta, lo, hi, verdict, na, nb = row
+        ci = "-" if verdict == "too few samples" else "[%+.3f, %+.3f]" % (lo, hi)
+        print("| %s | %.3f | %.3f | %+.3f | %s | %s | %d | %d |" % (
+            name, a, b, delta, ci, verdict, na, nb))
+        regressions += verdict == "regression"
+
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
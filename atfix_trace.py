@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Shared parsing helpers for atfix trace logs and replay summaries.
+
+Trace logs are written by the DLL when tracing is toggled with F9 (and by
+atfix_replay --dump-trace), replay summaries by atfix_replay/atfix_e2e --json.
+"""
+import json
+import re
+from collections import namedtuple
+
+LINE_RE = re.compile(r'^\[(\d+)\] (\w+)(.*)$')
+
+Call = namedtuple('Call', ['ts', 'kind', 'args'])
+
+
+def normalize_address(value):
+    """The logger prints pointers with an extra 0x prefix."""
+    while value.lower().startswith('0x0x'):
+        value = value[2:]
+    return value.lower()
+
+
+def parse_trace(path):
+    """Returns the list of calls in a trace log, in file order."""
+    calls = []
+    with open(path) as f:
+        for line in f:
+            if line.startswith('#'):
+                continue
+            match = LINE_RE.match(line.strip())
+            if not match:
+                continue
+            ts, kind, rest = match.groups()
+            args = {}
+            for token in rest.split():
+                key, sep, value = token.partition('=')
+                if not sep:
+                    continue
+                if key in ('res', 'src', 'dst'):
+                    value = normalize_address(value)
+                args[key] = value
+            calls.append(Call(int(ts), kind, args))
+    return calls
+
+
+def split_episodes(calls, gap_us):
+    """Splits calls into episodes (menu opens) separated by gaps > gap_us.
+
+    Same rule as core::EpisodeDetector."""
+    episodes = []
+    last_ts = None
+    for call in calls:
+        if last_ts is None or call.ts - last_ts > gap_us:
+            episodes.append([])
+        episodes[-1].append(call)
+        last_ts = call.ts
+    return episodes
+
+
+def is_readback(call):
+    return call.kind == 'Map' and call.args.get('type') in ('READ', 'READ_WRITE')
+
+
+def readback_stalls_us(episode):
+    """Estimates the stall of each readback in an episode.
+
+    Copies are logged before they are recorded and readbacks after Map
+    returns, so the copy -> map gap on the same staging texture bounds
+    the time the game spent waiting for the GPU."""
+    last_copy = {}
+    stalls = []
+    for call in episode:
+        if call.kind == 'CopySubresourceRegion':
+            last_copy[call.args.get('dst')] = call.ts
+        elif is_readback(call):
+            copy_ts = last_copy.pop(call.args.get('res'), None)
+            if copy_ts is not None:
+                stalls.append(call.ts - copy_ts)
+    return stalls
+
+
+EpisodeStats = namedtuple('EpisodeStats', ['latency_us', 'readbacks', 'stalls_us', 'intervals_us'])
+
+
+def trace_episode_stats(episode):
+    reads = [c.ts for c in episode if is_readback(c)]
+    return EpisodeStats(
+        latency_us=episode[-1].ts - episode[0].ts,
+        readbacks=len(reads),
+        stalls_us=readback_stalls_us(episode),
+        intervals_us=[b - a for a, b in zip(reads, reads[1:])])
+
+
+def summary_episode_stats(episode):
+    """Replay summaries only carry totals per episode, so the episode
+    contributes its average stall as a single sample, and there are no
+    readback intervals."""
+    readbacks = episode['readbacks']
+    stall_us = episode['readback_ns'] / 1000.0
+    return EpisodeStats(
+        latency_us=episode['duration_ns'] / 1000.0,
+        readbacks=readbacks,
+        stalls_us=[stall_us / readbacks] if readbacks else [],
+        intervals_us=[])
+
+
+def load_runs(path, gap_us):
+    """Loads a trace log or replay summary as a list of runs, each run
+    being a list of EpisodeStats."""
+    with open(path) as f:
+        head = f.read(1)
+
+    if head == '{':
+        with open(path) as f:
+            summary = json.load(f)
+        return [[summary_episode_stats(e) for e in run['episodes']]
+                for trace in summary['traces'] for run in trace['runs']]
+
+    episodes = split_episodes(parse_trace(path), gap_us)
+    return [[trace_episode_stats(e) for e in episodes]]
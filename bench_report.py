@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Compares benchmark results of two build directories.
+
+Reads microbench.json (atfix_microbench --json) and replay.json
+(atfix_replay/atfix_e2e --json FILE) from each directory, if present,
+and prints a table of baseline vs. candidate numbers.
+
+Usage: bench_report.py BASELINE_DIR CANDIDATE_DIR
+"""
+import json
+import os
+import statistics
+import sys
+
+
+def load(directory, name):
+    path = os.path.join(directory, name)
+    if not os.path.exists(path):
+        return None
+    with open(path) as f:
+        return json.load(f)
+
+
+def change(base, cand):
+    if not base:
+        return "n/a"
+    return "%+.1f%%" % ((cand - base) / base * 100.0)
+
+
+def report_microbench(base, cand):
+    base_by_name = {b['name']: b for b in base['benchmarks']}
+
+    print("| benchmark | baseline ns/op | candidate ns/op | change | significant |")
+    print("|---|---:|---:|---:|---|")
+
+    for c in cand['benchmarks']:
+        b = base_by_name.get(c['name'])
+        if not b:
+            continue
+        # Treat differences within the combined spread as noise
+        noise = 2.0 * (b['mad_ns'] + c['mad_ns'])
+        significant = abs(c['median_ns'] - b['median_ns']) > noise
+        print("| %s | %.2f ± %.2f | %.2f ± %.2f | %s | %s |" % (
+            c['name'], b['median_ns'], b['mad_ns'], c['median_ns'], c['mad_ns'],
+            change(b['median_ns'], c['median_ns']), "yes" if significant else "no"))
+
+
+def menu_open_latencies_ms(trace):
+    return [sum(e['duration_ns'] for e in run['episodes']) / 1.0e6 for run in trace['runs']]
+
+
+def report_replay(base, cand):
+    base_by_name = {t['name']: t for t in base['traces']}
+
+    print("| trace | baseline ms | candidate ms | change |")
+    print("|---|---:|---:|---:|")
+
+    for c in cand['traces']:
+        b = base_by_name.get(c['name'])
+        if not b:
+            continue
+        base_ms = statistics.median(menu_open_latencies_ms(b))
+        cand_ms = statistics.median(menu_open_latencies_ms(c))
+        print("| %s | %.3f | %.3f | %s |" % (
+            c['name'], base_ms, cand_ms, change(base_ms, cand_ms)))
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__.strip(), file=sys.stderr)
+        return 1
+
+    base_dir, cand_dir = sys.argv[1:]
+    print("# Benchmark report: %s vs. %s" % (base_dir, cand_dir))
+
+    for name, report in (("microbench.json", report_microbench), ("replay.json", report_replay)):
+        base = load(base_dir, name)
+        cand = load(cand_dir, name)
+        if base is None or cand is None:
+            continue
+        print("\n## %s\n" % name)
+        report(base, cand)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
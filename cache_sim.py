@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+"""Offline readback cache simulator.
+
+Replays the write payloads and readbacks of atfix traces against candidate
+cache policies. A readback is a hit if the payload that its staging texture
+holds, i.e. the checksum of the last write to the copy source, is already
+cached. Hits save the stall measured for that readback in the trace (the
+copy -> map gap); misses insert the payload.
+
+Policies: lru, lfu, arc, epoch (LRU that is emptied at every menu open).
+
+Usage: cache_sim.py [options] trace...
+"""
+import argparse
+import sys
+from collections import OrderedDict, defaultdict
+
+from atfix_trace import parse_trace, split_episodes, is_readback
+
+BYTES_PER_PIXEL = 4
+
+
+class LruCache:
+    def __init__(self, capacity):
+        self.capacity = capacity
+        self.entries = OrderedDict()
+
+    def lookup(self, key):
+        if key in self.entries:
+            self.entries.move_to_end(key)
+            return True
+        return False
+
+    def insert(self, key, size):
+        self.entries[key] = size
+        while len(self.entries) > self.capacity:
+            self.entries.popitem(last=False)
+
+    def new_epoch(self):
+        pass
+
+    def bytes_held(self):
+        return sum(self.entries.values())
+
+
+class EpochCache(LruCache):
+    def new_epoch(self):
+        self.entries.clear()
+
+
+class LfuCache:
+    """Least frequently used, ties broken by least recent use. Counts
+    are kept for evicted keys too, so that returning glyphs win."""
+    def __init__(self, capacity):
+        self.capacity = capacity
+        self.entries = OrderedDict()
+        self.counts = defaultdict(int)
+
+    def lookup(self, key):
+        self.counts[key] += 1
+        if key in self.entries:
+            self.entries.move_to_end(key)
+            return True
+        return False
+
+    def insert(self, key, size):
+        self.entries[key] = size
+        if len(self.entries) > self.capacity:
+            victim = min(self.entries, key=lambda k: self.counts[k])
+            del self.entries[victim]
+
+    def new_epoch(self):
+        pass
+
+    def bytes_held(self):
+        return sum(self.entries.values())
+
+
+class ArcCache:
+    """Adaptive replacement cache (Megiddo & Modha), balancing recency
+    (T1) and frequency (T2) with ghost lists B1 and B2."""
+    def __init__(self, capacity):
+        self.c = capacity
+        self.p = 0
+        self.t1, self.t2 = OrderedDict(), OrderedDict()
+        self.b1, self.b2 = OrderedDict(), OrderedDict()
+
+    def _replace(self, key):
+        if self.t1 and (len(self.t1) > self.p or (key in self.b2 and len(self.t1) == self.p)):
+            old, _ = self.t1.popitem(last=False)
+            self.b1[old] = None
+        else:
+            old, _ = self.t2.popitem(last=False)
+            self.b2[old] = None
+
+    def lookup(self, key):
+        if key in self.t1:
+            self.t2[key] = self.t1.pop(key)
+            return True
+        if key in self.t2:
+            self.t2.move_to_end(key)
+            return True
+        return False
+
+    def insert(self, key, size):
+        if key in self.b1:
+            self.p = min(self.c, self.p + max(len(self.b2) // max(len(self.b1), 1), 1))
+            self._replace(key)
+            del self.b1[key]
+            self.t2[key] = size
+            return
+        if key in self.b2:
+            self.p = max(0, self.p - max(len(self.b1) // max(len(self.b2), 1), 1))
+            self._replace(key)
+            del self.b2[key]
+            self.t2[key] = size
+            return
+        if len(self.t1) + len(self.b1) == self.c:
+            if len(self.t1) < self.c:
+                self.b1.popitem(last=False)
+                self._replace(key)
+            else:
+                self.t1.popitem(last=False)
+        elif len(self.t1) + len(self.b1) < self.c:
+            total = len(self.t1) + len(self.t2) + len(self.b1) + len(self.b2)
+            if total >= self.c:
+                if total == 2 * self.c:
+                    self.b2.popitem(last=False)
+                self._replace(key)
+        self.t1[key] = size
+
+    def new_epoch(self):
+        pass
+
+    def bytes_held(self):
+        return sum(self.t1.values()) + sum(self.t2.values())
+
+
+POLICIES = {
+    'lru': LruCache,
+    'lfu': LfuCache,
+    'arc': ArcCache,
+    'epoch': EpochCache,
+}
+
+
+def extract_readbacks(calls, gap_us):
+    """Returns (episode, payload key, bytes, stall_us) for every readback.
+    The key is None if the payload is unknown."""
+    readbacks = []
+    for index, episode in enumerate(split_episodes(calls, gap_us)):
+        written = {}     # dynamic texture -> checksum of last write
+        holds = {}       # staging texture -> payload key
+        sizes = {}
+        last_copy = {}
+        for call in episode:
+            args = call.args
+            if call.kind == 'Unmap' and 'checksum' in args:
+                written[args['res']] = args['checksum']
+            elif call.kind == 'CopySubresourceRegion':
+                dst = args.get('dst')
+                holds[dst] = written.get(args.get('src'))
+                last_copy[dst] = call.ts
+                w, _, h = args.get('srcDim', '0x0').partition('x')
+                sizes[dst] = int(w) * int(h) * BYTES_PER_PIXEL
+            elif is_readback(call):
+                res = args.get('res')
+                copy_ts = last_copy.pop(res, None)
+                stall = call.ts - copy_ts if copy_ts is not None else 0
+                readbacks.append((index, holds.get(res), sizes.get(res, 0), stall))
+    return readbacks
+
+
+def simulate(readbacks, policy, capacity):
+    cache = POLICIES[policy](capacity)
+    hits = 0
+    saved_us = 0
+    peak_bytes = 0
+    epoch = None
+    for index, key, size, stall in readbacks:
+        if index != epoch:
+            cache.new_epoch()
+            epoch = index
+        if key is None:
+            continue
+        if cache.lookup(key):
+            hits += 1
+            saved_us += stall
+        else:
+            cache.insert(key, size)
+            peak_bytes = max(peak_bytes, cache.bytes_held())
+    return hits, saved_us, peak_bytes
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__.strip().split('\n')[0],
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('traces', nargs='+', metavar='trace')
+    parser.add_argument('--policies', default='lru,lfu,arc,epoch', help='comma-separated policies (default all)')
+    parser.add_argument('--capacities', default='1,2,4,8,16,32,64,256', help='cache sizes in entries')
+    parser.add_argument('--episode-gap-ms', type=float, default=500.0, help='gap that separates episodes (default 500)')
+    args = parser.parse_args()
+
+    policies = args.policies.split(',')
+    for policy in policies:
+        if policy not in POLICIES:
+            parser.error("unknown policy '%s'" % policy)
+    capacities = [int(c) for c in args.capacities.split(',')]
+
+    for path in args.traces:
+        readbacks = extract_readbacks(parse_trace(path), args.episode_gap_ms * 1000.0)
+        known = [r for r in readbacks if r[1] is not None]
+        total_stall = sum(r[3] for r in readbacks)
+        distinct = len(set(r[1] for r in known))
+
+        print("%s: %d readbacks, %d with known payload, %d distinct payloads, %.1f ms total stall" % (
+            path, len(readbacks), len(known), distinct, total_stall / 1000.0))
+        if not readbacks:
+            continue
+
+        # Compulsory misses bound what any policy can achieve
+        print("  ideal: hit rate %.1f%%\n" % (100.0 * (len(known) - distinct) / len(readbacks)))
+        print("| policy | capacity | hit rate | peak MiB held | stall saved ms | stall saved |")
+        print("|---|---:|---:|---:|---:|---:|")
+
+        for policy in policies:
+            for capacity in capacities:
+                hits, saved_us, peak = simulate(readbacks, policy, capacity)
+                print("| %s | %d | %.1f%% | %.2f | %.1f | %.1f%% |" % (
+                    policy, capacity, 100.0 * hits / len(readbacks), peak / float(1 << 20),
+                    saved_us / 1000.0, 100.0 * saved_us / total_stall if total_stall else 0.0))
+        print()
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "../minimal_d3d11_dll/d3d11_proxy.h"
+
+#include "replay_cli.h"
+
+using namespace atfix;
+
+using PFN_D3D11CreateDevice = HRESULT (__stdcall *) (
+  IDXGIAdapter*, D3D_DRIVER_TYPE, HMODULE, UINT, const D3D_FEATURE_LEVEL*,
+  UINT, UINT, ID3D11Device**, D3D_FEATURE_LEVEL*, ID3D11DeviceContext**);
+
+std::string getApplicationDir() {
+  char path[MAX_PATH + 1] = { };
+
+  DWORD length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+  std::string result(path, length);
+
+  size_t split = result.find_last_of("\\/");
+  return split != std::string::npos ? result.substr(0, split + 1) : std::string();
+}
+
+template<typename T>
+T getProc(HMODULE module, const char* pName) {
+  return reinterpret_cast<T>(GetProcAddress(module, pName));
+}
+
+int main(int argc, char** argv) {
+  bench::ReplayArgs args;
+
+  if (!bench::parseReplayArgs(argc, argv, args)) {
+    bench::printReplayUsage(argv[0],
+      "Replays atfix traces through the atfix d3d11.dll and the fake\n"
+      "d3d11_proxy.dll backend, both loaded from the executable's directory.\n"
+      "Under wine, run with WINEDLLOVERRIDES=d3d11=n.");
+    return 1;
+  }
+
+  std::vector<bench::NamedTrace> traces;
+  int status = bench::loadReplayTraces(args, traces) ? 0 : 1;
+
+  /* Without hooks, talk to the backend directly */
+  std::string dllPath = getApplicationDir()
+    + (args.installHooks ? "d3d11.dll" : "d3d11_proxy.dll");
+
+  HMODULE d3d11 = LoadLibraryA(dllPath.c_str());
+
+  if (!d3d11) {
+    std::fprintf(stderr, "Failed to load %s\n", dllPath.c_str());
+    return 1;
+  }
+
+  auto createDevice = getProc<PFN_D3D11CreateDevice>(d3d11, "D3D11CreateDevice");
+
+  if (!createDevice) {
+    std::fprintf(stderr, "D3D11CreateDevice not found in %s\n", dllPath.c_str());
+    return 1;
+  }
+
+  ID3D11Device* device = nullptr;
+  ID3D11DeviceContext* context = nullptr;
+
+  HRESULT hr = (*createDevice)(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, 0,
+    nullptr, 0, D3D11_SDK_VERSION, &device, nullptr, &context);
+
+  if (FAILED(hr)) {
+    std::fprintf(stderr, "D3D11CreateDevice failed with 0x%lx\n", (unsigned long)hr);
+    return 1;
+  }
+
+  /* If d3d11.dll did not forward to the fake backend, we
+   * are either hitting the system D3D11 or wine's builtin */
+  HMODULE proxy = GetModuleHandleA("d3d11_proxy.dll");
+
+  if (!proxy) {
+    std::fprintf(stderr, "Device was not created by d3d11_proxy.dll\n");
+    return 1;
+  }
+
+  auto setConfig = getProc<PFN_MockSetConfig>(proxy, "MockSetConfig");
+  auto getStats = getProc<PFN_MockGetStats>(proxy, "MockGetStats");
+  auto resetStats = getProc<PFN_MockResetStats>(proxy, "MockResetStats");
+  auto waitForIdle = getProc<PFN_MockWaitForIdle>(proxy, "MockWaitForIdle");
+
+  if (!setConfig || !getStats || !resetStats || !waitForIdle) {
+    std::fprintf(stderr, "d3d11_proxy.dll does not export the mock controls\n");
+    return 1;
+  }
+
+  (*setConfig)(device, &args.mock);
+
+  bench::MockControl control;
+  control.getStats = [device, getStats] {
+    mock::MockStats stats;
+    (*getStats)(device, &stats);
+    return stats;
+  };
+  control.resetStats = [device, resetStats] { (*resetStats)(device); };
+  control.waitForIdle = [device, waitForIdle] { (*waitForIdle)(device); };
+
+  status = std::max(status, bench::runReplays(device, context, args, traces, control));
+
+  context->Release();
+  device->Release();
+  return status;
+}
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "microbench.h"
+
+namespace atfix::bench {
+
+using Clock = std::chrono::steady_clock;
+
+double getMedian(std::vector<double> values) {
+  if (values.empty())
+    return 0.0;
+
+  std::sort(values.begin(), values.end());
+  size_t n = values.size();
+
+  return (n & 1)
+    ? values[n / 2]
+    : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+MicroBench::MicroBench(const MicroBenchOptions& options)
+: m_options(options) {
+
+}
+
+bool MicroBench::isEnabled(const std::string& name) const {
+  return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+}
+
+void MicroBench::run(const std::string& name, uint64_t bytesPerOp, const Fn& fn) {
+  if (!isEnabled(name))
+    return;
+
+  auto measure = [&fn] (uint64_t ops) {
+    auto t0 = Clock::now();
+    fn(ops);
+    auto t1 = Clock::now();
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+  };
+
+  /* Calibrate the op count so that timer resolution and
+   * per-sample overhead do not matter */
+  uint64_t ops = 1;
+
+  while (measure(ops) < m_options.minSampleNs && ops < (1ull << 40))
+    ops *= 2;
+
+  for (uint32_t i = 0; i < m_options.warmupSamples; i++)
+    measure(ops);
+
+  std::vector<double> perOp;
+  perOp.reserve(m_options.samples);
+
+  for (uint32_t i = 0; i < std::max(m_options.samples, 1u); i++)
+    perOp.push_back(double(measure(ops)) / double(ops));
+
+  MicroBenchResult result;
+  result.name = name;
+  result.opsPerSample = ops;
+  result.samples = uint32_t(perOp.size());
+  result.medianNs = getMedian(perOp);
+  result.minNs = *std::min_element(perOp.begin(), perOp.end());
+  result.maxNs = *std::max_element(perOp.begin(), perOp.end());
+  result.bytesPerOp = bytesPerOp;
+
+  std::vector<double> deviations;
+  deviations.reserve(perOp.size());
+
+  for (double v : perOp)
+    deviations.push_back(std::abs(v - result.medianNs));
+
+  result.madNs = getMedian(std::move(deviations));
+
+  m_results.push_back(result);
+}
+
+void printMicroBenchText(std::FILE* file, const std::vector<MicroBenchResult>& results) {
+  std::fprintf(file, "%-40s %12s %10s %12s %12s\n",
+    "benchmark", "median ns", "mad ns", "ops/sample", "MiB/s");
+
+  for (const auto& r : results) {
+    std::fprintf(file, "%-40s %12.2f %10.2f %12llu",
+      r.name.c_str(), r.medianNs, r.madNs, (unsigned long long)r.opsPerSample);
+
+    if (r.bytesPerOp && r.medianNs > 0.0)
+      std::fprintf(file, " %12.1f", double(r.bytesPerOp) / r.medianNs * 1.0e9 / double(1u << 20));
+
+    std::fprintf(file, "\n");
+  }
+}
+
+void printMicroBenchJson(std::FILE* file, const std::vector<MicroBenchResult>& results) {
+  std::fprintf(file, "{\n  \"benchmarks\": [");
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto& r = results[i];
+
+    std::fprintf(file, "%s\n    { \"name\": \"%s\", \"samples\": %u, \"ops_per_sample\": %llu, "
+      "\"median_ns\": %.3f, \"mad_ns\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f, \"bytes_per_op\": %llu }",
+      i ? "," : "", r.name.c_str(), r.samples, (unsigned long long)r.opsPerSample,
+      r.medianNs, r.madNs, r.minNs, r.maxNs, (unsigned long long)r.bytesPerOp);
+  }
+
+  std::fprintf(file, "\n  ]\n}\n");
+}
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace atfix::bench {
+
+struct MicroBenchOptions {
+  /** Samples that are run and discarded before measuring */
+  uint32_t    warmupSamples = 5;
+  /** Measured samples per benchmark */
+  uint32_t    samples       = 31;
+  /** Minimum duration of a sample, used to calibrate the op count */
+  uint64_t    minSampleNs   = 2000000;
+  /** Only run benchmarks whose name contains this string */
+  std::string filter;
+};
+
+/**
+ * \brief Result of a single benchmark
+ *
+ * All times are per operation.
+ */
+struct MicroBenchResult {
+  std::string name;
+  uint64_t    opsPerSample  = 0;
+  uint32_t    samples       = 0;
+  double      medianNs      = 0.0;
+  /** Median absolute deviation from the median */
+  double      madNs         = 0.0;
+  double      minNs         = 0.0;
+  double      maxNs         = 0.0;
+  /** Bytes processed per operation, zero if not applicable */
+  uint64_t    bytesPerOp    = 0;
+};
+
+/**
+ * \brief Runs benchmarks and collects robust statistics
+ *
+ * Each benchmark is a function that performs a given number
+ * of operations. The op count is doubled until one call takes
+ * at least the minimum sample time, then a number of warmup
+ * samples is discarded and the per-op time of the remaining
+ * samples is summarized by median and MAD, which unlike mean
+ * and standard deviation are not skewed by the occasional
+ * preempted sample.
+ */
+class MicroBench {
+
+public:
+
+  using Fn = std::function<void (uint64_t)>;
+
+  MicroBench(const MicroBenchOptions& options);
+
+  /**
+   * \brief Checks whether a benchmark passes the filter
+   */
+  bool isEnabled(const std::string& name) const;
+
+  /**
+   * \brief Runs a benchmark if it passes the filter
+   *
+   * \param [in] name Benchmark name, as group/name
+   * \param [in] bytesPerOp Bytes processed per operation
+   * \param [in] fn Function running the given number of operations
+   */
+  void run(const std::string& name, uint64_t bytesPerOp, const Fn& fn);
+
+  const std::vector<MicroBenchResult>& getResults() const {
+    return m_results;
+  }
+
+private:
+
+  MicroBenchOptions             m_options;
+  std::vector<MicroBenchResult> m_results;
+
+};
+
+/**
+ * \brief Prints results as a table
+ */
+void printMicroBenchText(std::FILE* file, const std::vector<MicroBenchResult>& results);
+
+/**
+ * \brief Prints results as JSON
+ *
+ * Produces a single object with a \c benchmarks array, one
+ * object per benchmark with times in nanoseconds per op.
+ */
+void printMicroBenchJson(std::FILE* file, const std::vector<MicroBenchResult>& results);
+
+/**
+ * \brief Keeps a value from being optimized out
+ */
+template<typename T>
+void doNotOptimize(const T& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+}
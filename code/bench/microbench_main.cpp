@@ -0,0 +1,344 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../generation.h"
+#include "../impl.h"
+#include "../trace.h"
+
+#include "../core/readback_cache.h"
+#include "../core/trace_format.h"
+
+#include "../mock/mock_d3d11.h"
+
+#include "microbench.h"
+#include "payload.h"
+
+using namespace atfix;
+
+void printUsage(const char* pName) {
+  std::fprintf(stderr,
+    "Usage: %s [options]\n"
+    "\n"
+    "Runs atfix hot path microbenchmarks against the mock device.\n"
+    "\n"
+    "  --filter STR           Only run benchmarks whose name contains STR\n"
+    "  --samples N            Measured samples per benchmark (default 31)\n"
+    "  --warmup N             Discarded warmup samples (default 5)\n"
+    "  --min-sample-us N      Minimum duration of a sample (default 2000)\n"
+    "  --json                 Print results as JSON\n",
+    pName);
+}
+
+ID3D11Texture2D* createTexture(ID3D11Device* pDevice, UINT width, UINT height, D3D11_USAGE usage) {
+  D3D11_TEXTURE2D_DESC desc = { };
+  desc.Width = width;
+  desc.Height = height;
+  desc.MipLevels = 1;
+  desc.ArraySize = 1;
+  desc.Format = DXGI_FORMAT_B8G8R8A8_TYPELESS;
+  desc.SampleDesc = { 1, 0 };
+  desc.Usage = usage;
+
+  if (usage == D3D11_USAGE_DYNAMIC) {
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+  } else if (usage == D3D11_USAGE_STAGING) {
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+  }
+
+  ID3D11Texture2D* texture = nullptr;
+
+  if (FAILED(pDevice->CreateTexture2D(&desc, nullptr, &texture))) {
+    std::fprintf(stderr, "Failed to create %ux%u texture\n", width, height);
+    std::exit(1);
+  }
+
+  return texture;
+}
+
+void runContextBenchmarks(bench::MicroBench& bench, const char* pSuffix,
+    ID3D11DeviceContext* pContext, ID3D11Texture2D* pDynamic, ID3D11Texture2D* pStaging) {
+  std::string suffix = pSuffix;
+
+  bench.run("hook/map_unmap_write/" + suffix, 0, [=] (uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+      D3D11_MAPPED_SUBRESOURCE sr;
+      pContext->Map(pDynamic, 0, D3D11_MAP_WRITE_DISCARD, 0, &sr);
+      pContext->Unmap(pDynamic, 0);
+    }
+  });
+
+  bench.run("hook/map_unmap_read/" + suffix, 0, [=] (uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+      D3D11_MAPPED_SUBRESOURCE sr;
+      pContext->Map(pStaging, 0, D3D11_MAP_READ, 0, &sr);
+      pContext->Unmap(pStaging, 0);
+    }
+  });
+
+  /* Copies are queued until the next flush, so flush in batches
+   * to keep the mock's command list from growing unbounded */
+  bench.run("hook/copy_subresource_region/" + suffix, 0, [=] (uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+      pContext->CopySubresourceRegion(pStaging, 0, 0, 0, 0, pDynamic, 0, nullptr);
+
+      if (!(i & 1023))
+        pContext->Flush();
+    }
+
+    pContext->Flush();
+  });
+}
+
+void runTrackerBenchmarks(bench::MicroBench& bench, ID3D11Texture2D* pStaging) {
+  std::vector<uint32_t> objects(64);
+
+  bench.run("tracker/resource_key", 0, [pStaging] (uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++)
+      bench::doNotOptimize(getResourceKey(pStaging));
+  });
+
+  bench.run("tracker/staging_track_untrack", 0, [&objects] (uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+      core::ResourceKey object = { &objects[i % objects.size()], 1u };
+      trackStagingTexture(object);
+      bench::doNotOptimize(isStagingTextureTracked(object));
+      untrackStagingTexture(object);
+    }
+  });
+
+  uint32_t pixel = 0xdeadbeef;
+
+  D3D11_MAPPED_SUBRESOURCE mapped = { &pixel, 4u, 4u };
+  SubresourceLayout layout = { 4u, 1u, 1u };
+
+  bench.run("tracker/mapped_data_checksum_1x1", 0, [&objects, &mapped, &layout] (uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+      core::ResourceKey object = { &objects[i % objects.size()], 1u };
+      trackMappedTextureData(object, mapped, layout);
+      bench::doNotOptimize(getAndClearMappedChecksum(object));
+    }
+  });
+}
+
+void runChecksumBenchmarks(bench::MicroBench& bench) {
+  for (UINT size : { 64u, 512u }) {
+    std::vector<uint8_t> data(size * size * 4);
+
+    for (size_t i = 0; i < data.size(); i++)
+      data[i] = uint8_t(i * 0x9e3779b1u >> 24);
+
+    D3D11_MAPPED_SUBRESOURCE mapped = { data.data(), size * 4, size * size * 4 };
+    SubresourceLayout layout = { size * 4, size, 1u };
+
+    bench.run("checksum/" + std::to_string(size) + "x" + std::to_string(size), data.size(),
+      [&mapped, &layout] (uint64_t ops) {
+        for (uint64_t i = 0; i < ops; i++)
+          bench::doNotOptimize(calculateTextureChecksum(mapped, layout));
+      });
+
+    bench.run("checksum/hash_" + std::to_string(size) + "x" + std::to_string(size), data.size(),
+      [&mapped, &layout] (uint64_t ops) {
+        for (uint64_t i = 0; i < ops; i++)
+          bench::doNotOptimize(calculateTextureHash(mapped, layout));
+      });
+  }
+}
+
+void runImageBenchmarks(bench::MicroBench& bench) {
+  constexpr UINT size = 512;
+
+  std::vector<uint8_t> glyph(size * size * 4);
+  std::vector<uint8_t> output(glyph.size());
+
+  D3D11_MAPPED_SUBRESOURCE mapped = { };
+  mapped.pData = glyph.data();
+  mapped.RowPitch = size * 4;
+  bench::writeGlyphPayload(1, mapped, size, size);
+
+  bench.run("image/compress_glyph_512x512", glyph.size(), [&glyph] (uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++)
+      bench::doNotOptimize(core::createReadbackImage(glyph.data(), size * 4, size * 4, size));
+  });
+
+  auto image = core::createReadbackImage(glyph.data(), size * 4, size * 4, size);
+
+  bench.run("image/decompress_glyph_512x512", glyph.size(), [&image, &output] (uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+      core::decompressReadbackImage(*image, output.data(), size * 4);
+      bench::doNotOptimize(output[0]);
+    }
+  });
+
+  bench.run("image/copy_512x512", glyph.size(), [&glyph, &output] (uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+      std::memcpy(output.data(), glyph.data(), glyph.size());
+      bench::doNotOptimize(output[0]);
+    }
+  });
+}
+
+void runTraceBenchmarks(bench::MicroBench& bench,
+    ID3D11DeviceContext* pContext, ID3D11Texture2D* pStaging) {
+  const char* filename = "atfix_microbench_trace.log";
+
+  bench.run("trace/timestamp", 0, [] (uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++)
+      bench::doNotOptimize(getLogTimestampUs());
+  });
+
+  core::ResourceDesc dstDesc;
+  dstDesc.width = 512;
+  dstDesc.height = 512;
+  dstDesc.usage = core::Usage::Staging;
+  dstDesc.cpuAccessFlags = D3D11_CPU_ACCESS_READ;
+  dstDesc.format = DXGI_FORMAT_B8G8R8A8_TYPELESS;
+
+  core::ResourceDesc srcDesc = dstDesc;
+  srcDesc.usage = core::Usage::Dynamic;
+  srcDesc.cpuAccessFlags = D3D11_CPU_ACCESS_WRITE;
+  srcDesc.bindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+  bench.run("trace/format_map_line", 0, [&dstDesc, pStaging] (uint64_t ops) {
+    uint32_t checksum = 0x918f3024;
+
+    for (uint64_t i = 0; i < ops; i++) {
+      bench::doNotOptimize(core::formatMapLine(i, pStaging, 0,
+        core::MapType::Read, dstDesc, &checksum));
+    }
+  });
+
+  bench.run("trace/format_copy_line", 0, [&dstDesc, &srcDesc, pStaging] (uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+      bench::doNotOptimize(core::formatCopyLine(i, pStaging, 0, 0, 0, 0, dstDesc,
+        pStaging, 0, srcDesc, nullptr));
+    }
+  });
+
+  if (!bench.isEnabled("trace/map_unmap_read_logged"))
+    return;
+
+  if (!startTraceLogging(filename)) {
+    std::fprintf(stderr, "Failed to start trace logging\n");
+    return;
+  }
+
+  /* Map(READ) on a staging texture formats and writes two trace
+   * lines, the texture is tiny so that the checksum is negligible */
+  bench.run("trace/map_unmap_read_logged", 0, [=] (uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+      D3D11_MAPPED_SUBRESOURCE sr;
+      pContext->Map(pStaging, 0, D3D11_MAP_READ, 0, &sr);
+      pContext->Unmap(pStaging, 0);
+    }
+  });
+
+  stopTraceLogging();
+  std::remove(filename);
+}
+
+void runLogBenchmarks(bench::MicroBench& bench) {
+  const char* filename = "atfix_microbench.log";
+
+  for (uint32_t threads : { 1u, 2u, 4u }) {
+    std::string name = "log/contention_" + std::to_string(threads) + "t";
+
+    if (!bench.isEnabled(name))
+      continue;
+
+    Log benchLog(filename);
+
+    /* Reports the time per message across all threads */
+    bench.run(name, 0, [&benchLog, threads] (uint64_t ops) {
+      std::vector<std::thread> workers;
+
+      for (uint32_t t = 0; t < threads; t++) {
+        workers.emplace_back([&benchLog, ops, threads, t] {
+          for (uint64_t i = t; i < ops; i += threads)
+            benchLog("Created hook for ID3D11DeviceContext::Map @ ", i);
+        });
+      }
+
+      for (auto& worker : workers)
+        worker.join();
+    });
+  }
+
+  std::remove(filename);
+}
+
+int main(int argc, char** argv) {
+  bench::MicroBenchOptions options;
+  bool json = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    auto nextValue = [&] () {
+      return uint64_t(std::strtoull(argv[++i], nullptr, 10));
+    };
+
+    if (arg == "--filter" && hasValue)
+      options.filter = argv[++i];
+    else if (arg == "--samples" && hasValue)
+      options.samples = uint32_t(nextValue());
+    else if (arg == "--warmup" && hasValue)
+      options.warmupSamples = uint32_t(nextValue());
+    else if (arg == "--min-sample-us" && hasValue)
+      options.minSampleNs = nextValue() * 1000u;
+    else if (arg == "--json")
+      json = true;
+    else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  MH_Initialize();
+
+  ID3D11Device* device = nullptr;
+  ID3D11DeviceContext* context = nullptr;
+
+  if (FAILED(mock::createMockDevice(mock::MockConfig(), &device, &context))) {
+    std::fprintf(stderr, "Failed to create mock device\n");
+    return 1;
+  }
+
+  ID3D11Texture2D* dynamic = createTexture(device, 4, 4, D3D11_USAGE_DYNAMIC);
+  ID3D11Texture2D* staging = createTexture(device, 4, 4, D3D11_USAGE_STAGING);
+
+  bench::MicroBench bench(options);
+
+  /* Hooks cannot be removed again, so measure the bare
+   * mock first and then the same calls through the hooks */
+  runContextBenchmarks(bench, "direct", context, dynamic, staging);
+
+  hookDevice(device);
+  hookContext(context);
+
+  runContextBenchmarks(bench, "hooked", context, dynamic, staging);
+  runTrackerBenchmarks(bench, staging);
+  runChecksumBenchmarks(bench);
+  runImageBenchmarks(bench);
+  runTraceBenchmarks(bench, context, staging);
+  runLogBenchmarks(bench);
+
+  if (json)
+    bench::printMicroBenchJson(stdout, bench.getResults());
+  else
+    bench::printMicroBenchText(stdout, bench.getResults());
+
+  staging->Release();
+  dynamic->Release();
+  context->Release();
+  device->Release();
+
+  shutdownTraceLogging();
+  MH_Uninitialize();
+  return 0;
+}
@@ -0,0 +1,69 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "mock_args.h"
+
+namespace atfix::bench {
+
+mock::MockConfig getDefaultMockConfig() {
+  mock::MockConfig config;
+  config.submitDelayNs = 100000;
+  config.gpuCopyNs = 20000;
+  config.gpuCopyNsPerMiB = 400000;
+  return config;
+}
+
+bool parseMockArg(int argc, char** argv, int& index, mock::MockConfig& config) {
+  struct MockArg {
+    const char* name;
+    uint64_t mock::MockConfig::*field;
+  };
+
+  static const MockArg s_args[] = {
+    { "--map-cost-us",          &mock::MockConfig::mapCostNs        },
+    { "--unmap-cost-us",        &mock::MockConfig::unmapCostNs      },
+    { "--copy-cost-us",         &mock::MockConfig::copyCostNs       },
+    { "--flush-cost-us",        &mock::MockConfig::flushCostNs      },
+    { "--submit-delay-us",      &mock::MockConfig::submitDelayNs    },
+    { "--gpu-copy-us",          &mock::MockConfig::gpuCopyNs        },
+    { "--gpu-copy-us-per-mib",  &mock::MockConfig::gpuCopyNsPerMiB  },
+  };
+
+  if (index + 1 >= argc)
+    return false;
+
+  std::string arg = argv[index];
+
+  for (const auto& entry : s_args) {
+    if (arg == entry.name) {
+      config.*entry.field = uint64_t(std::strtoull(argv[++index], nullptr, 10)) * 1000u;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void printMockArgUsage() {
+  mock::MockConfig defaults = getDefaultMockConfig();
+
+  std::fprintf(stderr,
+    "GPU model:\n"
+    "  --submit-delay-us N      Delay between submission and GPU start (default %llu)\n"
+    "  --gpu-copy-us N          Fixed GPU time per copy (default %llu)\n"
+    "  --gpu-copy-us-per-mib N  GPU time per MiB copied (default %llu)\n"
+    "  --flush-cost-us N        CPU cost per submission (default %llu)\n"
+    "  --map-cost-us N          CPU cost per Map call (default %llu)\n"
+    "  --unmap-cost-us N        CPU cost per Unmap call (default %llu)\n"
+    "  --copy-cost-us N         CPU cost per recorded copy (default %llu)\n",
+    (unsigned long long)(defaults.submitDelayNs / 1000u),
+    (unsigned long long)(defaults.gpuCopyNs / 1000u),
+    (unsigned long long)(defaults.gpuCopyNsPerMiB / 1000u),
+    (unsigned long long)(defaults.flushCostNs / 1000u),
+    (unsigned long long)(defaults.mapCostNs / 1000u),
+    (unsigned long long)(defaults.unmapCostNs / 1000u),
+    (unsigned long long)(defaults.copyCostNs / 1000u));
+}
+
+}
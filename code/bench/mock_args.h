@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../mock/mock_d3d11.h"
+
+namespace atfix::bench {
+
+/**
+ * \brief Mock latency model used by the benchmark tools
+ *
+ * Roughly calibrated to the Meruru DX measurements, where a
+ * 512x512 glyph readback blocks for about 0.52 ms on average.
+ */
+mock::MockConfig getDefaultMockConfig();
+
+/**
+ * \brief Parses a mock latency option
+ *
+ * \param [in] argc Argument count
+ * \param [in] argv Arguments
+ * \param [in,out] index Current argument, advanced
+ *    past the value if the option was consumed
+ * \param [in,out] config Latency model to update
+ * \returns \c true if the argument was a mock option
+ */
+bool parseMockArg(int argc, char** argv, int& index, mock::MockConfig& config);
+
+/**
+ * \brief Prints usage of the mock latency options
+ */
+void printMockArgUsage();
+
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cstring>
+
+#include "payload.h"
+
+namespace atfix::bench {
+
+constexpr UINT GlyphWidth   = 24;
+constexpr UINT GlyphHeight  = 32;
+
+struct GlyphRect {
+  UINT x, y, w, h;
+};
+
+uint64_t mixSeed(uint64_t x) {
+  /* splitmix64 finalizer */
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+GlyphRect getGlyphRect(uint64_t seed, UINT width, UINT height) {
+  GlyphRect rect;
+  rect.w = std::min(GlyphWidth, width);
+  rect.h = std::min(GlyphHeight, height);
+
+  uint64_t pos = mixSeed(seed);
+  rect.x = UINT(pos % (width - rect.w + 1));
+  rect.y = UINT((pos >> 32) % (height - rect.h + 1));
+  return rect;
+}
+
+uint32_t getGlyphPixel(uint64_t seed, UINT x, UINT y) {
+  return uint32_t(mixSeed(seed ^ (uint64_t(y) << 32) ^ x)) | 0xff000000u;
+}
+
+void writeGlyphPayload(
+        uint64_t                  seed,
+  const D3D11_MAPPED_SUBRESOURCE& mapped,
+        UINT                      width,
+        UINT                      height) {
+  auto data = static_cast<uint8_t*>(mapped.pData);
+  GlyphRect rect = getGlyphRect(seed, width, height);
+
+  for (UINT y = 0; y < height; y++)
+    std::memset(data + y * mapped.RowPitch, 0, width * sizeof(uint32_t));
+
+  for (UINT y = 0; y < rect.h; y++) {
+    auto row = reinterpret_cast<uint32_t*>(data + (rect.y + y) * mapped.RowPitch);
+
+    for (UINT x = 0; x < rect.w; x++)
+      row[rect.x + x] = getGlyphPixel(seed, x, y);
+  }
+}
+
+bool checkGlyphPayload(
+        uint64_t                  seed,
+  const D3D11_MAPPED_SUBRESOURCE& mapped,
+        UINT                      width,
+        UINT                      height,
+        UINT                      rowCount) {
+  auto data = static_cast<const uint8_t*>(mapped.pData);
+  GlyphRect rect = getGlyphRect(seed, width, height);
+
+  for (UINT y = 0; y < rowCount; y++) {
+    auto row = reinterpret_cast<const uint32_t*>(data + y * mapped.RowPitch);
+    bool glyphRow = y >= rect.y && y < rect.y + rect.h;
+
+    for (UINT x = 0; x < width; x++) {
+      uint32_t expected = 0u;
+
+      if (glyphRow && x >= rect.x && x < rect.x + rect.w)
+        expected = getGlyphPixel(seed, x - rect.x, y - rect.y);
+
+      if (row[x] != expected)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+}
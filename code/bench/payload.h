@@ -0,0 +1,51 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <d3d11.h>
+
+#include <cstdint>
+
+namespace atfix::bench {
+
+/**
+ * \brief Writes a synthetic glyph image
+ *
+ * Mimics what the game uploads into its DYNAMIC glyph textures:
+ * a mostly transparent image with a small opaque block whose
+ * position and contents are derived from the seed. Equal seeds
+ * produce bit-identical images, so content-based strategies see
+ * the same payload reuse as in the recorded trace. Assumes a
+ * 32-bit pixel format, which is what the glyph textures use.
+ * \param [in] seed Payload seed
+ * \param [in] mapped Mapped subresource to write to
+ * \param [in] width Width in pixels
+ * \param [in] height Height in pixels
+ */
+void writeGlyphPayload(
+        uint64_t                  seed,
+  const D3D11_MAPPED_SUBRESOURCE& mapped,
+        UINT                      width,
+        UINT                      height);
+
+/**
+ * \brief Checks whether mapped data matches a glyph payload
+ *
+ * Only reads the given number of rows, so that consumers which
+ * inspect part of a readback can be modelled.
+ * \param [in] seed Payload seed
+ * \param [in] mapped Mapped subresource to compare
+ * \param [in] width Width in pixels
+ * \param [in] height Height in pixels
+ * \param [in] rowCount Number of rows to compare
+ * \returns \c true if the first rows are identical to what
+ *    \c writeGlyphPayload would produce for the seed
+ */
+bool checkGlyphPayload(
+        uint64_t                  seed,
+  const D3D11_MAPPED_SUBRESOURCE& mapped,
+        UINT                      width,
+        UINT                      height,
+        UINT                      rowCount);
+
+}
@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "mock_args.h"
+#include "replay_cli.h"
+
+namespace atfix::bench {
+
+bool parseReplayDimension(const std::string& str, ReplayDimension* pDimension) {
+  if (str == "buffer")  { *pDimension = ReplayDimension::Buffer;     return true; }
+  if (str == "1d")      { *pDimension = ReplayDimension::Texture1D;  return true; }
+  if (str == "2d")      { *pDimension = ReplayDimension::Texture2D;  return true; }
+  if (str == "3d")      { *pDimension = ReplayDimension::Texture3D;  return true; }
+  return false;
+}
+
+bool parseReplayUpload(const std::string& str, ReplayUpload* pUpload) {
+  if (str == "map")     { *pUpload = ReplayUpload::Map;      return true; }
+  if (str == "update")  { *pUpload = ReplayUpload::Update;   return true; }
+  if (str == "update1") { *pUpload = ReplayUpload::Update1;  return true; }
+  return false;
+}
+
+bool parseReplayArgs(int argc, char** argv, ReplayArgs& args) {
+  args.mock = getDefaultMockConfig();
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    auto nextValue = [&] () {
+      return uint64_t(std::strtoull(argv[++i], nullptr, 10));
+    };
+
+    if (arg == "--realtime")
+      args.options.realtime = true;
+    else if (arg == "--max-speed")
+      args.options.realtime = false;
+    else if (arg == "--no-hooks")
+      args.installHooks = false;
+    else if (arg == "--verify")
+      args.options.verify = true;
+    else if (arg == "--deferred")
+      args.options.deferred = true;
+    else if (arg == "--dimension" && hasValue) {
+      if (!parseReplayDimension(argv[++i], &args.options.dimension))
+        return false;
+    } else if (arg == "--upload" && hasValue) {
+      if (!parseReplayUpload(argv[++i], &args.options.upload))
+        return false;
+    } else if (arg == "--read-rows" && hasValue)
+      args.options.readRows = uint32_t(nextValue());
+    else if (arg == "--repeat" && hasValue)
+      args.repeat = std::max(1u, uint32_t(nextValue()));
+    else if (arg == "--episode-gap-ms" && hasValue)
+      args.options.episodeGapUs = nextValue() * 1000u;
+    else if (arg == "--synthetic")
+      args.synthetic = true;
+    else if (arg == "--dump-trace" && hasValue)
+      args.dumpFile = argv[++i];
+    else if (arg == "--json" && hasValue)
+      args.jsonFile = argv[++i];
+    else if (parseMockArg(argc, argv, i, args.mock)
+          || parseWorkloadArg(argc, argv, i, args.workload))
+      continue;
+    else if (arg[0] == '-')
+      return false;
+    else
+      args.files.push_back(arg);
+  }
+
+  return args.synthetic || !args.files.empty();
+}
+
+void printReplayUsage(const char* pName, const char* pDescription) {
+  std::fprintf(stderr,
+    "Usage: %s [options] [trace...]\n"
+    "\n"
+    "%s\n"
+    "\n"
+    "  --realtime               Honor recorded timestamps\n"
+    "  --max-speed              Replay without gaps between calls (default)\n"
+    "  --no-hooks               Do not install hooks, for baseline numbers\n"
+    "  --verify                 Check readback data against copy sources\n"
+    "  --deferred               Record uploads and copies on a deferred context\n"
+    "  --dimension DIM          Replay with buffer, 1d, 2d or 3d resources (default 2d)\n"
+    "  --upload CALL            Upload with map, update or update1 (default map)\n"
+    "  --read-rows N            Only read and check the first N rows (default all)\n"
+    "  --repeat N               Replay each trace N times (default 1)\n"
+    "  --episode-gap-ms N       Gap that separates episodes (default 500)\n"
+    "  --synthetic              Replay a generated workload instead of a trace\n"
+    "  --dump-trace FILE        Write the generated workload to FILE\n"
+    "  --json FILE              Write a JSON summary of all runs to FILE\n"
+    "\n", pName, pDescription);
+
+  printMockArgUsage();
+  std::fprintf(stderr, "\n");
+  printWorkloadArgUsage();
+}
+
+bool loadReplayTraces(const ReplayArgs& args, std::vector<NamedTrace>& traces) {
+  bool success = true;
+
+  if (args.synthetic) {
+    Trace trace = generateWorkload(args.workload);
+
+    if (!args.dumpFile.empty()) {
+      std::ofstream stream(args.dumpFile);
+
+      if (!stream) {
+        std::fprintf(stderr, "Failed to open %s\n", args.dumpFile.c_str());
+        return false;
+      }
+
+      writeTrace(stream, trace);
+    }
+
+    traces.emplace_back("synthetic", std::move(trace));
+  }
+
+  for (const auto& file : args.files) {
+    std::ifstream stream(file);
+
+    if (!stream) {
+      std::fprintf(stderr, "Failed to open %s\n", file.c_str());
+      success = false;
+      continue;
+    }
+
+    traces.emplace_back(file, parseTrace(stream));
+  }
+
+  return success;
+}
+
+void writeReplayJson(std::FILE* file, const ReplayResult& result, const mock::MockStats& stats) {
+  std::fprintf(file, "        { \"map_failures\": %u, \"verified_reads\": %u, \"mismatches\": %u,\n"
+    "          \"stall_count\": %llu, \"stall_ns\": %llu, \"submit_count\": %llu, \"flush_count\": %llu,\n"
+    "          \"episodes\": [",
+    result.mapFailures, result.verifiedReads, result.mismatches,
+    (unsigned long long)stats.stallCount, (unsigned long long)stats.stallNs,
+    (unsigned long long)stats.submitCount, (unsigned long long)stats.flushCount);
+
+  for (size_t e = 0; e < result.episodes.size(); e++) {
+    const auto& episode = result.episodes[e];
+
+    std::fprintf(file, "%s\n            { \"calls\": %u, \"readbacks\": %u, \"duration_ns\": %llu, "
+      "\"readback_ns\": %llu, \"max_readback_ns\": %llu }",
+      e ? "," : "", episode.callCount, episode.readbackCount,
+      (unsigned long long)episode.durationNs,
+      (unsigned long long)episode.readbackNs,
+      (unsigned long long)episode.maxReadbackNs);
+  }
+
+  std::fprintf(file, "\n          ] }");
+}
+
+int runReplays(
+        ID3D11Device*           pDevice,
+        ID3D11DeviceContext*    pContext,
+  const ReplayArgs&             args,
+  const std::vector<NamedTrace>& traces,
+  const MockControl&            control) {
+  int status = 0;
+
+  std::FILE* json = nullptr;
+
+  if (!args.jsonFile.empty()) {
+    if (!(json = std::fopen(args.jsonFile.c_str(), "w"))) {
+      std::fprintf(stderr, "Failed to open %s\n", args.jsonFile.c_str());
+      return 1;
+    }
+
+    std::fprintf(json, "{\n  \"traces\": [");
+  }
+
+  for (size_t t = 0; t < traces.size(); t++) {
+    const auto& [name, trace] = traces[t];
+
+    if (json) {
+      std::fprintf(json, "%s\n    { \"name\": \"%s\", \"hooks\": %s, \"runs\": [",
+        t ? "," : "", name.c_str(), args.installHooks ? "true" : "false");
+    }
+
+    std::printf("%s: %zu calls, %zu resources, %u lines skipped, hooks %s\n",
+      name.c_str(), trace.calls.size(), trace.resources.size(),
+      trace.skippedLines, args.installHooks ? "on" : "off");
+
+    TraceReplayer replayer(pDevice, pContext);
+    std::vector<double> latencies;
+
+    for (uint32_t r = 0; r < args.repeat; r++) {
+      control.resetStats();
+
+      ReplayResult result = replayer.replay(trace, args.options);
+      mock::MockStats stats = control.getStats();
+
+      double totalMs = 0.0;
+
+      for (size_t e = 0; e < result.episodes.size(); e++) {
+        const auto& episode = result.episodes[e];
+        double durationMs = double(episode.durationNs) / 1.0e6;
+        double readbackMs = double(episode.readbackNs) / 1.0e6;
+
+        std::printf("  run %u episode %zu: %u calls, %u readbacks, "
+          "latency %.3f ms, readback %.3f ms (avg %.3f ms, max %.3f ms)\n",
+          r, e, episode.callCount, episode.readbackCount, durationMs, readbackMs,
+          episode.readbackCount ? readbackMs / episode.readbackCount : 0.0,
+          double(episode.maxReadbackNs) / 1.0e6);
+
+        totalMs += durationMs;
+      }
+
+      std::printf("  run %u: menu-open latency %.3f ms, %llu GPU stalls (%.3f ms), "
+        "%llu submissions, %llu flushes\n",
+        r, totalMs,
+        (unsigned long long)stats.stallCount, double(stats.stallNs) / 1.0e6,
+        (unsigned long long)stats.submitCount,
+        (unsigned long long)stats.flushCount);
+
+      if (result.mapFailures)
+        std::printf("  run %u: %u failed Map calls\n", r, result.mapFailures);
+
+      if (args.options.verify) {
+        std::printf("  run %u: %u readbacks verified, %u mismatches\n",
+          r, result.verifiedReads, result.mismatches);
+
+        if (result.mismatches)
+          status = 2;
+      }
+
+      if (json) {
+        std::fprintf(json, "%s\n", r ? "," : "");
+        writeReplayJson(json, result, stats);
+      }
+
+      latencies.push_back(totalMs);
+      control.waitForIdle();
+    }
+
+    if (json)
+      std::fprintf(json, "\n      ] }");
+
+    if (args.repeat > 1) {
+      std::sort(latencies.begin(), latencies.end());
+      std::printf("  median menu-open latency over %u runs: %.3f ms (min %.3f ms, max %.3f ms)\n",
+        args.repeat, latencies[latencies.size() / 2], latencies.front(), latencies.back());
+    }
+  }
+
+  if (json) {
+    std::fprintf(json, "\n  ]\n}\n");
+    std::fclose(json);
+  }
+
+  return status;
+}
+
+}
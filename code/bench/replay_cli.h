@@ -0,0 +1,89 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../mock/mock_d3d11.h"
+
+#include "trace_replay.h"
+#include "workload.h"
+
+namespace atfix::bench {
+
+/**
+ * \brief Command line shared by the replay tools
+ */
+struct ReplayArgs {
+  mock::MockConfig          mock;
+  WorkloadConfig            workload;
+  ReplayOptions             options;
+  bool                      installHooks  = true;
+  bool                      synthetic     = false;
+  uint32_t                  repeat        = 1;
+  std::string               dumpFile;
+  std::string               jsonFile;
+  std::vector<std::string>  files;
+};
+
+using NamedTrace = std::pair<std::string, Trace>;
+
+/**
+ * \brief Mock device controls
+ *
+ * Lets the replay loop query the mock device both when it is
+ * linked in directly and when it lives in a proxy DLL.
+ */
+struct MockControl {
+  std::function<mock::MockStats ()> getStats;
+  std::function<void ()>            resetStats;
+  std::function<void ()>            waitForIdle;
+};
+
+/**
+ * \brief Parses the replay command line
+ *
+ * \param [in] argc Argument count
+ * \param [in] argv Arguments
+ * \param [out] args Parsed arguments
+ * \returns \c false if the command line is invalid
+ */
+bool parseReplayArgs(int argc, char** argv, ReplayArgs& args);
+
+/**
+ * \brief Prints usage of the replay command line
+ *
+ * \param [in] pName Program name
+ * \param [in] pDescription One-line description of the tool
+ */
+void printReplayUsage(const char* pName, const char* pDescription);
+
+/**
+ * \brief Loads or generates all traces named on the command line
+ *
+ * \param [in] args Parsed arguments
+ * \param [out] traces Traces, in command line order
+ * \returns \c false if any trace could not be read or written
+ */
+bool loadReplayTraces(const ReplayArgs& args, std::vector<NamedTrace>& traces);
+
+/**
+ * \brief Replays traces and prints per-episode results
+ *
+ * If requested, also writes all results to a JSON summary.
+ * \param [in] pDevice Device
+ * \param [in] pContext Immediate context
+ * \param [in] args Parsed arguments
+ * \param [in] traces Traces to replay
+ * \param [in] control Mock device controls
+ * \returns Exit status, non-zero on verification failures
+ */
+int runReplays(
+        ID3D11Device*           pDevice,
+        ID3D11DeviceContext*    pContext,
+  const ReplayArgs&             args,
+  const std::vector<NamedTrace>& traces,
+  const MockControl&            control);
+
+}
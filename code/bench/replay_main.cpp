@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "../impl.h"
+#include "../trace.h"
+
+#include "../mock/mock_d3d11.h"
+
+#include "replay_cli.h"
+
+using namespace atfix;
+
+int main(int argc, char** argv) {
+  bench::ReplayArgs args;
+
+  if (!bench::parseReplayArgs(argc, argv, args)) {
+    bench::printReplayUsage(argv[0], "Replays atfix traces through the hooked mock device.");
+    return 1;
+  }
+
+  std::vector<bench::NamedTrace> traces;
+  int status = bench::loadReplayTraces(args, traces) ? 0 : 1;
+
+  MH_Initialize();
+
+  ID3D11Device* device = nullptr;
+  ID3D11DeviceContext* context = nullptr;
+
+  if (FAILED(mock::createMockDevice(args.mock, &device, &context))) {
+    std::fprintf(stderr, "Failed to create mock device\n");
+    return 1;
+  }
+
+  if (args.installHooks) {
+    hookDevice(device);
+    hookContext(context);
+  }
+
+  bench::MockControl control;
+  control.getStats = [device] { return mock::getMockStats(device); };
+  control.resetStats = [device] { mock::resetMockStats(device); };
+  control.waitForIdle = [device] { mock::waitForMockIdle(device); };
+
+  status = std::max(status, bench::runReplays(device, context, args, traces, control));
+
+  context->Release();
+  device->Release();
+
+  shutdownTraceLogging();
+  MH_Uninitialize();
+  return status;
+}
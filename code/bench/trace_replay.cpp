@@ -0,0 +1,658 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+
+#include "../core/episode.h"
+#include "../core/trace_format.h"
+
+#include "payload.h"
+#include "trace_replay.h"
+
+namespace atfix::bench {
+
+using Clock = std::chrono::steady_clock;
+
+/** Trace parsing */
+using TraceArgs = std::unordered_map<std::string, std::string>;
+
+uint64_t parseHex(std::string str) {
+  /* The logger prints pointers with an extra 0x prefix */
+  while (str.size() > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X'))
+    str = str.substr(2);
+
+  return std::strtoull(str.c_str(), nullptr, 16);
+}
+
+uint64_t parseDec(const std::string& str) {
+  return std::strtoull(str.c_str(), nullptr, 10);
+}
+
+bool parseDim(const std::string& str, UINT* pWidth, UINT* pHeight) {
+  return std::sscanf(str.c_str(), "%ux%u", pWidth, pHeight) == 2;
+}
+
+D3D11_USAGE parseUsage(const std::string& str) {
+  if (str == "IMMUTABLE") return D3D11_USAGE_IMMUTABLE;
+  if (str == "DYNAMIC")   return D3D11_USAGE_DYNAMIC;
+  if (str == "STAGING")   return D3D11_USAGE_STAGING;
+  return D3D11_USAGE_DEFAULT;
+}
+
+bool parseMapType(const std::string& str, D3D11_MAP* pMapType) {
+  if (str == "READ")                { *pMapType = D3D11_MAP_READ;               return true; }
+  if (str == "WRITE")               { *pMapType = D3D11_MAP_WRITE;              return true; }
+  if (str == "READ_WRITE")          { *pMapType = D3D11_MAP_READ_WRITE;         return true; }
+  if (str == "WRITE_DISCARD")       { *pMapType = D3D11_MAP_WRITE_DISCARD;      return true; }
+  if (str == "WRITE_NO_OVERWRITE")  { *pMapType = D3D11_MAP_WRITE_NO_OVERWRITE; return true; }
+  return false;
+}
+
+bool hasArg(const TraceArgs& args, const char* pName) {
+  return args.find(pName) != args.end();
+}
+
+const std::string& getArg(const TraceArgs& args, const char* pName) {
+  static const std::string empty;
+  auto entry = args.find(pName);
+  return entry != args.end() ? entry->second : empty;
+}
+
+void addResourceDesc(Trace& trace, uint64_t address, const TraceResourceDesc& desc) {
+  if (address && desc.width && desc.height)
+    trace.resources.emplace(address, desc);
+}
+
+bool parseMapCall(const TraceArgs& args, Trace& trace, TraceCall& call) {
+  call.type = TraceCallType::Map;
+  call.resource = parseHex(getArg(args, "res"));
+  call.subresource = UINT(parseDec(getArg(args, "sub")));
+
+  if (!parseMapType(getArg(args, "type"), &call.mapType))
+    return false;
+
+  if (hasArg(args, "checksum")) {
+    call.hasChecksum = true;
+    call.checksum = uint32_t(parseHex(getArg(args, "checksum")));
+  }
+
+  TraceResourceDesc desc;
+  desc.usage = parseUsage(getArg(args, "usage"));
+  desc.cpuAccessFlags = UINT(parseHex(getArg(args, "cpu")));
+  desc.bindFlags = UINT(parseHex(getArg(args, "bind")));
+  desc.format = DXGI_FORMAT(parseDec(getArg(args, "fmt")));
+
+  if (parseDim(getArg(args, "dim"), &desc.width, &desc.height))
+    addResourceDesc(trace, call.resource, desc);
+
+  return call.resource != 0;
+}
+
+bool parseUnmapCall(const TraceArgs& args, TraceCall& call) {
+  call.type = TraceCallType::Unmap;
+  call.resource = parseHex(getArg(args, "res"));
+  call.subresource = UINT(parseDec(getArg(args, "sub")));
+
+  if (hasArg(args, "checksum")) {
+    call.hasChecksum = true;
+    call.checksum = uint32_t(parseHex(getArg(args, "checksum")));
+  }
+
+  return call.resource != 0;
+}
+
+bool parseCopyCall(const TraceArgs& args, Trace& trace, TraceCall& call) {
+  call.type = TraceCallType::CopySubresourceRegion;
+  call.resource = parseHex(getArg(args, "dst"));
+  call.srcResource = parseHex(getArg(args, "src"));
+  call.subresource = UINT(parseDec(getArg(args, "dstSub")));
+  call.srcSubresource = UINT(parseDec(getArg(args, "srcSub")));
+
+  std::sscanf(getArg(args, "dstPos").c_str(), "(%u,%u,%u)",
+    &call.dstX, &call.dstY, &call.dstZ);
+
+  const std::string& box = getArg(args, "box");
+
+  if (!box.empty() && box != "full") {
+    call.hasBox = std::sscanf(box.c_str(), "(%u,%u,%u)-(%u,%u,%u)",
+      &call.box.left, &call.box.top, &call.box.front,
+      &call.box.right, &call.box.bottom, &call.box.back) == 6;
+  }
+
+  DXGI_FORMAT format = DXGI_FORMAT(parseDec(getArg(args, "fmt")));
+
+  TraceResourceDesc srcDesc;
+  srcDesc.usage = parseUsage(getArg(args, "srcUsage"));
+  srcDesc.cpuAccessFlags = UINT(parseHex(getArg(args, "srcCPU")));
+  srcDesc.bindFlags = UINT(parseHex(getArg(args, "srcBind")));
+  srcDesc.format = format;
+
+  if (parseDim(getArg(args, "srcDim"), &srcDesc.width, &srcDesc.height))
+    addResourceDesc(trace, call.srcResource, srcDesc);
+
+  TraceResourceDesc dstDesc;
+  dstDesc.usage = parseUsage(getArg(args, "dstUsage"));
+  dstDesc.cpuAccessFlags = UINT(parseHex(getArg(args, "dstCPU")));
+  dstDesc.bindFlags = UINT(parseHex(getArg(args, "dstBind")));
+  dstDesc.format = format;
+
+  if (parseDim(getArg(args, "dstDim"), &dstDesc.width, &dstDesc.height))
+    addResourceDesc(trace, call.resource, dstDesc);
+
+  return call.resource && call.srcResource;
+}
+
+bool parseFlushCall(TraceCall& call) {
+  call.type = TraceCallType::Flush;
+  return true;
+}
+
+Trace parseTrace(std::istream& stream) {
+  Trace trace;
+  std::string line;
+
+  while (std::getline(stream, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream tokens(line);
+    std::string timestamp, name, token;
+    tokens >> timestamp >> name;
+
+    if (timestamp.size() < 3 || timestamp.front() != '[' || timestamp.back() != ']') {
+      trace.skippedLines += 1;
+      continue;
+    }
+
+    TraceArgs args;
+
+    while (tokens >> token) {
+      size_t split = token.find('=');
+
+      if (split != std::string::npos)
+        args[token.substr(0, split)] = token.substr(split + 1);
+    }
+
+    TraceCall call;
+    call.timestampUs = parseDec(timestamp.substr(1, timestamp.size() - 2));
+
+    bool valid = false;
+
+    if (name == "Map")
+      valid = parseMapCall(args, trace, call);
+    else if (name == "Unmap")
+      valid = parseUnmapCall(args, call);
+    else if (name == "CopySubresourceRegion")
+      valid = parseCopyCall(args, trace, call);
+    else if (name == "Flush")
+      valid = parseFlushCall(call);
+
+    if (valid)
+      trace.calls.push_back(call);
+    else
+      trace.skippedLines += 1;
+  }
+
+  return trace;
+}
+
+core::ResourceDesc getCoreDesc(const TraceResourceDesc& desc) {
+  core::ResourceDesc result;
+  result.width = desc.width;
+  result.height = desc.height;
+  result.usage = core::Usage(desc.usage);
+  result.cpuAccessFlags = desc.cpuAccessFlags;
+  result.bindFlags = desc.bindFlags;
+  result.format = uint32_t(desc.format);
+  return result;
+}
+
+void writeTrace(std::ostream& stream, const Trace& trace) {
+  auto getDesc = [&trace] (uint64_t address) {
+    auto entry = trace.resources.find(address);
+
+    return entry != trace.resources.end()
+      ? getCoreDesc(entry->second)
+      : core::ResourceDesc();
+  };
+
+  auto getPointer = [] (uint64_t address) {
+    return reinterpret_cast<const void*>(uintptr_t(address));
+  };
+
+  stream << "# atfix trace log - timestamps in microseconds\n"
+         << "# Format: [timestamp_us] CallType key=value ...\n";
+
+  for (const auto& call : trace.calls) {
+    const uint32_t* checksum = call.hasChecksum ? &call.checksum : nullptr;
+
+    switch (call.type) {
+      case TraceCallType::Map:
+        stream << core::formatMapLine(call.timestampUs, getPointer(call.resource),
+          call.subresource, core::MapType(call.mapType), getDesc(call.resource), checksum);
+        break;
+
+      case TraceCallType::Unmap:
+        stream << core::formatUnmapLine(call.timestampUs, getPointer(call.resource),
+          call.subresource, checksum);
+        break;
+
+      case TraceCallType::CopySubresourceRegion:
+        stream << core::formatCopyLine(call.timestampUs,
+          getPointer(call.resource), call.subresource,
+          call.dstX, call.dstY, call.dstZ, getDesc(call.resource),
+          getPointer(call.srcResource), call.srcSubresource, getDesc(call.srcResource),
+          call.hasBox ? reinterpret_cast<const core::Box*>(&call.box) : nullptr);
+        break;
+
+      case TraceCallType::Flush:
+        stream << core::formatFlushLine(call.timestampUs);
+        break;
+    }
+
+    stream << '\n';
+  }
+}
+
+std::vector<size_t> findTraceEpisodes(const Trace& trace, uint64_t gapUs) {
+  std::vector<size_t> episodes;
+  core::EpisodeDetector detector(gapUs);
+
+  for (size_t i = 0; i < trace.calls.size(); i++) {
+    if (detector.addCall(trace.calls[i].timestampUs))
+      episodes.push_back(i);
+  }
+
+  return episodes;
+}
+
+
+/** Replay */
+TraceReplayer::TraceReplayer(ID3D11Device* pDevice, ID3D11DeviceContext* pContext)
+: m_device(pDevice), m_context(pContext) {
+  m_device->AddRef();
+  m_context->AddRef();
+}
+
+TraceReplayer::~TraceReplayer() {
+  for (auto& entry : m_resources)
+    entry.second.resource->Release();
+
+  if (m_deferred)
+    m_deferred->Release();
+
+  m_context->Release();
+  m_device->Release();
+}
+
+TraceReplayer::Resource* TraceReplayer::getResource(const Trace& trace, const ReplayOptions& options, uint64_t address) {
+  auto entry = m_resources.find(address);
+
+  if (entry != m_resources.end())
+    return &entry->second;
+
+  auto descEntry = trace.resources.find(address);
+
+  if (descEntry == trace.resources.end())
+    return nullptr;
+
+  TraceResourceDesc traceDesc = descEntry->second;
+
+  if (options.upload != ReplayUpload::Map && traceDesc.usage == D3D11_USAGE_DYNAMIC) {
+    traceDesc.usage = D3D11_USAGE_DEFAULT;
+    traceDesc.cpuAccessFlags = 0;
+  }
+
+  Resource resource;
+  resource.dimension = options.dimension;
+  resource.width = traceDesc.width;
+  resource.height = traceDesc.height;
+
+  if (FAILED(createResource(traceDesc, resource))) {
+    std::fprintf(stderr, "Failed to create resource for 0x%llx\n", (unsigned long long)address);
+    return nullptr;
+  }
+
+  return &m_resources.emplace(address, resource).first->second;
+}
+
+HRESULT TraceReplayer::createResource(const TraceResourceDesc& traceDesc, Resource& resource) {
+  switch (resource.dimension) {
+    case ReplayDimension::Buffer: {
+      D3D11_BUFFER_DESC desc = { };
+      desc.ByteWidth = traceDesc.width * traceDesc.height * 4u;
+      desc.Usage = traceDesc.usage;
+      desc.BindFlags = traceDesc.usage == D3D11_USAGE_STAGING ? 0u : UINT(D3D11_BIND_SHADER_RESOURCE);
+      desc.CPUAccessFlags = traceDesc.cpuAccessFlags;
+
+      ID3D11Buffer* buffer = nullptr;
+      HRESULT hr = m_device->CreateBuffer(&desc, nullptr, &buffer);
+      resource.resource = buffer;
+      return hr;
+    }
+
+    case ReplayDimension::Texture1D: {
+      D3D11_TEXTURE1D_DESC desc = { };
+      desc.Width = traceDesc.width * traceDesc.height;
+      desc.MipLevels = 1;
+      desc.ArraySize = 1;
+      desc.Format = traceDesc.format;
+      desc.Usage = traceDesc.usage;
+      desc.BindFlags = traceDesc.bindFlags;
+      desc.CPUAccessFlags = traceDesc.cpuAccessFlags;
+
+      ID3D11Texture1D* texture = nullptr;
+      HRESULT hr = m_device->CreateTexture1D(&desc, nullptr, &texture);
+      resource.resource = texture;
+      return hr;
+    }
+
+    case ReplayDimension::Texture2D: {
+      D3D11_TEXTURE2D_DESC desc = { };
+      desc.Width = traceDesc.width;
+      desc.Height = traceDesc.height;
+      desc.MipLevels = 1;
+      desc.ArraySize = 1;
+      desc.Format = traceDesc.format;
+      desc.SampleDesc = { 1, 0 };
+      desc.Usage = traceDesc.usage;
+      desc.BindFlags = traceDesc.bindFlags;
+      desc.CPUAccessFlags = traceDesc.cpuAccessFlags;
+
+      ID3D11Texture2D* texture = nullptr;
+      HRESULT hr = m_device->CreateTexture2D(&desc, nullptr, &texture);
+      resource.resource = texture;
+      return hr;
+    }
+
+    case ReplayDimension::Texture3D: {
+      D3D11_TEXTURE3D_DESC desc = { };
+      desc.Width = traceDesc.width;
+      desc.Height = 1;
+      desc.Depth = traceDesc.height;
+      desc.MipLevels = 1;
+      desc.Format = traceDesc.format;
+      desc.Usage = traceDesc.usage;
+      desc.BindFlags = traceDesc.bindFlags;
+      desc.CPUAccessFlags = traceDesc.cpuAccessFlags;
+
+      ID3D11Texture3D* texture = nullptr;
+      HRESULT hr = m_device->CreateTexture3D(&desc, nullptr, &texture);
+      resource.resource = texture;
+      return hr;
+    }
+  }
+
+  return E_INVALIDARG;
+}
+
+D3D11_MAPPED_SUBRESOURCE TraceReplayer::getPayloadMapping(const Resource& resource, const D3D11_MAPPED_SUBRESOURCE& mapped) {
+  D3D11_MAPPED_SUBRESOURCE result = mapped;
+
+  switch (resource.dimension) {
+    case ReplayDimension::Buffer:
+    case ReplayDimension::Texture1D:
+      /* One row of the payload image after the other */
+      result.RowPitch = resource.width * 4u;
+      break;
+
+    case ReplayDimension::Texture2D:
+      break;
+
+    case ReplayDimension::Texture3D:
+      /* One row of the payload image per slice */
+      result.RowPitch = mapped.DepthPitch;
+      break;
+  }
+
+  return result;
+}
+
+ID3D11DeviceContext* TraceReplayer::getRecordingContext(const ReplayOptions& options) {
+  if (!options.deferred)
+    return m_context;
+
+  if (!m_deferred && FAILED(m_device->CreateDeferredContext(0, &m_deferred))) {
+    std::fprintf(stderr, "Failed to create deferred context, recording on the immediate context\n");
+    return m_context;
+  }
+
+  m_hasRecordedWork = true;
+  return m_deferred;
+}
+
+void TraceReplayer::updateResource(ID3D11DeviceContext* context, const Resource& resource,
+    UINT subresource, const ReplayOptions& options) {
+  /* Pack the payload, rows of 3D textures are slices */
+  UINT rowPitch = resource.width * 4u;
+  UINT depthPitch = resource.dimension == ReplayDimension::Texture3D
+    ? rowPitch : rowPitch * resource.height;
+
+  m_uploadData.resize(size_t(rowPitch) * resource.height);
+
+  D3D11_MAPPED_SUBRESOURCE sr = { m_uploadData.data(), rowPitch, depthPitch };
+  writeGlyphPayload(resource.seed, getPayloadMapping(resource, sr), resource.width, resource.height);
+
+  if (options.upload == ReplayUpload::Update) {
+    context->UpdateSubresource(resource.resource, subresource, nullptr,
+      sr.pData, sr.RowPitch, sr.DepthPitch);
+    return;
+  }
+
+  ID3D11DeviceContext1* context1 = nullptr;
+
+  if (FAILED(context->QueryInterface(IID_PPV_ARGS(&context1)))) {
+    std::fprintf(stderr, "ID3D11DeviceContext1 not supported, falling back to UpdateSubresource\n");
+    context->UpdateSubresource(resource.resource, subresource, nullptr,
+      sr.pData, sr.RowPitch, sr.DepthPitch);
+    return;
+  }
+
+  context1->DiscardResource(resource.resource);
+  context1->UpdateSubresource1(resource.resource, subresource, nullptr,
+    sr.pData, sr.RowPitch, sr.DepthPitch, 0);
+  context1->Release();
+}
+
+void TraceReplayer::executeRecordedWork() {
+  if (!m_hasRecordedWork)
+    return;
+
+  ID3D11CommandList* commandList = nullptr;
+
+  if (SUCCEEDED(m_deferred->FinishCommandList(FALSE, &commandList))) {
+    m_context->ExecuteCommandList(commandList, FALSE);
+    commandList->Release();
+  }
+
+  m_hasRecordedWork = false;
+}
+
+ReplayResult TraceReplayer::replay(const Trace& trace, const ReplayOptions& options) {
+  ReplayResult result;
+
+  /* Derive payload seeds for write maps from the checksum logged on the
+   * matching Unmap, so that identical uploads produce identical data */
+  std::vector<uint64_t> writeSeeds(trace.calls.size(), 0);
+  std::unordered_map<uint64_t, size_t> openWrites;
+
+  for (size_t i = 0; i < trace.calls.size(); i++) {
+    const TraceCall& call = trace.calls[i];
+
+    if (call.type == TraceCallType::Map && call.mapType != D3D11_MAP_READ) {
+      writeSeeds[i] = m_nextSeed++ << 32;
+      openWrites[call.resource] = i;
+    } else if (call.type == TraceCallType::Unmap) {
+      auto entry = openWrites.find(call.resource);
+
+      if (entry != openWrites.end()) {
+        if (call.hasChecksum)
+          writeSeeds[entry->second] = call.checksum;
+
+        openWrites.erase(entry);
+      }
+    }
+  }
+
+  std::vector<size_t> episodes = findTraceEpisodes(trace, options.episodeGapUs);
+  std::unordered_map<uint64_t, ID3D11DeviceContext*> mapped;
+
+  auto replayStart = Clock::now();
+  uint64_t traceStart = trace.calls.empty() ? 0 : trace.calls.front().timestampUs;
+
+  for (size_t e = 0; e < episodes.size(); e++) {
+    size_t first = episodes[e];
+    size_t last = e + 1 < episodes.size() ? episodes[e + 1] : trace.calls.size();
+
+    ReplayEpisode episode;
+    episode.callCount = uint32_t(last - first);
+
+    auto episodeStart = Clock::now();
+
+    for (size_t i = first; i < last; i++) {
+      const TraceCall& call = trace.calls[i];
+
+      if (options.realtime) {
+        auto target = replayStart + std::chrono::microseconds(call.timestampUs - traceStart);
+        auto remaining = target - Clock::now();
+
+        if (remaining > std::chrono::milliseconds(2))
+          std::this_thread::sleep_for(remaining - std::chrono::milliseconds(1));
+
+        while (Clock::now() < target)
+          continue;
+      }
+
+      if (call.type == TraceCallType::Flush) {
+        executeRecordedWork();
+        m_context->Flush();
+        continue;
+      }
+
+      Resource* resource = getResource(trace, options, call.resource);
+
+      if (!resource)
+        continue;
+
+      switch (call.type) {
+        case TraceCallType::Map: {
+          D3D11_MAPPED_SUBRESOURCE sr = { };
+          bool isRead = call.mapType == D3D11_MAP_READ || call.mapType == D3D11_MAP_READ_WRITE;
+
+          /* Deferred contexts can only discard */
+          ID3D11DeviceContext* context = m_context;
+
+          if (call.mapType == D3D11_MAP_WRITE_DISCARD)
+            context = getRecordingContext(options);
+          else
+            executeRecordedWork();
+
+          if (call.mapType == D3D11_MAP_WRITE_DISCARD && options.upload != ReplayUpload::Map) {
+            resource->seed = writeSeeds[i];
+            resource->known = true;
+            updateResource(context, *resource, call.subresource, options);
+            break;
+          }
+
+          auto t0 = Clock::now();
+          HRESULT hr = context->Map(resource->resource, call.subresource, call.mapType, 0, &sr);
+          auto t1 = Clock::now();
+
+          if (FAILED(hr)) {
+            result.mapFailures += 1;
+            break;
+          }
+
+          mapped[call.resource] = context;
+
+          if (isRead) {
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+            episode.readbackCount += 1;
+            episode.readbackNs += ns;
+            episode.maxReadbackNs = std::max(episode.maxReadbackNs, ns);
+
+            if (options.verify && resource->known) {
+              result.verifiedReads += 1;
+
+              UINT rowCount = options.readRows
+                ? std::min(options.readRows, resource->height)
+                : resource->height;
+
+              if (!checkGlyphPayload(resource->seed, getPayloadMapping(*resource, sr), resource->width, resource->height, rowCount))
+                result.mismatches += 1;
+            }
+          }
+
+          if (call.mapType != D3D11_MAP_READ) {
+            resource->seed = writeSeeds[i];
+            resource->known = true;
+            writeGlyphPayload(resource->seed, getPayloadMapping(*resource, sr), resource->width, resource->height);
+          }
+        } break;
+
+        case TraceCallType::Unmap: {
+          auto entry = mapped.find(call.resource);
+
+          if (entry != mapped.end()) {
+            entry->second->Unmap(resource->resource, call.subresource);
+            mapped.erase(entry);
+          }
+        } break;
+
+        case TraceCallType::CopySubresourceRegion: {
+          Resource* src = getResource(trace, options, call.srcResource);
+
+          if (!src)
+            break;
+
+          ID3D11DeviceContext* context = getRecordingContext(options);
+          ID3D11DeviceContext1* context1 = nullptr;
+
+          if (options.upload == ReplayUpload::Update1
+           && SUCCEEDED(context->QueryInterface(IID_PPV_ARGS(&context1)))) {
+            context1->CopySubresourceRegion1(
+              resource->resource, call.subresource,
+              call.dstX, call.dstY, call.dstZ,
+              src->resource, call.srcSubresource,
+              call.hasBox ? &call.box : nullptr, 0);
+            context1->Release();
+          } else {
+            context->CopySubresourceRegion(
+              resource->resource, call.subresource,
+              call.dstX, call.dstY, call.dstZ,
+              src->resource, call.srcSubresource,
+              call.hasBox ? &call.box : nullptr);
+          }
+
+          bool fullCopy = !call.hasBox && !call.dstX && !call.dstY && !call.dstZ
+            && src->width == resource->width && src->height == resource->height;
+
+          resource->seed = src->seed;
+          resource->known = src->known && fullCopy;
+        } break;
+
+        case TraceCallType::Flush:
+          /* Issued above, flushes have no resource */
+          break;
+      }
+    }
+
+    executeRecordedWork();
+
+    episode.durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - episodeStart).count();
+    result.episodes.push_back(episode);
+  }
+
+  /* Don't leave anything mapped if the trace was cut off mid-pair */
+  for (const auto& entry : mapped)
+    entry.second->Unmap(m_resources[entry.first].resource, 0);
+
+  executeRecordedWork();
+
+  return result;
+}
+
+}
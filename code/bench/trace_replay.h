@@ -0,0 +1,245 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <d3d11_1.h>
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace atfix::bench {
+
+enum class TraceCallType : uint32_t {
+  Map,
+  Unmap,
+  CopySubresourceRegion,
+  Flush,
+};
+
+/**
+ * \brief Resource descriptor as logged in the trace
+ */
+struct TraceResourceDesc {
+  UINT        width           = 0;
+  UINT        height          = 0;
+  D3D11_USAGE usage           = D3D11_USAGE_DEFAULT;
+  UINT        cpuAccessFlags  = 0;
+  UINT        bindFlags       = 0;
+  DXGI_FORMAT format          = DXGI_FORMAT_UNKNOWN;
+};
+
+/**
+ * \brief Single call parsed from an atfix trace
+ *
+ * For copies, \c resource is the destination.
+ */
+struct TraceCall {
+  uint64_t      timestampUs     = 0;
+  TraceCallType type            = TraceCallType::Map;
+  uint64_t      resource        = 0;
+  uint64_t      srcResource     = 0;
+  UINT          subresource     = 0;
+  UINT          srcSubresource  = 0;
+  D3D11_MAP     mapType         = D3D11_MAP_READ;
+  bool          hasChecksum     = false;
+  uint32_t      checksum        = 0;
+  UINT          dstX            = 0;
+  UINT          dstY            = 0;
+  UINT          dstZ            = 0;
+  bool          hasBox          = false;
+  D3D11_BOX     box             = { };
+};
+
+/**
+ * \brief Parsed trace
+ */
+struct Trace {
+  std::vector<TraceCall> calls;
+  std::unordered_map<uint64_t, TraceResourceDesc> resources;
+  /** Number of lines that could not be parsed */
+  uint32_t skippedLines = 0;
+};
+
+/**
+ * \brief Parses an atfix trace
+ *
+ * Accepts the format written by the trace logger, i.e. lines of
+ * the form <tt>[timestamp_us] CallType key=value ...</tt>. Comment
+ * lines are ignored, unknown lines are counted and skipped.
+ * \param [in] stream Input stream
+ * \returns Parsed trace
+ */
+Trace parseTrace(std::istream& stream);
+
+/**
+ * \brief Writes a trace
+ *
+ * Uses the same format as the trace logger, so that
+ * the output can be read back by \c parseTrace and
+ * by the offline analysis scripts.
+ * \param [in] stream Output stream
+ * \param [in] trace Trace
+ */
+void writeTrace(std::ostream& stream, const Trace& trace);
+
+/**
+ * \brief Splits a trace into episodes
+ *
+ * An episode, i.e. one menu open, ends whenever the gap between
+ * two consecutive calls exceeds the given threshold.
+ * \param [in] trace Trace
+ * \param [in] gapUs Minimum gap between episodes
+ * \returns Index of the first call of each episode
+ */
+std::vector<size_t> findTraceEpisodes(const Trace& trace, uint64_t gapUs);
+
+
+/**
+ * \brief Dimension of replayed resources
+ *
+ * Traces only record 2D glyph textures. Other dimensions lay
+ * out the same payload so that every row of the image is one
+ * separately strided unit: buffers and 1D textures hold the
+ * rows back to back, 3D textures hold one row per slice.
+ */
+enum class ReplayDimension : uint32_t {
+  Buffer,
+  Texture1D,
+  Texture2D,
+  Texture3D,
+};
+
+/**
+ * \brief How replayed uploads reach their resource
+ *
+ * With updates, resources that the trace maps for writing are
+ * created with DEFAULT usage, and the payload is passed to
+ * UpdateSubresource instead of being written through Map.
+ */
+enum class ReplayUpload : uint32_t {
+  Map,
+  /** UpdateSubresource */
+  Update,
+  /** DiscardResource followed by UpdateSubresource1, and
+   *  copies through CopySubresourceRegion1 */
+  Update1,
+};
+
+struct ReplayOptions {
+  /** Honor recorded timestamps instead of replaying at maximum speed */
+  bool      realtime      = false;
+  /** Check that every Map(READ) returns the data of its copy source */
+  bool      verify        = false;
+  /** Record uploads and copies on a deferred context, and execute
+   *  its command list before each readback and flush */
+  bool      deferred      = false;
+  /** Dimension of the resources created for the trace */
+  ReplayDimension dimension = ReplayDimension::Texture2D;
+  /** Call that uploads the payloads */
+  ReplayUpload upload = ReplayUpload::Map;
+  /** Rows of each readback that are read and checked, 0 for all */
+  uint32_t  readRows      = 0;
+  /** Gap between calls that separates two episodes */
+  uint64_t  episodeGapUs  = 500000;
+};
+
+struct ReplayEpisode {
+  /** Number of calls in the episode */
+  uint32_t  callCount     = 0;
+  /** Number of Map(READ) and Map(READ_WRITE) calls */
+  uint32_t  readbackCount = 0;
+  /** Wall time from the first to the last call of the episode */
+  uint64_t  durationNs    = 0;
+  /** Time spent inside Map(READ) and Map(READ_WRITE) */
+  uint64_t  readbackNs    = 0;
+  /** Longest single readback */
+  uint64_t  maxReadbackNs = 0;
+};
+
+struct ReplayResult {
+  std::vector<ReplayEpisode> episodes;
+  /** Failed Map calls */
+  uint32_t  mapFailures   = 0;
+  /** Readbacks that were checked against their source */
+  uint32_t  verifiedReads = 0;
+  /** Readbacks that returned data other than their source */
+  uint32_t  mismatches    = 0;
+};
+
+
+/**
+ * \brief Replays traces through a device context
+ *
+ * Recreates every resource referenced by the trace from its logged
+ * descriptor and issues the recorded calls through the context, so
+ * that any installed hooks see the same sequence as in the game.
+ * Write maps upload a synthetic glyph payload derived from the logged
+ * checksum, so that payload reuse matches the recording.
+ */
+class TraceReplayer {
+
+public:
+
+  TraceReplayer(ID3D11Device* pDevice, ID3D11DeviceContext* pContext);
+
+  ~TraceReplayer();
+
+  TraceReplayer(const TraceReplayer&) = delete;
+  TraceReplayer& operator = (const TraceReplayer&) = delete;
+
+  /**
+   * \brief Replays a trace
+   *
+   * Resources are created on first use and kept alive across
+   * calls, so that a trace can be replayed multiple times.
+   * \param [in] trace Trace to replay
+   * \param [in] options Replay options
+   * \returns Timing results
+   */
+  ReplayResult replay(const Trace& trace, const ReplayOptions& options);
+
+private:
+
+  struct Resource {
+    ID3D11Resource*   resource  = nullptr;
+    ReplayDimension   dimension = ReplayDimension::Texture2D;
+    UINT              width     = 0;
+    UINT              height    = 0;
+    /** Seed of the payload the resource currently holds */
+    uint64_t          seed    = 0;
+    /** Whether the seed is known, i.e. the content is verifiable */
+    bool              known   = false;
+  };
+
+  ID3D11Device*         m_device;
+  ID3D11DeviceContext*  m_context;
+
+  std::unordered_map<uint64_t, Resource> m_resources;
+
+  ID3D11DeviceContext*  m_deferred = nullptr;
+  bool                  m_hasRecordedWork = false;
+
+  uint64_t m_nextSeed = 1;
+
+  std::vector<uint8_t> m_uploadData;
+
+  Resource* getResource(const Trace& trace, const ReplayOptions& options, uint64_t address);
+
+  HRESULT createResource(const TraceResourceDesc& traceDesc, Resource& resource);
+
+  static D3D11_MAPPED_SUBRESOURCE getPayloadMapping(const Resource& resource, const D3D11_MAPPED_SUBRESOURCE& mapped);
+
+  ID3D11DeviceContext* getRecordingContext(const ReplayOptions& options);
+
+  void updateResource(ID3D11DeviceContext* context, const Resource& resource,
+    UINT subresource, const ReplayOptions& options);
+
+  void executeRecordedWork();
+
+};
+
+}
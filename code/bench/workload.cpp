@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "workload.h"
+
+namespace atfix::bench {
+
+constexpr uint64_t SourceBaseAddress  = 0x10000000ull;
+constexpr uint64_t StagingBaseAddress = 0x20000000ull;
+constexpr uint64_t AddressStride      = 0x400ull;
+
+/* Payload IDs of unique glyphs start above the reusable set */
+constexpr uint32_t UniquePayloadBase  = 0x80000000u;
+
+class WorkloadPicker {
+
+public:
+
+  WorkloadPicker(WorkloadRotation rotation, double jitter, uint32_t count)
+  : m_rotation(rotation), m_jitter(jitter), m_count(count) { }
+
+  uint32_t pick(std::mt19937_64& rng) {
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+    if (m_rotation == WorkloadRotation::Random || chance(rng) < m_jitter)
+      return uint32_t(rng() % m_count);
+
+    return m_cursor++ % m_count;
+  }
+
+private:
+
+  WorkloadRotation  m_rotation;
+  double            m_jitter;
+  uint32_t          m_count;
+  uint32_t          m_cursor = 0;
+
+};
+
+Trace generateWorkload(const WorkloadConfig& config) {
+  Trace trace;
+
+  uint32_t sourceCount = std::max(config.dynamicSources, 1u);
+  uint32_t stagingCount = std::max(config.stagingPoolSize, 1u);
+
+  TraceResourceDesc srcDesc;
+  srcDesc.width = config.width;
+  srcDesc.height = config.height;
+  srcDesc.usage = D3D11_USAGE_DYNAMIC;
+  srcDesc.cpuAccessFlags = D3D11_CPU_ACCESS_WRITE;
+  srcDesc.bindFlags = D3D11_BIND_SHADER_RESOURCE;
+  srcDesc.format = config.format;
+
+  TraceResourceDesc dstDesc = srcDesc;
+  dstDesc.usage = D3D11_USAGE_STAGING;
+  dstDesc.cpuAccessFlags = D3D11_CPU_ACCESS_READ;
+  dstDesc.bindFlags = 0;
+
+  for (uint32_t i = 0; i < sourceCount; i++)
+    trace.resources.emplace(SourceBaseAddress + i * AddressStride, srcDesc);
+
+  for (uint32_t i = 0; i < stagingCount; i++)
+    trace.resources.emplace(StagingBaseAddress + i * AddressStride, dstDesc);
+
+  std::mt19937_64 rng(config.seed);
+  std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+  WorkloadPicker sourcePicker(config.sourceRotation, config.sourceJitter, sourceCount);
+  WorkloadPicker stagingPicker(config.stagingRotation, 0.0, stagingCount);
+
+  uint32_t nextUniquePayload = UniquePayloadBase;
+  uint64_t timestamp = 0;
+
+  auto emit = [&trace, &timestamp] (TraceCall call) {
+    call.timestampUs = timestamp;
+    trace.calls.push_back(call);
+  };
+
+  TraceCall flush;
+  flush.type = TraceCallType::Flush;
+
+  for (uint32_t e = 0; e < config.episodes; e++) {
+    for (uint32_t r = 0; r < config.readbacksPerEpisode; r++) {
+      uint32_t writes = chance(rng) < config.burstRate
+        ? std::max(config.burstLength, 1u) : 1u;
+
+      uint64_t src = 0;
+
+      for (uint32_t w = 0; w < writes; w++) {
+        src = SourceBaseAddress + sourcePicker.pick(rng) * AddressStride;
+
+        uint32_t payload = config.glyphSetSize && chance(rng) < config.payloadReuse
+          ? 1u + uint32_t(rng() % config.glyphSetSize)
+          : nextUniquePayload++;
+
+        TraceCall map;
+        map.type = TraceCallType::Map;
+        map.mapType = D3D11_MAP_WRITE_DISCARD;
+        map.resource = src;
+        emit(map);
+
+        TraceCall unmap;
+        unmap.type = TraceCallType::Unmap;
+        unmap.resource = src;
+        unmap.hasChecksum = true;
+        unmap.checksum = payload;
+        emit(unmap);
+
+        if (config.flushRate > 0.0 && chance(rng) < config.flushRate)
+          emit(flush);
+      }
+
+      uint64_t dst = StagingBaseAddress + stagingPicker.pick(rng) * AddressStride;
+
+      TraceCall copy;
+      copy.type = TraceCallType::CopySubresourceRegion;
+      copy.resource = dst;
+      copy.srcResource = src;
+      emit(copy);
+
+      if (config.flushRate > 0.0 && chance(rng) < config.flushRate)
+        emit(flush);
+
+      TraceCall map;
+      map.type = TraceCallType::Map;
+      map.mapType = D3D11_MAP_READ;
+      map.resource = dst;
+      emit(map);
+
+      TraceCall unmap;
+      unmap.type = TraceCallType::Unmap;
+      unmap.resource = dst;
+      emit(unmap);
+
+      timestamp += config.iterationGapUs;
+    }
+
+    timestamp += config.episodeGapUs;
+  }
+
+  return trace;
+}
+
+
+bool parseRotation(const std::string& str, WorkloadRotation* pRotation) {
+  if (str == "rr" || str == "round-robin") {
+    *pRotation = WorkloadRotation::RoundRobin;
+    return true;
+  }
+
+  if (str == "random") {
+    *pRotation = WorkloadRotation::Random;
+    return true;
+  }
+
+  std::fprintf(stderr, "Unknown rotation '%s', expected 'rr' or 'random'\n", str.c_str());
+  return false;
+}
+
+bool parseWorkloadArg(int argc, char** argv, int& index, WorkloadConfig& config) {
+  if (index + 1 >= argc)
+    return false;
+
+  std::string arg = argv[index];
+  const char* value = argv[index + 1];
+
+  auto u32 = [value] { return uint32_t(std::strtoul(value, nullptr, 10)); };
+  auto u64 = [value] { return uint64_t(std::strtoull(value, nullptr, 10)); };
+  auto f64 = [value] { return std::strtod(value, nullptr); };
+
+  if (arg == "--episodes")
+    config.episodes = u32();
+  else if (arg == "--readbacks")
+    config.readbacksPerEpisode = u32();
+  else if (arg == "--sources")
+    config.dynamicSources = u32();
+  else if (arg == "--source-rotation")
+    parseRotation(value, &config.sourceRotation);
+  else if (arg == "--source-jitter")
+    config.sourceJitter = f64();
+  else if (arg == "--staging")
+    config.stagingPoolSize = u32();
+  else if (arg == "--staging-rotation")
+    parseRotation(value, &config.stagingRotation);
+  else if (arg == "--burst-rate")
+    config.burstRate = f64();
+  else if (arg == "--burst-length")
+    config.burstLength = u32();
+  else if (arg == "--payload-reuse")
+    config.payloadReuse = f64();
+  else if (arg == "--glyph-set")
+    config.glyphSetSize = u32();
+  else if (arg == "--flush-rate")
+    config.flushRate = f64();
+  else if (arg == "--width")
+    config.width = u32();
+  else if (arg == "--height")
+    config.height = u32();
+  else if (arg == "--iteration-gap-us")
+    config.iterationGapUs = u64();
+  else if (arg == "--seed")
+    config.seed = u64();
+  else
+    return false;
+
+  index += 1;
+  return true;
+}
+
+void printWorkloadArgUsage() {
+  WorkloadConfig defaults;
+
+  std::fprintf(stderr,
+    "Synthetic workload (with --synthetic):\n"
+    "  --episodes N             Number of menu opens (default %u)\n"
+    "  --readbacks N            Readbacks per menu open (default %u)\n"
+    "  --sources N              DYNAMIC source textures (default %u)\n"
+    "  --source-rotation R      Source order, 'rr' or 'random' (default rr)\n"
+    "  --source-jitter P        Probability of leaving the rotation (default %.2f)\n"
+    "  --staging N              STAGING pool size (default %u)\n"
+    "  --staging-rotation R     Staging order, 'rr' or 'random' (default random)\n"
+    "  --burst-rate P           Probability of a write burst (default %.2f)\n"
+    "  --burst-length N         Writes per burst (default %u)\n"
+    "  --payload-reuse P        Probability of re-uploading a known glyph (default %.2f)\n"
+    "  --glyph-set N            Distinct reusable glyphs (default %u)\n"
+    "  --flush-rate P           Probability of a Flush after an upload or copy (default %.2f)\n"
+    "  --width N, --height N    Texture size (default %ux%u)\n"
+    "  --iteration-gap-us N     CPU time per iteration (default %llu)\n"
+    "  --seed N                 Random seed (default %llu)\n",
+    defaults.episodes, defaults.readbacksPerEpisode, defaults.dynamicSources,
+    defaults.sourceJitter, defaults.stagingPoolSize, defaults.burstRate,
+    defaults.burstLength, defaults.payloadReuse, defaults.glyphSetSize, defaults.flushRate,
+    defaults.width, defaults.height,
+    (unsigned long long)defaults.iterationGapUs,
+    (unsigned long long)defaults.seed);
+}
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+
+#include "trace_replay.h"
+
+namespace atfix::bench {
+
+enum class WorkloadRotation : uint32_t {
+  /** Resources are used in a fixed cyclic order */
+  RoundRobin,
+  /** Resources are picked uniformly at random */
+  Random,
+};
+
+/**
+ * \brief Parameters of a synthetic glyph readback workload
+ *
+ * Defaults reproduce the Meruru DX main menu: three rotating
+ * DYNAMIC sources, a pool of 64 STAGING textures, ~1000 readbacks
+ * per menu open and occasional bursts of writes that are never
+ * read back.
+ */
+struct WorkloadConfig {
+  /** Number of menu opens */
+  uint32_t          episodes            = 1;
+  /** Copy and readback iterations per menu open */
+  uint32_t          readbacksPerEpisode = 1018;
+  /** Number of DYNAMIC textures the game renders glyphs into */
+  uint32_t          dynamicSources      = 3;
+  /** Order in which DYNAMIC textures are written */
+  WorkloadRotation  sourceRotation      = WorkloadRotation::RoundRobin;
+  /** Probability of deviating from the source rotation */
+  double            sourceJitter        = 0.1;
+  /** Number of STAGING textures used as copy destinations */
+  uint32_t          stagingPoolSize     = 64;
+  /** Order in which STAGING textures are used */
+  WorkloadRotation  stagingRotation     = WorkloadRotation::Random;
+  /** Probability that an iteration is preceded by a write burst */
+  double            burstRate           = 0.03;
+  /** Number of writes in a burst, only the last one is read back */
+  uint32_t          burstLength         = 8;
+  /** Probability that a write uploads a previously seen glyph */
+  double            payloadReuse        = 0.9;
+  /** Number of distinct glyphs that reused payloads are drawn from */
+  uint32_t          glyphSetSize        = 15;
+  /** Probability that the game flushes after an upload or a copy */
+  double            flushRate           = 0.0;
+  /** Texture size and format */
+  UINT              width               = 512;
+  UINT              height              = 512;
+  DXGI_FORMAT       format              = DXGI_FORMAT_B8G8R8A8_TYPELESS;
+  /** CPU time between iterations, used for trace timestamps */
+  uint64_t          iterationGapUs      = 750;
+  /** Idle time between two menu opens */
+  uint64_t          episodeGapUs        = 2000000;
+  /** Random seed */
+  uint64_t          seed                = 1;
+};
+
+/**
+ * \brief Generates a synthetic workload
+ *
+ * The result is a regular trace, so it can be replayed with
+ * \c TraceReplayer and written out for the offline tools.
+ * \param [in] config Workload parameters
+ * \returns Generated trace
+ */
+Trace generateWorkload(const WorkloadConfig& config);
+
+/**
+ * \brief Parses a workload option
+ *
+ * \param [in] argc Argument count
+ * \param [in] argv Arguments
+ * \param [in,out] index Current argument, advanced
+ *    past the value if the option was consumed
+ * \param [in,out] config Workload parameters to update
+ * \returns \c true if the argument was a workload option
+ */
+bool parseWorkloadArg(int argc, char** argv, int& index, WorkloadConfig& config);
+
+/**
+ * \brief Prints usage of the workload options
+ */
+void printWorkloadArgUsage();
+
+}
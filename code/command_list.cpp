@@ -0,0 +1,73 @@
+#include "command_list.h"
+
+namespace atfix {
+
+void CommandListTracker::record(const core::ResourceKey& Context, const DeferredOp& Op) {
+  std::lock_guard lock(m_mutex);
+
+  m_contexts[Context].push_back(Op);
+  m_stats.recordedOps += 1;
+}
+
+
+void CommandListTracker::recordCommandList(const core::ResourceKey& Context, const core::ResourceKey& CommandList) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_commandLists.find(CommandList);
+
+  if (entry == m_commandLists.end())
+    return;
+
+  auto& ops = m_contexts[Context];
+  ops.insert(ops.end(), entry->second->begin(), entry->second->end());
+}
+
+
+void CommandListTracker::finish(const core::ResourceKey& Context, const core::ResourceKey& CommandList) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_contexts.find(Context);
+
+  if (entry == m_contexts.end())
+    return;
+
+  if (CommandList.pointer && !entry->second.empty()) {
+    m_commandLists[CommandList] = std::make_shared<const DeferredOpList>(std::move(entry->second));
+    m_stats.finishedLists += 1;
+  }
+
+  m_contexts.erase(entry);
+}
+
+
+std::shared_ptr<const DeferredOpList> CommandListTracker::execute(const core::ResourceKey& CommandList) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_commandLists.find(CommandList);
+
+  if (entry == m_commandLists.end())
+    return nullptr;
+
+  m_stats.executedLists += 1;
+  m_stats.mergedOps += entry->second->size();
+  return entry->second;
+}
+
+
+void CommandListTracker::retire(const core::ResourceKey& Object) {
+  std::lock_guard lock(m_mutex);
+
+  m_contexts.erase(Object);
+  m_commandLists.erase(Object);
+}
+
+
+CommandListStats CommandListTracker::takeStats() {
+  std::lock_guard lock(m_mutex);
+
+  CommandListStats result = m_stats;
+  m_stats = CommandListStats();
+  return result;
+}
+
+}
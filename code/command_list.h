@@ -0,0 +1,140 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "impl.h"
+#include "util.h"
+
+#include "core/types.h"
+
+namespace atfix {
+
+/**
+ * \brief Command list tracking counters
+ */
+struct CommandListStats {
+  /** Uploads, copies, updates, resolves and discards
+   *  recorded on deferred contexts */
+  uint64_t recordedOps      = 0;
+  /** Command lists finished with tracked work */
+  uint64_t finishedLists    = 0;
+  /** Executions of command lists with tracked work */
+  uint64_t executedLists    = 0;
+  /** Recorded uploads and copies passed to the trackers */
+  uint64_t mergedOps        = 0;
+};
+
+enum class DeferredOpType : uint32_t {
+  /** Unmap of a discarding map */
+  Write,
+  CopyResource,
+  CopySubresourceRegion,
+  /** UpdateSubresource and UpdateSubresource1 */
+  Update,
+  ResolveSubresource,
+  DiscardResource,
+};
+
+/**
+ * \brief Upload or copy recorded on a deferred context
+ *
+ * Resources are not referenced, the deferred context and the
+ * command list keep them alive for as long as the op exists.
+ */
+struct DeferredOp {
+  DeferredOpType    type            = DeferredOpType::Write;
+  /** Written resource, or copy destination */
+  ID3D11Resource*   pDstResource    = nullptr;
+  UINT              DstSubresource  = 0;
+  UINT              DstX            = 0;
+  UINT              DstY            = 0;
+  UINT              DstZ            = 0;
+  ID3D11Resource*   pSrcResource    = nullptr;
+  UINT              SrcSubresource  = 0;
+  bool              hasSrcBox       = false;
+  D3D11_BOX         SrcBox          = { };
+  /** Hash of the uploaded data for writes and updates, or 0 */
+  uint64_t          payload         = 0;
+};
+
+using DeferredOpList = std::vector<DeferredOp>;
+
+/**
+ * \brief Tracks uploads and copies of deferred contexts
+ *
+ * Work recorded on a deferred context only happens once its
+ * command list is executed on the immediate context, so the ops
+ * are kept per deferred context, move to the command list on
+ * FinishCommandList, and are handed to the trackers each time
+ * the list is executed. Lists executed on other deferred
+ * contexts are inlined into those contexts.
+ *
+ * Contexts and command lists are identified by their key, and
+ * dropped when they are destroyed. Thread-safe.
+ */
+class CommandListTracker {
+
+public:
+
+  /**
+   * \brief Records an op on a deferred context
+   *
+   * \param [in] Context Deferred context
+   * \param [in] Op Upload or copy
+   */
+  void record(const core::ResourceKey& Context, const DeferredOp& Op);
+
+  /**
+   * \brief Records execution of a command list on a deferred context
+   *
+   * \param [in] Context Deferred context
+   * \param [in] CommandList Executed command list
+   */
+  void recordCommandList(const core::ResourceKey& Context, const core::ResourceKey& CommandList);
+
+  /**
+   * \brief Moves the ops of a deferred context to its command list
+   *
+   * \param [in] Context Deferred context
+   * \param [in] CommandList New command list, or a null key if
+   *    FinishCommandList failed, in which case the ops are dropped
+   */
+  void finish(const core::ResourceKey& Context, const core::ResourceKey& CommandList);
+
+  /**
+   * \brief Returns the ops of a command list for execution
+   *
+   * \param [in] CommandList Command list
+   * \returns Recorded ops, or \c nullptr if there are none
+   */
+  std::shared_ptr<const DeferredOpList> execute(const core::ResourceKey& CommandList);
+
+  /**
+   * \brief Forgets a destroyed context or command list
+   *
+   * \param [in] Object Object
+   */
+  void retire(const core::ResourceKey& Object);
+
+  /**
+   * \brief Returns and resets counters
+   */
+  CommandListStats takeStats();
+
+private:
+
+  mutex                                 m_mutex;
+
+  std::unordered_map<core::ResourceKey, DeferredOpList,
+    core::ResourceKeyHash>              m_contexts;
+
+  std::unordered_map<core::ResourceKey, std::shared_ptr<const DeferredOpList>,
+    core::ResourceKeyHash>              m_commandLists;
+
+  CommandListStats                      m_stats;
+
+};
+
+}
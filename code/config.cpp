@@ -0,0 +1,82 @@
+#include <cstdlib>
+
+#include "config.h"
+#include "profile.h"
+
+namespace atfix {
+
+static bool getEnvFlag(const char* pName, bool defaultValue) {
+  const char* value = std::getenv(pName);
+
+  if (!value || !value[0])
+    return defaultValue;
+
+  return value[0] != '0';
+}
+
+static uint32_t getEnvUint(const char* pName, uint32_t defaultValue) {
+  const char* value = std::getenv(pName);
+
+  if (!value || !value[0])
+    return defaultValue;
+
+  return uint32_t(std::strtoul(value, nullptr, 10));
+}
+
+static double getEnvFloat(const char* pName, double defaultValue) {
+  const char* value = std::getenv(pName);
+
+  if (!value || !value[0])
+    return defaultValue;
+
+  return std::strtod(value, nullptr);
+}
+
+static const char* getEnvString(const char* pName, const char* defaultValue) {
+  const char* value = std::getenv(pName);
+
+  if (!value || !value[0])
+    return defaultValue;
+
+  return value;
+}
+
+static Config loadConfig() {
+  Config config;
+  config.profile = &selectGameProfile(getExecutableIdentity(),
+    getEnvString("ATFIX_PROFILE", nullptr));
+
+  if (config.profile->configure)
+    config.profile->configure(config);
+
+  config.shadowCache = getEnvFlag("ATFIX_SHADOW_CACHE", config.shadowCache);
+  config.shadowCacheEntries = getEnvUint("ATFIX_SHADOW_CACHE_ENTRIES", config.shadowCacheEntries);
+  config.speculativeReadback = getEnvFlag("ATFIX_SPECULATIVE_READBACK", config.speculativeReadback);
+  config.speculativeCacheMiB = getEnvUint("ATFIX_SPECULATIVE_CACHE_MIB", config.speculativeCacheMiB);
+  config.speculativeMaxMismatches = getEnvUint("ATFIX_SPECULATIVE_MAX_MISMATCHES", config.speculativeMaxMismatches);
+  config.validationRate = getEnvFloat("ATFIX_VALIDATION_RATE", config.validationRate);
+  config.validationDepth = getEnvUint("ATFIX_VALIDATION_DEPTH", config.validationDepth);
+  config.dirtyTracking = getEnvFlag("ATFIX_DIRTY_TRACKING", config.dirtyTracking);
+  config.dirtyTrackingCalibration = getEnvUint("ATFIX_DIRTY_TRACKING_CALIBRATION", config.dirtyTrackingCalibration);
+  config.readProfiling = getEnvFlag("ATFIX_READ_PROFILING", config.readProfiling);
+  config.readProfilingStableMaps = getEnvUint("ATFIX_READ_PROFILING_STABLE", config.readProfilingStableMaps);
+  config.copyShrinking = getEnvFlag("ATFIX_COPY_SHRINKING", config.copyShrinking);
+  config.flushCoalescing = getEnvFlag("ATFIX_FLUSH_COALESCING", config.flushCoalescing);
+  config.flushCoalescingWindowUs = getEnvUint("ATFIX_FLUSH_COALESCING_WINDOW_US", config.flushCoalescingWindowUs);
+  config.hazardDetection = getEnvFlag("ATFIX_HAZARD_DETECTION", config.hazardDetection);
+  config.hazardReportTop = getEnvUint("ATFIX_HAZARD_REPORT_TOP", config.hazardReportTop);
+  config.strategyControl = getEnvFlag("ATFIX_STRATEGY_CONTROL", config.strategyControl);
+  config.strategyExploreEpisodes = getEnvUint("ATFIX_STRATEGY_EXPLORE_EPISODES", config.strategyExploreEpisodes);
+  config.strategyRegression = getEnvFloat("ATFIX_STRATEGY_REGRESSION", config.strategyRegression);
+  config.strategyRegressionMinUs = getEnvUint("ATFIX_STRATEGY_REGRESSION_MIN_US", config.strategyRegressionMinUs);
+  config.deferredContexts = getEnvFlag("ATFIX_DEFERRED_CONTEXTS", config.deferredContexts);
+  config.rulesFile = getEnvString("ATFIX_RULES", config.rulesFile);
+  return config;
+}
+
+const Config& getConfig() {
+  static const Config s_config = loadConfig();
+  return s_config;
+}
+
+}
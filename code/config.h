@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+
+namespace atfix {
+
+struct GameProfile;
+
+/**
+ * \brief Runtime options
+ *
+ * Read once from the environment, so that experimental
+ * modes can be enabled per launch without rebuilding.
+ * Defaults come from the profile of the host game.
+ */
+struct Config {
+  /** Score a readback cache without serving anything from
+   *  it (\c ATFIX_SHADOW_CACHE=1) */
+  bool      shadowCache              = false;
+  /** Entries the shadow cache holds (\c ATFIX_SHADOW_CACHE_ENTRIES) */
+  uint32_t  shadowCacheEntries       = 64;
+  /** Serve readbacks of known glyphs from a CPU cache and verify
+   *  them in the background (\c ATFIX_SPECULATIVE_READBACK=1) */
+  bool      speculativeReadback      = false;
+  /** Memory the compressed speculative cache may hold, in MiB
+   *  (\c ATFIX_SPECULATIVE_CACHE_MIB) */
+  uint32_t  speculativeCacheMiB      = 16;
+  /** Mismatches after which speculation turns itself off
+   *  (\c ATFIX_SPECULATIVE_MAX_MISMATCHES) */
+  uint32_t  speculativeMaxMismatches = 4;
+  /** Fraction of readbacks served from CPU data that are checked
+   *  against the GPU (\c ATFIX_VALIDATION_RATE) */
+  double    validationRate           = 0.1;
+  /** Validation copies in flight (\c ATFIX_VALIDATION_DEPTH) */
+  uint32_t  validationDepth          = 8;
+  /** Hand WRITE_DISCARD maps of glyph textures a write-protected
+   *  shadow and only upload dirty rows (\c ATFIX_DIRTY_TRACKING=1) */
+  bool      dirtyTracking            = false;
+  /** Maps that compare shadowed and direct maps before deciding to
+   *  keep dirty tracking, 0 to always keep it
+   *  (\c ATFIX_DIRTY_TRACKING_CALIBRATION) */
+  uint32_t  dirtyTrackingCalibration = 64;
+  /** Record which rows of glyph readbacks the game reads, per
+   *  call site (\c ATFIX_READ_PROFILING=1) */
+  bool      readProfiling            = false;
+  /** Maps without a growing footprint after which a call site is
+   *  stable (\c ATFIX_READ_PROFILING_STABLE) */
+  uint32_t  readProfilingStableMaps  = 32;
+  /** Only copy the rows of glyph readbacks that the game reads once
+   *  footprints are stable, implies profiling (\c ATFIX_COPY_SHRINKING=1) */
+  bool      copyShrinking            = false;
+  /** Drop flushes during glyph readback bursts unless a pending
+   *  readback copy needs them (\c ATFIX_FLUSH_COALESCING=1) */
+  bool      flushCoalescing          = false;
+  /** Time after a readback during which flushes are coalesced, in
+   *  microseconds (\c ATFIX_FLUSH_COALESCING_WINDOW_US) */
+  uint32_t  flushCoalescingWindowUs  = 20000;
+  /** Rank all readbacks by stall per resource pattern
+   *  (\c ATFIX_HAZARD_DETECTION=1) */
+  bool      hazardDetection          = false;
+  /** Patterns logged per menu open (\c ATFIX_HAZARD_REPORT_TOP) */
+  uint32_t  hazardReportTop          = 5;
+  /** Choose readback strategies per resource pattern from measured
+   *  stall (\c ATFIX_STRATEGY_CONTROL=1) */
+  bool      strategyControl          = false;
+  /** Menu opens measured per pattern before committing to a
+   *  strategy (\c ATFIX_STRATEGY_EXPLORE_EPISODES) */
+  uint32_t  strategyExploreEpisodes  = 8;
+  /** Slowdown of the committed strategy that restarts exploration
+   *  (\c ATFIX_STRATEGY_REGRESSION) */
+  double    strategyRegression       = 1.5;
+  /** Smallest slowdown per readback, in microseconds, that restarts
+   *  exploration (\c ATFIX_STRATEGY_REGRESSION_MIN_US) */
+  uint32_t  strategyRegressionMinUs  = 200;
+  /** Hook deferred contexts and pass their uploads and copies to
+   *  the other modes when their command lists are executed on the
+   *  immediate context (\c ATFIX_DEFERRED_CONTEXTS=0 to disable) */
+  bool      deferredContexts         = true;
+  /** Pattern rules file, relative to the game directory
+   *  (\c ATFIX_RULES) */
+  const char* rulesFile              = "atfix.ini";
+  /** Profile the defaults were taken from, selected by executable
+   *  unless forced by name (\c ATFIX_PROFILE) */
+  const GameProfile* profile         = nullptr;
+};
+
+/**
+ * \brief Returns runtime options
+ */
+const Config& getConfig();
+
+}
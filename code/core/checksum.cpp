@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "checksum.h"
+
+namespace atfix::core {
+
+uint32_t calculateChecksum(const void* pData, uint32_t rowPitch, uint32_t rowSize, uint32_t rowCount) {
+  return calculateChecksum(pData, rowPitch, rowPitch * rowCount, rowSize, rowCount, 1);
+}
+
+uint32_t calculateChecksum(const void* pData, uint32_t rowPitch, uint32_t depthPitch,
+    uint32_t rowSize, uint32_t rowCount, uint32_t sliceCount) {
+  if (!pData)
+    return 0;
+
+  // Simple CRC32-like checksum using XOR and rotation
+  uint32_t checksum = 0x12345678;
+  const uint8_t* bytes = static_cast<const uint8_t*>(pData);
+
+  for (uint32_t slice = 0; slice < sliceCount; slice++) {
+    const uint8_t* sliceData = bytes + size_t(slice) * depthPitch;
+
+    for (uint32_t row = 0; row < rowCount; row++) {
+      const uint8_t* rowData = sliceData + size_t(row) * rowPitch;
+
+      for (uint32_t col = 0; col < rowSize; col++)
+        checksum = ((checksum << 5) | (checksum >> 27)) ^ rowData[col];
+    }
+  }
+
+  return checksum;
+}
+
+static inline uint64_t mixHash(uint64_t hash, uint64_t word) {
+  hash ^= word;
+  hash = (hash << 29) | (hash >> 35);
+  return hash * 0x9fb21c651e98df25ull;
+}
+
+uint64_t calculateHash(const void* pData, uint32_t rowPitch, uint32_t rowSize, uint32_t rowCount) {
+  return calculateHash(pData, rowPitch, rowPitch * rowCount, rowSize, rowCount, 1);
+}
+
+uint64_t calculateHash(const void* pData, uint32_t rowPitch, uint32_t depthPitch,
+    uint32_t rowSize, uint32_t rowCount, uint32_t sliceCount) {
+  if (!pData)
+    return 0;
+
+  // Four independent lanes, so that the multiplies can overlap
+  constexpr uint32_t LaneCount = 4;
+  constexpr uint32_t BlockSize = LaneCount * sizeof(uint64_t);
+
+  uint64_t lanes[LaneCount] = {
+    0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full,
+    0x165667b19e3779f9ull, 0x85ebca77c2b2ae63ull,
+  };
+
+  lanes[0] ^= (uint64_t(rowSize) << 32) | (rowCount * sliceCount);
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(pData);
+
+  for (uint32_t slice = 0; slice < sliceCount; slice++) {
+    const uint8_t* sliceData = bytes + size_t(slice) * depthPitch;
+
+    for (uint32_t row = 0; row < rowCount; row++) {
+      const uint8_t* rowData = sliceData + size_t(row) * rowPitch;
+      uint32_t col = 0;
+
+      for ( ; col + BlockSize <= rowSize; col += BlockSize) {
+        uint64_t words[LaneCount];
+        std::memcpy(words, &rowData[col], sizeof(words));
+
+        for (uint32_t i = 0; i < LaneCount; i++)
+          lanes[i] = mixHash(lanes[i], words[i]);
+      }
+
+      for ( ; col < rowSize; col += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        std::memcpy(&word, &rowData[col], std::min<uint32_t>(rowSize - col, sizeof(word)));
+        lanes[0] = mixHash(lanes[0], word);
+      }
+    }
+  }
+
+  uint64_t hash = lanes[0];
+
+  for (uint32_t i = 1; i < LaneCount; i++)
+    hash = mixHash(hash, lanes[i]);
+
+  // splitmix64 finalizer
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+  return hash ^ (hash >> 31);
+}
+
+}
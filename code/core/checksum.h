@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+namespace atfix::core {
+
+/**
+ * \brief Computes the checksum of a mapped image
+ *
+ * Rotate-and-xor hash over \c rowSize bytes of each row, so
+ * that row padding does not affect the result. This is the
+ * checksum written to traces, offline tools rely on it.
+ * \param [in] pData Pointer to the first row
+ * \param [in] rowPitch Distance between rows, in bytes
+ * \param [in] rowSize Number of bytes to hash per row
+ * \param [in] rowCount Number of rows
+ * \returns Checksum, or 0 if \c pData is null
+ */
+uint32_t calculateChecksum(const void* pData, uint32_t rowPitch, uint32_t rowSize, uint32_t rowCount);
+
+/**
+ * \brief Computes the checksum of a mapped image with several slices
+ *
+ * Slices are checksummed like one image of \c rowCount times
+ * \c sliceCount rows, so the result does not depend on the
+ * depth pitch. Same as \c calculateChecksum for one slice.
+ * \param [in] pData Pointer to the first row of the first slice
+ * \param [in] rowPitch Distance between rows, in bytes
+ * \param [in] depthPitch Distance between slices, in bytes
+ * \param [in] rowSize Number of bytes to hash per row
+ * \param [in] rowCount Number of rows per slice
+ * \param [in] sliceCount Number of slices
+ * \returns Checksum, or 0 if \c pData is null
+ */
+uint32_t calculateChecksum(const void* pData, uint32_t rowPitch, uint32_t depthPitch,
+  uint32_t rowSize, uint32_t rowCount, uint32_t sliceCount);
+
+/**
+ * \brief Computes a content hash of a mapped image
+ *
+ * 64-bit multiply-rotate hash over \c rowSize bytes of each row.
+ * Unlike \c calculateChecksum, which only rotates its state on
+ * zero bytes and therefore maps a glyph moved by 8 pixels or by
+ * any number of rows to the same value, this depends on where
+ * the data is. Used to key cached image data.
+ * \param [in] pData Pointer to the first row
+ * \param [in] rowPitch Distance between rows, in bytes
+ * \param [in] rowSize Number of bytes to hash per row
+ * \param [in] rowCount Number of rows
+ * \returns Hash, or 0 if \c pData is null
+ */
+uint64_t calculateHash(const void* pData, uint32_t rowPitch, uint32_t rowSize, uint32_t rowCount);
+
+/**
+ * \brief Computes a content hash of a mapped image with several slices
+ *
+ * Same as \c calculateHash of one image of \c rowCount times
+ * \c sliceCount rows, so that data read back through different
+ * depth pitches, or packed into one image, hashes the same.
+ * \param [in] pData Pointer to the first row of the first slice
+ * \param [in] rowPitch Distance between rows, in bytes
+ * \param [in] depthPitch Distance between slices, in bytes
+ * \param [in] rowSize Number of bytes to hash per row
+ * \param [in] rowCount Number of rows per slice
+ * \param [in] sliceCount Number of slices
+ * \returns Hash, or 0 if \c pData is null
+ */
+uint64_t calculateHash(const void* pData, uint32_t rowPitch, uint32_t depthPitch,
+  uint32_t rowSize, uint32_t rowCount, uint32_t sliceCount);
+
+}
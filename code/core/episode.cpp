@@ -0,0 +1,18 @@
+#include "episode.h"
+
+namespace atfix::core {
+
+bool EpisodeDetector::addCall(uint64_t timestampUs) {
+  bool isNew = !m_episodeCount || timestampUs - m_lastUs > m_gapUs;
+
+  if (isNew) {
+    m_episodeCount += 1;
+    m_episodeCalls = 0;
+  }
+
+  m_episodeCalls += 1;
+  m_lastUs = timestampUs;
+  return isNew;
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+namespace atfix::core {
+
+/**
+ * \brief Splits a call stream into episodes
+ *
+ * An episode, e.g. one menu open, ends whenever the gap between
+ * two consecutive calls exceeds a threshold. Works on recorded
+ * traces as well as on live calls.
+ */
+class EpisodeDetector {
+
+public:
+
+  explicit EpisodeDetector(uint64_t gapUs)
+  : m_gapUs(gapUs) { }
+
+  /**
+   * \brief Registers a call
+   *
+   * \param [in] timestampUs Time of the call
+   * \returns \c true if the call starts a new episode
+   */
+  bool addCall(uint64_t timestampUs);
+
+  /**
+   * \brief Number of episodes seen so far
+   */
+  uint32_t getEpisodeCount() const {
+    return m_episodeCount;
+  }
+
+  /**
+   * \brief Number of calls in the current episode
+   */
+  uint32_t getEpisodeCallCount() const {
+    return m_episodeCalls;
+  }
+
+private:
+
+  uint64_t  m_gapUs;
+  uint64_t  m_lastUs        = 0;
+  uint32_t  m_episodeCount  = 0;
+  uint32_t  m_episodeCalls  = 0;
+
+};
+
+}
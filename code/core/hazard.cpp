@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <sstream>
+
+#include "hazard.h"
+
+namespace atfix::core {
+
+bool HazardSignature::operator == (const HazardSignature& other) const {
+  return dimension == other.dimension && desc == other.desc
+      && mapType == other.mapType && producer == other.producer
+      && srcDimension == other.srcDimension && srcDesc == other.srcDesc
+      && srcProducer == other.srcProducer;
+}
+
+
+size_t HazardSignatureHash::operator () (const HazardSignature& signature) const {
+  uint64_t h = ResourceDescHash()(signature.desc);
+  h = h * 0x9e3779b97f4a7c15ull ^ ResourceDescHash()(signature.srcDesc);
+  h = h * 0x9e3779b97f4a7c15ull ^ (uint32_t(signature.dimension) << 0)
+    ^ (uint32_t(signature.srcDimension) << 4) ^ (uint32_t(signature.mapType) << 8)
+    ^ (uint32_t(signature.producer) << 12) ^ (uint32_t(signature.srcProducer) << 16);
+  return size_t(h);
+}
+
+
+void HazardDetector::registerWrite(const ResourceKey& resource, WriteKind kind) {
+  std::lock_guard lock(m_mutex);
+
+  Producer& producer = m_producers[resource];
+  producer = Producer();
+  producer.kind = kind;
+}
+
+
+void HazardDetector::registerCopy(
+  const ResourceKey&    dst,
+  const ResourceKey&    src,
+        WriteKind       kind,
+        Dimension       srcDimension,
+  const ResourceDesc&   srcDesc) {
+  std::lock_guard lock(m_mutex);
+
+  auto srcEntry = m_producers.find(src);
+
+  Producer producer;
+  producer.kind = kind;
+  producer.srcDimension = srcDimension;
+  producer.srcDesc = srcDesc;
+  producer.srcKind = srcEntry != m_producers.end()
+    ? srcEntry->second.kind : WriteKind::Unobserved;
+
+  m_producers[dst] = producer;
+}
+
+
+void HazardDetector::registerReadback(
+  const ResourceKey&    resource,
+        Dimension       dimension,
+  const ResourceDesc&   desc,
+        MapType         mapType,
+        uint64_t        stallUs) {
+  std::lock_guard lock(m_mutex);
+
+  HazardSignature signature;
+  signature.dimension = dimension;
+  signature.desc = desc;
+  signature.mapType = mapType;
+
+  auto entry = m_producers.find(resource);
+
+  if (entry != m_producers.end()) {
+    signature.producer = entry->second.kind;
+    signature.srcDimension = entry->second.srcDimension;
+    signature.srcDesc = entry->second.srcDesc;
+    signature.srcProducer = entry->second.srcKind;
+  }
+
+  HazardStats& stats = m_stats[signature];
+  stats.signature = signature;
+  stats.readbacks += 1;
+  stats.stallUs += stallUs;
+  stats.maxStallUs = std::max(stats.maxStallUs, stallUs);
+}
+
+
+void HazardDetector::retire(const ResourceKey& resource) {
+  std::lock_guard lock(m_mutex);
+
+  m_producers.erase(resource);
+}
+
+
+std::vector<HazardStats> HazardDetector::takeTop(size_t count) {
+  std::lock_guard lock(m_mutex);
+
+  std::vector<HazardStats> result;
+  result.reserve(m_stats.size());
+
+  for (const auto& entry : m_stats)
+    result.push_back(entry.second);
+
+  m_stats.clear();
+
+  std::sort(result.begin(), result.end(), [] (const HazardStats& a, const HazardStats& b) {
+    return a.stallUs > b.stallUs;
+  });
+
+  if (result.size() > count)
+    result.resize(count);
+
+  return result;
+}
+
+
+const char* dimensionToString(Dimension dimension) {
+  switch (dimension) {
+    case Dimension::Unknown:    return "UNKNOWN";
+    case Dimension::Buffer:     return "BUFFER";
+    case Dimension::Texture1D:  return "TEXTURE1D";
+    case Dimension::Texture2D:  return "TEXTURE2D";
+    case Dimension::Texture3D:  return "TEXTURE3D";
+  }
+
+  return "UNKNOWN";
+}
+
+
+const char* writeKindToString(WriteKind kind) {
+  switch (kind) {
+    case WriteKind::Unobserved: return "GPU";
+    case WriteKind::CpuWrite:   return "CPU";
+    case WriteKind::Copy:       return "COPY";
+    case WriteKind::Resolve:    return "RESOLVE";
+    case WriteKind::Update:     return "UPDATE";
+  }
+
+  return "UNKNOWN";
+}
+
+
+static void formatDesc(std::ostringstream& oss, Dimension dimension, const ResourceDesc& desc) {
+  oss << dimensionToString(dimension) << " " << formatResourceDesc(desc);
+}
+
+
+std::string formatHazardSignature(const HazardSignature& signature) {
+  std::ostringstream oss;
+  oss << mapTypeToString(signature.mapType) << " ";
+  formatDesc(oss, signature.dimension, signature.desc);
+
+  if (signature.producer == WriteKind::Copy || signature.producer == WriteKind::Resolve) {
+    oss << " <- " << writeKindToString(signature.producer) << " from ";
+    formatDesc(oss, signature.srcDimension, signature.srcDesc);
+    oss << " <- " << writeKindToString(signature.srcProducer);
+  } else {
+    oss << " <- " << writeKindToString(signature.producer);
+  }
+
+  return oss.str();
+}
+
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sync.h"
+#include "types.h"
+
+namespace atfix::core {
+
+/**
+ * \brief Resource dimension
+ *
+ * Values match \c D3D11_RESOURCE_DIMENSION.
+ */
+enum class Dimension : uint32_t {
+  Unknown   = 0,
+  Buffer    = 1,
+  Texture1D = 2,
+  Texture2D = 3,
+  Texture3D = 4,
+};
+
+/**
+ * \brief Last observed write to a resource
+ */
+enum class WriteKind : uint32_t {
+  /** No hooked call wrote the resource, so it was written by
+   *  a draw or dispatch, or not written at all */
+  Unobserved  = 0,
+  /** CPU write through Map */
+  CpuWrite    = 1,
+  /** CopyResource or CopySubresourceRegion */
+  Copy        = 2,
+  /** ResolveSubresource */
+  Resolve     = 3,
+  /** UpdateSubresource */
+  Update      = 4,
+};
+
+/**
+ * \brief Resource class a readback hazard is ranked by
+ *
+ * Describes the mapped resource, how it got its data, and
+ * for copies, the source and how that got its data. Two
+ * readbacks with the same signature would be handled by
+ * the same fast path.
+ */
+struct HazardSignature {
+  Dimension     dimension       = Dimension::Unknown;
+  ResourceDesc  desc;
+  MapType       mapType         = MapType::Read;
+  WriteKind     producer        = WriteKind::Unobserved;
+  Dimension     srcDimension    = Dimension::Unknown;
+  ResourceDesc  srcDesc;
+  WriteKind     srcProducer     = WriteKind::Unobserved;
+
+  bool operator == (const HazardSignature& other) const;
+};
+
+struct HazardSignatureHash {
+  size_t operator () (const HazardSignature& signature) const;
+};
+
+/**
+ * \brief Stall accumulated by one signature
+ */
+struct HazardStats {
+  HazardSignature signature;
+  /** Readbacks with this signature */
+  uint64_t readbacks  = 0;
+  /** Time spent inside Map, in microseconds */
+  uint64_t stallUs    = 0;
+  /** Longest single Map, in microseconds */
+  uint64_t maxStallUs = 0;
+};
+
+/**
+ * \brief Finds the resource patterns whose readbacks stall
+ *
+ * Follows every resource to the last hooked call that wrote it,
+ * and every copy to the writer of its source, so that readbacks
+ * can be grouped by descriptors and producers instead of a
+ * compiled-in pattern. Readback stalls are summed per group.
+ *
+ * Resources are only used as keys and never dereferenced.
+ * Thread-safe.
+ */
+class HazardDetector {
+
+public:
+
+  /**
+   * \brief Registers a write from the CPU to a resource
+   *
+   * \param [in] resource Written resource
+   * \param [in] kind \c CpuWrite or \c Update
+   */
+  void registerWrite(const ResourceKey& resource, WriteKind kind);
+
+  /**
+   * \brief Registers a copy or resolve
+   *
+   * \param [in] dst Destination resource
+   * \param [in] src Source resource
+   * \param [in] kind \c Copy or \c Resolve
+   * \param [in] srcDimension Source dimension
+   * \param [in] srcDesc Source properties
+   */
+  void registerCopy(
+    const ResourceKey&    dst,
+    const ResourceKey&    src,
+          WriteKind       kind,
+          Dimension       srcDimension,
+    const ResourceDesc&   srcDesc);
+
+  /**
+   * \brief Registers a completed Map(READ) or Map(READ_WRITE)
+   *
+   * \param [in] resource Mapped resource
+   * \param [in] dimension Resource dimension
+   * \param [in] desc Resource properties
+   * \param [in] mapType Map type
+   * \param [in] stallUs Time spent inside Map
+   */
+  void registerReadback(
+    const ResourceKey&    resource,
+          Dimension       dimension,
+    const ResourceDesc&   desc,
+          MapType         mapType,
+          uint64_t        stallUs);
+
+  /**
+   * \brief Forgets a destroyed resource
+   *
+   * \param [in] resource Resource
+   */
+  void retire(const ResourceKey& resource);
+
+  /**
+   * \brief Returns the signatures with the most stall and resets counters
+   *
+   * \param [in] count Maximum number of signatures
+   * \returns Signatures, ordered by decreasing total stall
+   */
+  std::vector<HazardStats> takeTop(size_t count);
+
+private:
+
+  struct Producer {
+    WriteKind     kind          = WriteKind::Unobserved;
+    Dimension     srcDimension  = Dimension::Unknown;
+    ResourceDesc  srcDesc;
+    WriteKind     srcKind       = WriteKind::Unobserved;
+  };
+
+  mutex m_mutex;
+
+  std::unordered_map<ResourceKey, Producer, ResourceKeyHash> m_producers;
+  std::unordered_map<HazardSignature, HazardStats, HazardSignatureHash> m_stats;
+
+};
+
+const char* dimensionToString(Dimension dimension);
+const char* writeKindToString(WriteKind kind);
+
+/**
+ * \brief Formats a signature for the log
+ */
+std::string formatHazardSignature(const HazardSignature& signature);
+
+}
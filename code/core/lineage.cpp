@@ -0,0 +1,49 @@
+#include "lineage.h"
+
+namespace atfix::core {
+
+void LineageTracker::registerWrite(const ResourceKey& resource, uint64_t payload) {
+  std::lock_guard lock(m_mutex);
+
+  if (payload)
+    m_sources[resource] = payload;
+  else
+    m_sources.erase(resource);
+}
+
+void LineageTracker::registerCopy(const ResourceKey& dst, const ResourceKey& src) {
+  std::lock_guard lock(m_mutex);
+
+  auto payload = src.pointer ? m_sources.find(src) : m_sources.end();
+
+  if (payload != m_sources.end())
+    m_copies[dst] = payload->second;
+  else
+    m_copies.erase(dst);
+}
+
+bool LineageTracker::getPayload(const ResourceKey& resource, uint64_t* pPayload) const {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_copies.find(resource);
+
+  if (entry == m_copies.end())
+    return false;
+
+  *pPayload = entry->second;
+  return true;
+}
+
+void LineageTracker::retire(const ResourceKey& resource) {
+  std::lock_guard lock(m_mutex);
+  m_sources.erase(resource);
+  m_copies.erase(resource);
+}
+
+void LineageTracker::clear() {
+  std::lock_guard lock(m_mutex);
+  m_sources.clear();
+  m_copies.clear();
+}
+
+}
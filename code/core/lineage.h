@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "sync.h"
+#include "types.h"
+
+namespace atfix::core {
+
+/**
+ * \brief Tracks which payload each resource holds
+ *
+ * A payload is the content hash of the data the game uploaded
+ * to a source texture. Copies pass it on to their destination,
+ * so that a readback can be traced back to the upload that
+ * produced it. Resources are only used as keys and never
+ * dereferenced. Keys include the resource generation, so a
+ * new texture at a reused address starts out unknown.
+ * Thread-safe.
+ */
+class LineageTracker {
+
+public:
+
+  /**
+   * \brief Registers a write to a source resource
+   *
+   * \param [in] resource Written resource
+   * \param [in] payload Hash of the written data, or 0
+   *    if unknown, in which case the resource is forgotten
+   */
+  void registerWrite(const ResourceKey& resource, uint64_t payload);
+
+  /**
+   * \brief Registers a copy
+   *
+   * The destination inherits the payload of the source.
+   * \param [in] dst Destination resource
+   * \param [in] src Source resource, or a null key if the
+   *    copy does not reproduce the source payload
+   */
+  void registerCopy(const ResourceKey& dst, const ResourceKey& src);
+
+  /**
+   * \brief Queries the payload a resource holds
+   *
+   * \param [in] resource Resource
+   * \param [out] pPayload Payload, if known
+   * \returns \c true if the payload is known
+   */
+  bool getPayload(const ResourceKey& resource, uint64_t* pPayload) const;
+
+  /**
+   * \brief Forgets a destroyed resource
+   *
+   * \param [in] resource Resource
+   */
+  void retire(const ResourceKey& resource);
+
+  void clear();
+
+private:
+
+  using PayloadMap = std::unordered_map<ResourceKey, uint64_t, ResourceKeyHash>;
+
+  mutable mutex                             m_mutex;
+
+  PayloadMap                                m_sources;
+  PayloadMap                                m_copies;
+
+};
+
+}
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cstring>
+
+#include "checksum.h"
+#include "readback_cache.h"
+
+namespace atfix::core {
+
+/** Granularity of bounds and segments, in bytes */
+constexpr uint32_t ChunkSize = 8;
+
+/** Zero chunks that end a literal. Shorter gaps are stored
+ *  as literal zeros, since every segment costs 8 bytes. */
+constexpr uint32_t MinGapChunks = 2;
+
+static bool isZeroChunk(const uint8_t* pData, uint32_t size) {
+  if (size == ChunkSize) {
+    uint64_t value;
+    std::memcpy(&value, pData, sizeof(value));
+    return !value;
+  }
+
+  for (uint32_t i = 0; i < size; i++) {
+    if (pData[i])
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * \brief Skips zero chunks
+ *
+ * Tests four chunks at a time while possible, since most
+ * of a glyph texture is empty.
+ * \returns Offset of the first non-zero chunk at or after
+ *    \c x, or a value not less than \c end if there is none
+ */
+static uint32_t skipZeroChunks(const uint8_t* pRow, uint32_t x, uint32_t end) {
+  while (x + 4 * ChunkSize <= end) {
+    uint64_t values[4];
+    std::memcpy(values, pRow + x, sizeof(values));
+
+    if (values[0] | values[1] | values[2] | values[3])
+      break;
+
+    x += 4 * ChunkSize;
+  }
+
+  while (x < end && isZeroChunk(pRow + x, std::min(ChunkSize, end - x)))
+    x += ChunkSize;
+
+  return x;
+}
+
+static void writeCount(std::vector<uint8_t>& stream, size_t offset, uint32_t count) {
+  std::memcpy(&stream[offset], &count, sizeof(count));
+}
+
+static void appendCount(std::vector<uint8_t>& stream, uint32_t count) {
+  stream.resize(stream.size() + sizeof(count));
+  writeCount(stream, stream.size() - sizeof(count), count);
+}
+
+static uint32_t readCount(const uint8_t*& pStream) {
+  uint32_t count;
+  std::memcpy(&count, pStream, sizeof(count));
+  pStream += sizeof(count);
+  return count;
+}
+
+static void compressRow(std::vector<uint8_t>& stream, const uint8_t* pRow, uint32_t colBegin, uint32_t colEnd) {
+  size_t countOffset = stream.size();
+  appendCount(stream, 0);
+
+  uint32_t segments = 0;
+  uint32_t cursor = colBegin;
+  uint32_t x = colBegin;
+
+  while (x < colEnd) {
+    x = skipZeroChunks(pRow, x, colEnd);
+
+    if (x >= colEnd)
+      break;
+
+    uint32_t literalBegin = x;
+    uint32_t literalEnd = x;
+    uint32_t gap = 0;
+
+    while (x < colEnd && gap < MinGapChunks) {
+      uint32_t size = std::min(ChunkSize, colEnd - x);
+
+      if (isZeroChunk(pRow + x, size)) {
+        gap += 1;
+      } else {
+        gap = 0;
+        literalEnd = x + size;
+      }
+
+      x += size;
+    }
+
+    appendCount(stream, literalBegin - cursor);
+    appendCount(stream, literalEnd - literalBegin);
+    stream.insert(stream.end(), pRow + literalBegin, pRow + literalEnd);
+
+    cursor = literalEnd;
+    segments += 1;
+  }
+
+  writeCount(stream, countOffset, segments);
+}
+
+/** Row of possibly sliced source data, rows are
+ *  numbered across slices */
+static const uint8_t* getSourceRow(const uint8_t* pData, uint32_t row,
+    uint32_t rowPitch, uint32_t depthPitch, uint32_t rowCount) {
+  return pData + size_t(row / rowCount) * depthPitch + size_t(row % rowCount) * rowPitch;
+}
+
+std::shared_ptr<const ReadbackImage> createReadbackImage(
+  const void* pData, uint32_t rowPitch, uint32_t rowSize, uint32_t rowCount) {
+  return createReadbackImage(pData, rowPitch, rowPitch * rowCount, rowSize, rowCount, 1);
+}
+
+std::shared_ptr<const ReadbackImage> createReadbackImage(
+  const void* pData, uint32_t rowPitch, uint32_t depthPitch,
+  uint32_t rowSize, uint32_t rowCount, uint32_t sliceCount) {
+  auto image = std::make_shared<ReadbackImage>();
+  image->rowSize = rowSize;
+  image->rowCount = rowCount * sliceCount;
+  image->sliceCount = sliceCount;
+  image->hash = calculateHash(pData, rowPitch, depthPitch, rowSize, rowCount, sliceCount);
+
+  auto src = reinterpret_cast<const uint8_t*>(pData);
+
+  // Find the bounding box of non-zero chunks
+  uint32_t rowBegin = image->rowCount;
+  uint32_t rowEnd = 0;
+  uint32_t colBegin = rowSize;
+  uint32_t colEnd = 0;
+
+  for (uint32_t y = 0; y < image->rowCount && rowSize; y++) {
+    const uint8_t* row = getSourceRow(src, y, rowPitch, depthPitch, rowCount);
+
+    uint32_t first = skipZeroChunks(row, 0, rowSize);
+
+    if (first >= rowSize)
+      continue;
+
+    uint32_t last = ((rowSize - 1) / ChunkSize) * ChunkSize;
+
+    while (isZeroChunk(row + last, std::min(ChunkSize, rowSize - last)))
+      last -= ChunkSize;
+
+    rowBegin = std::min(rowBegin, y);
+    rowEnd = y + 1;
+    colBegin = std::min(colBegin, first);
+    colEnd = std::max(colEnd, std::min(last + ChunkSize, rowSize));
+  }
+
+  if (rowBegin >= rowEnd)
+    return image;
+
+  image->rowBegin = rowBegin;
+  image->rowEnd = rowEnd;
+  image->colBegin = colBegin;
+  image->colEnd = colEnd;
+
+  for (uint32_t y = rowBegin; y < rowEnd; y++)
+    compressRow(image->stream, getSourceRow(src, y, rowPitch, depthPitch, rowCount), colBegin, colEnd);
+
+  image->stream.shrink_to_fit();
+  return image;
+}
+
+void decompressReadbackImage(const ReadbackImage& image, void* pDst, uint32_t dstPitch) {
+  auto dst = reinterpret_cast<uint8_t*>(pDst);
+  const uint8_t* stream = image.stream.data();
+
+  for (uint32_t y = 0; y < image.rowCount; y++) {
+    uint8_t* row = &dst[size_t(y) * dstPitch];
+
+    if (y < image.rowBegin || y >= image.rowEnd) {
+      std::memset(row, 0, image.rowSize);
+      continue;
+    }
+
+    std::memset(row, 0, image.colBegin);
+
+    uint32_t cursor = image.colBegin;
+    uint32_t segments = readCount(stream);
+
+    for (uint32_t i = 0; i < segments; i++) {
+      uint32_t skip = readCount(stream);
+      uint32_t length = readCount(stream);
+
+      std::memset(row + cursor, 0, skip);
+      cursor += skip;
+
+      std::memcpy(row + cursor, stream, length);
+      stream += length;
+      cursor += length;
+    }
+
+    std::memset(row + cursor, 0, image.rowSize - cursor);
+  }
+}
+
+std::shared_ptr<const ReadbackImage> ReadbackCache::lookup(uint64_t payload) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_entries.find(payload);
+
+  if (entry == m_entries.end())
+    return nullptr;
+
+  m_lru.splice(m_lru.begin(), m_lru, entry->second);
+  return entry->second->second;
+}
+
+void ReadbackCache::insert(uint64_t payload, std::shared_ptr<const ReadbackImage> image) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_entries.find(payload);
+
+  if (entry != m_entries.end())
+    remove(entry->second);
+
+  size_t size = image->getStoredSize();
+
+  if (size > m_budget)
+    return;
+
+  while (m_stats.storedBytes + size > m_budget) {
+    remove(std::prev(m_lru.end()));
+    m_stats.evictions += 1;
+  }
+
+  m_stats.entries += 1;
+  m_stats.storedBytes += size;
+  m_stats.rawBytes += image->getRawSize();
+
+  m_lru.emplace_front(payload, std::move(image));
+  m_entries.emplace(payload, m_lru.begin());
+}
+
+void ReadbackCache::invalidate(uint64_t payload) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_entries.find(payload);
+
+  if (entry != m_entries.end())
+    remove(entry->second);
+}
+
+void ReadbackCache::clear() {
+  std::lock_guard lock(m_mutex);
+  m_lru.clear();
+  m_entries.clear();
+
+  m_stats.entries = 0;
+  m_stats.storedBytes = 0;
+  m_stats.rawBytes = 0;
+}
+
+ReadbackCacheStats ReadbackCache::getStats() const {
+  std::lock_guard lock(m_mutex);
+  return m_stats;
+}
+
+void ReadbackCache::remove(LruList::iterator entry) {
+  m_stats.entries -= 1;
+  m_stats.storedBytes -= entry->second->getStoredSize();
+  m_stats.rawBytes -= entry->second->getRawSize();
+
+  m_entries.erase(entry->first);
+  m_lru.erase(entry);
+}
+
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "sync.h"
+
+namespace atfix::core {
+
+/**
+ * \brief Compressed CPU copy of read back image data
+ *
+ * Glyph images are mostly transparent, so only the bounding box
+ * of non-zero data is stored, and each of its rows as a list of
+ * segments that skip zero bytes and copy literal ones. Bounds
+ * and segments are aligned to 8 bytes relative to the row start,
+ * which keeps compression fast at the cost of a few zero bytes.
+ *
+ * Images are immutable once cached, so they can be decompressed
+ * without holding the cache lock, even if the entry is evicted.
+ */
+struct ReadbackImage {
+  /** Bytes per row and number of rows of the original data,
+   *  the rows of all slices of 3D data are stored in order */
+  uint32_t              rowSize   = 0;
+  uint32_t              rowCount  = 0;
+  /** Number of slices the rows are split into */
+  uint32_t              sliceCount = 1;
+  /** Content hash of the original data */
+  uint64_t              hash      = 0;
+  /** Bounding box of non-zero data, in rows and row bytes */
+  uint32_t              rowBegin  = 0;
+  uint32_t              rowEnd    = 0;
+  uint32_t              colBegin  = 0;
+  uint32_t              colEnd    = 0;
+  /** Per bounding box row: segment count, followed by the
+   *  segments as zero byte count, literal byte count and
+   *  literal bytes. Counts are 32-bit and unaligned. */
+  std::vector<uint8_t>  stream;
+
+  /** Size of the original data in bytes */
+  size_t getRawSize() const {
+    return size_t(rowSize) * rowCount;
+  }
+
+  /** Memory held by the image in bytes */
+  size_t getStoredSize() const {
+    return sizeof(*this) + stream.capacity();
+  }
+};
+
+/**
+ * \brief Creates a readback image from mapped data
+ *
+ * \param [in] pData Pointer to the first row
+ * \param [in] rowPitch Distance between rows of the source
+ * \param [in] rowSize Number of bytes to copy per row
+ * \param [in] rowCount Number of rows
+ * \returns Compressed image with its content hash
+ */
+std::shared_ptr<const ReadbackImage> createReadbackImage(
+  const void* pData, uint32_t rowPitch, uint32_t rowSize, uint32_t rowCount);
+
+/**
+ * \brief Creates a readback image from mapped data with several slices
+ *
+ * \param [in] pData Pointer to the first row of the first slice
+ * \param [in] rowPitch Distance between rows of the source
+ * \param [in] depthPitch Distance between slices of the source
+ * \param [in] rowSize Number of bytes to copy per row
+ * \param [in] rowCount Number of rows per slice
+ * \param [in] sliceCount Number of slices
+ * \returns Compressed image with its content hash, which
+ *    is the same as for the slices packed into one image
+ */
+std::shared_ptr<const ReadbackImage> createReadbackImage(
+  const void* pData, uint32_t rowPitch, uint32_t depthPitch,
+  uint32_t rowSize, uint32_t rowCount, uint32_t sliceCount);
+
+/**
+ * \brief Decompresses a readback image
+ *
+ * Writes every byte of every row exactly once, zero runs with
+ * \c memset and literals with \c memcpy, both of which the C
+ * runtime vectorizes.
+ * \param [in] image Image
+ * \param [out] pDst Pointer to the first destination row
+ * \param [in] dstPitch Distance between destination rows
+ */
+void decompressReadbackImage(const ReadbackImage& image, void* pDst, uint32_t dstPitch);
+
+/**
+ * \brief Readback cache memory counters
+ */
+struct ReadbackCacheStats {
+  /** Images held */
+  uint64_t entries      = 0;
+  /** Memory held by images, in bytes */
+  uint64_t storedBytes  = 0;
+  /** Uncompressed size of the images held, in bytes */
+  uint64_t rawBytes     = 0;
+  /** Images evicted to stay within the budget */
+  uint64_t evictions    = 0;
+};
+
+/**
+ * \brief LRU cache of readback images keyed by payload
+ *
+ * Holds at most a given number of bytes of compressed images,
+ * evicting the least recently used ones to make room. Images
+ * larger than the whole budget are not cached. Thread-safe.
+ */
+class ReadbackCache {
+
+public:
+
+  explicit ReadbackCache(uint64_t budget)
+  : m_budget(budget) { }
+
+  /**
+   * \brief Looks up an image and marks it as recently used
+   *
+   * \param [in] payload Payload hash
+   * \returns Cached image, or \c nullptr
+   */
+  std::shared_ptr<const ReadbackImage> lookup(uint64_t payload);
+
+  /**
+   * \brief Inserts or replaces an image
+   *
+   * Evicts least recently used images until it fits.
+   * \param [in] payload Payload hash
+   * \param [in] image Image
+   */
+  void insert(uint64_t payload, std::shared_ptr<const ReadbackImage> image);
+
+  /**
+   * \brief Removes an image
+   *
+   * \param [in] payload Payload hash
+   */
+  void invalidate(uint64_t payload);
+
+  void clear();
+
+  /**
+   * \brief Returns memory counters
+   *
+   * Evictions are counted since the cache was created.
+   */
+  ReadbackCacheStats getStats() const;
+
+private:
+
+  using LruList = std::list<std::pair<uint64_t, std::shared_ptr<const ReadbackImage>>>;
+
+  mutable mutex                                   m_mutex;
+  uint64_t                                        m_budget;
+
+  LruList                                         m_lru;
+  std::unordered_map<uint64_t, LruList::iterator> m_entries;
+
+  ReadbackCacheStats                              m_stats;
+
+  void remove(LruList::iterator entry);
+
+};
+
+}
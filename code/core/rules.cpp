@@ -0,0 +1,519 @@
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+#include "rules.h"
+
+namespace atfix::core {
+
+bool RuleDescMatch::matches(const ResourceDesc& desc) const {
+  if (desc.width < minWidth || desc.width > maxWidth
+   || desc.height < minHeight || desc.height > maxHeight)
+    return false;
+
+  if (!(usages & (1u << uint32_t(desc.usage))))
+    return false;
+
+  if (hasCpu && desc.cpuAccessFlags != cpu)
+    return false;
+
+  if (hasBind && desc.bindFlags != bind)
+    return false;
+
+  if (formats.empty())
+    return true;
+
+  for (uint32_t format : formats) {
+    if (desc.format == format)
+      return true;
+  }
+
+  return false;
+}
+
+
+bool RuleDescMatch::isAny() const {
+  return *this == RuleDescMatch();
+}
+
+
+bool RuleDescMatch::operator == (const RuleDescMatch& other) const {
+  return minWidth == other.minWidth && maxWidth == other.maxWidth
+      && minHeight == other.minHeight && maxHeight == other.maxHeight
+      && usages == other.usages && formats == other.formats
+      && hasCpu == other.hasCpu && cpu == other.cpu
+      && hasBind == other.hasBind && bind == other.bind;
+}
+
+
+bool RuleSet::addRule(const Rule& rule) {
+  uint32_t dstMask = 0;
+  uint32_t srcMask = 0;
+
+  // New conditions change the class of known descriptors
+  { std::lock_guard lock(m_classMutex);
+    m_classes.clear();
+  }
+
+  if (!getConditionMask(rule.dst, &dstMask))
+    return false;
+
+  if (rule.call == RuleCall::Copy) {
+    if (!getConditionMask(rule.src, &srcMask))
+      return false;
+
+    CopyEntry entry;
+    entry.dstMask = dstMask;
+    entry.srcMask = srcMask;
+    entry.actions = rule.actions;
+    m_copyEntries.push_back(entry);
+  } else {
+    MapEntry entry;
+    entry.mapTypes = rule.mapTypes;
+    entry.mask = dstMask;
+    entry.actions = rule.actions;
+    m_mapEntries.push_back(entry);
+  }
+
+  m_rules.push_back(rule);
+  return true;
+}
+
+
+uint32_t RuleSet::classify(const ResourceDesc& desc) const {
+  std::lock_guard lock(m_classMutex);
+
+  auto entry = m_classes.find(desc);
+
+  if (entry != m_classes.end())
+    return entry->second;
+
+  if (m_classes.size() >= MaxCachedClasses)
+    m_classes.clear();
+
+  uint32_t result = computeClass(desc);
+  m_classes.emplace(desc, result);
+  return result;
+}
+
+
+uint32_t RuleSet::computeClass(const ResourceDesc& desc) const {
+  uint32_t result = 0;
+
+  for (size_t i = 0; i < m_conditions.size(); i++) {
+    if (m_conditions[i].matches(desc))
+      result |= 1u << i;
+  }
+
+  return result;
+}
+
+
+RuleActions RuleSet::getMapActions(uint32_t resourceClass, MapType mapType) const {
+  uint32_t mapTypeBit = 1u << uint32_t(mapType);
+
+  for (const auto& entry : m_mapEntries) {
+    if ((entry.mapTypes & mapTypeBit) && (resourceClass & entry.mask) == entry.mask)
+      return entry.actions;
+  }
+
+  return 0;
+}
+
+
+RuleActions RuleSet::getCopyActions(uint32_t dstClass, uint32_t srcClass) const {
+  for (const auto& entry : m_copyEntries) {
+    if ((dstClass & entry.dstMask) == entry.dstMask
+     && (srcClass & entry.srcMask) == entry.srcMask)
+      return entry.actions;
+  }
+
+  return 0;
+}
+
+
+bool RuleSet::getConditionMask(const RuleDescMatch& match, uint32_t* pMask) {
+  // Unconstrained descriptors need no bit at all
+  if (match.isAny()) {
+    *pMask = 0;
+    return true;
+  }
+
+  for (size_t i = 0; i < m_conditions.size(); i++) {
+    if (m_conditions[i] == match) {
+      *pMask = 1u << i;
+      return true;
+    }
+  }
+
+  if (m_conditions.size() >= MaxConditions)
+    return false;
+
+  *pMask = 1u << m_conditions.size();
+  m_conditions.push_back(match);
+  return true;
+}
+
+
+static std::string trim(const std::string& str) {
+  size_t begin = 0;
+  size_t end = str.size();
+
+  while (begin < end && std::isspace(uint8_t(str[begin])))
+    begin++;
+
+  while (end > begin && std::isspace(uint8_t(str[end - 1])))
+    end--;
+
+  return str.substr(begin, end - begin);
+}
+
+
+static std::string toUpper(std::string str) {
+  for (auto& c : str)
+    c = char(std::toupper(uint8_t(c)));
+
+  return str;
+}
+
+
+static std::vector<std::string> splitList(const std::string& str) {
+  std::vector<std::string> result;
+  std::istringstream iss(str);
+  std::string item;
+
+  while (std::getline(iss, item, ',')) {
+    item = trim(item);
+
+    if (!item.empty())
+      result.push_back(item);
+  }
+
+  return result;
+}
+
+
+static bool parseNumber(const std::string& str, uint32_t* pValue) {
+  if (str.empty())
+    return false;
+
+  char* end = nullptr;
+  unsigned long value = std::strtoul(str.c_str(), &end, 0);
+
+  if (*end)
+    return false;
+
+  *pValue = uint32_t(value);
+  return true;
+}
+
+
+static bool parseRange(const std::string& str, uint32_t* pMin, uint32_t* pMax) {
+  size_t dash = str.find('-');
+
+  if (dash == std::string::npos) {
+    if (!parseNumber(str, pMin))
+      return false;
+
+    *pMax = *pMin;
+    return true;
+  }
+
+  return parseNumber(trim(str.substr(0, dash)), pMin)
+      && parseNumber(trim(str.substr(dash + 1)), pMax)
+      && *pMin <= *pMax;
+}
+
+
+static bool parseUsages(const std::string& str, uint32_t* pUsages) {
+  static const Usage s_usages[] = {
+    Usage::Default, Usage::Immutable, Usage::Dynamic, Usage::Staging };
+
+  uint32_t result = 0;
+
+  for (const auto& item : splitList(str)) {
+    std::string name = toUpper(item);
+    bool found = false;
+
+    for (Usage usage : s_usages) {
+      if (name == usageToString(usage)) {
+        result |= 1u << uint32_t(usage);
+        found = true;
+      }
+    }
+
+    if (!found)
+      return false;
+  }
+
+  *pUsages = result;
+  return result != 0;
+}
+
+
+static bool parseMapTypes(const std::string& str, uint32_t* pMapTypes) {
+  static const MapType s_mapTypes[] = {
+    MapType::Read, MapType::Write, MapType::ReadWrite,
+    MapType::WriteDiscard, MapType::WriteNoOverwrite };
+
+  uint32_t result = 0;
+
+  for (const auto& item : splitList(str)) {
+    std::string name = toUpper(item);
+    bool found = false;
+
+    for (MapType mapType : s_mapTypes) {
+      if (name == mapTypeToString(mapType)) {
+        result |= 1u << uint32_t(mapType);
+        found = true;
+      }
+    }
+
+    if (!found)
+      return false;
+  }
+
+  *pMapTypes = result;
+  return result != 0;
+}
+
+
+static bool parseActions(const std::string& str, RuleActions* pActions) {
+  RuleActions result = 0;
+
+  for (const auto& item : splitList(str)) {
+    std::string name = toUpper(item);
+
+    if (name == "TRACE")
+      result |= RuleActionTrace;
+    else if (name == "SHADOW")
+      result |= RuleActionShadow;
+    else if (name == "CACHE")
+      result |= RuleActionCache;
+    else if (name == "PROFILE")
+      result |= RuleActionProfile;
+    else if (name == "FLUSH")
+      result |= RuleActionFlush;
+    else if (name != "PASS")
+      return false;
+  }
+
+  *pActions = result;
+  return true;
+}
+
+
+static bool parseDescKey(RuleDescMatch* pMatch, const std::string& key, const std::string& value) {
+  if (key == "width")
+    return parseRange(value, &pMatch->minWidth, &pMatch->maxWidth);
+
+  if (key == "height")
+    return parseRange(value, &pMatch->minHeight, &pMatch->maxHeight);
+
+  if (key == "usage")
+    return parseUsages(value, &pMatch->usages);
+
+  if (key == "cpu")
+    return pMatch->hasCpu = parseNumber(value, &pMatch->cpu);
+
+  if (key == "bind")
+    return pMatch->hasBind = parseNumber(value, &pMatch->bind);
+
+  if (key == "format") {
+    pMatch->formats.clear();
+
+    for (const auto& item : splitList(value)) {
+      uint32_t format = 0;
+
+      if (!parseNumber(item, &format))
+        return false;
+
+      pMatch->formats.push_back(format);
+    }
+
+    return !pMatch->formats.empty();
+  }
+
+  return false;
+}
+
+
+static bool parseRuleKey(Rule* pRule, const std::string& key, const std::string& value) {
+  if (key == "call") {
+    std::string name = toUpper(value);
+
+    if (name == "MAP")
+      pRule->call = RuleCall::Map;
+    else if (name == "COPY")
+      pRule->call = RuleCall::Copy;
+    else
+      return false;
+
+    return true;
+  }
+
+  if (key == "map")
+    return parseMapTypes(value, &pRule->mapTypes);
+
+  if (key == "actions")
+    return parseActions(value, &pRule->actions);
+
+  if (key.compare(0, 4, "src.") == 0)
+    return parseDescKey(&pRule->src, key.substr(4), value);
+
+  if (key.compare(0, 4, "dst.") == 0)
+    return parseDescKey(&pRule->dst, key.substr(4), value);
+
+  return parseDescKey(&pRule->dst, key, value);
+}
+
+
+void parseRules(
+        std::istream&             stream,
+        std::vector<Rule>*        pRules,
+        std::vector<std::string>* pErrors) {
+  std::string line;
+  uint32_t lineNumber = 0;
+
+  Rule rule;
+  bool hasRule = false;
+  bool isValid = false;
+
+  auto addError = [&] (const char* message) {
+    std::ostringstream oss;
+    oss << "line " << lineNumber << ": " << message << ": " << trim(line);
+    pErrors->push_back(oss.str());
+  };
+
+  // A rule missing one of its conditions would match more than
+  // intended, so rules with any invalid line are dropped as a whole
+  auto finishRule = [&] {
+    if (hasRule && isValid && rule.call == RuleCall::Map && !rule.src.isAny()) {
+      pErrors->push_back("rule " + rule.name + ": Source conditions on a map rule");
+      isValid = false;
+    }
+
+    if (hasRule && isValid)
+      pRules->push_back(rule);
+    else if (hasRule)
+      pErrors->push_back("rule " + rule.name + " ignored");
+
+    rule = Rule();
+    hasRule = false;
+  };
+
+  while (std::getline(stream, line)) {
+    lineNumber += 1;
+
+    std::string text = trim(line.substr(0, line.find_first_of(";#")));
+
+    if (text.empty())
+      continue;
+
+    if (text.front() == '[') {
+      finishRule();
+
+      if (text.back() != ']') {
+        addError("Malformed section");
+        continue;
+      }
+
+      rule.name = trim(text.substr(1, text.size() - 2));
+      hasRule = true;
+      isValid = true;
+      continue;
+    }
+
+    if (!hasRule) {
+      addError("Key outside of a rule");
+      continue;
+    }
+
+    size_t equals = text.find('=');
+
+    if (equals == std::string::npos) {
+      addError("Expected key = value");
+      isValid = false;
+      continue;
+    }
+
+    std::string key = trim(text.substr(0, equals));
+    std::string value = trim(text.substr(equals + 1));
+
+    if (!parseRuleKey(&rule, key, value)) {
+      addError("Invalid key or value");
+      isValid = false;
+    }
+  }
+
+  finishRule();
+}
+
+
+const char* getDefaultRulesText() {
+  return
+    "[glyph-upload]\n"
+    "call = map\n"
+    "map = WRITE_DISCARD\n"
+    "usage = DYNAMIC\n"
+    "width = 512\n"
+    "height = 512\n"
+    "format = 90\n"
+    "actions = trace, shadow, cache\n"
+    "\n"
+    "[glyph-readback]\n"
+    "call = map\n"
+    "map = READ\n"
+    "usage = STAGING\n"
+    "width = 512\n"
+    "height = 512\n"
+    "format = 90\n"
+    "actions = trace, cache, profile\n"
+    "\n"
+    "[readback]\n"
+    "call = map\n"
+    "map = READ, READ_WRITE\n"
+    "usage = STAGING\n"
+    "actions = trace, cache\n"
+    "\n"
+    "[glyph-copy]\n"
+    "call = copy\n"
+    "src.usage = DYNAMIC\n"
+    "src.cpu = 0x10000\n"
+    "src.width = 512\n"
+    "src.height = 512\n"
+    "dst.usage = STAGING\n"
+    "dst.cpu = 0x20000\n"
+    "actions = trace, cache, profile, flush\n"
+    "\n"
+    "[staging-copy]\n"
+    "call = copy\n"
+    "dst.usage = STAGING\n"
+    "actions = flush\n";
+}
+
+
+std::string formatRuleActions(RuleActions actions) {
+  static const std::pair<RuleAction, const char*> s_names[] = {
+    { RuleActionTrace,    "trace"   },
+    { RuleActionShadow,   "shadow"  },
+    { RuleActionCache,    "cache"   },
+    { RuleActionProfile,  "profile" },
+    { RuleActionFlush,    "flush"   },
+  };
+
+  std::string result;
+
+  for (const auto& entry : s_names) {
+    if (actions & entry.first) {
+      if (!result.empty())
+        result += ", ";
+
+      result += entry.second;
+    }
+  }
+
+  return result.empty() ? "pass" : result;
+}
+
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sync.h"
+#include "types.h"
+
+namespace atfix::core {
+
+/**
+ * \brief What the hooks do with a matching call
+ *
+ * Bit mask, a rule may select several actions.
+ */
+enum RuleAction : uint32_t {
+  /** Write the call to the trace log */
+  RuleActionTrace   = 1u << 0,
+  /** Hand WRITE_DISCARD maps a write-protected shadow */
+  RuleActionShadow  = 1u << 1,
+  /** Hash uploads and follow copies and readbacks for the
+   *  shadow cache and speculative readback */
+  RuleActionCache   = 1u << 2,
+  /** Profile read footprints of readbacks, and shrink copies */
+  RuleActionProfile = 1u << 3,
+  /** Copies that flush coalescing keeps flushes for */
+  RuleActionFlush   = 1u << 4,
+};
+
+using RuleActions = uint32_t;
+
+/**
+ * \brief Hooked call a rule applies to
+ */
+enum class RuleCall : uint32_t {
+  Map,
+  Copy,
+};
+
+/**
+ * \brief Conditions on one resource descriptor
+ *
+ * Fields that are not set match any value.
+ */
+struct RuleDescMatch {
+  uint32_t  minWidth  = 0;
+  uint32_t  maxWidth  = ~0u;
+  uint32_t  minHeight = 0;
+  uint32_t  maxHeight = ~0u;
+  /** Bit per \c Usage value */
+  uint32_t  usages    = ~0u;
+  /** Accepted formats, empty for any */
+  std::vector<uint32_t> formats;
+  bool      hasCpu    = false;
+  uint32_t  cpu       = 0;
+  bool      hasBind   = false;
+  uint32_t  bind      = 0;
+
+  bool matches(const ResourceDesc& desc) const;
+
+  bool isAny() const;
+
+  bool operator == (const RuleDescMatch& other) const;
+};
+
+/**
+ * \brief Pattern rule as written in the rules file
+ */
+struct Rule {
+  std::string   name;
+  RuleCall      call      = RuleCall::Map;
+  /** Bit per \c MapType value, map rules only */
+  uint32_t      mapTypes  = ~0u;
+  /** Mapped resource, or copy destination */
+  RuleDescMatch dst;
+  /** Copy source, copy rules only */
+  RuleDescMatch src;
+  RuleActions   actions   = 0;
+};
+
+/**
+ * \brief Compiled pattern rules
+ *
+ * Every distinct descriptor condition of all rules gets one
+ * bit, and a resource's class is the set of conditions its
+ * descriptor meets. Rules are compiled to the bits they need,
+ * so that deciding on a call only takes one mask test per rule
+ * once the classes of the involved resources are known. The
+ * first matching rule wins, calls no rule matches get no
+ * actions.
+ *
+ * Games use few distinct descriptors, so classes are cached
+ * per descriptor. Adding a rule drops the cache. Thread-safe
+ * once built, rules must not be added concurrently.
+ */
+class RuleSet {
+
+public:
+
+  /** At most this many distinct descriptor conditions */
+  static constexpr size_t MaxConditions = 32;
+
+  /** Descriptors whose class is cached before the cache is
+   *  dropped, so that odd games cannot grow it without bound */
+  static constexpr size_t MaxCachedClasses = 1024;
+
+  RuleSet() = default;
+
+  RuleSet(const RuleSet&) = delete;
+  RuleSet& operator = (const RuleSet&) = delete;
+
+  /**
+   * \brief Appends a rule
+   *
+   * \param [in] rule Rule
+   * \returns \c false if the rule needs too many conditions
+   */
+  bool addRule(const Rule& rule);
+
+  /**
+   * \brief Computes the class of a resource
+   *
+   * Evaluates all conditions only for new descriptors.
+   * \param [in] desc Resource properties
+   * \returns Conditions the descriptor meets
+   */
+  uint32_t classify(const ResourceDesc& desc) const;
+
+  /**
+   * \brief Looks up the actions for a Map call
+   *
+   * \param [in] resourceClass Class of the mapped resource
+   * \param [in] mapType Map type
+   */
+  RuleActions getMapActions(uint32_t resourceClass, MapType mapType) const;
+
+  /**
+   * \brief Looks up the actions for a copy
+   *
+   * \param [in] dstClass Class of the destination
+   * \param [in] srcClass Class of the source
+   */
+  RuleActions getCopyActions(uint32_t dstClass, uint32_t srcClass) const;
+
+  const std::vector<Rule>& getRules() const {
+    return m_rules;
+  }
+
+private:
+
+  struct MapEntry {
+    uint32_t    mapTypes  = 0;
+    uint32_t    mask      = 0;
+    RuleActions actions   = 0;
+  };
+
+  struct CopyEntry {
+    uint32_t    dstMask   = 0;
+    uint32_t    srcMask   = 0;
+    RuleActions actions   = 0;
+  };
+
+  std::vector<Rule>           m_rules;
+  std::vector<RuleDescMatch>  m_conditions;
+  std::vector<MapEntry>       m_mapEntries;
+  std::vector<CopyEntry>      m_copyEntries;
+
+  mutable mutex               m_classMutex;
+  mutable std::unordered_map<ResourceDesc, uint32_t, ResourceDescHash> m_classes;
+
+  uint32_t computeClass(const ResourceDesc& desc) const;
+
+  bool getConditionMask(const RuleDescMatch& match, uint32_t* pMask);
+
+};
+
+/**
+ * \brief Parses a rules file
+ *
+ * Each rule is an ini section, e.g.:
+ * \code
+ * [glyph-copy]
+ * call = copy
+ * src.usage = DYNAMIC
+ * src.width = 512
+ * dst.usage = STAGING
+ * actions = trace, cache
+ * \endcode
+ * Map rules take \c map, \c width, \c height, \c format,
+ * \c usage, \c cpu and \c bind. Copy rules take the same
+ * descriptor keys with a \c src. or \c dst. prefix. Sizes may
+ * be ranges such as \c 256-1024, formats and usages lists.
+ * Actions are \c trace, \c shadow, \c cache, \c profile,
+ * \c flush and \c pass, which selects nothing.
+ * \param [in] stream Input
+ * \param [out] pRules Parsed rules, in file order
+ * \param [out] pErrors Messages for invalid lines, rules with
+ *    an invalid line are left out
+ */
+void parseRules(
+        std::istream&             stream,
+        std::vector<Rule>*        pRules,
+        std::vector<std::string>* pErrors);
+
+/**
+ * \brief Returns the built-in rules
+ *
+ * Reproduce the glyph readback patterns of the Arland games.
+ */
+const char* getDefaultRulesText();
+
+std::string formatRuleActions(RuleActions actions);
+
+}
@@ -0,0 +1,64 @@
+#include "shadow_cache.h"
+
+namespace atfix::core {
+
+ShadowCacheStats& ShadowCacheStats::operator += (const ShadowCacheStats& other) {
+  readbacks += other.readbacks;
+  keyed += other.keyed;
+  hits += other.hits;
+  correctHits += other.correctHits;
+  savedUs += other.savedUs;
+  waitUs += other.waitUs;
+  return *this;
+}
+
+void ShadowCache::registerReadback(const ResourceKey& resource, uint64_t hash, uint64_t waitUs) {
+  std::lock_guard lock(m_mutex);
+
+  m_stats.readbacks += 1;
+  m_stats.waitUs += waitUs;
+
+  uint64_t payload = 0;
+
+  if (!m_lineage.getPayload(resource, &payload))
+    return;
+
+  m_stats.keyed += 1;
+
+  auto entry = m_entries.find(payload);
+
+  if (entry != m_entries.end()) {
+    m_stats.hits += 1;
+
+    if (entry->second->second == hash) {
+      m_stats.correctHits += 1;
+      m_stats.savedUs += waitUs;
+    }
+
+    // A real cache would have to take the new data on a mismatch too
+    entry->second->second = hash;
+    m_lru.splice(m_lru.begin(), m_lru, entry->second);
+    return;
+  }
+
+  if (!m_capacity)
+    return;
+
+  if (m_entries.size() >= m_capacity) {
+    m_entries.erase(m_lru.back().first);
+    m_lru.pop_back();
+  }
+
+  m_lru.emplace_front(payload, hash);
+  m_entries.emplace(payload, m_lru.begin());
+}
+
+ShadowCacheStats ShadowCache::takeStats() {
+  std::lock_guard lock(m_mutex);
+
+  ShadowCacheStats result = m_stats;
+  m_stats = ShadowCacheStats();
+  return result;
+}
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+#include "lineage.h"
+#include "sync.h"
+
+namespace atfix::core {
+
+/**
+ * \brief Shadow cache counters
+ */
+struct ShadowCacheStats {
+  /** Readbacks seen */
+  uint64_t readbacks      = 0;
+  /** Readbacks whose copy source had a known payload */
+  uint64_t keyed          = 0;
+  /** Readbacks a real cache would have served */
+  uint64_t hits           = 0;
+  /** Hits where the cached data matched the real readback */
+  uint64_t correctHits    = 0;
+  /** Time correct hits spent waiting in Map, in microseconds */
+  uint64_t savedUs        = 0;
+  /** Time all readbacks spent waiting in Map, in microseconds */
+  uint64_t waitUs         = 0;
+
+  ShadowCacheStats& operator += (const ShadowCacheStats& other);
+};
+
+/**
+ * \brief Readback cache that only keeps score
+ *
+ * Follows the lineage of every readback from the payload
+ * written to the DYNAMIC source, through the copy, to the
+ * data read from the STAGING texture, and keeps an LRU of
+ * payload -> readback hashes just like a real cache of
+ * readback data would. Nothing is ever served from it, so
+ * it can run in live play to tell how often a cache would
+ * hit and whether the hits would have been correct.
+ *
+ * Resources are only used as keys and never dereferenced.
+ * Thread-safe.
+ */
+class ShadowCache {
+
+public:
+
+  explicit ShadowCache(uint32_t capacity)
+  : m_capacity(capacity) { }
+
+  /**
+   * \brief Registers a write to a source resource
+   * \see LineageTracker::registerWrite
+   */
+  void registerWrite(const ResourceKey& resource, uint64_t payload) {
+    m_lineage.registerWrite(resource, payload);
+  }
+
+  /**
+   * \brief Registers a copy
+   * \see LineageTracker::registerCopy
+   */
+  void registerCopy(const ResourceKey& dst, const ResourceKey& src) {
+    m_lineage.registerCopy(dst, src);
+  }
+
+  /**
+   * \brief Forgets a destroyed resource
+   * \see LineageTracker::retire
+   */
+  void retire(const ResourceKey& resource) {
+    m_lineage.retire(resource);
+  }
+
+  /**
+   * \brief Registers a readback and scores the cache
+   *
+   * \param [in] resource Resource read back
+   * \param [in] hash Content hash of the real data
+   * \param [in] waitUs Time the real Map call took
+   */
+  void registerReadback(const ResourceKey& resource, uint64_t hash, uint64_t waitUs);
+
+  /**
+   * \brief Returns and resets counters
+   *
+   * Cache contents are kept.
+   */
+  ShadowCacheStats takeStats();
+
+private:
+
+  using LruList = std::list<std::pair<uint64_t, uint64_t>>;
+
+  mutex                                     m_mutex;
+  uint32_t                                  m_capacity;
+
+  LineageTracker                            m_lineage;
+
+  LruList                                   m_lru;
+  std::unordered_map<uint64_t, LruList::iterator> m_entries;
+
+  ShadowCacheStats                          m_stats;
+
+};
+
+}
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cmath>
+
+#include "strategy.h"
+
+namespace atfix::core {
+
+StrategyController::StrategyController(uint32_t exploreEpisodes, double regressionFactor, uint64_t regressionFloorUs)
+: m_exploreEpisodes(exploreEpisodes), m_regressionFactor(regressionFactor), m_regressionFloorUs(double(regressionFloorUs)) {
+
+}
+
+
+Strategy StrategyController::selectStrategy(const ResourceDesc& pattern, uint32_t available) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_patterns.find(pattern);
+
+  if (entry == m_patterns.end()) {
+    entry = m_patterns.emplace(pattern, Pattern()).first;
+    entry->second.available = available;
+    entry->second.current = pickExploration(entry->second);
+  }
+
+  // Strategies only some maps of a pattern allow, e.g. speculation
+  // for Map(READ) but not Map(READ_WRITE), must not leak into others
+  entry->second.available |= available;
+
+  Strategy strategy = entry->second.current;
+  return (available & (1u << uint32_t(strategy))) ? strategy : Strategy::Driver;
+}
+
+
+Strategy StrategyController::getStrategy(const ResourceDesc& pattern) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_patterns.find(pattern);
+
+  return entry != m_patterns.end()
+    ? entry->second.current
+    : Strategy::Driver;
+}
+
+
+void StrategyController::registerReadback(const ResourceDesc& pattern, uint64_t stallUs) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_patterns.find(pattern);
+
+  if (entry == m_patterns.end())
+    return;
+
+  entry->second.readbacks += 1;
+  entry->second.latencyUs += stallUs;
+}
+
+
+void StrategyController::registerCost(const ResourceDesc& pattern, uint64_t costUs) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_patterns.find(pattern);
+
+  if (entry == m_patterns.end())
+    return;
+
+  entry->second.latencyUs += costUs;
+}
+
+
+std::vector<StrategyDecision> StrategyController::endEpisode() {
+  std::lock_guard lock(m_mutex);
+
+  std::vector<StrategyDecision> result;
+
+  for (auto& entry : m_patterns) {
+    Pattern& pattern = entry.second;
+
+    if (!pattern.readbacks)
+      continue;
+
+    StrategyDecision decision;
+    decision.pattern = entry.first;
+    decision.measured = pattern.current;
+    decision.readbacks = pattern.readbacks;
+    decision.latencyUs = pattern.latencyUs / pattern.readbacks;
+
+    double latencyUs = double(pattern.latencyUs) / double(pattern.readbacks);
+
+    pattern.readbacks = 0;
+    pattern.latencyUs = 0;
+
+    Arm& arm = pattern.arms[uint32_t(pattern.current)];
+
+    // Fast strategies vary by more than the factor from noise alone
+    bool isRegression = latencyUs > arm.meanUs * m_regressionFactor
+                     && latencyUs > arm.meanUs + m_regressionFloorUs;
+
+    if (pattern.committed && isRegression) {
+      // The driver or the game changed, old measurements are worthless
+      decision.event = StrategyEvent::Regress;
+
+      pattern.arms = { };
+      pattern.committed = false;
+      pattern.explored = 0;
+      pattern.current = pickExploration(pattern);
+    } else {
+      arm.episodes += 1;
+      arm.meanUs += (latencyUs - arm.meanUs) / double(arm.episodes);
+
+      if (pattern.committed) {
+        decision.event = StrategyEvent::Hold;
+      } else {
+        pattern.explored += 1;
+
+        uint32_t armCount = 0;
+        uint32_t triedCount = 0;
+
+        for (uint32_t i = 0; i < StrategyCount; i++) {
+          if (pattern.available & (1u << i)) {
+            armCount += 1;
+            triedCount += pattern.arms[i].episodes ? 1u : 0u;
+          }
+        }
+
+        if (triedCount == armCount && pattern.explored >= std::max(m_exploreEpisodes, armCount)) {
+          decision.event = StrategyEvent::Commit;
+
+          pattern.committed = true;
+          pattern.current = pickBest(pattern);
+        } else {
+          decision.event = StrategyEvent::Explore;
+
+          pattern.current = pickExploration(pattern);
+        }
+      }
+    }
+
+    decision.next = pattern.current;
+    decision.nextEpisodes = pattern.arms[uint32_t(pattern.current)].episodes;
+    decision.nextMeanUs = uint64_t(pattern.arms[uint32_t(pattern.current)].meanUs);
+    decision.driverMeanUs = uint64_t(pattern.arms[uint32_t(Strategy::Driver)].meanUs);
+
+    result.push_back(decision);
+  }
+
+  return result;
+}
+
+
+Strategy StrategyController::pickExploration(const Pattern& pattern) const {
+  uint32_t totalEpisodes = 0;
+  double bestMeanUs = 0.0;
+
+  // Try every strategy once before comparing any
+  for (uint32_t i = 0; i < StrategyCount; i++) {
+    if (!(pattern.available & (1u << i)))
+      continue;
+
+    const Arm& arm = pattern.arms[i];
+
+    if (!arm.episodes)
+      return Strategy(i);
+
+    if (!totalEpisodes || arm.meanUs < bestMeanUs)
+      bestMeanUs = arm.meanUs;
+
+    totalEpisodes += arm.episodes;
+  }
+
+  // UCB1 on latency relative to the best strategy, lower is better
+  double logEpisodes = std::log(double(totalEpisodes));
+  double scale = std::max(bestMeanUs, 1.0);
+
+  Strategy result = Strategy::Driver;
+  double resultBound = 0.0;
+  bool hasResult = false;
+
+  for (uint32_t i = 0; i < StrategyCount; i++) {
+    if (!(pattern.available & (1u << i)))
+      continue;
+
+    const Arm& arm = pattern.arms[i];
+    double bound = arm.meanUs / scale - std::sqrt(2.0 * logEpisodes / double(arm.episodes));
+
+    if (!hasResult || bound < resultBound) {
+      result = Strategy(i);
+      resultBound = bound;
+      hasResult = true;
+    }
+  }
+
+  return result;
+}
+
+
+Strategy StrategyController::pickBest(const Pattern& pattern) const {
+  Strategy result = Strategy::Driver;
+  double resultMeanUs = 0.0;
+  bool hasResult = false;
+
+  for (uint32_t i = 0; i < StrategyCount; i++) {
+    const Arm& arm = pattern.arms[i];
+
+    if (!(pattern.available & (1u << i)) || !arm.episodes)
+      continue;
+
+    if (!hasResult || arm.meanUs < resultMeanUs) {
+      result = Strategy(i);
+      resultMeanUs = arm.meanUs;
+      hasResult = true;
+    }
+  }
+
+  return result;
+}
+
+
+const char* strategyToString(Strategy strategy) {
+  switch (strategy) {
+    case Strategy::Driver:      return "driver";
+    case Strategy::EarlyFlush:  return "early-flush";
+    case Strategy::SpinWait:    return "spin-wait";
+    case Strategy::Speculative: return "speculative";
+  }
+
+  return "unknown";
+}
+
+
+const char* strategyEventToString(StrategyEvent event) {
+  switch (event) {
+    case StrategyEvent::Explore:  return "exploring";
+    case StrategyEvent::Commit:   return "committed";
+    case StrategyEvent::Hold:     return "holding";
+    case StrategyEvent::Regress:  return "regressed";
+  }
+
+  return "unknown";
+}
+
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "sync.h"
+#include "types.h"
+
+namespace atfix::core {
+
+/**
+ * \brief Way of handling the readbacks of one resource pattern
+ */
+enum class Strategy : uint32_t {
+  /** Leave the readback to the driver */
+  Driver      = 0,
+  /** Flush right after each copy into the readback resource */
+  EarlyFlush  = 1,
+  /** Flush and poll Map with DO_NOT_WAIT for a while before
+   *  letting the driver block */
+  SpinWait    = 2,
+  /** Serve known images from the speculative readback cache */
+  Speculative = 3,
+};
+
+constexpr uint32_t StrategyCount = 4;
+
+/**
+ * \brief What the controller did at the end of an episode
+ */
+enum class StrategyEvent : uint32_t {
+  /** Still trying strategies */
+  Explore = 0,
+  /** Settled on the best strategy */
+  Commit  = 1,
+  /** The committed strategy stays */
+  Hold    = 2,
+  /** The committed strategy got slower, exploring again */
+  Regress = 3,
+};
+
+/**
+ * \brief Decision for one pattern at the end of an episode
+ */
+struct StrategyDecision {
+  ResourceDesc  pattern;
+  StrategyEvent event        = StrategyEvent::Explore;
+  /** Strategy used during the episode */
+  Strategy      measured     = Strategy::Driver;
+  /** Readbacks of the pattern during the episode */
+  uint32_t      readbacks    = 0;
+  /** Mean latency per readback during the episode, in microseconds */
+  uint64_t      latencyUs    = 0;
+  /** Strategy for the next episode */
+  Strategy      next         = Strategy::Driver;
+  /** Episodes the next strategy was measured for so far */
+  uint32_t      nextEpisodes = 0;
+  /** Mean latency of the next strategy over all its episodes */
+  uint64_t      nextMeanUs   = 0;
+  /** Mean latency of the driver over all its episodes */
+  uint64_t      driverMeanUs = 0;
+};
+
+/**
+ * \brief Chooses readback strategies from measured latency
+ *
+ * Each resource pattern, identified by the descriptor of the
+ * mapped resource, is a multi-armed bandit whose arms are the
+ * strategies available for it. An arm is scored by the latency
+ * per readback, i.e. the stall inside Map plus the flushes and
+ * copies the strategy issues elsewhere. During the first
+ * episodes, every arm is tried once and further episodes go to
+ * the arm with the lowest UCB1 bound on that mean. Afterwards,
+ * the arm with the lowest mean is kept until an episode is
+ * slower than its mean by both the regression factor and the
+ * regression floor, which restarts exploration with fresh
+ * measurements.
+ *
+ * Strategies only change between episodes, so a copy and the
+ * readback that follows it always see the same strategy.
+ * Thread-safe.
+ */
+class StrategyController {
+
+public:
+
+  /**
+   * \brief Creates the controller
+   *
+   * \param [in] exploreEpisodes Episodes measured per pattern
+   *    before committing, at least one per available strategy
+   * \param [in] regressionFactor Slowdown of the committed
+   *    strategy that restarts exploration
+   * \param [in] regressionFloorUs Smallest slowdown per readback
+   *    that restarts exploration, so that noise on fast strategies
+   *    does not
+   */
+  StrategyController(uint32_t exploreEpisodes, double regressionFactor, uint64_t regressionFloorUs);
+
+  StrategyController(const StrategyController&) = delete;
+  StrategyController& operator = (const StrategyController&) = delete;
+
+  /**
+   * \brief Returns the strategy for a readback
+   *
+   * Starts tracking the pattern if it is new.
+   * \param [in] pattern Descriptor of the mapped resource
+   * \param [in] available Bit per usable \c Strategy
+   */
+  Strategy selectStrategy(const ResourceDesc& pattern, uint32_t available);
+
+  /**
+   * \brief Returns the strategy of a pattern
+   *
+   * \param [in] pattern Resource descriptor
+   * \returns Current strategy, \c Driver for unknown patterns
+   */
+  Strategy getStrategy(const ResourceDesc& pattern);
+
+  /**
+   * \brief Registers a completed readback
+   *
+   * \param [in] pattern Descriptor of the mapped resource
+   * \param [in] stallUs Time spent inside Map
+   */
+  void registerReadback(const ResourceDesc& pattern, uint64_t stallUs);
+
+  /**
+   * \brief Registers time spent for readbacks outside of Map
+   *
+   * Flushes and copies issued by the current strategy of the
+   * pattern, counted towards its readbacks in this episode.
+   * \param [in] pattern Descriptor of the read back resource
+   * \param [in] costUs Time spent
+   */
+  void registerCost(const ResourceDesc& pattern, uint64_t costUs);
+
+  /**
+   * \brief Evaluates the episode that just ended
+   *
+   * \returns Decisions for all patterns read back in the episode
+   */
+  std::vector<StrategyDecision> endEpisode();
+
+private:
+
+  struct Arm {
+    uint32_t  episodes  = 0;
+    double    meanUs    = 0.0;
+  };
+
+  struct Pattern {
+    uint32_t  available     = 0;
+    Strategy  current       = Strategy::Driver;
+    bool      committed     = false;
+    uint32_t  explored      = 0;
+    uint32_t  readbacks     = 0;
+    uint64_t  latencyUs     = 0;
+    std::array<Arm, StrategyCount> arms = { };
+  };
+
+  mutex     m_mutex;
+
+  uint32_t  m_exploreEpisodes;
+  double    m_regressionFactor;
+  double    m_regressionFloorUs;
+
+  std::unordered_map<ResourceDesc, Pattern, ResourceDescHash> m_patterns;
+
+  Strategy pickExploration(const Pattern& pattern) const;
+
+  Strategy pickBest(const Pattern& pattern) const;
+
+};
+
+const char* strategyToString(Strategy strategy);
+const char* strategyEventToString(StrategyEvent event);
+
+}
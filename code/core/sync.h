@@ -0,0 +1,19 @@
+#pragma once
+
+#ifdef _WIN32
+#include "../util.h"
+#else
+#include <mutex>
+#endif
+
+namespace atfix::core {
+
+/* The DLL uses SRW locks, which are much cheaper than winpthreads
+ * mutexes under wine. Elsewhere the standard mutex is fine. */
+#ifdef _WIN32
+using mutex = atfix::mutex;
+#else
+using mutex = std::mutex;
+#endif
+
+}
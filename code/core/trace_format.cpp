@@ -0,0 +1,95 @@
+#include <sstream>
+
+#include "trace_format.h"
+
+namespace atfix::core {
+
+std::string formatMapLine(
+        uint64_t        timestampUs,
+  const void*           pResource,
+        uint32_t        subresource,
+        MapType         mapType,
+  const ResourceDesc&   desc,
+  const uint32_t*       pChecksum) {
+  std::ostringstream oss;
+  oss << "[" << timestampUs << "] Map"
+      << " type=" << mapTypeToString(mapType)
+      << " res=0x" << std::hex << pResource << std::dec
+      << " sub=" << subresource
+      << " dim=" << desc.width << "x" << desc.height
+      << " usage=" << usageToString(desc.usage)
+      << " cpu=0x" << std::hex << desc.cpuAccessFlags << std::dec
+      << " bind=0x" << std::hex << desc.bindFlags << std::dec
+      << " fmt=" << desc.format;
+
+  if (pChecksum)
+    oss << " checksum=0x" << std::hex << *pChecksum << std::dec;
+
+  return oss.str();
+}
+
+std::string formatUnmapLine(
+        uint64_t        timestampUs,
+  const void*           pResource,
+        uint32_t        subresource,
+  const uint32_t*       pChecksum) {
+  std::ostringstream oss;
+  oss << "[" << timestampUs << "] Unmap"
+      << " res=0x" << std::hex << pResource << std::dec
+      << " sub=" << subresource;
+
+  if (pChecksum)
+    oss << " checksum=0x" << std::hex << *pChecksum << std::dec;
+
+  return oss.str();
+}
+
+std::string formatFlushLine(
+        uint64_t        timestampUs) {
+  std::ostringstream oss;
+  oss << "[" << timestampUs << "] Flush";
+  return oss.str();
+}
+
+std::string formatCopyLine(
+        uint64_t        timestampUs,
+  const void*           pDstResource,
+        uint32_t        dstSubresource,
+        uint32_t        dstX,
+        uint32_t        dstY,
+        uint32_t        dstZ,
+  const ResourceDesc&   dstDesc,
+  const void*           pSrcResource,
+        uint32_t        srcSubresource,
+  const ResourceDesc&   srcDesc,
+  const Box*            pSrcBox) {
+  std::ostringstream oss;
+  oss << "[" << timestampUs << "] CopySubresourceRegion"
+      << " src=0x" << std::hex << pSrcResource << std::dec
+      << " dst=0x" << std::hex << pDstResource << std::dec
+      << " srcSub=" << srcSubresource
+      << " dstSub=" << dstSubresource
+      << " srcDim=" << srcDesc.width << "x" << srcDesc.height
+      << " dstDim=" << dstDesc.width << "x" << dstDesc.height
+      << " srcUsage=" << usageToString(srcDesc.usage)
+      << " dstUsage=" << usageToString(dstDesc.usage)
+      << " srcCPU=0x" << std::hex << srcDesc.cpuAccessFlags << std::dec
+      << " dstCPU=0x" << std::hex << dstDesc.cpuAccessFlags << std::dec
+      << " srcBind=0x" << std::hex << srcDesc.bindFlags << std::dec
+      << " dstBind=0x" << std::hex << dstDesc.bindFlags << std::dec
+      << " fmt=" << srcDesc.format
+      << " dstPos=(" << dstX << "," << dstY << "," << dstZ << ")";
+
+  // Add box info if present
+  if (pSrcBox) {
+    oss << " box=(" << pSrcBox->left << "," << pSrcBox->top << "," << pSrcBox->front
+        << ")-(" << pSrcBox->right << "," << pSrcBox->bottom << "," << pSrcBox->back << ")"
+        << " boxSize=" << (pSrcBox->right - pSrcBox->left) << "x" << (pSrcBox->bottom - pSrcBox->top);
+  } else {
+    oss << " box=full";
+  }
+
+  return oss.str();
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "types.h"
+
+namespace atfix::core {
+
+/**
+ * \brief Formats a Map trace line
+ *
+ * \param [in] timestampUs Timestamp
+ * \param [in] pResource Resource, only printed
+ * \param [in] subresource Subresource index
+ * \param [in] mapType Map type
+ * \param [in] desc Resource properties
+ * \param [in] pChecksum Checksum of the mapped data, if any
+ * \returns Line without trailing newline
+ */
+std::string formatMapLine(
+        uint64_t        timestampUs,
+  const void*           pResource,
+        uint32_t        subresource,
+        MapType         mapType,
+  const ResourceDesc&   desc,
+  const uint32_t*       pChecksum);
+
+/**
+ * \brief Formats an Unmap trace line
+ */
+std::string formatUnmapLine(
+        uint64_t        timestampUs,
+  const void*           pResource,
+        uint32_t        subresource,
+  const uint32_t*       pChecksum);
+
+/**
+ * \brief Formats a Flush trace line
+ */
+std::string formatFlushLine(
+        uint64_t        timestampUs);
+
+/**
+ * \brief Formats a CopySubresourceRegion trace line
+ *
+ * The format of both resources is assumed to be
+ * the same, only the source format is printed.
+ */
+std::string formatCopyLine(
+        uint64_t        timestampUs,
+  const void*           pDstResource,
+        uint32_t        dstSubresource,
+        uint32_t        dstX,
+        uint32_t        dstY,
+        uint32_t        dstZ,
+  const ResourceDesc&   dstDesc,
+  const void*           pSrcResource,
+        uint32_t        srcSubresource,
+  const ResourceDesc&   srcDesc,
+  const Box*            pSrcBox);
+
+}
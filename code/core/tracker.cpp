@@ -0,0 +1,66 @@
+#include "checksum.h"
+#include "tracker.h"
+
+namespace atfix::core {
+
+void ResourceTracker::track(const ResourceKey& resource) {
+  std::lock_guard lock(m_trackedMutex);
+  m_tracked.insert(resource);
+}
+
+void ResourceTracker::untrack(const ResourceKey& resource) {
+  std::lock_guard lock(m_trackedMutex);
+  m_tracked.erase(resource);
+}
+
+bool ResourceTracker::isTracked(const ResourceKey& resource) const {
+  std::lock_guard lock(m_trackedMutex);
+  return m_tracked.find(resource) != m_tracked.end();
+}
+
+void ResourceTracker::trackMappedData(const ResourceKey& resource, const MappedData& data) {
+  std::lock_guard lock(m_mappedMutex);
+  m_mapped[resource] = data;
+}
+
+bool ResourceTracker::takeMappedData(const ResourceKey& resource, MappedData* pData) {
+  std::lock_guard lock(m_mappedMutex);
+  auto entry = m_mapped.find(resource);
+
+  if (entry == m_mapped.end())
+    return false;
+
+  *pData = entry->second;
+
+  m_mapped.erase(entry);
+  return true;
+}
+
+uint32_t ResourceTracker::takeMappedChecksum(const ResourceKey& resource) {
+  MappedData data;
+
+  if (!takeMappedData(resource, &data))
+    return 0;
+
+  return calculateChecksum(data.pData, data.rowPitch, data.depthPitch,
+    data.rowSize, data.rowCount, data.sliceCount);
+}
+
+void ResourceTracker::retire(const ResourceKey& resource) {
+  untrack(resource);
+
+  std::lock_guard lock(m_mappedMutex);
+  m_mapped.erase(resource);
+}
+
+void ResourceTracker::clear() {
+  { std::lock_guard lock(m_trackedMutex);
+    m_tracked.clear();
+  }
+
+  { std::lock_guard lock(m_mappedMutex);
+    m_mapped.clear();
+  }
+}
+
+}
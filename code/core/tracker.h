@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "sync.h"
+#include "types.h"
+
+namespace atfix::core {
+
+/**
+ * \brief Mapped data of a tracked resource
+ */
+struct MappedData {
+  const void* pData       = nullptr;
+  uint32_t    rowPitch    = 0;
+  uint32_t    depthPitch  = 0;
+  uint32_t    rowSize     = 0;
+  /** Rows per slice, only 3D textures have more than one slice */
+  uint32_t    rowCount    = 0;
+  uint32_t    sliceCount  = 1;
+};
+
+/**
+ * \brief Tracks resources between Map and Unmap
+ *
+ * Keeps the set of resources whose Unmap should be logged, and
+ * the mapped pointer of written resources so that a checksum
+ * of the uploaded data can be computed before Unmap. Resources
+ * are only used as keys and never dereferenced. Thread-safe.
+ */
+class ResourceTracker {
+
+public:
+
+  void track(const ResourceKey& resource);
+
+  void untrack(const ResourceKey& resource);
+
+  bool isTracked(const ResourceKey& resource) const;
+
+  void trackMappedData(const ResourceKey& resource, const MappedData& data);
+
+  /**
+   * \brief Returns and forgets mapped data
+   *
+   * \param [in] resource Resource
+   * \param [out] pData Mapped data
+   * \returns \c true if the resource had mapped data
+   */
+  bool takeMappedData(const ResourceKey& resource, MappedData* pData);
+
+  /**
+   * \brief Computes checksum of and forgets mapped data
+   *
+   * \param [in] resource Resource
+   * \returns Checksum, or 0 if the resource has no mapped data
+   */
+  uint32_t takeMappedChecksum(const ResourceKey& resource);
+
+  /**
+   * \brief Forgets a destroyed resource
+   *
+   * \param [in] resource Resource
+   */
+  void retire(const ResourceKey& resource);
+
+  void clear();
+
+private:
+
+  mutable mutex                                               m_trackedMutex;
+  std::unordered_set<ResourceKey, ResourceKeyHash>            m_tracked;
+
+  mutex                                                       m_mappedMutex;
+  std::unordered_map<ResourceKey, MappedData, ResourceKeyHash> m_mapped;
+
+};
+
+}
@@ -0,0 +1,51 @@
+#include <sstream>
+
+#include "types.h"
+
+namespace atfix::core {
+
+size_t ResourceDescHash::operator () (const ResourceDesc& desc) const {
+  uint64_t h = desc.width;
+  h = h * 0x100000001b3ull ^ desc.height;
+  h = h * 0x100000001b3ull ^ uint32_t(desc.usage);
+  h = h * 0x100000001b3ull ^ desc.cpuAccessFlags;
+  h = h * 0x100000001b3ull ^ desc.bindFlags;
+  h = h * 0x100000001b3ull ^ desc.format;
+  return size_t(h);
+}
+
+
+const char* usageToString(Usage usage) {
+  switch (usage) {
+    case Usage::Default:    return "DEFAULT";
+    case Usage::Immutable:  return "IMMUTABLE";
+    case Usage::Dynamic:    return "DYNAMIC";
+    case Usage::Staging:    return "STAGING";
+  }
+
+  return "UNKNOWN";
+}
+
+const char* mapTypeToString(MapType mapType) {
+  switch (mapType) {
+    case MapType::Read:             return "READ";
+    case MapType::Write:            return "WRITE";
+    case MapType::ReadWrite:        return "READ_WRITE";
+    case MapType::WriteDiscard:     return "WRITE_DISCARD";
+    case MapType::WriteNoOverwrite: return "WRITE_NO_OVERWRITE";
+  }
+
+  return "UNKNOWN";
+}
+
+std::string formatResourceDesc(const ResourceDesc& desc) {
+  std::ostringstream oss;
+  oss << "dim=" << desc.width << "x" << desc.height
+      << " fmt=" << desc.format
+      << " usage=" << usageToString(desc.usage)
+      << " cpu=0x" << std::hex << desc.cpuAccessFlags
+      << " bind=0x" << desc.bindFlags << std::dec;
+  return oss.str();
+}
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace atfix::core {
+
+/**
+ * \brief Resource usage
+ *
+ * Values match \c D3D11_USAGE.
+ */
+enum class Usage : uint32_t {
+  Default   = 0,
+  Immutable = 1,
+  Dynamic   = 2,
+  Staging   = 3,
+};
+
+/**
+ * \brief Map type
+ *
+ * Values match \c D3D11_MAP.
+ */
+enum class MapType : uint32_t {
+  Read              = 1,
+  Write             = 2,
+  ReadWrite         = 3,
+  WriteDiscard      = 4,
+  WriteNoOverwrite  = 5,
+};
+
+/**
+ * \brief Copy region, laid out like \c D3D11_BOX
+ */
+struct Box {
+  uint32_t left   = 0;
+  uint32_t top    = 0;
+  uint32_t front  = 0;
+  uint32_t right  = 0;
+  uint32_t bottom = 0;
+  uint32_t back   = 0;
+};
+
+/**
+ * \brief Resource properties the core logic cares about
+ *
+ * Flags and format use the D3D11 and DXGI values, so that
+ * the DLL can convert descriptors without lookup tables.
+ */
+struct ResourceDesc {
+  uint32_t  width           = 0;
+  uint32_t  height          = 0;
+  Usage     usage           = Usage::Default;
+  uint32_t  cpuAccessFlags  = 0;
+  uint32_t  bindFlags       = 0;
+  uint32_t  format          = 0;
+
+  bool operator == (const ResourceDesc& other) const {
+    return width == other.width && height == other.height
+        && usage == other.usage && cpuAccessFlags == other.cpuAccessFlags
+        && bindFlags == other.bindFlags && format == other.format;
+  }
+
+  bool operator != (const ResourceDesc& other) const {
+    return !(*this == other);
+  }
+};
+
+struct ResourceDescHash {
+  size_t operator () (const ResourceDesc& desc) const;
+};
+
+/**
+ * \brief Identifies one resource object
+ *
+ * Drivers reuse the addresses of destroyed resources, so a
+ * pointer alone may refer to a different texture over time.
+ * The generation is assigned when a resource is first seen
+ * and never reused, which makes the pair unique for the life
+ * of the process. Generation 0 means unknown.
+ */
+struct ResourceKey {
+  const void* pointer     = nullptr;
+  uint64_t    generation  = 0;
+
+  bool operator == (const ResourceKey& other) const {
+    return pointer == other.pointer && generation == other.generation;
+  }
+
+  bool operator != (const ResourceKey& other) const {
+    return !(*this == other);
+  }
+};
+
+struct ResourceKeyHash {
+  size_t operator () (const ResourceKey& key) const {
+    return std::hash<const void*>()(key.pointer) ^ size_t(key.generation * 0x9e3779b97f4a7c15ull);
+  }
+};
+
+const char* usageToString(Usage usage);
+const char* mapTypeToString(MapType mapType);
+
+/**
+ * \brief Formats descriptor fields for the log
+ */
+std::string formatResourceDesc(const ResourceDesc& desc);
+
+}
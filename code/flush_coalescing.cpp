@@ -0,0 +1,96 @@
+#include "flush_coalescing.h"
+
+namespace atfix {
+
+FlushCoalescer::FlushCoalescer(uint64_t burstGapUs)
+: m_burstGapUs(burstGapUs) {
+
+}
+
+
+void FlushCoalescer::registerCopy(const core::ResourceKey& Resource) {
+  std::lock_guard lock(m_mutex);
+
+  m_pendingCopies.insert(Resource);
+}
+
+
+void FlushCoalescer::registerReadback(const core::ResourceKey& Resource, uint64_t timeUs) {
+  std::lock_guard lock(m_mutex);
+
+  m_lastReadbackUs = timeUs;
+  m_hasReadback = true;
+
+  if (m_pendingCopies.count(Resource))
+    registerSubmission();
+}
+
+
+void FlushCoalescer::registerQueryEnd() {
+  std::lock_guard lock(m_mutex);
+
+  m_hasQueryEnd = true;
+}
+
+
+bool FlushCoalescer::forwardFlush(uint64_t timeUs) {
+  std::lock_guard lock(m_mutex);
+
+  bool isBurst = m_hasReadback && timeUs - m_lastReadbackUs < m_burstGapUs;
+
+  if (!isBurst) {
+    m_stats.idle += 1;
+    registerSubmission();
+    return true;
+  }
+
+  // Don't let a game that waits on a query starve
+  bool isNeeded = !m_pendingCopies.empty() || m_hasSuppressed || m_hasQueryEnd;
+
+  if (!isNeeded) {
+    m_stats.suppressed += 1;
+    m_hasSuppressed = true;
+    return false;
+  }
+
+  m_stats.forwarded += 1;
+  registerSubmission();
+  return true;
+}
+
+
+bool FlushCoalescer::forwardDroppedFlush() {
+  std::lock_guard lock(m_mutex);
+
+  if (!m_hasSuppressed)
+    return false;
+
+  m_stats.forwarded += 1;
+  registerSubmission();
+  return true;
+}
+
+
+void FlushCoalescer::retire(const core::ResourceKey& Resource) {
+  std::lock_guard lock(m_mutex);
+
+  m_pendingCopies.erase(Resource);
+}
+
+
+FlushStats FlushCoalescer::takeStats() {
+  std::lock_guard lock(m_mutex);
+
+  FlushStats result = m_stats;
+  m_stats = FlushStats();
+  return result;
+}
+
+
+void FlushCoalescer::registerSubmission() {
+  m_pendingCopies.clear();
+  m_hasSuppressed = false;
+  m_hasQueryEnd = false;
+}
+
+}
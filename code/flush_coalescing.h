@@ -0,0 +1,130 @@
+#pragma once
+
+#include <unordered_set>
+
+#include "impl.h"
+#include "util.h"
+
+#include "core/types.h"
+
+namespace atfix {
+
+/**
+ * \brief Flush coalescing counters
+ */
+struct FlushStats {
+  /** Flushes during readback bursts passed to the driver */
+  uint64_t forwarded  = 0;
+  /** Flushes during readback bursts that were dropped */
+  uint64_t suppressed = 0;
+  /** Flushes outside of readback bursts, always passed on */
+  uint64_t idle       = 0;
+};
+
+/**
+ * \brief Drops flushes that no readback waits for
+ *
+ * While the game reads back glyphs, every Map(READ) of a texture
+ * with a pending copy submits the context anyway, so additional
+ * flushes only add queue submissions. During such a burst, a
+ * flush is only passed on if a copy into a STAGING texture was
+ * recorded since the last submission, since submitting it early
+ * shortens the wait of the Map(READ) that follows.
+ *
+ * Implicit flushes of GetData polls are handled the same way. A
+ * dropped flush is always followed by a forwarded one, and flushes
+ * after a query was ended are never dropped, so that a game waiting
+ * on a query or event still makes progress.
+ *
+ * Only immediate context calls may be passed in. Thread-safe.
+ */
+class FlushCoalescer {
+
+public:
+
+  /**
+   * \brief Creates the coalescer
+   *
+   * \param [in] burstGapUs Time after a readback during
+   *    which flushes are coalesced
+   */
+  explicit FlushCoalescer(uint64_t burstGapUs);
+
+  FlushCoalescer(const FlushCoalescer&) = delete;
+  FlushCoalescer& operator = (const FlushCoalescer&) = delete;
+
+  /**
+   * \brief Registers a copy into a STAGING resource
+   *
+   * \param [in] Resource Copy destination
+   */
+  void registerCopy(const core::ResourceKey& Resource);
+
+  /**
+   * \brief Registers a Map(READ) or Map(READ_WRITE)
+   *
+   * Starts or extends a burst. If the resource has a pending
+   * copy, the driver submits everything recorded so far. Only
+   * maps passed on to the driver count, a readback served from
+   * a CPU cache submits nothing.
+   * \param [in] Resource Mapped resource
+   * \param [in] timeUs Time of the call
+   */
+  void registerReadback(const core::ResourceKey& Resource, uint64_t timeUs);
+
+  /**
+   * \brief Registers the end of a query
+   *
+   * The next flush submits it and is always passed on.
+   */
+  void registerQueryEnd();
+
+  /**
+   * \brief Decides whether to pass on a flush
+   *
+   * \param [in] timeUs Time of the call
+   * \returns \c true if the flush should reach the driver
+   */
+  bool forwardFlush(uint64_t timeUs);
+
+  /**
+   * \brief Decides whether a non-flushing poll must flush
+   *
+   * A game that polls with \c D3D11_ASYNC_GETDATA_DONOTFLUSH
+   * relies on an earlier flush, which may have been dropped.
+   * \returns \c true if a flush was dropped since the last
+   *    submission, the caller must then flush
+   */
+  bool forwardDroppedFlush();
+
+  /**
+   * \brief Forgets pending copies into a destroyed resource
+   *
+   * \param [in] Resource Resource
+   */
+  void retire(const core::ResourceKey& Resource);
+
+  /**
+   * \brief Returns and resets counters
+   */
+  FlushStats takeStats();
+
+private:
+
+  mutex                                 m_mutex;
+
+  uint64_t                              m_burstGapUs;
+  uint64_t                              m_lastReadbackUs = 0;
+  bool                                  m_hasReadback    = false;
+  bool                                  m_hasSuppressed  = false;
+  bool                                  m_hasQueryEnd    = false;
+
+  std::unordered_set<core::ResourceKey, core::ResourceKeyHash> m_pendingCopies;
+
+  FlushStats                            m_stats;
+
+  void registerSubmission();
+
+};
+
+}
@@ -0,0 +1,141 @@
+#include <atomic>
+#include <unordered_map>
+
+#include "generation.h"
+#include "util.h"
+
+namespace atfix {
+
+/** Private data GUID of the retirement token,
+ *  {5c1d7e0a-8f42-4b5e-9a31-6c2f0e8d4b17} */
+static const GUID s_tokenGuid = { 0x5c1d7e0a, 0x8f42, 0x4b5e,
+  { 0x9a, 0x31, 0x6c, 0x2f, 0x0e, 0x8d, 0x4b, 0x17 } };
+
+static mutex                                          g_generationMutex;
+static std::unordered_map<const void*, uint64_t>      g_generations;
+static uint64_t                                       g_nextGeneration = 1;
+static bool                                           g_attachFailed = false;
+
+static std::atomic<PFN_RetireResource>                g_pfnRetire = { nullptr };
+
+static void retireResource(const core::ResourceKey& key) {
+  { std::lock_guard lock(g_generationMutex);
+    auto entry = g_generations.find(key.pointer);
+
+    if (entry != g_generations.end() && entry->second == key.generation)
+      g_generations.erase(entry);
+  }
+
+  PFN_RetireResource pfnRetire = g_pfnRetire.load();
+
+  if (pfnRetire)
+    pfnRetire(key);
+}
+
+/**
+ * \brief Retires a key when its resource dies
+ *
+ * Only referenced by the resource's private data, so the
+ * final release happens when the resource is destroyed.
+ */
+class ResourceRetirementToken final : public IUnknown {
+
+public:
+
+  explicit ResourceRetirementToken(const core::ResourceKey& key)
+  : m_key(key) { }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override {
+    if (!ppvObject)
+      return E_POINTER;
+
+    if (riid == __uuidof(IUnknown)) {
+      AddRef();
+      *ppvObject = this;
+      return S_OK;
+    }
+
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+  }
+
+  ULONG STDMETHODCALLTYPE AddRef() override {
+    return ++m_refCount;
+  }
+
+  ULONG STDMETHODCALLTYPE Release() override {
+    ULONG refCount = --m_refCount;
+
+    if (!refCount) {
+      if (m_attached)
+        retireResource(m_key);
+
+      delete this;
+    }
+
+    return refCount;
+  }
+
+  void attach() {
+    m_attached = true;
+  }
+
+private:
+
+  std::atomic<ULONG>  m_refCount = { 1u };
+  core::ResourceKey   m_key;
+  std::atomic<bool>   m_attached = { false };
+
+};
+
+
+core::ResourceKey getResourceKey(ID3D11Resource* pResource) {
+  return getObjectKey(pResource);
+}
+
+
+core::ResourceKey getObjectKey(ID3D11DeviceChild* pObject) {
+  core::ResourceKey key;
+  key.pointer = pObject;
+
+  if (!pObject)
+    return key;
+
+  { std::lock_guard lock(g_generationMutex);
+    auto entry = g_generations.find(pObject);
+
+    if (entry != g_generations.end()) {
+      key.generation = entry->second;
+      return key;
+    }
+
+    key.generation = g_nextGeneration++;
+    g_generations.emplace(pObject, key.generation);
+  }
+
+  // The token must not be released with the lock held, since
+  // dropping it retires the key. If it cannot be attached, the
+  // key is kept for the lifetime of the process.
+  auto token = new ResourceRetirementToken(key);
+
+  if (SUCCEEDED(pObject->SetPrivateDataInterface(s_tokenGuid, token))) {
+    token->attach();
+  } else {
+    std::lock_guard lock(g_generationMutex);
+
+    if (!g_attachFailed) {
+      log("Failed to attach resource token, reused resource addresses will not be detected");
+      g_attachFailed = true;
+    }
+  }
+
+  token->Release();
+  return key;
+}
+
+
+void setResourceRetireCallback(PFN_RetireResource pfnRetire) {
+  g_pfnRetire.store(pfnRetire);
+}
+
+}
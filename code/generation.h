@@ -0,0 +1,45 @@
+#pragma once
+
+#include "impl.h"
+
+#include "core/types.h"
+
+namespace atfix {
+
+using PFN_RetireResource = void (*) (const core::ResourceKey&);
+
+/**
+ * \brief Looks up the key of a resource
+ *
+ * Assigns the next generation to resources seen for the first
+ * time, and attaches a private data interface to them whose
+ * final release, i.e. the destruction of the resource, retires
+ * the key again. A different resource created at the same
+ * address therefore gets a different key.
+ * \param [in] pResource Resource, may be \c nullptr
+ * \returns Key of the resource
+ */
+core::ResourceKey getResourceKey(ID3D11Resource* pResource);
+
+/**
+ * \brief Looks up the key of any device child
+ *
+ * Same as \c getResourceKey, for command lists and deferred
+ * contexts, so that state kept for them is retired with them.
+ * Keys of all objects share one generation counter.
+ * \param [in] pObject Object, may be \c nullptr
+ * \returns Key of the object
+ */
+core::ResourceKey getObjectKey(ID3D11DeviceChild* pObject);
+
+/**
+ * \brief Sets the function called when a resource is destroyed
+ *
+ * Also called for other objects whose key was looked up.
+ * The callback may run on any thread that releases a resource,
+ * and must not call back into D3D11.
+ * \param [in] pfnRetire Callback
+ */
+void setResourceRetireCallback(PFN_RetireResource pfnRetire);
+
+}
@@ -1,38 +1,50 @@
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cstring>
-#include <iomanip>
+#include <fstream>
+#include <memory>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
+#include "command_list.h"
+#include "config.h"
+#include "flush_coalescing.h"
+#include "generation.h"
 #include "impl.h"
+#include "profile.h"
+#include "read_profile.h"
+#include "resource_info.h"
+#include "speculation.h"
 #include "trace.h"
 #include "util.h"
+#include "validator.h"
+#include "write_shadow.h"
 
-namespace atfix {
+#include "core/checksum.h"
+#include "core/episode.h"
+#include "core/hazard.h"
+#include "core/rules.h"
+#include "core/shadow_cache.h"
+#include "core/strategy.h"
+#include "core/trace_format.h"
 
-/** Hooking-related stuff */
-using PFN_ID3D11DeviceContext_Map = HRESULT (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
-  ID3D11Resource*, UINT, D3D11_MAP, UINT, D3D11_MAPPED_SUBRESOURCE*);
-using PFN_ID3D11DeviceContext_Unmap = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
-  ID3D11Resource*, UINT);
-using PFN_ID3D11DeviceContext_CopyResource = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
-  ID3D11Resource*, ID3D11Resource*);
-using PFN_ID3D11DeviceContext_CopySubresourceRegion = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
-  ID3D11Resource*, UINT, UINT, UINT, UINT, ID3D11Resource*, UINT, const D3D11_BOX*);
-
-struct ContextProcs {
-  PFN_ID3D11DeviceContext_Map                   Map                   = nullptr;
-  PFN_ID3D11DeviceContext_Unmap                 Unmap                 = nullptr;
-  PFN_ID3D11DeviceContext_CopyResource          CopyResource          = nullptr;
-  PFN_ID3D11DeviceContext_CopySubresourceRegion CopySubresourceRegion = nullptr;
-};
+namespace atfix {
 
 static mutex  g_hookMutex;
 
 ContextProcs  g_immContextProcs;
 ContextProcs  g_defContextProcs;
+DeviceProcs   g_deviceProcs;
+
+/** DO_NOT_WAIT polls of a spin-waited Map before it blocks */
+constexpr uint32_t SpinWaitPollCount = 256;
 
 constexpr uint32_t HOOK_IMM_CTX = (1u << 0);
 constexpr uint32_t HOOK_DEF_CTX = (1u << 1);
+constexpr uint32_t HOOK_DEVICE  = (1u << 2);
 
 uint32_t      g_installedHooks = 0u;
 
@@ -46,6 +58,280 @@ bool isImmediateContext(ID3D11DeviceContext* pContext) {
   return pContext->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE;
 }
 
+static_assert(sizeof(core::Box) == sizeof(D3D11_BOX));
+
+/** Shadow cache, readback fast paths, their validator, dirty
+ *  tracking, read profiling, flush coalescing, hazard detection,
+ *  strategy control and command list tracking, only created if
+ *  enabled */
+std::unique_ptr<core::ShadowCache>  g_shadowCache;
+std::unique_ptr<ReadbackValidator>  g_validator;
+std::unique_ptr<ReadbackSpeculator> g_speculator;
+std::unique_ptr<WriteShadowTracker> g_writeShadows;
+std::unique_ptr<ReadProfiler>       g_readProfiler;
+std::unique_ptr<FlushCoalescer>     g_flushCoalescer;
+std::unique_ptr<core::HazardDetector> g_hazardDetector;
+std::unique_ptr<core::StrategyController> g_strategyController;
+std::unique_ptr<CommandListTracker> g_commandLists;
+
+/** Pattern rules, loaded before any hook is installed */
+std::unique_ptr<core::RuleSet>      g_rules;
+
+/** Gap between readbacks that ends a statistics report */
+constexpr uint64_t ReportEpisodeGapUs = 500000;
+
+static mutex                  g_reportMutex;
+static core::EpisodeDetector  g_reportEpisodes(ReportEpisodeGapUs);
+static core::ShadowCacheStats g_shadowTotals;
+
+uint64_t getTimeUs() {
+  auto now = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
+}
+
+void logShadowCacheStats(const char* pWhat, const core::ShadowCacheStats& stats) {
+  log("Shadow cache ", pWhat, ": ", stats.readbacks, " readbacks, ",
+    stats.keyed, " with known payload, ", stats.hits, " would hit, ",
+    stats.correctHits, " would be correct, ",
+    stats.savedUs, " us of ", stats.waitUs, " us would be saved");
+}
+
+void logSpeculationStats(const SpeculationStats& stats) {
+  log("Speculative readback: ", stats.hits, " hits, ", stats.misses, " misses, ",
+    stats.mismatches, " mismatches, ", stats.skipped, " skipped, ",
+    stats.decompressNs / 1000u, " us decompressing");
+}
+
+void logReadbackCacheStats(const core::ReadbackCacheStats& stats) {
+  log("Readback cache: ", stats.entries, " images, ", stats.storedBytes >> 10, " KiB held for ",
+    stats.rawBytes >> 10, " KiB of data, ", stats.evictions, " evictions");
+}
+
+void logValidationStats(const ValidationStats& stats) {
+  log("Readback validation: ", stats.sampled, " sampled, ", stats.passed, " passed, ",
+    stats.failed, " failed, ", stats.dropped, " dropped");
+}
+
+void logWriteShadowStats(const WriteShadowStats& stats) {
+  log("Dirty tracking: ", stats.shadowMaps, " shadowed maps, ", stats.directMaps, " direct maps, ",
+    stats.faults, " faults, ", stats.copiedRows, " of ", stats.totalRows, " rows copied, ",
+    stats.shadowUs / std::max<uint64_t>(stats.shadowMaps, 1u), " us per shadowed map, ",
+    stats.directUs / std::max<uint64_t>(stats.directMaps, 1u), " us per direct map");
+}
+
+void logReadProfileStats(const ReadProfileStats& stats) {
+  for (const auto& site : stats.sites) {
+    log("Read profile of call site 0x", std::hex, uintptr_t(site.callSite), std::dec, ": ",
+      site.maps, " maps, ", site.touchedRows, " of ", site.totalRows, " rows read, footprint rows ",
+      site.rowBegin, "-", site.rowEnd, site.stable ? ", stable" : "");
+  }
+
+  log("Read profiling: ", stats.faults, " faults, ", stats.shrunkCopies, " copies shrunk, ",
+    stats.savedBytes >> 10, " KiB not copied");
+}
+
+void logFlushStats(const FlushStats& stats) {
+  log("Flush coalescing: ", stats.forwarded, " flushes forwarded, ", stats.suppressed,
+    " suppressed during readbacks, ", stats.idle, " outside of readbacks");
+}
+
+void logHazards(const std::vector<core::HazardStats>& hazards) {
+  for (size_t i = 0; i < hazards.size(); i++) {
+    const core::HazardStats& hazard = hazards[i];
+
+    log("Readback hazard #", i + 1, ": ", hazard.readbacks, " readbacks, ",
+      hazard.stallUs, " us stall, ", hazard.maxStallUs, " us max, ",
+      core::formatHazardSignature(hazard.signature));
+  }
+}
+
+void logStrategyDecisions(const std::vector<core::StrategyDecision>& decisions) {
+  for (const auto& decision : decisions) {
+    std::string pattern = core::formatResourceDesc(decision.pattern);
+
+    log("Strategy for ", pattern, ": ", core::strategyToString(decision.measured), " took ",
+      decision.latencyUs, " us per readback over ", decision.readbacks, " readbacks, ",
+      core::strategyEventToString(decision.event), ", next ", core::strategyToString(decision.next));
+
+    if (decision.nextEpisodes && decision.event != core::StrategyEvent::Explore) {
+      log("Strategy for ", pattern, ": ", core::strategyToString(decision.next), " averages ",
+        decision.nextMeanUs, " us per readback, driver ", decision.driverMeanUs, " us, gain ",
+        int64_t(decision.driverMeanUs) - int64_t(decision.nextMeanUs), " us");
+    }
+  }
+}
+
+void logCommandListStats(const CommandListStats& stats) {
+  log("Deferred contexts: ", stats.recordedOps, " uploads and copies recorded, ",
+    stats.finishedLists, " command lists finished, ", stats.executedLists, " executed, ",
+    stats.mergedOps, " uploads and copies merged");
+}
+
+void pollValidation(ID3D11DeviceContext* pContext) {
+  std::vector<ReadbackValidation> failures;
+  g_validator->poll(pContext, &failures);
+
+  for (const auto& failure : failures) {
+    if (g_speculator && failure.lineage.pStrategy == ReadbackSpeculator::StrategyName)
+      g_speculator->registerFailure(failure);
+  }
+}
+
+void retireResource(const core::ResourceKey& key) {
+  retireTrackedTexture(key);
+
+  if (g_shadowCache)
+    g_shadowCache->retire(key);
+
+  if (g_speculator)
+    g_speculator->retire(key);
+
+  if (g_writeShadows)
+    g_writeShadows->retire(key);
+
+  if (g_readProfiler)
+    g_readProfiler->retire(key);
+
+  if (g_flushCoalescer)
+    g_flushCoalescer->retire(key);
+
+  if (g_hazardDetector)
+    g_hazardDetector->retire(key);
+
+  if (g_commandLists)
+    g_commandLists->retire(key);
+}
+
+void registerReadbackEpisode() {
+  std::lock_guard lock(g_reportMutex);
+
+  // Report once the menu is done, i.e. when the next one starts
+  if (!g_reportEpisodes.addCall(getTimeUs()) || g_reportEpisodes.getEpisodeCount() < 2)
+    return;
+
+  if (g_shadowCache) {
+    core::ShadowCacheStats stats = g_shadowCache->takeStats();
+    g_shadowTotals += stats;
+
+    logShadowCacheStats("episode", stats);
+    logShadowCacheStats("total", g_shadowTotals);
+  }
+
+  if (g_speculator) {
+    logSpeculationStats(g_speculator->takeStats());
+    logReadbackCacheStats(g_speculator->getCacheStats());
+  }
+
+  if (g_validator)
+    logValidationStats(g_validator->takeStats());
+
+  if (g_writeShadows)
+    logWriteShadowStats(g_writeShadows->takeStats());
+
+  if (g_readProfiler)
+    logReadProfileStats(g_readProfiler->takeStats());
+
+  if (g_flushCoalescer)
+    logFlushStats(g_flushCoalescer->takeStats());
+
+  if (g_hazardDetector)
+    logHazards(g_hazardDetector->takeTop(getConfig().hazardReportTop));
+
+  if (g_strategyController)
+    logStrategyDecisions(g_strategyController->endEpisode());
+
+  if (g_commandLists) {
+    CommandListStats stats = g_commandLists->takeStats();
+
+    if (stats.recordedOps || stats.executedLists)
+      logCommandListStats(stats);
+  }
+}
+
+/** Describes a resource of any dimension. Buffers are one row of
+ *  ByteWidth bytes, and the depth of 3D textures is ignored. */
+core::Dimension describeResource(ID3D11Resource* pResource, core::ResourceDesc* pDesc) {
+  ResourceInfo info;
+  getResourceInfo(pResource, &info);
+
+  *pDesc = getResourceDesc(info);
+  return core::Dimension(info.dimension);
+}
+
+/** Feeds a copy or resolve to the hazard detector */
+void registerHazardCopy(const core::ResourceKey& dstKey, const core::ResourceKey& srcKey,
+        ID3D11Resource* pSrcResource, core::WriteKind kind) {
+  core::ResourceDesc srcDesc;
+  core::Dimension srcDim = describeResource(pSrcResource, &srcDesc);
+  g_hazardDetector->registerCopy(dstKey, srcKey, kind, srcDim, srcDesc);
+}
+
+/** Looks up the rule actions for a copy of any resources */
+core::RuleActions getCopyActions(ID3D11Resource* pDstResource, ID3D11Resource* pSrcResource) {
+  core::ResourceDesc dstDesc, srcDesc;
+  describeResource(pDstResource, &dstDesc);
+  describeResource(pSrcResource, &srcDesc);
+
+  return g_rules->getCopyActions(g_rules->classify(dstDesc), g_rules->classify(srcDesc));
+}
+
+/** Loads pattern rules from the rules file, or the rules of
+ *  the game profile if there is none */
+std::unique_ptr<core::RuleSet> loadRules(const char* pPath, const GameProfile& profile) {
+  std::vector<core::Rule> rules;
+  std::vector<std::string> errors;
+
+  std::ifstream file(pPath);
+
+  if (file) {
+    log("Loading pattern rules from ", pPath);
+    core::parseRules(file, &rules, &errors);
+  } else {
+    log("No ", pPath, ", using pattern rules of profile ", profile.name);
+    std::istringstream stream(profile.rules ? profile.rules : core::getDefaultRulesText());
+    core::parseRules(stream, &rules, &errors);
+  }
+
+  for (const auto& error : errors)
+    log("Rules: ", error);
+
+  auto result = std::make_unique<core::RuleSet>();
+
+  for (const auto& rule : rules) {
+    if (!result->addRule(rule)) {
+      log("Rule ", rule.name, " ignored, more than ",
+        core::RuleSet::MaxConditions, " distinct conditions");
+      continue;
+    }
+
+    log("Rule ", rule.name, ": ", rule.call == core::RuleCall::Copy ? "copy" : "map",
+      " -> ", core::formatRuleActions(rule.actions));
+  }
+
+  return result;
+}
+
+/** Whether a context records its uploads and copies for
+ *  the trackers to see when its command list is executed */
+bool isRecordingContext(ID3D11DeviceContext* pContext) {
+  return g_commandLists && !isImmediateContext(pContext);
+}
+
+/** Whether copies into a resource are to be flushed right away */
+bool isEarlyFlushTarget(ID3D11Resource* pResource, core::ResourceDesc* pPattern) {
+  describeResource(pResource, pPattern);
+
+  return g_strategyController->getStrategy(*pPattern) == core::Strategy::EarlyFlush;
+}
+
+/** Flushes on behalf of a readback strategy, whose latency includes
+ *  the time spent submitting */
+void flushForStrategy(ID3D11DeviceContext* pContext, const core::ResourceDesc& pattern) {
+  uint64_t startUs = getTimeUs();
+  getContextProcs(pContext)->Flush(pContext);
+  g_strategyController->registerCost(pattern, getTimeUs() - startUs);
+}
+
 /** Hooked functions */
 
 HRESULT STDMETHODCALLTYPE ID3D11DeviceContext_Map(
@@ -57,69 +343,176 @@ HRESULT STDMETHODCALLTYPE ID3D11DeviceContext_Map(
         D3D11_MAPPED_SUBRESOURCE* pMappedResource) {
   auto procs = getContextProcs(pContext);
 
-  // Call real Map first
-  HRESULT hr = procs->Map(pContext, pResource, Subresource, MapType, MapFlags, pMappedResource);
+  // Footprints are recorded per caller of Map
+  const void* pCallSite = __builtin_return_address(0);
+
+  bool isRead = MapType == D3D11_MAP_READ || MapType == D3D11_MAP_READ_WRITE;
+  bool isTracing = isTraceLoggingActive();
+  bool isSpeculating = g_speculator && isImmediateContext(pContext);
+  bool isProfiling = g_readProfiler && isImmediateContext(pContext);
+  bool isCoalescing = g_flushCoalescer && isImmediateContext(pContext);
+  bool isDetecting = g_hazardDetector && isImmediateContext(pContext) && pResource;
+  bool isControlling = g_strategyController && isImmediateContext(pContext) && isRead && pResource;
+  bool isRecording = isRecordingContext(pContext);
+  bool isActive = isTracing || g_shadowCache || isSpeculating || isProfiling || isRecording;
+  bool hasWriteShadows = g_writeShadows && isImmediateContext(pContext);
+
+  core::ResourceKey key = isActive || hasWriteShadows || isDetecting || (isCoalescing && isRead)
+    ? getResourceKey(pResource) : core::ResourceKey();
+
+  if (g_validator && isImmediateContext(pContext))
+    pollValidation(pContext);
+
+  if (isRead && (g_shadowCache || isSpeculating || hasWriteShadows || isProfiling || isCoalescing
+   || isDetecting || isControlling))
+    registerReadbackEpisode();
+
+  // Speculation is only worth trying where the rules let the cache
+  // see the uploads that readbacks of this pattern come from
+  core::ResourceDesc pattern;
+  core::Strategy strategy = core::Strategy::Driver;
+
+  if (isControlling) {
+    describeResource(pResource, &pattern);
+
+    uint32_t available = (1u << uint32_t(core::Strategy::Driver))
+                       | (1u << uint32_t(core::Strategy::EarlyFlush))
+                       | (1u << uint32_t(core::Strategy::SpinWait));
+
+    if (isSpeculating && MapType == D3D11_MAP_READ
+     && (g_rules->getMapActions(g_rules->classify(pattern), core::MapType(MapType)) & core::RuleActionCache))
+      available |= 1u << uint32_t(core::Strategy::Speculative);
+
+    strategy = g_strategyController->selectStrategy(pattern, available);
+  }
+
+  // Time reads for the shadow cache, hazard detection and strategy
+  // control, this is what a cache hit would save
+  uint64_t mapStartUs = (g_shadowCache || isDetecting || isControlling) && isRead ? getTimeUs() : 0;
+
+  // Time writes for dirty tracking calibration
+  uint64_t writeStartUs = hasWriteShadows && MapType == D3D11_MAP_WRITE_DISCARD ? getTimeUs() : 0;
 
-  // Log Map operations on Tex2D (if logging active and Map succeeded)
-  if (SUCCEEDED(hr) && isTraceLoggingActive() && pResource && pMappedResource) {
-    D3D11_RESOURCE_DIMENSION dim;
-    pResource->GetType(&dim);
+  // Serve predicted glyph readbacks without waiting for the GPU,
+  // otherwise call real Map first
+  bool isSpeculative = isSpeculating && MapType == D3D11_MAP_READ
+    && (!isControlling || strategy == core::Strategy::Speculative)
+    && g_speculator->mapSpeculative(key, Subresource, pMappedResource);
 
-    if (dim == D3D11_RESOURCE_DIMENSION_TEXTURE2D) {
-      ID3D11Texture2D* tex = nullptr;
-      pResource->QueryInterface(IID_PPV_ARGS(&tex));
+  HRESULT hr = S_OK;
 
-      D3D11_TEXTURE2D_DESC desc = {};
-      tex->GetDesc(&desc);
+  if (!isSpeculative && strategy == core::Strategy::SpinWait && !(MapFlags & D3D11_MAP_FLAG_DO_NOT_WAIT)) {
+    // Poll rather than let the driver put the thread to sleep. Submit
+    // first so there is something to wait for, and block if the GPU
+    // takes longer than a few time slices.
+    procs->Flush(pContext);
 
-      // Log Map(READ) on STAGING textures
-      if ((MapType == D3D11_MAP_READ || MapType == D3D11_MAP_READ_WRITE) &&
-          desc.Usage == D3D11_USAGE_STAGING) {
+    for (uint32_t i = 0; i < SpinWaitPollCount; i++) {
+      hr = procs->Map(pContext, pResource, Subresource, MapType,
+        MapFlags | D3D11_MAP_FLAG_DO_NOT_WAIT, pMappedResource);
+
+      if (hr != DXGI_ERROR_WAS_STILL_DRAWING)
+        break;
+
+      std::this_thread::yield();
+    }
+
+    if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+      hr = procs->Map(pContext, pResource, Subresource, MapType, MapFlags, pMappedResource);
+  } else if (!isSpeculative) {
+    hr = procs->Map(pContext, pResource, Subresource, MapType, MapFlags, pMappedResource);
+  } else if (isControlling) {
+    flushForStrategy(pContext, pattern);
+  } else {
+    // The real Map would have submitted the game's copy. Without
+    // that, copies of served readbacks pile up, and the next miss
+    // waits for all of them.
+    procs->Flush(pContext);
+  }
+
+  uint64_t mapUs = mapStartUs ? getTimeUs() - mapStartUs : 0;
+
+  // Only the real Map submits the copies pending for the resource
+  if (isRead && isCoalescing && !isSpeculative)
+    g_flushCoalescer->registerReadback(key, getTimeUs());
+
+  if (SUCCEEDED(hr) && isControlling)
+    g_strategyController->registerReadback(pattern, mapUs);
+
+  if (SUCCEEDED(hr) && isDetecting) {
+    if (isRead) {
+      core::ResourceDesc desc;
+      core::Dimension dim = describeResource(pResource, &desc);
+      g_hazardDetector->registerReadback(key, dim, desc, core::MapType(MapType), mapUs);
+    }
+
+    if (MapType != D3D11_MAP_READ)
+      g_hazardDetector->registerWrite(key, core::WriteKind::CpuWrite);
+  }
+
+  // Log Map operations on resources of any dimension (if logging active and Map succeeded)
+  ResourceInfo info;
+  SubresourceLayout layout;
+
+  if (SUCCEEDED(hr) && (isActive || hasWriteShadows) && pResource && pMappedResource
+   && getResourceInfo(pResource, &info) && getSubresourceLayout(info, Subresource, &layout)) {
+    core::ResourceDesc desc = getResourceDesc(info);
+    core::RuleActions actions = g_rules->getMapActions(g_rules->classify(desc), core::MapType(MapType));
+
+    // Unmap only untracks resources while a cache or trace is active
+    bool isTraced = isTracing && (actions & core::RuleActionTrace);
+    bool isCached = isActive && (actions & core::RuleActionCache);
+
+    if (isRead) {
+      if (isTraced) {
         // Calculate checksum of the data
-        uint32_t checksum = calculateTextureChecksum(pMappedResource->pData,
-                                                      pMappedResource->RowPitch,
-                                                      desc.Width, desc.Height, desc.Format);
-
-        std::ostringstream oss;
-        oss << "[" << getLogTimestamp() << "] Map"
-            << " type=" << mapTypeToString(MapType)
-            << " res=0x" << std::hex << pResource << std::dec
-            << " sub=" << Subresource
-            << " dim=" << desc.Width << "x" << desc.Height
-            << " usage=" << usageToString(desc.Usage)
-            << " cpu=0x" << std::hex << desc.CPUAccessFlags << std::dec
-            << " bind=0x" << std::hex << desc.BindFlags << std::dec
-            << " fmt=" << desc.Format
-            << " checksum=0x" << std::hex << checksum << std::dec;
-        writeTraceLog(oss.str());
-
-        // Track this texture for Unmap logging
-        trackStagingTexture(pResource);
+        uint32_t checksum = calculateTextureChecksum(*pMappedResource, layout);
+
+        writeTraceLog(core::formatMapLine(getLogTimestampUs(), pResource, Subresource,
+          core::MapType(MapType), desc, &checksum));
       }
 
-      // Log Map(WRITE_DISCARD) on DYNAMIC textures (512x512, format 90)
-      if (MapType == D3D11_MAP_WRITE_DISCARD &&
-          desc.Usage == D3D11_USAGE_DYNAMIC &&
-          desc.Width == 512 && desc.Height == 512 && desc.Format == 90) {
-        std::ostringstream oss;
-        oss << "[" << getLogTimestamp() << "] Map"
-            << " type=" << mapTypeToString(MapType)
-            << " res=0x" << std::hex << pResource << std::dec
-            << " sub=" << Subresource
-            << " dim=" << desc.Width << "x" << desc.Height
-            << " usage=" << usageToString(desc.Usage)
-            << " cpu=0x" << std::hex << desc.CPUAccessFlags << std::dec
-            << " bind=0x" << std::hex << desc.BindFlags << std::dec
-            << " fmt=" << desc.Format;
-        writeTraceLog(oss.str());
-
-        // Track this texture for Unmap checksum calculation
-        trackStagingTexture(pResource);
-        trackMappedTextureData(pResource, pMappedResource->pData, pMappedResource->RowPitch,
-                                desc.Width, desc.Height, desc.Format);
+      // Speculative data came from the speculator, not the driver,
+      // so scoring it would only confirm the shadow cache's guess
+      if (g_shadowCache && isCached && !isSpeculative) {
+        uint64_t hash = calculateTextureHash(*pMappedResource, layout);
+        g_shadowCache->registerReadback(key, hash, mapUs);
       }
 
-      tex->Release();
+      if (isSpeculating && isCached && !isSpeculative)
+        g_speculator->registerReadback(key, Subresource, *pMappedResource, layout);
+
+      // Track this resource for Unmap logging
+      if (isTraced || isCached)
+        trackStagingTexture(key);
+
+      // Hand the game a read-protected copy of glyph readbacks to see which
+      // rows it reads. Must come last, nothing else may touch the copy.
+      // Footprints are rows, so 3D textures with several slices are skipped.
+      if (isProfiling && (actions & core::RuleActionProfile)
+       && MapType == D3D11_MAP_READ && !isSpeculative && !Subresource && layout.sliceCount == 1) {
+        g_readProfiler->mapProfiled(key, pCallSite, layout.rowSize, layout.rowCount, pMappedResource);
+      }
+    } else {
+      if (isTraced) {
+        writeTraceLog(core::formatMapLine(getLogTimestampUs(), pResource, Subresource,
+          core::MapType(MapType), desc, nullptr));
+      }
+
+      // Hand the game a write-protected shadow, so that only dirty rows
+      // are uploaded and hashing does not read write-combined memory.
+      // Only discarded maps may start out with undefined contents.
+      if (hasWriteShadows && (actions & core::RuleActionShadow)
+       && MapType == D3D11_MAP_WRITE_DISCARD && !Subresource) {
+        g_writeShadows->mapShadow(key, layout.rowSize, layout.rowCount, layout.sliceCount,
+          writeStartUs, pMappedResource);
+      }
+
+      // Track this resource for Unmap checksum calculation
+      if (isTraced || isCached) {
+        trackStagingTexture(key);
+        trackMappedTextureData(key, *pMappedResource, layout);
+      }
     }
   }
 
@@ -134,36 +527,500 @@ void STDMETHODCALLTYPE ID3D11DeviceContext_Unmap(
 
   // Log Unmap on tracked textures (STAGING and DYNAMIC) (if logging active)
   // IMPORTANT: Calculate checksum BEFORE calling real Unmap (while data is still mapped)
-  if (isTraceLoggingActive() && pResource) {
-    if (isStagingTextureTracked(pResource)) {
-      std::ostringstream oss;
-      oss << "[" << getLogTimestamp() << "] Unmap"
-          << " res=0x" << std::hex << pResource << std::dec
-          << " sub=" << Subresource;
+  bool isTracing = isTraceLoggingActive();
+  bool isSpeculating = g_speculator && isImmediateContext(pContext);
+  bool isProfiling = g_readProfiler && isImmediateContext(pContext);
+  bool isRecording = isRecordingContext(pContext);
+  bool isActive = isTracing || g_shadowCache || isSpeculating || isProfiling || isRecording;
+  bool hasWriteShadows = g_writeShadows && isImmediateContext(pContext);
+
+  core::ResourceKey key = isActive || hasWriteShadows ? getResourceKey(pResource) : core::ResourceKey();
+  uint64_t payload = 0;
+
+  // Upload dirty rows of a shadowed map before anything reads them. Rows
+  // that were not copied are undefined, so the payload is only known if
+  // every row was.
+  bool isComplete = true;
 
+  if (hasWriteShadows && pResource)
+    g_writeShadows->unmapShadow(key, &isComplete);
+
+  if (isActive && pResource) {
+    if (isStagingTextureTracked(key)) {
       // Check if we have tracked mapped data (for WRITE_DISCARD operations)
-      uint32_t checksum = getAndClearMappedChecksum(pResource);
-      if (checksum != 0) {
-        oss << " checksum=0x" << std::hex << checksum << std::dec;
+      core::MappedData data;
+      bool hasData = takeMappedTextureData(key, &data);
+
+      if (isTracing) {
+        uint32_t checksum = hasData
+          ? core::calculateChecksum(data.pData, data.rowPitch, data.depthPitch,
+            data.rowSize, data.rowCount, data.sliceCount)
+          : 0u;
+
+        writeTraceLog(core::formatUnmapLine(getLogTimestampUs(), pResource, Subresource,
+          checksum ? &checksum : nullptr));
       }
 
-      writeTraceLog(oss.str());
+      // Caches key by a content hash, the trace checksum collides too easily
+      if (g_shadowCache || isSpeculating || isRecording) {
+        payload = hasData && isComplete
+          ? core::calculateHash(data.pData, data.rowPitch, data.depthPitch,
+            data.rowSize, data.rowCount, data.sliceCount)
+          : 0u;
+
+        // Deferred uploads only land once their command list is executed
+        if (g_shadowCache && !isRecording)
+          g_shadowCache->registerWrite(key, payload);
+
+        if (isSpeculating)
+          g_speculator->registerWrite(key, payload);
+      }
 
       // Remove from tracking (unmap completes the Map/Unmap pair)
-      untrackStagingTexture(pResource);
+      untrackStagingTexture(key);
     }
   }
 
+  if (isProfiling && pResource)
+    g_readProfiler->unmapProfiled(key);
+
+  if (isRecording && pResource) {
+    DeferredOp op;
+    op.type = DeferredOpType::Write;
+    op.pDstResource = pResource;
+    op.DstSubresource = Subresource;
+    op.payload = payload;
+
+    g_commandLists->record(getObjectKey(pContext), op);
+  }
+
+  // Speculative maps never reached the driver
+  if (isSpeculating && g_speculator->unmapSpeculative(key, Subresource))
+    return;
+
   procs->Unmap(pContext, pResource, Subresource);
+
+  if (hasWriteShadows && pResource)
+    g_writeShadows->endMap(key);
+}
+
+
+/** Updates the trackers for a copy that is about to be executed on a
+ *  context, or for one recorded in a command list that just was */
+void trackCopyResource(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pDstResource,
+        ID3D11Resource*           pSrcResource,
+        core::WriteKind           kind) {
+  bool isSpeculating = g_speculator && isImmediateContext(pContext);
+  bool isProfiling = g_readProfiler && isImmediateContext(pContext);
+  bool isCoalescing = g_flushCoalescer && isImmediateContext(pContext);
+  bool isDetecting = g_hazardDetector && isImmediateContext(pContext) && pSrcResource;
+
+  if ((g_shadowCache || isSpeculating || isProfiling || isCoalescing || isDetecting) && pDstResource) {
+    core::ResourceKey dstKey = getResourceKey(pDstResource);
+
+    if (isDetecting)
+      registerHazardCopy(dstKey, getResourceKey(pSrcResource), pSrcResource, kind);
+
+    if (isCoalescing && pSrcResource
+     && (getCopyActions(pDstResource, pSrcResource) & core::RuleActionFlush))
+      g_flushCoalescer->registerCopy(dstKey);
+
+    if (g_shadowCache)
+      g_shadowCache->registerCopy(dstKey, core::ResourceKey());
+
+    if (isSpeculating)
+      g_speculator->invalidate(dstKey);
+
+    if (isProfiling)
+      g_readProfiler->invalidate(dstKey);
+  }
+}
+
+/** Same for region copies. If a shrunk box is passed in, full glyph
+ *  copies may be shrunk to the rows the game reads, in which case the
+ *  source box and destination row are replaced. Copies that ran before
+ *  their source was written again cannot be repeated for validation. */
+void trackCopySubresourceRegion(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+        UINT                      DstX,
+        UINT*                     pDstY,
+        UINT                      DstZ,
+        ID3D11Resource*           pSrcResource,
+        UINT                      SrcSubresource,
+  const D3D11_BOX**               ppSrcBox,
+        D3D11_BOX*                pShrunkBox,
+        bool                      isRepeatable) {
+  // Log copies selected by the pattern rules (if logging active)
+  bool isTracing = isTraceLoggingActive();
+  bool isSpeculating = g_speculator && isImmediateContext(pContext);
+  bool isProfiling = g_readProfiler && isImmediateContext(pContext);
+  bool isCoalescing = g_flushCoalescer && isImmediateContext(pContext);
+  bool isDetecting = g_hazardDetector && isImmediateContext(pContext);
+
+  UINT DstY = *pDstY;
+  const D3D11_BOX* pSrcBox = *ppSrcBox;
+
+  if ((isTracing || g_shadowCache || isSpeculating || isProfiling || isCoalescing || isDetecting)
+   && pDstResource && pSrcResource) {
+    core::ResourceKey dstKey = getResourceKey(pDstResource);
+    core::ResourceKey srcKey = getResourceKey(pSrcResource);
+
+    if (isDetecting)
+      registerHazardCopy(dstKey, srcKey, pSrcResource, core::WriteKind::Copy);
+
+    core::RuleActions actions = 0;
+    bool isShrunk = false;
+
+    ResourceInfo dstInfo;
+    ResourceInfo srcInfo;
+
+    if (getResourceInfo(pDstResource, &dstInfo) && getResourceInfo(pSrcResource, &srcInfo)) {
+      core::ResourceDesc dstDesc = getResourceDesc(dstInfo);
+      core::ResourceDesc srcDesc = getResourceDesc(srcInfo);
+
+      actions = g_rules->getCopyActions(g_rules->classify(dstDesc), g_rules->classify(srcDesc));
+
+      if (isTracing && (actions & core::RuleActionTrace)) {
+        writeTraceLog(core::formatCopyLine(getLogTimestampUs(),
+          pDstResource, DstSubresource, DstX, DstY, DstZ, dstDesc,
+          pSrcResource, SrcSubresource, srcDesc,
+          reinterpret_cast<const core::Box*>(pSrcBox)));
+      }
+
+      if (isSpeculating && (actions & core::RuleActionCache)) {
+        // Strategies only change between episodes, so this is the
+        // strategy of the readback. Validation copies are part of
+        // what speculation costs.
+        bool isServable = !g_strategyController
+          || g_strategyController->getStrategy(dstDesc) == core::Strategy::Speculative;
+
+        uint64_t startUs = g_strategyController ? getTimeUs() : 0;
+
+        g_speculator->registerCopy(pContext, dstKey, DstSubresource, DstX, DstY, DstZ,
+          srcKey, isRepeatable ? pSrcResource : nullptr, SrcSubresource, pSrcBox,
+          dstInfo, srcInfo, isServable);
+
+        if (g_strategyController)
+          g_strategyController->registerCost(dstDesc, getTimeUs() - startUs);
+      }
+
+      // Only copy the rows the game reads once that is known. Partial
+      // copies keep their own box, only full copies of a single slice
+      // are shrunk.
+      bool isFullCopy = !pSrcBox && !DstX && !DstY && !DstZ
+        && dstInfo.width == srcInfo.width && dstInfo.height == srcInfo.height
+        && dstInfo.depth == 1 && srcInfo.depth == 1;
+
+      SubresourceLayout srcLayout;
+      UINT rowBegin = 0;
+      UINT rowEnd = 0;
+
+      if (isProfiling && pShrunkBox && (actions & core::RuleActionProfile) && isFullCopy
+       && getSubresourceLayout(srcInfo, 0, &srcLayout)
+       && g_readProfiler->shrinkCopy(dstKey, srcLayout.rowSize, srcLayout.rowCount, &rowBegin, &rowEnd)) {
+        *pShrunkBox = { 0u, rowBegin, 0u, srcInfo.width, rowEnd, 1u };
+        *ppSrcBox = pShrunkBox;
+        *pDstY = rowBegin;
+        isShrunk = true;
+      }
+    }
+
+    if (isCoalescing && (actions & core::RuleActionFlush))
+      g_flushCoalescer->registerCopy(dstKey);
+
+    // Any other copy leaves the destination with unknown contents
+    if (g_shadowCache)
+      g_shadowCache->registerCopy(dstKey, (actions & core::RuleActionCache) ? srcKey : core::ResourceKey());
+
+    if (isSpeculating && !(actions & core::RuleActionCache))
+      g_speculator->invalidate(dstKey);
+
+    if (isProfiling && !isShrunk)
+      g_readProfiler->invalidate(dstKey);
+  }
+}
+
+/** Hash of the data of an UpdateSubresource call, if it replaces the
+ *  only subresource and the rules cache uploads to the resource. The
+ *  rules match updates like the Map(WRITE_DISCARD) they replace. */
+uint64_t getUpdatePayload(
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+  const D3D11_BOX*                pDstBox,
+  const void*                     pSrcData,
+        UINT                      SrcRowPitch,
+        UINT                      SrcDepthPitch) {
+  ResourceInfo info;
+  SubresourceLayout layout;
+
+  if (pDstBox || !pSrcData || DstSubresource
+   || !getResourceInfo(pDstResource, &info)
+   || info.mipLevels != 1 || info.arraySize != 1
+   || !getSubresourceLayout(info, DstSubresource, &layout))
+    return 0;
+
+  core::RuleActions actions = g_rules->getMapActions(
+    g_rules->classify(getResourceDesc(info)), core::MapType::WriteDiscard);
+
+  if (!(actions & core::RuleActionCache))
+    return 0;
+
+  return core::calculateHash(pSrcData, SrcRowPitch, SrcDepthPitch,
+    layout.rowSize, layout.rowCount, layout.sliceCount);
+}
+
+/** Updates the trackers for data written without Map, i.e. through
+ *  UpdateSubresource, or for an update recorded in a command list */
+void trackUpdateSubresource(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pDstResource,
+        uint64_t                  payload) {
+  bool isSpeculating = g_speculator && isImmediateContext(pContext);
+  bool isProfiling = g_readProfiler && isImmediateContext(pContext);
+  bool isDetecting = g_hazardDetector && isImmediateContext(pContext);
+
+  if ((g_shadowCache || isSpeculating || isProfiling || isDetecting) && pDstResource) {
+    core::ResourceKey key = getResourceKey(pDstResource);
+
+    if (g_shadowCache)
+      g_shadowCache->registerWrite(key, payload);
+
+    // Also drops readbacks planned for the resource as a copy destination
+    if (isSpeculating) {
+      g_speculator->invalidate(key);
+      g_speculator->registerWrite(key, payload);
+    }
+
+    if (isProfiling)
+      g_readProfiler->invalidate(key);
+
+    if (isDetecting)
+      g_hazardDetector->registerWrite(key, core::WriteKind::Update);
+  }
+}
+
+/** Same for discards, which leave the contents undefined */
+void trackDiscardResource(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pResource) {
+  bool isSpeculating = g_speculator && isImmediateContext(pContext);
+  bool isProfiling = g_readProfiler && isImmediateContext(pContext);
+
+  if ((g_shadowCache || isSpeculating || isProfiling) && pResource) {
+    core::ResourceKey key = getResourceKey(pResource);
+
+    if (g_shadowCache) {
+      g_shadowCache->registerCopy(key, core::ResourceKey());
+      g_shadowCache->registerWrite(key, 0u);
+    }
+
+    if (isSpeculating)
+      g_speculator->invalidate(key);
+
+    if (isProfiling)
+      g_readProfiler->invalidate(key);
+  }
+}
+
+/** Same for resolves. Resolved data differs from the source, so the
+ *  destination is tracked like a copy of unknown contents, and as a
+ *  copy source it no longer holds what was uploaded to it. */
+void trackResolveSubresource(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pDstResource,
+        ID3D11Resource*           pSrcResource) {
+  trackCopyResource(pContext, pDstResource, pSrcResource, core::WriteKind::Resolve);
+
+  if (g_shadowCache && pDstResource)
+    g_shadowCache->registerWrite(getResourceKey(pDstResource), 0u);
+}
+
+/** Passes the uploads and copies of a command list that was just
+ *  executed on the immediate context to the trackers, in order */
+void trackCommandList(ID3D11DeviceContext* pContext, const DeferredOpList& Ops) {
+  core::ResourceDesc flushPattern;
+  bool needsFlush = false;
+
+  if (g_validator)
+    pollValidation(pContext);
+
+  // Copies are tracked after the whole list ran, so validation
+  // can only repeat those whose source the list does not write
+  // again later on
+  std::vector<bool> isSrcRewritten(Ops.size());
+
+  if (g_speculator) {
+    std::unordered_set<ID3D11Resource*> written;
+
+    for (size_t i = Ops.size(); i--; ) {
+      isSrcRewritten[i] = Ops[i].pSrcResource && written.count(Ops[i].pSrcResource);
+      written.insert(Ops[i].pDstResource);
+    }
+  }
+
+  for (size_t i = 0; i < Ops.size(); i++) {
+    const DeferredOp& op = Ops[i];
+
+    switch (op.type) {
+      case DeferredOpType::Write: {
+        core::ResourceKey key = getResourceKey(op.pDstResource);
+
+        if (g_shadowCache)
+          g_shadowCache->registerWrite(key, op.payload);
+
+        if (g_speculator)
+          g_speculator->registerWrite(key, op.payload);
+
+        if (g_hazardDetector)
+          g_hazardDetector->registerWrite(key, core::WriteKind::CpuWrite);
+      } continue;
+
+      case DeferredOpType::Update:
+        trackUpdateSubresource(pContext, op.pDstResource, op.payload);
+        continue;
+
+      case DeferredOpType::DiscardResource:
+        trackDiscardResource(pContext, op.pDstResource);
+        continue;
+
+      case DeferredOpType::CopyResource:
+        trackCopyResource(pContext, op.pDstResource, op.pSrcResource, core::WriteKind::Copy);
+        break;
+
+      case DeferredOpType::ResolveSubresource:
+        trackResolveSubresource(pContext, op.pDstResource, op.pSrcResource);
+        break;
+
+      case DeferredOpType::CopySubresourceRegion: {
+        UINT DstY = op.DstY;
+        const D3D11_BOX* pSrcBox = op.hasSrcBox ? &op.SrcBox : nullptr;
+
+        // The copy already ran, so it cannot be shrunk anymore
+        trackCopySubresourceRegion(pContext, op.pDstResource, op.DstSubresource,
+          op.DstX, &DstY, op.DstZ, op.pSrcResource, op.SrcSubresource, &pSrcBox, nullptr,
+          !isSrcRewritten[i]);
+      } break;
+    }
+
+    core::ResourceDesc pattern;
+
+    if (g_strategyController && isEarlyFlushTarget(op.pDstResource, &pattern)) {
+      flushPattern = pattern;
+      needsFlush = true;
+    }
+  }
+
+  // Start the copies now instead of at the implicit flush of the
+  // readback. One flush serves all copies, the last one pays for it.
+  if (needsFlush)
+    flushForStrategy(pContext, flushPattern);
 }
 
+/** Starts a copy now instead of at the implicit flush of the readback */
+void flushEarlyCopy(ID3D11DeviceContext* pContext, ID3D11Resource* pDstResource) {
+  core::ResourceDesc pattern;
+
+  if (g_strategyController && isImmediateContext(pContext) && pDstResource && isEarlyFlushTarget(pDstResource, &pattern))
+    flushForStrategy(pContext, pattern);
+}
+
+/** Tracks a region copy before it is issued, or records it on a
+ *  deferred context. May shrink the copy, see above. */
+void beginCopySubresourceRegion(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+        UINT                      DstX,
+        UINT*                     pDstY,
+        UINT                      DstZ,
+        ID3D11Resource*           pSrcResource,
+        UINT                      SrcSubresource,
+  const D3D11_BOX**               ppSrcBox,
+        D3D11_BOX*                pShrunkBox) {
+  if (g_validator && isImmediateContext(pContext))
+    pollValidation(pContext);
+
+  if (!isRecordingContext(pContext)) {
+    trackCopySubresourceRegion(pContext, pDstResource, DstSubresource, DstX, pDstY, DstZ,
+      pSrcResource, SrcSubresource, ppSrcBox, pShrunkBox, true);
+  } else if (pDstResource && pSrcResource) {
+    DeferredOp op;
+    op.type = DeferredOpType::CopySubresourceRegion;
+    op.pDstResource = pDstResource;
+    op.DstSubresource = DstSubresource;
+    op.DstX = DstX;
+    op.DstY = *pDstY;
+    op.DstZ = DstZ;
+    op.pSrcResource = pSrcResource;
+    op.SrcSubresource = SrcSubresource;
+    op.hasSrcBox = *ppSrcBox != nullptr;
+
+    if (*ppSrcBox)
+      op.SrcBox = **ppSrcBox;
+
+    g_commandLists->record(getObjectKey(pContext), op);
+  }
+}
+
+/** Tracks an update before it is issued, or records it
+ *  on a deferred context */
+void beginUpdateSubresource(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+  const D3D11_BOX*                pDstBox,
+  const void*                     pSrcData,
+        UINT                      SrcRowPitch,
+        UINT                      SrcDepthPitch) {
+  bool isRecording = isRecordingContext(pContext);
+  bool isActive = g_shadowCache || isRecording || (isImmediateContext(pContext)
+    && (g_speculator || g_readProfiler || g_hazardDetector));
+
+  if (!isActive || !pDstResource)
+    return;
+
+  // Caches key by a content hash, like uploads through Map
+  uint64_t payload = g_shadowCache || g_speculator
+    ? getUpdatePayload(pDstResource, DstSubresource, pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch)
+    : 0u;
+
+  if (!isRecording) {
+    trackUpdateSubresource(pContext, pDstResource, payload);
+  } else {
+    DeferredOp op;
+    op.type = DeferredOpType::Update;
+    op.pDstResource = pDstResource;
+    op.DstSubresource = DstSubresource;
+    op.payload = payload;
+
+    g_commandLists->record(getObjectKey(pContext), op);
+  }
+}
 
 void STDMETHODCALLTYPE ID3D11DeviceContext_CopyResource(
         ID3D11DeviceContext*      pContext,
         ID3D11Resource*           pDstResource,
         ID3D11Resource*           pSrcResource) {
   auto procs = getContextProcs(pContext);
+
+  if (!isRecordingContext(pContext)) {
+    trackCopyResource(pContext, pDstResource, pSrcResource, core::WriteKind::Copy);
+  } else if (pDstResource && pSrcResource) {
+    DeferredOp op;
+    op.type = DeferredOpType::CopyResource;
+    op.pDstResource = pDstResource;
+    op.pSrcResource = pSrcResource;
+
+    g_commandLists->record(getObjectKey(pContext), op);
+  }
+
   procs->CopyResource(pContext, pDstResource, pSrcResource);
+
+  flushEarlyCopy(pContext, pDstResource);
 }
 
 void STDMETHODCALLTYPE ID3D11DeviceContext_CopySubresourceRegion(
@@ -178,69 +1035,230 @@ void STDMETHODCALLTYPE ID3D11DeviceContext_CopySubresourceRegion(
   const D3D11_BOX*                pSrcBox) {
   auto procs = getContextProcs(pContext);
 
-  // Log Arland pattern copies (if logging active)
-  if (isTraceLoggingActive() && pDstResource && pSrcResource) {
-    D3D11_RESOURCE_DIMENSION dstDim, srcDim;
-    pDstResource->GetType(&dstDim);
-    pSrcResource->GetType(&srcDim);
-
-    if (dstDim == D3D11_RESOURCE_DIMENSION_TEXTURE2D && srcDim == D3D11_RESOURCE_DIMENSION_TEXTURE2D) {
-      ID3D11Texture2D* dstTex = nullptr;
-      ID3D11Texture2D* srcTex = nullptr;
-      pDstResource->QueryInterface(IID_PPV_ARGS(&dstTex));
-      pSrcResource->QueryInterface(IID_PPV_ARGS(&srcTex));
-
-      D3D11_TEXTURE2D_DESC dstDesc = {};
-      D3D11_TEXTURE2D_DESC srcDesc = {};
-      dstTex->GetDesc(&dstDesc);
-      srcTex->GetDesc(&srcDesc);
-
-      // Check if this matches the Arland lag pattern
-      // Pattern: 512x512 DYNAMIC -> STAGING
-      bool isArlandPattern = (srcDesc.Width == 512 && srcDesc.Height == 512 &&
-                              srcDesc.Usage == D3D11_USAGE_DYNAMIC &&
-                              srcDesc.CPUAccessFlags == 0x10000 &&
-                              dstDesc.Usage == D3D11_USAGE_STAGING &&
-                              dstDesc.CPUAccessFlags == 0x20000);
-
-      if (isArlandPattern) {
-        std::ostringstream oss;
-        oss << "[" << getLogTimestamp() << "] CopySubresourceRegion"
-            << " src=0x" << std::hex << pSrcResource << std::dec
-            << " dst=0x" << std::hex << pDstResource << std::dec
-            << " srcSub=" << SrcSubresource
-            << " dstSub=" << DstSubresource
-            << " srcDim=" << srcDesc.Width << "x" << srcDesc.Height
-            << " dstDim=" << dstDesc.Width << "x" << dstDesc.Height
-            << " srcUsage=" << usageToString(srcDesc.Usage)
-            << " dstUsage=" << usageToString(dstDesc.Usage)
-            << " srcCPU=0x" << std::hex << srcDesc.CPUAccessFlags << std::dec
-            << " dstCPU=0x" << std::hex << dstDesc.CPUAccessFlags << std::dec
-            << " srcBind=0x" << std::hex << srcDesc.BindFlags << std::dec
-            << " dstBind=0x" << std::hex << dstDesc.BindFlags << std::dec
-            << " fmt=" << srcDesc.Format
-            << " dstPos=(" << DstX << "," << DstY << "," << DstZ << ")";
-
-        // Add box info if present
-        if (pSrcBox) {
-          oss << " box=(" << pSrcBox->left << "," << pSrcBox->top << "," << pSrcBox->front
-              << ")-(" << pSrcBox->right << "," << pSrcBox->bottom << "," << pSrcBox->back << ")"
-              << " boxSize=" << (pSrcBox->right - pSrcBox->left) << "x" << (pSrcBox->bottom - pSrcBox->top);
-        } else {
-          oss << " box=full";
-        }
-
-        writeTraceLog(oss.str());
-      }
+  D3D11_BOX shrunkBox = { };
 
-      dstTex->Release();
-      srcTex->Release();
-    }
-  }
+  beginCopySubresourceRegion(pContext, pDstResource, DstSubresource, DstX, &DstY, DstZ,
+    pSrcResource, SrcSubresource, &pSrcBox, &shrunkBox);
 
   // Always do the actual GPU copy (no skipping)
   procs->CopySubresourceRegion(pContext, pDstResource, DstSubresource,
                                 DstX, DstY, DstZ, pSrcResource, SrcSubresource, pSrcBox);
+
+  flushEarlyCopy(pContext, pDstResource);
+}
+
+void STDMETHODCALLTYPE ID3D11DeviceContext_UpdateSubresource(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+  const D3D11_BOX*                pDstBox,
+  const void*                     pSrcData,
+        UINT                      SrcRowPitch,
+        UINT                      SrcDepthPitch) {
+  auto procs = getContextProcs(pContext);
+
+  beginUpdateSubresource(pContext, pDstResource, DstSubresource,
+    pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch);
+
+  procs->UpdateSubresource(pContext, pDstResource, DstSubresource,
+    pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch);
+}
+
+void STDMETHODCALLTYPE ID3D11DeviceContext_ResolveSubresource(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+        ID3D11Resource*           pSrcResource,
+        UINT                      SrcSubresource,
+        DXGI_FORMAT               Format) {
+  auto procs = getContextProcs(pContext);
+
+  if (!isRecordingContext(pContext)) {
+    trackResolveSubresource(pContext, pDstResource, pSrcResource);
+  } else if (pDstResource && pSrcResource) {
+    DeferredOp op;
+    op.type = DeferredOpType::ResolveSubresource;
+    op.pDstResource = pDstResource;
+    op.DstSubresource = DstSubresource;
+    op.pSrcResource = pSrcResource;
+    op.SrcSubresource = SrcSubresource;
+
+    g_commandLists->record(getObjectKey(pContext), op);
+  }
+
+  procs->ResolveSubresource(pContext, pDstResource, DstSubresource,
+    pSrcResource, SrcSubresource, Format);
+
+  flushEarlyCopy(pContext, pDstResource);
+}
+
+void STDMETHODCALLTYPE ID3D11DeviceContext1_CopySubresourceRegion1(
+        ID3D11DeviceContext1*     pContext,
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+        UINT                      DstX,
+        UINT                      DstY,
+        UINT                      DstZ,
+        ID3D11Resource*           pSrcResource,
+        UINT                      SrcSubresource,
+  const D3D11_BOX*                pSrcBox,
+        UINT                      CopyFlags) {
+  auto procs = getContextProcs(pContext);
+
+  D3D11_BOX shrunkBox = { };
+
+  beginCopySubresourceRegion(pContext, pDstResource, DstSubresource, DstX, &DstY, DstZ,
+    pSrcResource, SrcSubresource, &pSrcBox, &shrunkBox);
+
+  procs->CopySubresourceRegion1(pContext, pDstResource, DstSubresource,
+    DstX, DstY, DstZ, pSrcResource, SrcSubresource, pSrcBox, CopyFlags);
+
+  flushEarlyCopy(pContext, pDstResource);
+}
+
+void STDMETHODCALLTYPE ID3D11DeviceContext1_UpdateSubresource1(
+        ID3D11DeviceContext1*     pContext,
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+  const D3D11_BOX*                pDstBox,
+  const void*                     pSrcData,
+        UINT                      SrcRowPitch,
+        UINT                      SrcDepthPitch,
+        UINT                      CopyFlags) {
+  auto procs = getContextProcs(pContext);
+
+  beginUpdateSubresource(pContext, pDstResource, DstSubresource,
+    pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch);
+
+  procs->UpdateSubresource1(pContext, pDstResource, DstSubresource,
+    pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch, CopyFlags);
+}
+
+void STDMETHODCALLTYPE ID3D11DeviceContext1_DiscardResource(
+        ID3D11DeviceContext1*     pContext,
+        ID3D11Resource*           pResource) {
+  auto procs = getContextProcs(pContext);
+
+  if (!isRecordingContext(pContext)) {
+    trackDiscardResource(pContext, pResource);
+  } else if (pResource) {
+    DeferredOp op;
+    op.type = DeferredOpType::DiscardResource;
+    op.pDstResource = pResource;
+
+    g_commandLists->record(getObjectKey(pContext), op);
+  }
+
+  procs->DiscardResource(pContext, pResource);
+}
+
+void STDMETHODCALLTYPE ID3D11DeviceContext_End(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Asynchronous*       pAsync) {
+  auto procs = getContextProcs(pContext);
+
+  procs->End(pContext, pAsync);
+
+  if (g_flushCoalescer && isImmediateContext(pContext))
+    g_flushCoalescer->registerQueryEnd();
+}
+
+HRESULT STDMETHODCALLTYPE ID3D11DeviceContext_GetData(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Asynchronous*       pAsync,
+        void*                     pData,
+        UINT                      DataSize,
+        UINT                      GetDataFlags) {
+  auto procs = getContextProcs(pContext);
+
+  // GetData flushes unless told not to, polls count as flushes. Polls
+  // that don't flush may wait on a flush that was dropped.
+  if (g_flushCoalescer && isImmediateContext(pContext)) {
+    if (!(GetDataFlags & D3D11_ASYNC_GETDATA_DONOTFLUSH)) {
+      if (!g_flushCoalescer->forwardFlush(getTimeUs()))
+        GetDataFlags |= D3D11_ASYNC_GETDATA_DONOTFLUSH;
+    } else if (g_flushCoalescer->forwardDroppedFlush()) {
+      procs->Flush(pContext);
+    }
+  }
+
+  return procs->GetData(pContext, pAsync, pData, DataSize, GetDataFlags);
+}
+
+void STDMETHODCALLTYPE ID3D11DeviceContext_Flush(
+        ID3D11DeviceContext*      pContext) {
+  auto procs = getContextProcs(pContext);
+
+  if (isTraceLoggingActive())
+    writeTraceLog(core::formatFlushLine(getLogTimestampUs()));
+
+  if (g_flushCoalescer && isImmediateContext(pContext)
+   && !g_flushCoalescer->forwardFlush(getTimeUs()))
+    return;
+
+  procs->Flush(pContext);
+}
+
+void STDMETHODCALLTYPE ID3D11DeviceContext_ExecuteCommandList(
+        ID3D11DeviceContext*      pContext,
+        ID3D11CommandList*        pCommandList,
+        BOOL                      RestoreContextState) {
+  auto procs = getContextProcs(pContext);
+
+  if (!g_commandLists || !pCommandList) {
+    procs->ExecuteCommandList(pContext, pCommandList, RestoreContextState);
+    return;
+  }
+
+  core::ResourceKey commandList = getObjectKey(pCommandList);
+
+  // Lists executed on a deferred context run as part of its own list
+  if (!isImmediateContext(pContext)) {
+    g_commandLists->recordCommandList(getObjectKey(pContext), commandList);
+    procs->ExecuteCommandList(pContext, pCommandList, RestoreContextState);
+    return;
+  }
+
+  procs->ExecuteCommandList(pContext, pCommandList, RestoreContextState);
+
+  // Recorded work is tracked as if it had just been issued on the
+  // immediate context, so validation copies see the uploaded data
+  auto ops = g_commandLists->execute(commandList);
+
+  if (ops)
+    trackCommandList(pContext, *ops);
+}
+
+HRESULT STDMETHODCALLTYPE ID3D11DeviceContext_FinishCommandList(
+        ID3D11DeviceContext*      pContext,
+        BOOL                      RestoreDeferredContextState,
+        ID3D11CommandList**       ppCommandList) {
+  auto procs = getContextProcs(pContext);
+
+  HRESULT hr = procs->FinishCommandList(pContext, RestoreDeferredContextState, ppCommandList);
+
+  if (isRecordingContext(pContext)) {
+    core::ResourceKey commandList;
+
+    if (SUCCEEDED(hr) && ppCommandList && *ppCommandList)
+      commandList = getObjectKey(*ppCommandList);
+
+    g_commandLists->finish(getObjectKey(pContext), commandList);
+  }
+
+  return hr;
+}
+
+HRESULT STDMETHODCALLTYPE ID3D11Device_CreateDeferredContext(
+        ID3D11Device*             pDevice,
+        UINT                      ContextFlags,
+        ID3D11DeviceContext**     ppDeferredContext) {
+  HRESULT hr = g_deviceProcs.CreateDeferredContext(pDevice, ContextFlags, ppDeferredContext);
+
+  if (SUCCEEDED(hr) && ppDeferredContext && *ppDeferredContext)
+    hookContext(*ppDeferredContext);
+
+  return hr;
 }
 
 #define HOOK_PROC(iface, object, table, index, proc) \
@@ -250,6 +1268,11 @@ template<typename T>
 void hookProc(void* pObject, const char* pName, T** ppOrig, T* pHook, uint32_t index) {
   void** vtbl = *reinterpret_cast<void***>(pObject);
 
+  // Objects whose vtable was patched rather than their code, e.g. a
+  // deferred context sharing the vtable of the immediate context
+  if (vtbl[index] == reinterpret_cast<void*>(pHook))
+    return;
+
   MH_STATUS mh = MH_CreateHook(vtbl[index],
     reinterpret_cast<void*>(pHook),
     reinterpret_cast<void**>(ppOrig));
@@ -271,7 +1294,22 @@ void hookProc(void* pObject, const char* pName, T** ppOrig, T* pHook, uint32_t i
 }
 
 void hookDevice(ID3D11Device* pDevice) {
-  log("=== hookDevice called ===");
+  std::lock_guard lock(g_hookMutex);
+
+  if (g_installedHooks & HOOK_DEVICE) {
+    log("=== hookDevice: Already hooked ===");
+    return;
+  }
+
+  log("=== hookDevice: Installing hooks ===");
+
+  DeviceProcs* procs = &g_deviceProcs;
+
+  // Deferred contexts are hooked as they are created
+  if (getConfig().deferredContexts)
+    HOOK_PROC(ID3D11Device, pDevice, procs, 27, CreateDeferredContext);
+
+  g_installedHooks |= HOOK_DEVICE;
 }
 
 void hookContext(ID3D11DeviceContext* pContext) {
@@ -292,6 +1330,75 @@ void hookContext(ID3D11DeviceContext* pContext) {
 
   log("=== hookContext: Installing hooks ===");
 
+  const Config& config = getConfig();
+
+  if (!g_rules) {
+    const ExecutableIdentity& identity = getExecutableIdentity();
+
+    log("Executable ", identity.moduleName.empty() ? "unknown" : identity.moduleName.c_str(),
+      ", timestamp 0x", std::hex, identity.timestamp, ", checksum 0x", identity.checksum, std::dec,
+      ", profile ", config.profile->name);
+
+    g_rules = loadRules(config.rulesFile, *config.profile);
+  }
+
+  if (config.shadowCache && !g_shadowCache) {
+    log("Shadow cache enabled, ", config.shadowCacheEntries, " entries");
+    g_shadowCache = std::make_unique<core::ShadowCache>(config.shadowCacheEntries);
+  }
+
+  if (config.speculativeReadback && !g_validator) {
+    log("Readback validation enabled, rate ", config.validationRate, ", ",
+      config.validationDepth, " resources");
+    g_validator = std::make_unique<ReadbackValidator>(config.validationDepth, config.validationRate);
+  }
+
+  if (config.speculativeReadback && !g_speculator) {
+    log("Speculative readback enabled, ", config.speculativeCacheMiB, " MiB cache");
+    g_speculator = std::make_unique<ReadbackSpeculator>(config, g_validator.get());
+  }
+
+  if (config.dirtyTracking && !g_writeShadows) {
+    log("Dirty tracking enabled, calibrating on ", config.dirtyTrackingCalibration, " maps");
+    g_writeShadows = std::make_unique<WriteShadowTracker>(config.dirtyTrackingCalibration);
+  }
+
+  if ((config.readProfiling || config.copyShrinking) && !g_readProfiler) {
+    // Caches store and hash whole readbacks, which shrunk copies are not
+    bool shrinkCopies = config.copyShrinking && !g_shadowCache && !g_speculator;
+
+    if (config.copyShrinking && !shrinkCopies)
+      log("Copy shrinking is not supported together with readback caches");
+
+    log("Read profiling enabled, footprints stable after ", config.readProfilingStableMaps, " maps",
+      shrinkCopies ? ", shrinking copies" : "");
+    g_readProfiler = std::make_unique<ReadProfiler>(config.readProfilingStableMaps, shrinkCopies);
+  }
+
+  if (config.hazardDetection && !g_hazardDetector) {
+    log("Hazard detection enabled, reporting ", config.hazardReportTop, " patterns");
+    g_hazardDetector = std::make_unique<core::HazardDetector>();
+  }
+
+  if (config.flushCoalescing && !g_flushCoalescer) {
+    log("Flush coalescing enabled, ", config.flushCoalescingWindowUs, " us window");
+    g_flushCoalescer = std::make_unique<FlushCoalescer>(config.flushCoalescingWindowUs);
+  }
+
+  if (config.strategyControl && !g_strategyController) {
+    log("Strategy control enabled, exploring for ", config.strategyExploreEpisodes,
+      " episodes, regression at ", config.strategyRegression, "x and ", config.strategyRegressionMinUs, " us");
+    g_strategyController = std::make_unique<core::StrategyController>(
+      config.strategyExploreEpisodes, config.strategyRegression, config.strategyRegressionMinUs);
+  }
+
+  if (config.deferredContexts && !g_commandLists) {
+    log("Deferred context tracking enabled");
+    g_commandLists = std::make_unique<CommandListTracker>();
+  }
+
+  setResourceRetireCallback(&retireResource);
+
   // Map/Unmap hooks (passthrough)
   HOOK_PROC(ID3D11DeviceContext, pContext, procs, 14, Map);
   HOOK_PROC(ID3D11DeviceContext, pContext, procs, 15, Unmap);
@@ -300,6 +1407,30 @@ void hookContext(ID3D11DeviceContext* pContext) {
   HOOK_PROC(ID3D11DeviceContext, pContext, procs, 47, CopyResource);
   HOOK_PROC(ID3D11DeviceContext, pContext, procs, 46, CopySubresourceRegion);
 
+  // Writes that bypass Map and copies, so that caches see them
+  HOOK_PROC(ID3D11DeviceContext, pContext, procs, 48, UpdateSubresource);
+  HOOK_PROC(ID3D11DeviceContext, pContext, procs, 57, ResolveSubresource);
+
+  ID3D11DeviceContext1* context1 = nullptr;
+
+  if (SUCCEEDED(pContext->QueryInterface(IID_PPV_ARGS(&context1)))) {
+    HOOK_PROC(ID3D11DeviceContext1, context1, procs, 115, CopySubresourceRegion1);
+    HOOK_PROC(ID3D11DeviceContext1, context1, procs, 116, UpdateSubresource1);
+    HOOK_PROC(ID3D11DeviceContext1, context1, procs, 117, DiscardResource);
+    context1->Release();
+  }
+
+  // Submission hooks for flush coalescing
+  HOOK_PROC(ID3D11DeviceContext, pContext, procs, 28, End);
+  HOOK_PROC(ID3D11DeviceContext, pContext, procs, 29, GetData);
+  HOOK_PROC(ID3D11DeviceContext, pContext, procs, 111, Flush);
+
+  // Command list hooks for deferred context tracking
+  if (config.deferredContexts) {
+    HOOK_PROC(ID3D11DeviceContext, pContext, procs, 58, ExecuteCommandList);
+    HOOK_PROC(ID3D11DeviceContext, pContext, procs, 114, FinishCommandList);
+  }
+
   g_installedHooks |= flag;
 
   /* Immediate context and deferred context methods may share code */
@@ -2,7 +2,7 @@
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
-#include <d3d11.h>
+#include <d3d11_1.h>
 #include <dxgi.h>
 
 #include "log.h"
@@ -11,6 +11,74 @@ namespace atfix {
 
 extern Log log;
 
+/** Hooking-related stuff */
+using PFN_ID3D11DeviceContext_Map = HRESULT (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
+  ID3D11Resource*, UINT, D3D11_MAP, UINT, D3D11_MAPPED_SUBRESOURCE*);
+using PFN_ID3D11DeviceContext_Unmap = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
+  ID3D11Resource*, UINT);
+using PFN_ID3D11DeviceContext_CopyResource = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
+  ID3D11Resource*, ID3D11Resource*);
+using PFN_ID3D11DeviceContext_CopySubresourceRegion = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
+  ID3D11Resource*, UINT, UINT, UINT, UINT, ID3D11Resource*, UINT, const D3D11_BOX*);
+using PFN_ID3D11DeviceContext_UpdateSubresource = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
+  ID3D11Resource*, UINT, const D3D11_BOX*, const void*, UINT, UINT);
+using PFN_ID3D11DeviceContext_ResolveSubresource = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
+  ID3D11Resource*, UINT, ID3D11Resource*, UINT, DXGI_FORMAT);
+using PFN_ID3D11DeviceContext_End = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
+  ID3D11Asynchronous*);
+using PFN_ID3D11DeviceContext_GetData = HRESULT (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
+  ID3D11Asynchronous*, void*, UINT, UINT);
+using PFN_ID3D11DeviceContext_Flush = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext*);
+using PFN_ID3D11DeviceContext_ExecuteCommandList = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
+  ID3D11CommandList*, BOOL);
+using PFN_ID3D11DeviceContext_FinishCommandList = HRESULT (STDMETHODCALLTYPE *) (ID3D11DeviceContext*,
+  BOOL, ID3D11CommandList**);
+using PFN_ID3D11DeviceContext1_CopySubresourceRegion1 = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext1*,
+  ID3D11Resource*, UINT, UINT, UINT, UINT, ID3D11Resource*, UINT, const D3D11_BOX*, UINT);
+using PFN_ID3D11DeviceContext1_UpdateSubresource1 = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext1*,
+  ID3D11Resource*, UINT, const D3D11_BOX*, const void*, UINT, UINT, UINT);
+using PFN_ID3D11DeviceContext1_DiscardResource = void (STDMETHODCALLTYPE *) (ID3D11DeviceContext1*,
+  ID3D11Resource*);
+using PFN_ID3D11Device_CreateDeferredContext = HRESULT (STDMETHODCALLTYPE *) (ID3D11Device*,
+  UINT, ID3D11DeviceContext**);
+
+struct ContextProcs {
+  PFN_ID3D11DeviceContext_Map                   Map                   = nullptr;
+  PFN_ID3D11DeviceContext_Unmap                 Unmap                 = nullptr;
+  PFN_ID3D11DeviceContext_CopyResource          CopyResource          = nullptr;
+  PFN_ID3D11DeviceContext_CopySubresourceRegion CopySubresourceRegion = nullptr;
+  PFN_ID3D11DeviceContext_UpdateSubresource     UpdateSubresource     = nullptr;
+  PFN_ID3D11DeviceContext_ResolveSubresource    ResolveSubresource    = nullptr;
+  PFN_ID3D11DeviceContext_End                   End                   = nullptr;
+  PFN_ID3D11DeviceContext_GetData               GetData               = nullptr;
+  PFN_ID3D11DeviceContext_Flush                 Flush                 = nullptr;
+  PFN_ID3D11DeviceContext_ExecuteCommandList    ExecuteCommandList    = nullptr;
+  PFN_ID3D11DeviceContext_FinishCommandList     FinishCommandList     = nullptr;
+  /* Only hooked if the context supports ID3D11DeviceContext1 */
+  PFN_ID3D11DeviceContext1_CopySubresourceRegion1 CopySubresourceRegion1 = nullptr;
+  PFN_ID3D11DeviceContext1_UpdateSubresource1   UpdateSubresource1    = nullptr;
+  PFN_ID3D11DeviceContext1_DiscardResource      DiscardResource       = nullptr;
+};
+
+struct DeviceProcs {
+  PFN_ID3D11Device_CreateDeferredContext        CreateDeferredContext = nullptr;
+};
+
+/**
+ * \brief Original context functions
+ *
+ * Calling these bypasses the hooks, e.g. for resources
+ * that the hooks create themselves.
+ * \param [in] pContext Context
+ * \returns Original functions for the context type
+ */
+const ContextProcs* getContextProcs(ID3D11DeviceContext* pContext);
+
+/**
+ * \brief Monotonic time in microseconds
+ */
+uint64_t getTimeUs();
+
 void hookDevice(ID3D11Device* pDevice);
 void hookContext(ID3D11DeviceContext* pContext);
 
@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "impl.h"
+#include "profile.h"
 #include "util.h"
 
 #include <array>
@@ -75,6 +76,35 @@ D3D11Proc loadSystemD3D11() {
   return d3d11Proc;
 }
 
+/** Identify the executable the DLL was loaded into. Only reads
+ *  the already mapped image, which is safe under the loader lock. */
+ExecutableIdentity identifyExecutable() {
+  ExecutableIdentity identity;
+
+  HMODULE module = GetModuleHandleA(nullptr);
+
+  std::array<char, MAX_PATH + 1> path = { };
+
+  if (GetModuleFileNameA(module, path.data(), MAX_PATH)) {
+    const char* name = std::strrchr(path.data(), '\\');
+    identity.moduleName = name ? name + 1 : path.data();
+  }
+
+  auto base = reinterpret_cast<const char*>(module);
+  auto dos = reinterpret_cast<const IMAGE_DOS_HEADER*>(base);
+
+  if (dos && dos->e_magic == IMAGE_DOS_SIGNATURE) {
+    auto nt = reinterpret_cast<const IMAGE_NT_HEADERS*>(base + dos->e_lfanew);
+
+    if (nt->Signature == IMAGE_NT_SIGNATURE) {
+      identity.timestamp = nt->FileHeader.TimeDateStamp;
+      identity.checksum = nt->OptionalHeader.CheckSum;
+    }
+  }
+
+  return identity;
+}
+
 }
 
 extern "C" {
@@ -187,6 +217,7 @@ DLLEXPORT HRESULT __stdcall D3D11CreateDeviceAndSwapChain(
 BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved) {
   switch (fdwReason) {
     case DLL_PROCESS_ATTACH:
+      atfix::setExecutableIdentity(atfix::identifyExecutable());
       MH_Initialize();
       break;
 
@@ -0,0 +1,105 @@
+#include "d3d11_proxy.h"
+
+#ifdef _MSC_VER
+  #define DLLEXPORT
+#else
+  #define DLLEXPORT __declspec(dllexport)
+#endif
+
+/**
+ * Fake D3D11 backend. The atfix d3d11.dll loads d3d11_proxy.dll from
+ * the application directory in place of the system D3D11, so placing
+ * this DLL next to a test executable routes all device creation to
+ * the mock device, which emulates GPU readback stalls without a GPU.
+ */
+extern "C" {
+
+DLLEXPORT HRESULT __stdcall D3D11CreateDevice(
+        IDXGIAdapter*         pAdapter,
+        D3D_DRIVER_TYPE       DriverType,
+        HMODULE               Software,
+        UINT                  Flags,
+  const D3D_FEATURE_LEVEL*    pFeatureLevels,
+        UINT                  FeatureLevels,
+        UINT                  SDKVersion,
+        ID3D11Device**        ppDevice,
+        D3D_FEATURE_LEVEL*    pFeatureLevel,
+        ID3D11DeviceContext** ppImmediateContext) {
+  if (ppDevice)
+    *ppDevice = nullptr;
+
+  if (ppImmediateContext)
+    *ppImmediateContext = nullptr;
+
+  if (pFeatureLevel)
+    *pFeatureLevel = D3D_FEATURE_LEVEL_11_0;
+
+  ID3D11Device* device = nullptr;
+  ID3D11DeviceContext* context = nullptr;
+
+  /* Starts out without any latency, the driver
+   * process sets up the model via MockSetConfig */
+  HRESULT hr = atfix::mock::createMockDevice(atfix::mock::MockConfig(), &device, &context);
+
+  if (FAILED(hr))
+    return hr;
+
+  if (ppDevice)
+    *ppDevice = device;
+  else
+    device->Release();
+
+  if (ppImmediateContext)
+    *ppImmediateContext = context;
+  else
+    context->Release();
+
+  return S_OK;
+}
+
+DLLEXPORT HRESULT __stdcall D3D11CreateDeviceAndSwapChain(
+        IDXGIAdapter*         pAdapter,
+        D3D_DRIVER_TYPE       DriverType,
+        HMODULE               Software,
+        UINT                  Flags,
+  const D3D_FEATURE_LEVEL*    pFeatureLevels,
+        UINT                  FeatureLevels,
+        UINT                  SDKVersion,
+  const DXGI_SWAP_CHAIN_DESC* pSwapChainDesc,
+        IDXGISwapChain**      ppSwapChain,
+        ID3D11Device**        ppDevice,
+        D3D_FEATURE_LEVEL*    pFeatureLevel,
+        ID3D11DeviceContext** ppImmediateContext) {
+  if (ppSwapChain) {
+    *ppSwapChain = nullptr;
+    return DXGI_ERROR_UNSUPPORTED;
+  }
+
+  return D3D11CreateDevice(pAdapter, DriverType, Software, Flags,
+    pFeatureLevels, FeatureLevels, SDKVersion, ppDevice, pFeatureLevel,
+    ppImmediateContext);
+}
+
+DLLEXPORT void __stdcall MockSetConfig(
+        ID3D11Device*         pDevice,
+  const atfix::mock::MockConfig* pConfig) {
+  atfix::mock::setMockConfig(pDevice, *pConfig);
+}
+
+DLLEXPORT void __stdcall MockGetStats(
+        ID3D11Device*         pDevice,
+        atfix::mock::MockStats* pStats) {
+  *pStats = atfix::mock::getMockStats(pDevice);
+}
+
+DLLEXPORT void __stdcall MockResetStats(
+        ID3D11Device*         pDevice) {
+  atfix::mock::resetMockStats(pDevice);
+}
+
+DLLEXPORT void __stdcall MockWaitForIdle(
+        ID3D11Device*         pDevice) {
+  atfix::mock::waitForMockIdle(pDevice);
+}
+
+}
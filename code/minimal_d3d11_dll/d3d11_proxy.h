@@ -0,0 +1,20 @@
+#pragma once
+
+#include "../mock/mock_d3d11.h"
+
+/**
+ * Entry points exported by the fake d3d11_proxy.dll in addition to
+ * D3D11CreateDevice, so that a driver process can control the mock
+ * device behind the atfix d3d11.dll.
+ */
+using PFN_MockSetConfig = void (__stdcall *) (
+  ID3D11Device*, const atfix::mock::MockConfig*);
+
+using PFN_MockGetStats = void (__stdcall *) (
+  ID3D11Device*, atfix::mock::MockStats*);
+
+using PFN_MockResetStats = void (__stdcall *) (
+  ID3D11Device*);
+
+using PFN_MockWaitForIdle = void (__stdcall *) (
+  ID3D11Device*);
@@ -0,0 +1,1566 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "mock_d3d11.h"
+
+#ifndef _WIN32
+#include "../native/minhook_shim.h"
+#endif
+
+namespace atfix::mock {
+
+/**
+ * Mock objects are laid out like C COM objects: the first member
+ * is a pointer to a table of plain functions taking the object as
+ * their first argument. This matches the vtable ABI of the D3D11
+ * interfaces, and unlike compiler-generated vtables the tables are
+ * writable, which the native MinHook shim relies on.
+ */
+constexpr size_t DeviceSlotCount      = 43;
+constexpr size_t ContextSlotCount     = 134;
+constexpr size_t ResourceSlotCount    = 11;
+constexpr size_t CommandListSlotCount = 8;
+
+/** Row granularity of the slices of 3D textures */
+constexpr UINT Texture3DSliceRows = 4;
+
+struct MockDevice;
+
+struct MockSubresource {
+  std::vector<uint8_t> data;
+  UINT width      = 0;
+  UINT height     = 0;
+  UINT depth      = 0;
+  UINT rowPitch   = 0;
+  UINT depthPitch = 0;
+};
+
+struct MockPrivateData {
+  GUID                      guid = { };
+  std::vector<uint8_t>      data;
+  IUnknown*                 pInterface = nullptr;
+};
+
+struct MockResource {
+  void**                    vtbl;
+  std::atomic<ULONG>        refCount = { 1u };
+  MockDevice*               device   = nullptr;
+  D3D11_RESOURCE_DIMENSION  dimension = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+  D3D11_BUFFER_DESC         bufferDesc = { };
+  D3D11_TEXTURE1D_DESC      tex1DDesc = { };
+  D3D11_TEXTURE2D_DESC      tex2DDesc = { };
+  D3D11_TEXTURE3D_DESC      tex3DDesc = { };
+  UINT                      formatSize = 0;
+  std::vector<MockSubresource> subresources;
+  /** Completion time of the last submitted GPU write */
+  uint64_t                  readyAt = 0;
+  /** Number of recorded GPU writes that were not submitted yet */
+  uint32_t                  pendingWrites = 0;
+  /** Private data, interfaces are released with the resource */
+  std::vector<MockPrivateData> privateData;
+};
+
+struct MockCommand {
+  MockResource* dst       = nullptr;
+  uint64_t      gpuCostNs = 0;
+};
+
+enum class MockDeferredCommandType : uint32_t {
+  Upload,
+  CopySubresourceRegion,
+  CopyResource,
+  UpdateSubresource,
+};
+
+/**
+ * Deferred contexts only record what the hooks care about: uploads
+ * through Map(WRITE_DISCARD), which get their own memory as if the
+ * resource had been renamed, updates, whose data is packed into the
+ * command, and copies. Recorded commands hold a reference to their
+ * resources, like real command lists do.
+ */
+struct MockDeferredCommand {
+  MockDeferredCommandType   type = MockDeferredCommandType::Upload;
+  MockResource*             dst  = nullptr;
+  MockResource*             src  = nullptr;
+  UINT                      dstSubresource = 0;
+  UINT                      dstX = 0;
+  UINT                      dstY = 0;
+  UINT                      dstZ = 0;
+  UINT                      srcSubresource = 0;
+  bool                      hasBox = false;
+  D3D11_BOX                 box = { };
+  std::vector<uint8_t>      data;
+};
+
+struct MockDeferredMap {
+  MockResource*             resource = nullptr;
+  UINT                      subresource = 0;
+  std::vector<uint8_t>      data;
+};
+
+struct MockContext {
+  void**                    vtbl;
+  MockDevice*               device = nullptr;
+  D3D11_DEVICE_CONTEXT_TYPE type   = D3D11_DEVICE_CONTEXT_IMMEDIATE;
+  /** Only used by deferred contexts, the immediate
+   *  context shares its reference count with the device */
+  std::atomic<ULONG>        refCount = { 1u };
+  std::vector<MockDeferredCommand> commands;
+  std::vector<MockDeferredMap> mapped;
+  std::vector<MockPrivateData> privateData;
+};
+
+struct MockCommandList {
+  void**                    vtbl;
+  std::atomic<ULONG>        refCount = { 1u };
+  MockDevice*               device   = nullptr;
+  std::vector<MockDeferredCommand> commands;
+  std::vector<MockPrivateData> privateData;
+};
+
+struct MockDevice {
+  void**                    vtbl;
+  std::atomic<ULONG>        refCount = { 1u };
+  std::mutex                mutex;
+  MockConfig                config;
+  MockStats                 stats;
+  MockContext               immediateContext;
+  std::vector<MockCommand>  pending;
+  uint64_t                  gpuBusyUntil = 0;
+};
+
+
+/** Timing helpers */
+uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void spinUntil(uint64_t deadline) {
+  while (nowNs() < deadline)
+    continue;
+}
+
+void spinFor(uint64_t ns) {
+  if (ns)
+    spinUntil(nowNs() + ns);
+}
+
+
+/** Object helpers */
+MockDevice* getDevice(ID3D11Device* pDevice) {
+  return reinterpret_cast<MockDevice*>(pDevice);
+}
+
+MockContext* getContext(ID3D11DeviceContext* pContext) {
+  return reinterpret_cast<MockContext*>(pContext);
+}
+
+MockResource* getResource(ID3D11Resource* pResource) {
+  return reinterpret_cast<MockResource*>(pResource);
+}
+
+MockCommandList* getCommandList(ID3D11CommandList* pCommandList) {
+  return reinterpret_cast<MockCommandList*>(pCommandList);
+}
+
+UINT getFormatSize(DXGI_FORMAT Format) {
+  switch (Format) {
+    case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+      return 16;
+
+    case DXGI_FORMAT_R32G32B32_FLOAT:
+      return 12;
+
+    case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+    case DXGI_FORMAT_R32G32_FLOAT:
+      return 8;
+
+    case DXGI_FORMAT_R8G8_UNORM:
+    case DXGI_FORMAT_R16_FLOAT:
+    case DXGI_FORMAT_R16_UNORM:
+      return 2;
+
+    case DXGI_FORMAT_R8_UNORM:
+    case DXGI_FORMAT_A8_UNORM:
+      return 1;
+
+    default:
+      return 4;
+  }
+}
+
+void STDMETHODCALLTYPE unimplementedMethod() {
+  std::fprintf(stderr, "mock_d3d11: Called unimplemented method\n");
+  std::abort();
+}
+
+template<typename Fn>
+void setSlot(void** pSlots, uint32_t index, Fn* pFunction) {
+  pSlots[index] = reinterpret_cast<void*>(pFunction);
+}
+
+void initVtable(void** pSlots, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    setSlot(pSlots, i, &unimplementedMethod);
+}
+
+void registerVtable(void** pSlots, size_t count) {
+#ifndef _WIN32
+  shim::registerHookableVtable(pSlots, count);
+#endif
+}
+
+
+/** GPU timeline */
+void submitPendingWork(MockDevice* pDevice) {
+  if (pDevice->pending.empty())
+    return;
+
+  spinFor(pDevice->config.flushCostNs);
+
+  uint64_t start = std::max(pDevice->gpuBusyUntil,
+    nowNs() + pDevice->config.submitDelayNs);
+
+  for (const auto& cmd : pDevice->pending) {
+    uint64_t end = start + cmd.gpuCostNs;
+
+    cmd.dst->readyAt = end;
+    cmd.dst->pendingWrites -= 1;
+
+    reinterpret_cast<ID3D11Resource*>(cmd.dst)->Release();
+    start = end;
+  }
+
+  pDevice->gpuBusyUntil = start;
+  pDevice->pending.clear();
+  pDevice->stats.submitCount += 1;
+}
+
+uint64_t getGpuCopyCost(const MockDevice* pDevice, uint64_t bytes) {
+  return pDevice->config.gpuCopyNs
+       + pDevice->config.gpuCopyNsPerMiB * bytes / (1u << 20);
+}
+
+void recordGpuWrite(MockDevice* pDevice, MockResource* pDst, uint64_t gpuCostNs) {
+  reinterpret_cast<ID3D11Resource*>(pDst)->AddRef();
+  pDst->pendingWrites += 1;
+
+  pDevice->pending.push_back({ pDst, gpuCostNs });
+}
+
+
+/**
+ * Private data follows the D3D11 rules: setting a GUID replaces
+ * the previous entry, null data removes it, and interfaces are
+ * referenced until they are replaced or the object dies.
+ * Objects are not shared between threads by the tools, so
+ * no locking is done.
+ */
+void setPrivateData(std::vector<MockPrivateData>& entries, REFGUID guid, UINT DataSize, const void* pData, IUnknown* pInterface) {
+  auto entry = std::find_if(entries.begin(), entries.end(),
+    [&guid] (const MockPrivateData& e) { return e.guid == guid; });
+
+  if (pInterface)
+    pInterface->AddRef();
+
+  if (entry != entries.end()) {
+    if (entry->pInterface)
+      entry->pInterface->Release();
+
+    entries.erase(entry);
+  }
+
+  if (!pData && !pInterface)
+    return;
+
+  MockPrivateData data;
+  data.guid = guid;
+  data.pInterface = pInterface;
+
+  if (pInterface)
+    data.data.resize(sizeof(pInterface));
+
+  if (pData) {
+    auto bytes = reinterpret_cast<const uint8_t*>(pData);
+    data.data.assign(bytes, bytes + DataSize);
+  }
+
+  entries.push_back(std::move(data));
+}
+
+HRESULT getPrivateData(const std::vector<MockPrivateData>& entries, REFGUID guid, UINT* pDataSize, void* pData) {
+  if (!pDataSize)
+    return E_INVALIDARG;
+
+  auto entry = std::find_if(entries.begin(), entries.end(),
+    [&guid] (const MockPrivateData& e) { return e.guid == guid; });
+
+  if (entry == entries.end()) {
+    *pDataSize = 0;
+    return DXGI_ERROR_NOT_FOUND;
+  }
+
+  UINT size = UINT(entry->data.size());
+
+  if (pData) {
+    if (*pDataSize < size)
+      return DXGI_ERROR_MORE_DATA;
+
+    if (entry->pInterface) {
+      entry->pInterface->AddRef();
+      std::memcpy(pData, &entry->pInterface, sizeof(entry->pInterface));
+    } else {
+      std::memcpy(pData, entry->data.data(), size);
+    }
+  }
+
+  *pDataSize = size;
+  return S_OK;
+}
+
+void releasePrivateData(std::vector<MockPrivateData>& entries) {
+  for (const auto& entry : entries) {
+    if (entry.pInterface)
+      entry.pInterface->Release();
+  }
+
+  entries.clear();
+}
+
+
+/** Resources */
+HRESULT STDMETHODCALLTYPE Resource_QueryInterface(ID3D11Resource* pResource, REFIID riid, void** ppvObject) {
+  if (!ppvObject)
+    return E_POINTER;
+
+  MockResource* resource = getResource(pResource);
+  bool supported = riid == __uuidof(IUnknown)
+                || riid == __uuidof(ID3D11DeviceChild)
+                || riid == __uuidof(ID3D11Resource);
+
+  if (resource->dimension == D3D11_RESOURCE_DIMENSION_BUFFER)
+    supported |= riid == __uuidof(ID3D11Buffer);
+
+  if (resource->dimension == D3D11_RESOURCE_DIMENSION_TEXTURE1D)
+    supported |= riid == __uuidof(ID3D11Texture1D);
+
+  if (resource->dimension == D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+    supported |= riid == __uuidof(ID3D11Texture2D);
+
+  if (resource->dimension == D3D11_RESOURCE_DIMENSION_TEXTURE3D)
+    supported |= riid == __uuidof(ID3D11Texture3D);
+
+  if (!supported) {
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+  }
+
+  pResource->AddRef();
+  *ppvObject = pResource;
+  return S_OK;
+}
+
+ULONG STDMETHODCALLTYPE Resource_AddRef(ID3D11Resource* pResource) {
+  return ++getResource(pResource)->refCount;
+}
+
+ULONG STDMETHODCALLTYPE Resource_Release(ID3D11Resource* pResource) {
+  MockResource* resource = getResource(pResource);
+  ULONG refCount = --resource->refCount;
+
+  if (!refCount) {
+    auto device = reinterpret_cast<ID3D11Device*>(resource->device);
+
+    releasePrivateData(resource->privateData);
+
+    delete resource;
+    device->Release();
+  }
+
+  return refCount;
+}
+
+void STDMETHODCALLTYPE Resource_GetDevice(ID3D11Resource* pResource, ID3D11Device** ppDevice) {
+  auto device = reinterpret_cast<ID3D11Device*>(getResource(pResource)->device);
+  device->AddRef();
+  *ppDevice = device;
+}
+
+HRESULT STDMETHODCALLTYPE Resource_GetPrivateData(ID3D11Resource* pResource, REFGUID guid, UINT* pDataSize, void* pData) {
+  return getPrivateData(getResource(pResource)->privateData, guid, pDataSize, pData);
+}
+
+HRESULT STDMETHODCALLTYPE Resource_SetPrivateData(ID3D11Resource* pResource, REFGUID guid, UINT DataSize, const void* pData) {
+  setPrivateData(getResource(pResource)->privateData, guid, DataSize, pData, nullptr);
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE Resource_SetPrivateDataInterface(ID3D11Resource* pResource, REFGUID guid, const IUnknown* pData) {
+  setPrivateData(getResource(pResource)->privateData, guid, 0, nullptr, const_cast<IUnknown*>(pData));
+  return S_OK;
+}
+
+void STDMETHODCALLTYPE Resource_GetType(ID3D11Resource* pResource, D3D11_RESOURCE_DIMENSION* pResourceDimension) {
+  *pResourceDimension = getResource(pResource)->dimension;
+}
+
+void STDMETHODCALLTYPE Resource_SetEvictionPriority(ID3D11Resource* pResource, UINT EvictionPriority) {
+
+}
+
+UINT STDMETHODCALLTYPE Resource_GetEvictionPriority(ID3D11Resource* pResource) {
+  return 0;
+}
+
+void STDMETHODCALLTYPE Buffer_GetDesc(ID3D11Buffer* pBuffer, D3D11_BUFFER_DESC* pDesc) {
+  *pDesc = getResource(pBuffer)->bufferDesc;
+}
+
+void STDMETHODCALLTYPE Texture1D_GetDesc(ID3D11Texture1D* pTexture, D3D11_TEXTURE1D_DESC* pDesc) {
+  *pDesc = getResource(pTexture)->tex1DDesc;
+}
+
+void STDMETHODCALLTYPE Texture2D_GetDesc(ID3D11Texture2D* pTexture, D3D11_TEXTURE2D_DESC* pDesc) {
+  *pDesc = getResource(pTexture)->tex2DDesc;
+}
+
+void STDMETHODCALLTYPE Texture3D_GetDesc(ID3D11Texture3D* pTexture, D3D11_TEXTURE3D_DESC* pDesc) {
+  *pDesc = getResource(pTexture)->tex3DDesc;
+}
+
+void initResourceVtable(void** pSlots) {
+  initVtable(pSlots, ResourceSlotCount);
+  setSlot(pSlots,  0, &Resource_QueryInterface);
+  setSlot(pSlots,  1, &Resource_AddRef);
+  setSlot(pSlots,  2, &Resource_Release);
+  setSlot(pSlots,  3, &Resource_GetDevice);
+  setSlot(pSlots,  4, &Resource_GetPrivateData);
+  setSlot(pSlots,  5, &Resource_SetPrivateData);
+  setSlot(pSlots,  6, &Resource_SetPrivateDataInterface);
+  setSlot(pSlots,  7, &Resource_GetType);
+  setSlot(pSlots,  8, &Resource_SetEvictionPriority);
+  setSlot(pSlots,  9, &Resource_GetEvictionPriority);
+}
+
+void** getBufferVtable() {
+  static void* slots[ResourceSlotCount];
+  static std::once_flag once;
+
+  std::call_once(once, [] {
+    initResourceVtable(slots);
+    setSlot(slots, 10, &Buffer_GetDesc);
+    registerVtable(slots, ResourceSlotCount);
+  });
+
+  return slots;
+}
+
+void** getTexture1DVtable() {
+  static void* slots[ResourceSlotCount];
+  static std::once_flag once;
+
+  std::call_once(once, [] {
+    initResourceVtable(slots);
+    setSlot(slots, 10, &Texture1D_GetDesc);
+    registerVtable(slots, ResourceSlotCount);
+  });
+
+  return slots;
+}
+
+void** getTexture2DVtable() {
+  static void* slots[ResourceSlotCount];
+  static std::once_flag once;
+
+  std::call_once(once, [] {
+    initResourceVtable(slots);
+    setSlot(slots, 10, &Texture2D_GetDesc);
+    registerVtable(slots, ResourceSlotCount);
+  });
+
+  return slots;
+}
+
+void** getTexture3DVtable() {
+  static void* slots[ResourceSlotCount];
+  static std::once_flag once;
+
+  std::call_once(once, [] {
+    initResourceVtable(slots);
+    setSlot(slots, 10, &Texture3D_GetDesc);
+    registerVtable(slots, ResourceSlotCount);
+  });
+
+  return slots;
+}
+
+MockResource* createResource(MockDevice* pDevice, void** pVtbl, D3D11_RESOURCE_DIMENSION Dimension) {
+  auto resource = new MockResource();
+  resource->vtbl = pVtbl;
+  resource->device = pDevice;
+  resource->dimension = Dimension;
+
+  reinterpret_cast<ID3D11Device*>(pDevice)->AddRef();
+  return resource;
+}
+
+void initSubresource(MockSubresource& Subresource, UINT Width, UINT Height, UINT Depth, UINT FormatSize, const D3D11_SUBRESOURCE_DATA* pInitialData) {
+  Subresource.width = Width;
+  Subresource.height = Height;
+  Subresource.depth = Depth;
+  Subresource.rowPitch = Width * FormatSize;
+  Subresource.depthPitch = Subresource.rowPitch * Height;
+
+  /* Like tiled layouts of real drivers, slices of 3D textures are
+   * padded, so that DepthPitch is more than RowPitch * Height */
+  if (Depth > 1)
+    Subresource.depthPitch = Subresource.rowPitch * ((Height + Texture3DSliceRows - 1) & ~(Texture3DSliceRows - 1));
+
+  Subresource.data.resize(size_t(Subresource.depthPitch) * Depth);
+
+  if (pInitialData && pInitialData->pSysMem) {
+    auto src = static_cast<const uint8_t*>(pInitialData->pSysMem);
+
+    for (UINT z = 0; z < Depth; z++) {
+      for (UINT y = 0; y < Height; y++) {
+        std::memcpy(&Subresource.data[z * Subresource.depthPitch + y * Subresource.rowPitch],
+          &src[z * pInitialData->SysMemSlicePitch + y * pInitialData->SysMemPitch],
+          Subresource.rowPitch);
+      }
+    }
+  }
+}
+
+
+/** Deferred commands */
+void releaseCommands(std::vector<MockDeferredCommand>& Commands) {
+  for (const auto& cmd : Commands) {
+    if (cmd.dst)
+      reinterpret_cast<ID3D11Resource*>(cmd.dst)->Release();
+
+    if (cmd.src)
+      reinterpret_cast<ID3D11Resource*>(cmd.src)->Release();
+  }
+
+  Commands.clear();
+}
+
+void appendCommands(std::vector<MockDeferredCommand>& Dst, const std::vector<MockDeferredCommand>& Src) {
+  for (const auto& cmd : Src) {
+    if (cmd.dst)
+      reinterpret_cast<ID3D11Resource*>(cmd.dst)->AddRef();
+
+    if (cmd.src)
+      reinterpret_cast<ID3D11Resource*>(cmd.src)->AddRef();
+
+    Dst.push_back(cmd);
+  }
+}
+
+
+/** Command lists */
+HRESULT STDMETHODCALLTYPE CommandList_QueryInterface(ID3D11CommandList* pCommandList, REFIID riid, void** ppvObject) {
+  if (!ppvObject)
+    return E_POINTER;
+
+  if (riid != __uuidof(IUnknown)
+   && riid != __uuidof(ID3D11DeviceChild)
+   && riid != __uuidof(ID3D11CommandList)) {
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+  }
+
+  pCommandList->AddRef();
+  *ppvObject = pCommandList;
+  return S_OK;
+}
+
+ULONG STDMETHODCALLTYPE CommandList_AddRef(ID3D11CommandList* pCommandList) {
+  return ++getCommandList(pCommandList)->refCount;
+}
+
+ULONG STDMETHODCALLTYPE CommandList_Release(ID3D11CommandList* pCommandList) {
+  MockCommandList* commandList = getCommandList(pCommandList);
+  ULONG refCount = --commandList->refCount;
+
+  if (!refCount) {
+    auto device = reinterpret_cast<ID3D11Device*>(commandList->device);
+
+    releaseCommands(commandList->commands);
+    releasePrivateData(commandList->privateData);
+
+    delete commandList;
+    device->Release();
+  }
+
+  return refCount;
+}
+
+void STDMETHODCALLTYPE CommandList_GetDevice(ID3D11CommandList* pCommandList, ID3D11Device** ppDevice) {
+  auto device = reinterpret_cast<ID3D11Device*>(getCommandList(pCommandList)->device);
+  device->AddRef();
+  *ppDevice = device;
+}
+
+HRESULT STDMETHODCALLTYPE CommandList_GetPrivateData(ID3D11CommandList* pCommandList, REFGUID guid, UINT* pDataSize, void* pData) {
+  return getPrivateData(getCommandList(pCommandList)->privateData, guid, pDataSize, pData);
+}
+
+HRESULT STDMETHODCALLTYPE CommandList_SetPrivateData(ID3D11CommandList* pCommandList, REFGUID guid, UINT DataSize, const void* pData) {
+  setPrivateData(getCommandList(pCommandList)->privateData, guid, DataSize, pData, nullptr);
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE CommandList_SetPrivateDataInterface(ID3D11CommandList* pCommandList, REFGUID guid, const IUnknown* pData) {
+  setPrivateData(getCommandList(pCommandList)->privateData, guid, 0, nullptr, const_cast<IUnknown*>(pData));
+  return S_OK;
+}
+
+UINT STDMETHODCALLTYPE CommandList_GetContextFlags(ID3D11CommandList* pCommandList) {
+  return 0;
+}
+
+void** getCommandListVtable() {
+  static void* slots[CommandListSlotCount];
+  static std::once_flag once;
+
+  std::call_once(once, [] {
+    initVtable(slots, CommandListSlotCount);
+    setSlot(slots, 0, &CommandList_QueryInterface);
+    setSlot(slots, 1, &CommandList_AddRef);
+    setSlot(slots, 2, &CommandList_Release);
+    setSlot(slots, 3, &CommandList_GetDevice);
+    setSlot(slots, 4, &CommandList_GetPrivateData);
+    setSlot(slots, 5, &CommandList_SetPrivateData);
+    setSlot(slots, 6, &CommandList_SetPrivateDataInterface);
+    setSlot(slots, 7, &CommandList_GetContextFlags);
+    registerVtable(slots, CommandListSlotCount);
+  });
+
+  return slots;
+}
+
+
+/** Device context */
+HRESULT STDMETHODCALLTYPE Context_QueryInterface(ID3D11DeviceContext* pContext, REFIID riid, void** ppvObject) {
+  if (!ppvObject)
+    return E_POINTER;
+
+  if (riid != __uuidof(IUnknown)
+   && riid != __uuidof(ID3D11DeviceChild)
+   && riid != __uuidof(ID3D11DeviceContext)
+   && riid != __uuidof(ID3D11DeviceContext1)) {
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+  }
+
+  pContext->AddRef();
+  *ppvObject = pContext;
+  return S_OK;
+}
+
+ULONG STDMETHODCALLTYPE Context_AddRef(ID3D11DeviceContext* pContext) {
+  MockContext* context = getContext(pContext);
+
+  /* The immediate context shares its reference count with the device */
+  if (context->type == D3D11_DEVICE_CONTEXT_IMMEDIATE)
+    return reinterpret_cast<ID3D11Device*>(context->device)->AddRef();
+
+  return ++context->refCount;
+}
+
+ULONG STDMETHODCALLTYPE Context_Release(ID3D11DeviceContext* pContext) {
+  MockContext* context = getContext(pContext);
+
+  if (context->type == D3D11_DEVICE_CONTEXT_IMMEDIATE)
+    return reinterpret_cast<ID3D11Device*>(context->device)->Release();
+
+  ULONG refCount = --context->refCount;
+
+  if (!refCount) {
+    auto device = reinterpret_cast<ID3D11Device*>(context->device);
+
+    for (const auto& map : context->mapped)
+      reinterpret_cast<ID3D11Resource*>(map.resource)->Release();
+
+    releaseCommands(context->commands);
+    releasePrivateData(context->privateData);
+
+    delete context;
+    device->Release();
+  }
+
+  return refCount;
+}
+
+void STDMETHODCALLTYPE Context_GetDevice(ID3D11DeviceContext* pContext, ID3D11Device** ppDevice) {
+  auto device = reinterpret_cast<ID3D11Device*>(getContext(pContext)->device);
+  device->AddRef();
+  *ppDevice = device;
+}
+
+HRESULT STDMETHODCALLTYPE Context_GetPrivateData(ID3D11DeviceContext* pContext, REFGUID guid, UINT* pDataSize, void* pData) {
+  return getPrivateData(getContext(pContext)->privateData, guid, pDataSize, pData);
+}
+
+HRESULT STDMETHODCALLTYPE Context_SetPrivateData(ID3D11DeviceContext* pContext, REFGUID guid, UINT DataSize, const void* pData) {
+  setPrivateData(getContext(pContext)->privateData, guid, DataSize, pData, nullptr);
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE Context_SetPrivateDataInterface(ID3D11DeviceContext* pContext, REFGUID guid, const IUnknown* pData) {
+  setPrivateData(getContext(pContext)->privateData, guid, 0, nullptr, const_cast<IUnknown*>(pData));
+  return S_OK;
+}
+
+/* Deferred contexts only support discarding maps, which
+ * get fresh memory that is uploaded on execution */
+HRESULT mapDeferred(
+        MockContext*              pContext,
+        MockResource*             pResource,
+        UINT                      Subresource,
+        D3D11_MAP                 MapType,
+        D3D11_MAPPED_SUBRESOURCE* pMappedResource) {
+  if (MapType != D3D11_MAP_WRITE_DISCARD)
+    return E_INVALIDARG;
+
+  const auto& subresource = pResource->subresources[Subresource];
+
+  MockDeferredMap map;
+  map.resource = pResource;
+  map.subresource = Subresource;
+  map.data.resize(subresource.data.size());
+
+  reinterpret_cast<ID3D11Resource*>(pResource)->AddRef();
+  pContext->mapped.push_back(std::move(map));
+
+  pMappedResource->pData = pContext->mapped.back().data.data();
+  pMappedResource->RowPitch = subresource.rowPitch;
+  pMappedResource->DepthPitch = subresource.depthPitch;
+  return S_OK;
+}
+
+void unmapDeferred(
+        MockContext*              pContext,
+        MockResource*             pResource,
+        UINT                      Subresource) {
+  auto entry = std::find_if(pContext->mapped.begin(), pContext->mapped.end(),
+    [pResource, Subresource] (const MockDeferredMap& map) {
+      return map.resource == pResource && map.subresource == Subresource;
+    });
+
+  if (entry == pContext->mapped.end())
+    return;
+
+  /* The reference moves from the map to the command */
+  MockDeferredCommand cmd;
+  cmd.type = MockDeferredCommandType::Upload;
+  cmd.dst = pResource;
+  cmd.dstSubresource = Subresource;
+  cmd.data = std::move(entry->data);
+
+  pContext->commands.push_back(std::move(cmd));
+  pContext->mapped.erase(entry);
+}
+
+HRESULT STDMETHODCALLTYPE Context_Map(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pResource,
+        UINT                      Subresource,
+        D3D11_MAP                 MapType,
+        UINT                      MapFlags,
+        D3D11_MAPPED_SUBRESOURCE* pMappedResource) {
+  MockContext* context = getContext(pContext);
+  MockDevice* device = context->device;
+  MockResource* resource = getResource(pResource);
+
+  std::lock_guard lock(device->mutex);
+  device->stats.mapCount += 1;
+  spinFor(device->config.mapCostNs);
+
+  if (!resource || !pMappedResource || Subresource >= resource->subresources.size())
+    return E_INVALIDARG;
+
+  if (context->type == D3D11_DEVICE_CONTEXT_DEFERRED)
+    return mapDeferred(context, resource, Subresource, MapType, pMappedResource);
+
+  /* Discarding and non-overwriting maps never wait for the GPU,
+   * everything else has to wait for pending writes to complete */
+  if (MapType != D3D11_MAP_WRITE_DISCARD && MapType != D3D11_MAP_WRITE_NO_OVERWRITE) {
+    if (resource->pendingWrites)
+      submitPendingWork(device);
+
+    uint64_t now = nowNs();
+
+    if (now < resource->readyAt) {
+      if (MapFlags & D3D11_MAP_FLAG_DO_NOT_WAIT)
+        return DXGI_ERROR_WAS_STILL_DRAWING;
+
+      spinUntil(resource->readyAt);
+
+      device->stats.stallCount += 1;
+      device->stats.stallNs += resource->readyAt - now;
+    }
+  }
+
+  auto& subresource = resource->subresources[Subresource];
+  pMappedResource->pData = subresource.data.data();
+  pMappedResource->RowPitch = subresource.rowPitch;
+  pMappedResource->DepthPitch = subresource.depthPitch;
+  return S_OK;
+}
+
+void STDMETHODCALLTYPE Context_Unmap(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pResource,
+        UINT                      Subresource) {
+  MockContext* context = getContext(pContext);
+  MockDevice* device = context->device;
+
+  std::lock_guard lock(device->mutex);
+  device->stats.unmapCount += 1;
+  spinFor(device->config.unmapCostNs);
+
+  if (context->type == D3D11_DEVICE_CONTEXT_DEFERRED)
+    unmapDeferred(context, getResource(pResource), Subresource);
+}
+
+uint64_t copySubresource(
+        MockSubresource&          Dst,
+        UINT                      DstX,
+        UINT                      DstY,
+        UINT                      DstZ,
+  const MockSubresource&          Src,
+  const D3D11_BOX&                Box,
+        UINT                      FormatSize) {
+  UINT w = std::min(Box.right, Src.width) - std::min(Box.left, Src.width);
+  UINT h = std::min(Box.bottom, Src.height) - std::min(Box.top, Src.height);
+  UINT d = std::min(Box.back, Src.depth) - std::min(Box.front, Src.depth);
+
+  w = std::min(w, Dst.width  - std::min(DstX, Dst.width));
+  h = std::min(h, Dst.height - std::min(DstY, Dst.height));
+  d = std::min(d, Dst.depth  - std::min(DstZ, Dst.depth));
+
+  for (UINT z = 0; z < d; z++) {
+    for (UINT y = 0; y < h; y++) {
+      std::memcpy(
+        &Dst.data[(DstZ + z) * Dst.depthPitch + (DstY + y) * Dst.rowPitch + DstX * FormatSize],
+        &Src.data[(Box.front + z) * Src.depthPitch + (Box.top + y) * Src.rowPitch + Box.left * FormatSize],
+        w * FormatSize);
+    }
+  }
+
+  return uint64_t(w) * h * d * FormatSize;
+}
+
+void executeCopyRegion(
+        MockDevice*               pDevice,
+        MockResource*             pDst,
+        UINT                      DstSubresource,
+        UINT                      DstX,
+        UINT                      DstY,
+        UINT                      DstZ,
+        MockResource*             pSrc,
+        UINT                      SrcSubresource,
+  const D3D11_BOX*                pSrcBox) {
+  if (pDst->formatSize != pSrc->formatSize
+   || DstSubresource >= pDst->subresources.size()
+   || SrcSubresource >= pSrc->subresources.size())
+    return;
+
+  /* Resource contents are copied right away. Since DYNAMIC resources
+   * are renamed on discard, this is indistinguishable from the copy
+   * executing on the GPU later, only the timing is modelled. */
+  const auto& srcSub = pSrc->subresources[SrcSubresource];
+  D3D11_BOX box = { 0u, 0u, 0u, srcSub.width, srcSub.height, srcSub.depth };
+
+  if (pSrcBox)
+    box = *pSrcBox;
+
+  uint64_t bytes = copySubresource(pDst->subresources[DstSubresource],
+    DstX, DstY, DstZ, srcSub, box, pSrc->formatSize);
+  recordGpuWrite(pDevice, pDst, getGpuCopyCost(pDevice, bytes));
+}
+
+void executeCopyResource(
+        MockDevice*               pDevice,
+        MockResource*             pDst,
+        MockResource*             pSrc) {
+  if (pDst->formatSize != pSrc->formatSize
+   || pDst->subresources.size() != pSrc->subresources.size())
+    return;
+
+  uint64_t bytes = 0;
+
+  for (size_t i = 0; i < pSrc->subresources.size(); i++) {
+    const auto& srcSub = pSrc->subresources[i];
+    D3D11_BOX box = { 0u, 0u, 0u, srcSub.width, srcSub.height, srcSub.depth };
+    bytes += copySubresource(pDst->subresources[i], 0, 0, 0, srcSub, box, pSrc->formatSize);
+  }
+
+  recordGpuWrite(pDevice, pDst, getGpuCopyCost(pDevice, bytes));
+}
+
+D3D11_BOX getUpdateBox(const MockSubresource& Subresource, const D3D11_BOX* pDstBox) {
+  D3D11_BOX box = { 0u, 0u, 0u, Subresource.width, Subresource.height, Subresource.depth };
+
+  if (pDstBox) {
+    box.left   = std::min(pDstBox->left,   Subresource.width);
+    box.top    = std::min(pDstBox->top,    Subresource.height);
+    box.front  = std::min(pDstBox->front,  Subresource.depth);
+    box.right  = std::max(std::min(pDstBox->right,  Subresource.width),  box.left);
+    box.bottom = std::max(std::min(pDstBox->bottom, Subresource.height), box.top);
+    box.back   = std::max(std::min(pDstBox->back,   Subresource.depth),  box.front);
+  }
+
+  return box;
+}
+
+void executeUpdate(
+        MockDevice*               pDevice,
+        MockResource*             pDst,
+        UINT                      DstSubresource,
+  const D3D11_BOX&                DstBox,
+  const void*                     pSrcData,
+        UINT                      SrcRowPitch,
+        UINT                      SrcDepthPitch) {
+  if (DstSubresource >= pDst->subresources.size())
+    return;
+
+  /* Like copies, updates land right away, and the upload
+   * is only modelled as GPU work on the resource */
+  auto& dst = pDst->subresources[DstSubresource];
+  auto src = static_cast<const uint8_t*>(pSrcData);
+
+  UINT rowSize = (DstBox.right - DstBox.left) * pDst->formatSize;
+
+  for (UINT z = 0; z < DstBox.back - DstBox.front; z++) {
+    for (UINT y = 0; y < DstBox.bottom - DstBox.top; y++) {
+      std::memcpy(
+        &dst.data[(DstBox.front + z) * dst.depthPitch + (DstBox.top + y) * dst.rowPitch + DstBox.left * pDst->formatSize],
+        &src[z * SrcDepthPitch + y * SrcRowPitch], rowSize);
+    }
+  }
+
+  uint64_t bytes = uint64_t(rowSize) * (DstBox.bottom - DstBox.top) * (DstBox.back - DstBox.front);
+  recordGpuWrite(pDevice, pDst, getGpuCopyCost(pDevice, bytes));
+}
+
+void executeCommands(MockDevice* pDevice, const std::vector<MockDeferredCommand>& Commands) {
+  for (const auto& cmd : Commands) {
+    switch (cmd.type) {
+      case MockDeferredCommandType::Upload:
+        if (cmd.dstSubresource < cmd.dst->subresources.size())
+          cmd.dst->subresources[cmd.dstSubresource].data = cmd.data;
+        break;
+
+      case MockDeferredCommandType::CopySubresourceRegion:
+        executeCopyRegion(pDevice, cmd.dst, cmd.dstSubresource, cmd.dstX, cmd.dstY, cmd.dstZ,
+          cmd.src, cmd.srcSubresource, cmd.hasBox ? &cmd.box : nullptr);
+        break;
+
+      case MockDeferredCommandType::CopyResource:
+        executeCopyResource(pDevice, cmd.dst, cmd.src);
+        break;
+
+      case MockDeferredCommandType::UpdateSubresource: {
+        UINT rowSize = (cmd.box.right - cmd.box.left) * cmd.dst->formatSize;
+        executeUpdate(pDevice, cmd.dst, cmd.dstSubresource, cmd.box, cmd.data.data(),
+          rowSize, rowSize * (cmd.box.bottom - cmd.box.top));
+      } break;
+    }
+  }
+}
+
+void STDMETHODCALLTYPE Context_CopySubresourceRegion(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+        UINT                      DstX,
+        UINT                      DstY,
+        UINT                      DstZ,
+        ID3D11Resource*           pSrcResource,
+        UINT                      SrcSubresource,
+  const D3D11_BOX*                pSrcBox) {
+  MockContext* context = getContext(pContext);
+  MockDevice* device = context->device;
+  MockResource* dst = getResource(pDstResource);
+  MockResource* src = getResource(pSrcResource);
+
+  std::lock_guard lock(device->mutex);
+  device->stats.copyCount += 1;
+  spinFor(device->config.copyCostNs);
+
+  if (!dst || !src)
+    return;
+
+  if (context->type == D3D11_DEVICE_CONTEXT_DEFERRED) {
+    MockDeferredCommand cmd;
+    cmd.type = MockDeferredCommandType::CopySubresourceRegion;
+    cmd.dst = dst;
+    cmd.src = src;
+    cmd.dstSubresource = DstSubresource;
+    cmd.dstX = DstX;
+    cmd.dstY = DstY;
+    cmd.dstZ = DstZ;
+    cmd.srcSubresource = SrcSubresource;
+    cmd.hasBox = pSrcBox != nullptr;
+
+    if (pSrcBox)
+      cmd.box = *pSrcBox;
+
+    pDstResource->AddRef();
+    pSrcResource->AddRef();
+
+    context->commands.push_back(std::move(cmd));
+    return;
+  }
+
+  executeCopyRegion(device, dst, DstSubresource, DstX, DstY, DstZ, src, SrcSubresource, pSrcBox);
+}
+
+void STDMETHODCALLTYPE Context_CopyResource(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pDstResource,
+        ID3D11Resource*           pSrcResource) {
+  MockContext* context = getContext(pContext);
+  MockDevice* device = context->device;
+  MockResource* dst = getResource(pDstResource);
+  MockResource* src = getResource(pSrcResource);
+
+  std::lock_guard lock(device->mutex);
+  device->stats.copyCount += 1;
+  spinFor(device->config.copyCostNs);
+
+  if (!dst || !src)
+    return;
+
+  if (context->type == D3D11_DEVICE_CONTEXT_DEFERRED) {
+    MockDeferredCommand cmd;
+    cmd.type = MockDeferredCommandType::CopyResource;
+    cmd.dst = dst;
+    cmd.src = src;
+
+    pDstResource->AddRef();
+    pSrcResource->AddRef();
+
+    context->commands.push_back(std::move(cmd));
+    return;
+  }
+
+  executeCopyResource(device, dst, src);
+}
+
+void STDMETHODCALLTYPE Context_UpdateSubresource(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+  const D3D11_BOX*                pDstBox,
+  const void*                     pSrcData,
+        UINT                      SrcRowPitch,
+        UINT                      SrcDepthPitch) {
+  MockContext* context = getContext(pContext);
+  MockDevice* device = context->device;
+  MockResource* dst = getResource(pDstResource);
+
+  std::lock_guard lock(device->mutex);
+  device->stats.updateCount += 1;
+  spinFor(device->config.copyCostNs);
+
+  if (!dst || !pSrcData || DstSubresource >= dst->subresources.size())
+    return;
+
+  D3D11_BOX box = getUpdateBox(dst->subresources[DstSubresource], pDstBox);
+
+  if (context->type == D3D11_DEVICE_CONTEXT_DEFERRED) {
+    MockDeferredCommand cmd;
+    cmd.type = MockDeferredCommandType::UpdateSubresource;
+    cmd.dst = dst;
+    cmd.dstSubresource = DstSubresource;
+    cmd.hasBox = true;
+    cmd.box = box;
+
+    /* Pack the data, the application may reuse its memory */
+    auto src = static_cast<const uint8_t*>(pSrcData);
+    UINT rowSize = (box.right - box.left) * dst->formatSize;
+
+    for (UINT z = 0; z < box.back - box.front; z++) {
+      for (UINT y = 0; y < box.bottom - box.top; y++) {
+        const uint8_t* row = &src[z * SrcDepthPitch + y * SrcRowPitch];
+        cmd.data.insert(cmd.data.end(), row, row + rowSize);
+      }
+    }
+
+    pDstResource->AddRef();
+
+    context->commands.push_back(std::move(cmd));
+    return;
+  }
+
+  executeUpdate(device, dst, DstSubresource, box, pSrcData, SrcRowPitch, SrcDepthPitch);
+}
+
+void STDMETHODCALLTYPE Context_ResolveSubresource(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+        ID3D11Resource*           pSrcResource,
+        UINT                      SrcSubresource,
+        DXGI_FORMAT               Format) {
+  /* Resources are never multisampled, so this is a plain copy */
+  Context_CopySubresourceRegion(pContext, pDstResource, DstSubresource,
+    0, 0, 0, pSrcResource, SrcSubresource, nullptr);
+}
+
+void STDMETHODCALLTYPE Context1_CopySubresourceRegion1(
+        ID3D11DeviceContext1*     pContext,
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+        UINT                      DstX,
+        UINT                      DstY,
+        UINT                      DstZ,
+        ID3D11Resource*           pSrcResource,
+        UINT                      SrcSubresource,
+  const D3D11_BOX*                pSrcBox,
+        UINT                      CopyFlags) {
+  /* Copies land right away, so flags make no difference */
+  Context_CopySubresourceRegion(pContext, pDstResource, DstSubresource,
+    DstX, DstY, DstZ, pSrcResource, SrcSubresource, pSrcBox);
+}
+
+void STDMETHODCALLTYPE Context1_UpdateSubresource1(
+        ID3D11DeviceContext1*     pContext,
+        ID3D11Resource*           pDstResource,
+        UINT                      DstSubresource,
+  const D3D11_BOX*                pDstBox,
+  const void*                     pSrcData,
+        UINT                      SrcRowPitch,
+        UINT                      SrcDepthPitch,
+        UINT                      CopyFlags) {
+  Context_UpdateSubresource(pContext, pDstResource, DstSubresource,
+    pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch);
+}
+
+void STDMETHODCALLTYPE Context1_DiscardResource(
+        ID3D11DeviceContext1*     pContext,
+        ID3D11Resource*           pResource) {
+  /* Keeping the contents is one of the outcomes a discard allows */
+}
+
+void STDMETHODCALLTYPE Context_End(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Asynchronous*       pAsync) {
+  /* There are no queries to end */
+}
+
+HRESULT STDMETHODCALLTYPE Context_GetData(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Asynchronous*       pAsync,
+        void*                     pData,
+        UINT                      DataSize,
+        UINT                      GetDataFlags) {
+  MockDevice* device = getContext(pContext)->device;
+
+  /* There are no queries, only the implicit flush is modelled */
+  std::lock_guard lock(device->mutex);
+
+  if (!(GetDataFlags & D3D11_ASYNC_GETDATA_DONOTFLUSH)) {
+    device->stats.flushCount += 1;
+    submitPendingWork(device);
+  }
+
+  return S_OK;
+}
+
+void STDMETHODCALLTYPE Context_ExecuteCommandList(
+        ID3D11DeviceContext*      pContext,
+        ID3D11CommandList*        pCommandList,
+        BOOL                      RestoreContextState) {
+  MockContext* context = getContext(pContext);
+  MockDevice* device = context->device;
+
+  if (!pCommandList)
+    return;
+
+  std::lock_guard lock(device->mutex);
+  const auto& commands = getCommandList(pCommandList)->commands;
+
+  if (context->type == D3D11_DEVICE_CONTEXT_DEFERRED)
+    appendCommands(context->commands, commands);
+  else
+    executeCommands(device, commands);
+}
+
+void STDMETHODCALLTYPE Context_ClearState(ID3D11DeviceContext* pContext) {
+
+}
+
+void STDMETHODCALLTYPE Context_Flush(ID3D11DeviceContext* pContext) {
+  MockDevice* device = getContext(pContext)->device;
+
+  std::lock_guard lock(device->mutex);
+  device->stats.flushCount += 1;
+  submitPendingWork(device);
+}
+
+D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE Context_GetType(ID3D11DeviceContext* pContext) {
+  return getContext(pContext)->type;
+}
+
+UINT STDMETHODCALLTYPE Context_GetContextFlags(ID3D11DeviceContext* pContext) {
+  return 0;
+}
+
+HRESULT STDMETHODCALLTYPE Context_FinishCommandList(
+        ID3D11DeviceContext*      pContext,
+        BOOL                      RestoreDeferredContextState,
+        ID3D11CommandList**       ppCommandList) {
+  MockContext* context = getContext(pContext);
+
+  if (context->type != D3D11_DEVICE_CONTEXT_DEFERRED)
+    return DXGI_ERROR_INVALID_CALL;
+
+  if (!ppCommandList)
+    return E_INVALIDARG;
+
+  auto commandList = new MockCommandList();
+  commandList->vtbl = getCommandListVtable();
+  commandList->device = context->device;
+
+  { std::lock_guard lock(context->device->mutex);
+    commandList->commands = std::move(context->commands);
+    context->commands.clear();
+  }
+
+  reinterpret_cast<ID3D11Device*>(context->device)->AddRef();
+
+  *ppCommandList = reinterpret_cast<ID3D11CommandList*>(commandList);
+  return S_OK;
+}
+
+void** getContextVtable() {
+  static void* slots[ContextSlotCount];
+  static std::once_flag once;
+
+  std::call_once(once, [] {
+    initVtable(slots, ContextSlotCount);
+    setSlot(slots,   0, &Context_QueryInterface);
+    setSlot(slots,   1, &Context_AddRef);
+    setSlot(slots,   2, &Context_Release);
+    setSlot(slots,   3, &Context_GetDevice);
+    setSlot(slots,   4, &Context_GetPrivateData);
+    setSlot(slots,   5, &Context_SetPrivateData);
+    setSlot(slots,   6, &Context_SetPrivateDataInterface);
+    setSlot(slots,  14, &Context_Map);
+    setSlot(slots,  15, &Context_Unmap);
+    setSlot(slots,  28, &Context_End);
+    setSlot(slots,  29, &Context_GetData);
+    setSlot(slots,  46, &Context_CopySubresourceRegion);
+    setSlot(slots,  47, &Context_CopyResource);
+    setSlot(slots,  48, &Context_UpdateSubresource);
+    setSlot(slots,  57, &Context_ResolveSubresource);
+    setSlot(slots,  58, &Context_ExecuteCommandList);
+    setSlot(slots, 110, &Context_ClearState);
+    setSlot(slots, 111, &Context_Flush);
+    setSlot(slots, 112, &Context_GetType);
+    setSlot(slots, 113, &Context_GetContextFlags);
+    setSlot(slots, 114, &Context_FinishCommandList);
+    setSlot(slots, 115, &Context1_CopySubresourceRegion1);
+    setSlot(slots, 116, &Context1_UpdateSubresource1);
+    setSlot(slots, 117, &Context1_DiscardResource);
+    registerVtable(slots, ContextSlotCount);
+  });
+
+  return slots;
+}
+
+
+/** Device */
+HRESULT STDMETHODCALLTYPE Device_QueryInterface(ID3D11Device* pDevice, REFIID riid, void** ppvObject) {
+  if (!ppvObject)
+    return E_POINTER;
+
+  if (riid != __uuidof(IUnknown)
+   && riid != __uuidof(ID3D11Device)) {
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+  }
+
+  pDevice->AddRef();
+  *ppvObject = pDevice;
+  return S_OK;
+}
+
+ULONG STDMETHODCALLTYPE Device_AddRef(ID3D11Device* pDevice) {
+  return ++getDevice(pDevice)->refCount;
+}
+
+ULONG STDMETHODCALLTYPE Device_Release(ID3D11Device* pDevice) {
+  MockDevice* device = getDevice(pDevice);
+  ULONG refCount = --device->refCount;
+
+  if (!refCount) {
+    releasePrivateData(device->immediateContext.privateData);
+    delete device;
+  }
+
+  return refCount;
+}
+
+HRESULT STDMETHODCALLTYPE Device_CreateBuffer(
+        ID3D11Device*             pDevice,
+  const D3D11_BUFFER_DESC*        pDesc,
+  const D3D11_SUBRESOURCE_DATA*   pInitialData,
+        ID3D11Buffer**            ppBuffer) {
+  if (!pDesc || !pDesc->ByteWidth)
+    return E_INVALIDARG;
+
+  if (!ppBuffer)
+    return S_FALSE;
+
+  MockResource* buffer = createResource(getDevice(pDevice),
+    getBufferVtable(), D3D11_RESOURCE_DIMENSION_BUFFER);
+  buffer->bufferDesc = *pDesc;
+  buffer->formatSize = 1;
+  buffer->subresources.resize(1);
+
+  initSubresource(buffer->subresources[0], pDesc->ByteWidth, 1, 1, 1, pInitialData);
+
+  *ppBuffer = reinterpret_cast<ID3D11Buffer*>(buffer);
+  return S_OK;
+}
+
+UINT getFullMipCount(UINT MaxExtent) {
+  UINT count = 0;
+
+  while (MaxExtent >> count)
+    count += 1;
+
+  return count;
+}
+
+HRESULT STDMETHODCALLTYPE Device_CreateTexture1D(
+        ID3D11Device*             pDevice,
+  const D3D11_TEXTURE1D_DESC*     pDesc,
+  const D3D11_SUBRESOURCE_DATA*   pInitialData,
+        ID3D11Texture1D**         ppTexture1D) {
+  if (!pDesc || !pDesc->Width || !pDesc->ArraySize)
+    return E_INVALIDARG;
+
+  if (!ppTexture1D)
+    return S_FALSE;
+
+  MockResource* texture = createResource(getDevice(pDevice),
+    getTexture1DVtable(), D3D11_RESOURCE_DIMENSION_TEXTURE1D);
+  texture->tex1DDesc = *pDesc;
+  texture->formatSize = getFormatSize(pDesc->Format);
+
+  if (!texture->tex1DDesc.MipLevels)
+    texture->tex1DDesc.MipLevels = getFullMipCount(pDesc->Width);
+
+  UINT mipCount = texture->tex1DDesc.MipLevels;
+  texture->subresources.resize(mipCount * pDesc->ArraySize);
+
+  for (UINT layer = 0; layer < pDesc->ArraySize; layer++) {
+    for (UINT mip = 0; mip < mipCount; mip++) {
+      UINT index = mip + layer * mipCount;
+
+      initSubresource(texture->subresources[index],
+        std::max(pDesc->Width >> mip, 1u), 1u, 1u,
+        texture->formatSize, pInitialData ? &pInitialData[index] : nullptr);
+    }
+  }
+
+  *ppTexture1D = reinterpret_cast<ID3D11Texture1D*>(texture);
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE Device_CreateTexture2D(
+        ID3D11Device*             pDevice,
+  const D3D11_TEXTURE2D_DESC*     pDesc,
+  const D3D11_SUBRESOURCE_DATA*   pInitialData,
+        ID3D11Texture2D**         ppTexture2D) {
+  if (!pDesc || !pDesc->Width || !pDesc->Height || !pDesc->ArraySize)
+    return E_INVALIDARG;
+
+  if (!ppTexture2D)
+    return S_FALSE;
+
+  MockResource* texture = createResource(getDevice(pDevice),
+    getTexture2DVtable(), D3D11_RESOURCE_DIMENSION_TEXTURE2D);
+  texture->tex2DDesc = *pDesc;
+  texture->formatSize = getFormatSize(pDesc->Format);
+
+  if (!texture->tex2DDesc.MipLevels)
+    texture->tex2DDesc.MipLevels = getFullMipCount(std::max(pDesc->Width, pDesc->Height));
+
+  UINT mipCount = texture->tex2DDesc.MipLevels;
+  texture->subresources.resize(mipCount * pDesc->ArraySize);
+
+  for (UINT layer = 0; layer < pDesc->ArraySize; layer++) {
+    for (UINT mip = 0; mip < mipCount; mip++) {
+      UINT index = mip + layer * mipCount;
+
+      initSubresource(texture->subresources[index],
+        std::max(pDesc->Width >> mip, 1u),
+        std::max(pDesc->Height >> mip, 1u), 1u,
+        texture->formatSize, pInitialData ? &pInitialData[index] : nullptr);
+    }
+  }
+
+  *ppTexture2D = reinterpret_cast<ID3D11Texture2D*>(texture);
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE Device_CreateTexture3D(
+        ID3D11Device*             pDevice,
+  const D3D11_TEXTURE3D_DESC*     pDesc,
+  const D3D11_SUBRESOURCE_DATA*   pInitialData,
+        ID3D11Texture3D**         ppTexture3D) {
+  if (!pDesc || !pDesc->Width || !pDesc->Height || !pDesc->Depth)
+    return E_INVALIDARG;
+
+  if (!ppTexture3D)
+    return S_FALSE;
+
+  MockResource* texture = createResource(getDevice(pDevice),
+    getTexture3DVtable(), D3D11_RESOURCE_DIMENSION_TEXTURE3D);
+  texture->tex3DDesc = *pDesc;
+  texture->formatSize = getFormatSize(pDesc->Format);
+
+  if (!texture->tex3DDesc.MipLevels)
+    texture->tex3DDesc.MipLevels = getFullMipCount(std::max({ pDesc->Width, pDesc->Height, pDesc->Depth }));
+
+  UINT mipCount = texture->tex3DDesc.MipLevels;
+  texture->subresources.resize(mipCount);
+
+  for (UINT mip = 0; mip < mipCount; mip++) {
+    initSubresource(texture->subresources[mip],
+      std::max(pDesc->Width >> mip, 1u),
+      std::max(pDesc->Height >> mip, 1u),
+      std::max(pDesc->Depth >> mip, 1u),
+      texture->formatSize, pInitialData ? &pInitialData[mip] : nullptr);
+  }
+
+  *ppTexture3D = reinterpret_cast<ID3D11Texture3D*>(texture);
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE Device_CreateDeferredContext(
+        ID3D11Device*             pDevice,
+        UINT                      ContextFlags,
+        ID3D11DeviceContext**     ppDeferredContext) {
+  if (!ppDeferredContext)
+    return E_INVALIDARG;
+
+  auto context = new MockContext();
+  context->vtbl = getContextVtable();
+  context->device = getDevice(pDevice);
+  context->type = D3D11_DEVICE_CONTEXT_DEFERRED;
+
+  pDevice->AddRef();
+
+  *ppDeferredContext = reinterpret_cast<ID3D11DeviceContext*>(context);
+  return S_OK;
+}
+
+D3D_FEATURE_LEVEL STDMETHODCALLTYPE Device_GetFeatureLevel(ID3D11Device* pDevice) {
+  return D3D_FEATURE_LEVEL_11_0;
+}
+
+UINT STDMETHODCALLTYPE Device_GetCreationFlags(ID3D11Device* pDevice) {
+  return 0;
+}
+
+void STDMETHODCALLTYPE Device_GetImmediateContext(ID3D11Device* pDevice, ID3D11DeviceContext** ppImmediateContext) {
+  pDevice->AddRef();
+  *ppImmediateContext = reinterpret_cast<ID3D11DeviceContext*>(&getDevice(pDevice)->immediateContext);
+}
+
+void** getDeviceVtable() {
+  static void* slots[DeviceSlotCount];
+  static std::once_flag once;
+
+  std::call_once(once, [] {
+    initVtable(slots, DeviceSlotCount);
+    setSlot(slots,  0, &Device_QueryInterface);
+    setSlot(slots,  1, &Device_AddRef);
+    setSlot(slots,  2, &Device_Release);
+    setSlot(slots,  3, &Device_CreateBuffer);
+    setSlot(slots,  4, &Device_CreateTexture1D);
+    setSlot(slots,  5, &Device_CreateTexture2D);
+    setSlot(slots,  6, &Device_CreateTexture3D);
+    setSlot(slots, 27, &Device_CreateDeferredContext);
+    setSlot(slots, 37, &Device_GetFeatureLevel);
+    setSlot(slots, 38, &Device_GetCreationFlags);
+    setSlot(slots, 40, &Device_GetImmediateContext);
+    registerVtable(slots, DeviceSlotCount);
+  });
+
+  return slots;
+}
+
+
+/** Public interface */
+HRESULT createMockDevice(
+  const MockConfig&           config,
+        ID3D11Device**        ppDevice,
+        ID3D11DeviceContext** ppContext) {
+  if (!ppDevice || !ppContext)
+    return E_POINTER;
+
+  auto device = new MockDevice();
+  device->vtbl = getDeviceVtable();
+  device->config = config;
+  device->immediateContext.vtbl = getContextVtable();
+  device->immediateContext.device = device;
+  device->immediateContext.type = D3D11_DEVICE_CONTEXT_IMMEDIATE;
+
+  /* One reference for each returned object */
+  device->refCount = 2;
+
+  *ppDevice = reinterpret_cast<ID3D11Device*>(device);
+  *ppContext = reinterpret_cast<ID3D11DeviceContext*>(&device->immediateContext);
+  return S_OK;
+}
+
+void setMockConfig(ID3D11Device* pDevice, const MockConfig& config) {
+  MockDevice* device = getDevice(pDevice);
+
+  std::lock_guard lock(device->mutex);
+  device->config = config;
+}
+
+MockStats getMockStats(ID3D11Device* pDevice) {
+  MockDevice* device = getDevice(pDevice);
+
+  std::lock_guard lock(device->mutex);
+  return device->stats;
+}
+
+void resetMockStats(ID3D11Device* pDevice) {
+  MockDevice* device = getDevice(pDevice);
+
+  std::lock_guard lock(device->mutex);
+  device->stats = MockStats();
+}
+
+void waitForMockIdle(ID3D11Device* pDevice) {
+  MockDevice* device = getDevice(pDevice);
+
+  std::lock_guard lock(device->mutex);
+  submitPendingWork(device);
+  spinUntil(device->gpuBusyUntil);
+}
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <d3d11_1.h>
+
+#include <cstdint>
+
+namespace atfix::mock {
+
+/**
+ * \brief Latency model of the mock device
+ *
+ * All times are in nanoseconds. CPU costs are spent inside the
+ * respective call, whereas GPU costs only delay the point in time
+ * at which submitted work completes. Work is recorded until the
+ * context is flushed, either explicitly or implicitly by a Map
+ * call that has to wait for it, which is what DXVK does as well.
+ */
+struct MockConfig {
+  /** CPU cost of each Map call */
+  uint64_t mapCostNs       = 0;
+  /** CPU cost of each Unmap call */
+  uint64_t unmapCostNs     = 0;
+  /** CPU cost of recording a copy */
+  uint64_t copyCostNs      = 0;
+  /** CPU cost of a submission, i.e. of each flush with pending work */
+  uint64_t flushCostNs     = 0;
+  /** Time between submission and the GPU starting to execute it */
+  uint64_t submitDelayNs   = 0;
+  /** Fixed GPU execution time of each copy */
+  uint64_t gpuCopyNs       = 0;
+  /** GPU execution time per MiB of copied data */
+  uint64_t gpuCopyNsPerMiB = 0;
+};
+
+
+/**
+ * \brief Counters maintained by the mock device
+ */
+struct MockStats {
+  uint64_t mapCount        = 0;
+  uint64_t unmapCount      = 0;
+  uint64_t copyCount       = 0;
+  uint64_t updateCount     = 0;
+  uint64_t flushCount      = 0;
+  uint64_t submitCount     = 0;
+  /** Map calls that had to wait for the GPU */
+  uint64_t stallCount      = 0;
+  /** Total time spent waiting for the GPU inside Map */
+  uint64_t stallNs         = 0;
+};
+
+
+/**
+ * \brief Creates a mock device and its immediate context
+ *
+ * The returned objects use real COM vtable layouts, so the hooks
+ * from impl.cpp can be installed on them like on a driver context.
+ * Resource contents live in host memory. Deferred contexts record
+ * uploads and copies into command lists that the immediate context
+ * executes, all other commands are not modelled.
+ * \param [in] config Latency model
+ * \param [out] ppDevice Device
+ * \param [out] ppContext Immediate context
+ * \returns \c S_OK on success
+ */
+HRESULT createMockDevice(
+  const MockConfig&           config,
+        ID3D11Device**        ppDevice,
+        ID3D11DeviceContext** ppContext);
+
+/**
+ * \brief Replaces the latency model of a mock device
+ */
+void setMockConfig(ID3D11Device* pDevice, const MockConfig& config);
+
+/**
+ * \brief Queries and resets counters of a mock device
+ */
+MockStats getMockStats(ID3D11Device* pDevice);
+void resetMockStats(ID3D11Device* pDevice);
+
+/**
+ * \brief Blocks until all submitted GPU work has completed
+ */
+void waitForMockIdle(ID3D11Device* pDevice);
+
+}
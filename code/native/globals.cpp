@@ -0,0 +1,9 @@
+#include "../impl.h"
+
+namespace atfix {
+
+/* Native counterpart of the global log defined in main.cpp,
+ * which only exists in the DLL build. */
+Log log("atfix.log");
+
+}
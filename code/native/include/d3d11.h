@@ -0,0 +1,396 @@
+#pragma once
+
+/**
+ * \brief Minimal D3D11 shim for native (non-Windows) builds
+ *
+ * Interfaces are declared in vtable order so that slot indices match
+ * the real ABI, which is what \c HOOK_PROC relies on. Methods that
+ * neither the hook code nor the mock device use are declared without
+ * parameters via \c D3D11_SHIM_SLOT, purely to keep the layout intact.
+ */
+
+#include <windows.h>
+#include <dxgi.h>
+
+#define D3D11_SDK_VERSION 7
+
+#define D3D11_SHIM_SLOT(name) virtual void STDMETHODCALLTYPE name() = 0
+
+typedef enum D3D_DRIVER_TYPE {
+  D3D_DRIVER_TYPE_UNKNOWN   = 0,
+  D3D_DRIVER_TYPE_HARDWARE  = 1,
+  D3D_DRIVER_TYPE_REFERENCE = 2,
+  D3D_DRIVER_TYPE_NULL      = 3,
+  D3D_DRIVER_TYPE_SOFTWARE  = 4,
+  D3D_DRIVER_TYPE_WARP      = 5,
+} D3D_DRIVER_TYPE;
+
+typedef enum D3D_FEATURE_LEVEL {
+  D3D_FEATURE_LEVEL_10_0    = 0xa000,
+  D3D_FEATURE_LEVEL_10_1    = 0xa100,
+  D3D_FEATURE_LEVEL_11_0    = 0xb000,
+  D3D_FEATURE_LEVEL_11_1    = 0xb100,
+} D3D_FEATURE_LEVEL;
+
+typedef enum D3D11_RESOURCE_DIMENSION {
+  D3D11_RESOURCE_DIMENSION_UNKNOWN    = 0,
+  D3D11_RESOURCE_DIMENSION_BUFFER     = 1,
+  D3D11_RESOURCE_DIMENSION_TEXTURE1D  = 2,
+  D3D11_RESOURCE_DIMENSION_TEXTURE2D  = 3,
+  D3D11_RESOURCE_DIMENSION_TEXTURE3D  = 4,
+} D3D11_RESOURCE_DIMENSION;
+
+typedef enum D3D11_USAGE {
+  D3D11_USAGE_DEFAULT   = 0,
+  D3D11_USAGE_IMMUTABLE = 1,
+  D3D11_USAGE_DYNAMIC   = 2,
+  D3D11_USAGE_STAGING   = 3,
+} D3D11_USAGE;
+
+typedef enum D3D11_MAP {
+  D3D11_MAP_READ                = 1,
+  D3D11_MAP_WRITE               = 2,
+  D3D11_MAP_READ_WRITE          = 3,
+  D3D11_MAP_WRITE_DISCARD       = 4,
+  D3D11_MAP_WRITE_NO_OVERWRITE  = 5,
+} D3D11_MAP;
+
+typedef enum D3D11_MAP_FLAG {
+  D3D11_MAP_FLAG_DO_NOT_WAIT    = 0x100000,
+} D3D11_MAP_FLAG;
+
+typedef enum D3D11_CPU_ACCESS_FLAG {
+  D3D11_CPU_ACCESS_WRITE        = 0x10000,
+  D3D11_CPU_ACCESS_READ         = 0x20000,
+} D3D11_CPU_ACCESS_FLAG;
+
+typedef enum D3D11_BIND_FLAG {
+  D3D11_BIND_VERTEX_BUFFER      = 0x1,
+  D3D11_BIND_INDEX_BUFFER       = 0x2,
+  D3D11_BIND_CONSTANT_BUFFER    = 0x4,
+  D3D11_BIND_SHADER_RESOURCE    = 0x8,
+  D3D11_BIND_STREAM_OUTPUT      = 0x10,
+  D3D11_BIND_RENDER_TARGET      = 0x20,
+  D3D11_BIND_DEPTH_STENCIL      = 0x40,
+  D3D11_BIND_UNORDERED_ACCESS   = 0x80,
+} D3D11_BIND_FLAG;
+
+typedef enum D3D11_DEVICE_CONTEXT_TYPE {
+  D3D11_DEVICE_CONTEXT_IMMEDIATE  = 0,
+  D3D11_DEVICE_CONTEXT_DEFERRED   = 1,
+} D3D11_DEVICE_CONTEXT_TYPE;
+
+typedef enum D3D11_QUERY {
+  D3D11_QUERY_EVENT               = 0,
+  D3D11_QUERY_OCCLUSION           = 1,
+  D3D11_QUERY_TIMESTAMP           = 2,
+  D3D11_QUERY_TIMESTAMP_DISJOINT  = 3,
+} D3D11_QUERY;
+
+typedef enum D3D11_ASYNC_GETDATA_FLAG {
+  D3D11_ASYNC_GETDATA_DONOTFLUSH  = 0x1,
+} D3D11_ASYNC_GETDATA_FLAG;
+
+typedef struct D3D11_BOX {
+  UINT left;
+  UINT top;
+  UINT front;
+  UINT right;
+  UINT bottom;
+  UINT back;
+} D3D11_BOX;
+
+typedef struct D3D11_MAPPED_SUBRESOURCE {
+  void* pData;
+  UINT  RowPitch;
+  UINT  DepthPitch;
+} D3D11_MAPPED_SUBRESOURCE;
+
+typedef struct D3D11_SUBRESOURCE_DATA {
+  const void* pSysMem;
+  UINT        SysMemPitch;
+  UINT        SysMemSlicePitch;
+} D3D11_SUBRESOURCE_DATA;
+
+typedef struct D3D11_BUFFER_DESC {
+  UINT        ByteWidth;
+  D3D11_USAGE Usage;
+  UINT        BindFlags;
+  UINT        CPUAccessFlags;
+  UINT        MiscFlags;
+  UINT        StructureByteStride;
+} D3D11_BUFFER_DESC;
+
+typedef struct D3D11_TEXTURE1D_DESC {
+  UINT        Width;
+  UINT        MipLevels;
+  UINT        ArraySize;
+  DXGI_FORMAT Format;
+  D3D11_USAGE Usage;
+  UINT        BindFlags;
+  UINT        CPUAccessFlags;
+  UINT        MiscFlags;
+} D3D11_TEXTURE1D_DESC;
+
+typedef struct D3D11_TEXTURE2D_DESC {
+  UINT              Width;
+  UINT              Height;
+  UINT              MipLevels;
+  UINT              ArraySize;
+  DXGI_FORMAT       Format;
+  DXGI_SAMPLE_DESC  SampleDesc;
+  D3D11_USAGE       Usage;
+  UINT              BindFlags;
+  UINT              CPUAccessFlags;
+  UINT              MiscFlags;
+} D3D11_TEXTURE2D_DESC;
+
+typedef struct D3D11_TEXTURE3D_DESC {
+  UINT        Width;
+  UINT        Height;
+  UINT        Depth;
+  UINT        MipLevels;
+  DXGI_FORMAT Format;
+  D3D11_USAGE Usage;
+  UINT        BindFlags;
+  UINT        CPUAccessFlags;
+  UINT        MiscFlags;
+} D3D11_TEXTURE3D_DESC;
+
+typedef struct D3D11_QUERY_DESC {
+  D3D11_QUERY Query;
+  UINT        MiscFlags;
+} D3D11_QUERY_DESC;
+
+struct ID3D11Device;
+
+
+/* Device children and resources */
+struct ID3D11DeviceChild : public IUnknown {
+  virtual void    STDMETHODCALLTYPE GetDevice(ID3D11Device** ppDevice) = 0;                           //  3
+  virtual HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* pDataSize, void* pData) = 0;   //  4
+  virtual HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT DataSize, const void* pData) = 0;
+  virtual HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* pData) = 0; //  6
+};
+
+struct ID3D11Resource : public ID3D11DeviceChild {
+  virtual void    STDMETHODCALLTYPE GetType(D3D11_RESOURCE_DIMENSION* pResourceDimension) = 0;        //  7
+  virtual void    STDMETHODCALLTYPE SetEvictionPriority(UINT EvictionPriority) = 0;
+  virtual UINT    STDMETHODCALLTYPE GetEvictionPriority() = 0;                                        //  9
+};
+
+struct ID3D11Buffer : public ID3D11Resource {
+  virtual void    STDMETHODCALLTYPE GetDesc(D3D11_BUFFER_DESC* pDesc) = 0;                            // 10
+};
+
+struct ID3D11Texture1D : public ID3D11Resource {
+  virtual void    STDMETHODCALLTYPE GetDesc(D3D11_TEXTURE1D_DESC* pDesc) = 0;                         // 10
+};
+
+struct ID3D11Texture2D : public ID3D11Resource {
+  virtual void    STDMETHODCALLTYPE GetDesc(D3D11_TEXTURE2D_DESC* pDesc) = 0;                         // 10
+};
+
+struct ID3D11Texture3D : public ID3D11Resource {
+  virtual void    STDMETHODCALLTYPE GetDesc(D3D11_TEXTURE3D_DESC* pDesc) = 0;                         // 10
+};
+
+struct ID3D11Asynchronous : public ID3D11DeviceChild {
+  virtual UINT    STDMETHODCALLTYPE GetDataSize() = 0;                                                //  7
+};
+
+struct ID3D11Query : public ID3D11Asynchronous {
+  virtual void    STDMETHODCALLTYPE GetDesc(D3D11_QUERY_DESC* pDesc) = 0;                             //  8
+};
+
+struct ID3D11CommandList : public ID3D11DeviceChild {
+  virtual UINT    STDMETHODCALLTYPE GetContextFlags() = 0;                                            //  7
+};
+
+
+/* Device context */
+struct ID3D11DeviceContext : public ID3D11DeviceChild {
+  D3D11_SHIM_SLOT(VSSetConstantBuffers);                                                              //  7
+  D3D11_SHIM_SLOT(PSSetShaderResources);
+  D3D11_SHIM_SLOT(PSSetShader);
+  D3D11_SHIM_SLOT(PSSetSamplers);                                                                     // 10
+  D3D11_SHIM_SLOT(VSSetShader);
+  D3D11_SHIM_SLOT(DrawIndexed);
+  D3D11_SHIM_SLOT(Draw);
+  virtual HRESULT STDMETHODCALLTYPE Map(ID3D11Resource* pResource, UINT Subresource,
+    D3D11_MAP MapType, UINT MapFlags, D3D11_MAPPED_SUBRESOURCE* pMappedResource) = 0;                 // 14
+  virtual void    STDMETHODCALLTYPE Unmap(ID3D11Resource* pResource, UINT Subresource) = 0;           // 15
+  D3D11_SHIM_SLOT(PSSetConstantBuffers);
+  D3D11_SHIM_SLOT(IASetInputLayout);
+  D3D11_SHIM_SLOT(IASetVertexBuffers);
+  D3D11_SHIM_SLOT(IASetIndexBuffer);
+  D3D11_SHIM_SLOT(DrawIndexedInstanced);                                                              // 20
+  D3D11_SHIM_SLOT(DrawInstanced);
+  D3D11_SHIM_SLOT(GSSetConstantBuffers);
+  D3D11_SHIM_SLOT(GSSetShader);
+  D3D11_SHIM_SLOT(IASetPrimitiveTopology);
+  D3D11_SHIM_SLOT(VSSetShaderResources);
+  D3D11_SHIM_SLOT(VSSetSamplers);
+  virtual void    STDMETHODCALLTYPE Begin(ID3D11Asynchronous* pAsync) = 0;                            // 27
+  virtual void    STDMETHODCALLTYPE End(ID3D11Asynchronous* pAsync) = 0;                              // 28
+  virtual HRESULT STDMETHODCALLTYPE GetData(ID3D11Asynchronous* pAsync, void* pData,
+    UINT DataSize, UINT GetDataFlags) = 0;                                                            // 29
+  D3D11_SHIM_SLOT(SetPredication);                                                                    // 30
+  D3D11_SHIM_SLOT(GSSetShaderResources);
+  D3D11_SHIM_SLOT(GSSetSamplers);
+  D3D11_SHIM_SLOT(OMSetRenderTargets);
+  D3D11_SHIM_SLOT(OMSetRenderTargetsAndUnorderedAccessViews);
+  D3D11_SHIM_SLOT(OMSetBlendState);
+  D3D11_SHIM_SLOT(OMSetDepthStencilState);
+  D3D11_SHIM_SLOT(SOSetTargets);
+  D3D11_SHIM_SLOT(DrawAuto);
+  D3D11_SHIM_SLOT(DrawIndexedInstancedIndirect);
+  D3D11_SHIM_SLOT(DrawInstancedIndirect);                                                             // 40
+  D3D11_SHIM_SLOT(Dispatch);
+  D3D11_SHIM_SLOT(DispatchIndirect);
+  D3D11_SHIM_SLOT(RSSetState);
+  D3D11_SHIM_SLOT(RSSetViewports);
+  D3D11_SHIM_SLOT(RSSetScissorRects);
+  virtual void    STDMETHODCALLTYPE CopySubresourceRegion(ID3D11Resource* pDstResource,
+    UINT DstSubresource, UINT DstX, UINT DstY, UINT DstZ, ID3D11Resource* pSrcResource,
+    UINT SrcSubresource, const D3D11_BOX* pSrcBox) = 0;                                               // 46
+  virtual void    STDMETHODCALLTYPE CopyResource(ID3D11Resource* pDstResource,
+    ID3D11Resource* pSrcResource) = 0;                                                                // 47
+  virtual void    STDMETHODCALLTYPE UpdateSubresource(ID3D11Resource* pDstResource,
+    UINT DstSubresource, const D3D11_BOX* pDstBox, const void* pSrcData,
+    UINT SrcRowPitch, UINT SrcDepthPitch) = 0;                                                        // 48
+  D3D11_SHIM_SLOT(CopyStructureCount);
+  D3D11_SHIM_SLOT(ClearRenderTargetView);                                                             // 50
+  D3D11_SHIM_SLOT(ClearUnorderedAccessViewUint);
+  D3D11_SHIM_SLOT(ClearUnorderedAccessViewFloat);
+  D3D11_SHIM_SLOT(ClearDepthStencilView);
+  D3D11_SHIM_SLOT(GenerateMips);
+  D3D11_SHIM_SLOT(SetResourceMinLOD);
+  D3D11_SHIM_SLOT(GetResourceMinLOD);
+  virtual void    STDMETHODCALLTYPE ResolveSubresource(ID3D11Resource* pDstResource,
+    UINT DstSubresource, ID3D11Resource* pSrcResource, UINT SrcSubresource,
+    DXGI_FORMAT Format) = 0;                                                                          // 57
+  virtual void    STDMETHODCALLTYPE ExecuteCommandList(ID3D11CommandList* pCommandList,
+    BOOL RestoreContextState) = 0;                                                                    // 58
+  D3D11_SHIM_SLOT(HSSetShaderResources);
+  D3D11_SHIM_SLOT(HSSetShader);                                                                       // 60
+  D3D11_SHIM_SLOT(HSSetSamplers);
+  D3D11_SHIM_SLOT(HSSetConstantBuffers);
+  D3D11_SHIM_SLOT(DSSetShaderResources);
+  D3D11_SHIM_SLOT(DSSetShader);
+  D3D11_SHIM_SLOT(DSSetSamplers);
+  D3D11_SHIM_SLOT(DSSetConstantBuffers);
+  D3D11_SHIM_SLOT(CSSetShaderResources);
+  D3D11_SHIM_SLOT(CSSetUnorderedAccessViews);
+  D3D11_SHIM_SLOT(CSSetShader);
+  D3D11_SHIM_SLOT(CSSetSamplers);                                                                     // 70
+  D3D11_SHIM_SLOT(CSSetConstantBuffers);
+  D3D11_SHIM_SLOT(VSGetConstantBuffers);
+  D3D11_SHIM_SLOT(PSGetShaderResources);
+  D3D11_SHIM_SLOT(PSGetShader);
+  D3D11_SHIM_SLOT(PSGetSamplers);
+  D3D11_SHIM_SLOT(VSGetShader);
+  D3D11_SHIM_SLOT(PSGetConstantBuffers);
+  D3D11_SHIM_SLOT(IAGetInputLayout);
+  D3D11_SHIM_SLOT(IAGetVertexBuffers);
+  D3D11_SHIM_SLOT(IAGetIndexBuffer);                                                                  // 80
+  D3D11_SHIM_SLOT(GSGetConstantBuffers);
+  D3D11_SHIM_SLOT(GSGetShader);
+  D3D11_SHIM_SLOT(IAGetPrimitiveTopology);
+  D3D11_SHIM_SLOT(VSGetShaderResources);
+  D3D11_SHIM_SLOT(VSGetSamplers);
+  D3D11_SHIM_SLOT(GetPredication);
+  D3D11_SHIM_SLOT(GSGetShaderResources);
+  D3D11_SHIM_SLOT(GSGetSamplers);
+  D3D11_SHIM_SLOT(OMGetRenderTargets);
+  D3D11_SHIM_SLOT(OMGetRenderTargetsAndUnorderedAccessViews);                                         // 90
+  D3D11_SHIM_SLOT(OMGetBlendState);
+  D3D11_SHIM_SLOT(OMGetDepthStencilState);
+  D3D11_SHIM_SLOT(SOGetTargets);
+  D3D11_SHIM_SLOT(RSGetState);
+  D3D11_SHIM_SLOT(RSGetViewports);
+  D3D11_SHIM_SLOT(RSGetScissorRects);
+  D3D11_SHIM_SLOT(HSGetShaderResources);
+  D3D11_SHIM_SLOT(HSGetShader);
+  D3D11_SHIM_SLOT(HSGetSamplers);
+  D3D11_SHIM_SLOT(HSGetConstantBuffers);                                                              // 100
+  D3D11_SHIM_SLOT(DSGetShaderResources);
+  D3D11_SHIM_SLOT(DSGetShader);
+  D3D11_SHIM_SLOT(DSGetSamplers);
+  D3D11_SHIM_SLOT(DSGetConstantBuffers);
+  D3D11_SHIM_SLOT(CSGetShaderResources);
+  D3D11_SHIM_SLOT(CSGetUnorderedAccessViews);
+  D3D11_SHIM_SLOT(CSGetShader);
+  D3D11_SHIM_SLOT(CSGetSamplers);
+  D3D11_SHIM_SLOT(CSGetConstantBuffers);
+  virtual void    STDMETHODCALLTYPE ClearState() = 0;                                                 // 110
+  virtual void    STDMETHODCALLTYPE Flush() = 0;                                                      // 111
+  virtual D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE GetType() = 0;                                  // 112
+  virtual UINT    STDMETHODCALLTYPE GetContextFlags() = 0;                                            // 113
+  virtual HRESULT STDMETHODCALLTYPE FinishCommandList(BOOL RestoreDeferredContextState,
+    ID3D11CommandList** ppCommandList) = 0;                                                           // 114
+};
+
+
+/* Device */
+struct ID3D11Device : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE CreateBuffer(const D3D11_BUFFER_DESC* pDesc,
+    const D3D11_SUBRESOURCE_DATA* pInitialData, ID3D11Buffer** ppBuffer) = 0;                         //  3
+  virtual HRESULT STDMETHODCALLTYPE CreateTexture1D(const D3D11_TEXTURE1D_DESC* pDesc,
+    const D3D11_SUBRESOURCE_DATA* pInitialData, ID3D11Texture1D** ppTexture1D) = 0;                   //  4
+  virtual HRESULT STDMETHODCALLTYPE CreateTexture2D(const D3D11_TEXTURE2D_DESC* pDesc,
+    const D3D11_SUBRESOURCE_DATA* pInitialData, ID3D11Texture2D** ppTexture2D) = 0;                   //  5
+  virtual HRESULT STDMETHODCALLTYPE CreateTexture3D(const D3D11_TEXTURE3D_DESC* pDesc,
+    const D3D11_SUBRESOURCE_DATA* pInitialData, ID3D11Texture3D** ppTexture3D) = 0;                   //  6
+  D3D11_SHIM_SLOT(CreateShaderResourceView);
+  D3D11_SHIM_SLOT(CreateUnorderedAccessView);
+  D3D11_SHIM_SLOT(CreateRenderTargetView);
+  D3D11_SHIM_SLOT(CreateDepthStencilView);                                                            // 10
+  D3D11_SHIM_SLOT(CreateInputLayout);
+  D3D11_SHIM_SLOT(CreateVertexShader);
+  D3D11_SHIM_SLOT(CreateGeometryShader);
+  D3D11_SHIM_SLOT(CreateGeometryShaderWithStreamOutput);
+  D3D11_SHIM_SLOT(CreatePixelShader);
+  D3D11_SHIM_SLOT(CreateHullShader);
+  D3D11_SHIM_SLOT(CreateDomainShader);
+  D3D11_SHIM_SLOT(CreateComputeShader);
+  D3D11_SHIM_SLOT(CreateClassLinkage);
+  D3D11_SHIM_SLOT(CreateBlendState);                                                                  // 20
+  D3D11_SHIM_SLOT(CreateDepthStencilState);
+  D3D11_SHIM_SLOT(CreateRasterizerState);
+  D3D11_SHIM_SLOT(CreateSamplerState);
+  virtual HRESULT STDMETHODCALLTYPE CreateQuery(const D3D11_QUERY_DESC* pQueryDesc,
+    ID3D11Query** ppQuery) = 0;                                                                       // 24
+  D3D11_SHIM_SLOT(CreatePredicate);
+  D3D11_SHIM_SLOT(CreateCounter);
+  virtual HRESULT STDMETHODCALLTYPE CreateDeferredContext(UINT ContextFlags,
+    ID3D11DeviceContext** ppDeferredContext) = 0;                                                     // 27
+  D3D11_SHIM_SLOT(OpenSharedResource);
+  D3D11_SHIM_SLOT(CheckFormatSupport);
+  D3D11_SHIM_SLOT(CheckMultisampleQualityLevels);                                                     // 30
+  D3D11_SHIM_SLOT(CheckCounterInfo);
+  D3D11_SHIM_SLOT(CheckCounter);
+  D3D11_SHIM_SLOT(CheckFeatureSupport);
+  virtual HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* pDataSize, void* pData) = 0;   // 34
+  virtual HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT DataSize, const void* pData) = 0;
+  virtual HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* pData) = 0; // 36
+  virtual D3D_FEATURE_LEVEL STDMETHODCALLTYPE GetFeatureLevel() = 0;                                  // 37
+  virtual UINT    STDMETHODCALLTYPE GetCreationFlags() = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetDeviceRemovedReason() = 0;
+  virtual void    STDMETHODCALLTYPE GetImmediateContext(ID3D11DeviceContext** ppImmediateContext) = 0; // 40
+  virtual HRESULT STDMETHODCALLTYPE SetExceptionMode(UINT RaiseFlags) = 0;
+  virtual UINT    STDMETHODCALLTYPE GetExceptionMode() = 0;                                           // 42
+};
+
+
+__CRT_UUID_DECL(ID3D11DeviceChild,    0x1841e5c8, 0x16b0, 0x489b, 0xbc, 0xc8, 0x44, 0xcf, 0xb0, 0xd5, 0xde, 0xae)
+__CRT_UUID_DECL(ID3D11Resource,       0xdc8e63f3, 0xd12b, 0x4952, 0xb4, 0x7b, 0x5e, 0x45, 0x02, 0x6a, 0x86, 0x2d)
+__CRT_UUID_DECL(ID3D11Buffer,         0x48570b85, 0xd1ee, 0x4fcd, 0xa2, 0x50, 0xeb, 0x35, 0x07, 0x22, 0xb0, 0x37)
+__CRT_UUID_DECL(ID3D11Texture1D,      0xf8fb5c27, 0xc6b3, 0x4f75, 0xa4, 0xc8, 0x43, 0x9a, 0xf2, 0xef, 0x56, 0x4c)
+__CRT_UUID_DECL(ID3D11Texture2D,      0x6f15aaf2, 0xd208, 0x4e89, 0x9a, 0xb4, 0x48, 0x95, 0x35, 0xd3, 0x4f, 0x9c)
+__CRT_UUID_DECL(ID3D11Texture3D,      0x037e866e, 0xf56d, 0x4357, 0xa8, 0xaf, 0x9d, 0xab, 0xbe, 0x6e, 0x25, 0x0e)
+__CRT_UUID_DECL(ID3D11Asynchronous,   0x4b35d0cd, 0x1e15, 0x4258, 0x9c, 0x98, 0x1b, 0x13, 0x33, 0xf6, 0xdd, 0x3b)
+__CRT_UUID_DECL(ID3D11Query,          0xd6c00747, 0x87b7, 0x425e, 0xb8, 0x4d, 0x44, 0xd1, 0x08, 0x56, 0x0a, 0xfd)
+__CRT_UUID_DECL(ID3D11CommandList,    0xa24bc4d1, 0x769e, 0x43f7, 0x80, 0x13, 0x98, 0xff, 0x56, 0x6c, 0x18, 0xe2)
+__CRT_UUID_DECL(ID3D11DeviceContext,  0xc0bfa96c, 0xe089, 0x44fb, 0x8e, 0xaf, 0x26, 0xf8, 0x79, 0x61, 0x90, 0xda)
+__CRT_UUID_DECL(ID3D11Device,         0xdb6f6ddb, 0xac77, 0x4e88, 0x82, 0x53, 0x81, 0x9d, 0xf9, 0xbb, 0xf1, 0x40)
@@ -0,0 +1,44 @@
+#pragma once
+
+/**
+ * \brief Minimal D3D11.1 shim for native (non-Windows) builds
+ *
+ * Only declares \c ID3D11DeviceContext1, in vtable order
+ * like the interfaces in \c d3d11.h.
+ */
+
+#include <d3d11.h>
+
+typedef enum D3D11_COPY_FLAGS {
+  D3D11_COPY_NO_OVERWRITE = 0x1,
+  D3D11_COPY_DISCARD      = 0x2,
+} D3D11_COPY_FLAGS;
+
+struct ID3D11DeviceContext1 : public ID3D11DeviceContext {
+  virtual void    STDMETHODCALLTYPE CopySubresourceRegion1(ID3D11Resource* pDstResource,
+    UINT DstSubresource, UINT DstX, UINT DstY, UINT DstZ, ID3D11Resource* pSrcResource,
+    UINT SrcSubresource, const D3D11_BOX* pSrcBox, UINT CopyFlags) = 0;                               // 115
+  virtual void    STDMETHODCALLTYPE UpdateSubresource1(ID3D11Resource* pDstResource,
+    UINT DstSubresource, const D3D11_BOX* pDstBox, const void* pSrcData,
+    UINT SrcRowPitch, UINT SrcDepthPitch, UINT CopyFlags) = 0;                                        // 116
+  virtual void    STDMETHODCALLTYPE DiscardResource(ID3D11Resource* pResource) = 0;                  // 117
+  D3D11_SHIM_SLOT(DiscardView);
+  D3D11_SHIM_SLOT(VSSetConstantBuffers1);
+  D3D11_SHIM_SLOT(HSSetConstantBuffers1);                                                             // 120
+  D3D11_SHIM_SLOT(DSSetConstantBuffers1);
+  D3D11_SHIM_SLOT(GSSetConstantBuffers1);
+  D3D11_SHIM_SLOT(PSSetConstantBuffers1);
+  D3D11_SHIM_SLOT(CSSetConstantBuffers1);
+  D3D11_SHIM_SLOT(VSGetConstantBuffers1);
+  D3D11_SHIM_SLOT(HSGetConstantBuffers1);
+  D3D11_SHIM_SLOT(DSGetConstantBuffers1);
+  D3D11_SHIM_SLOT(GSGetConstantBuffers1);
+  D3D11_SHIM_SLOT(PSGetConstantBuffers1);
+  D3D11_SHIM_SLOT(CSGetConstantBuffers1);                                                             // 130
+  D3D11_SHIM_SLOT(SwapDeviceContextState);
+  D3D11_SHIM_SLOT(ClearView);
+  D3D11_SHIM_SLOT(DiscardView1);                                                                      // 133
+};
+
+
+__CRT_UUID_DECL(ID3D11DeviceContext1, 0xbb2c6faa, 0xb5fb, 0x4082, 0x8e, 0x6b, 0x38, 0x8b, 0x8c, 0xfa, 0x90, 0xe1)
@@ -0,0 +1,56 @@
+#pragma once
+
+/**
+ * \brief Minimal DXGI shim for native (non-Windows) builds
+ *
+ * Only declares the types that the D3D11 shim and the hook
+ * code refer to. Format values match dxgiformat.h.
+ */
+
+#include <windows.h>
+
+#define DXGI_ERROR_INVALID_CALL      ((HRESULT)0x887A0001)
+#define DXGI_ERROR_NOT_FOUND         ((HRESULT)0x887A0002)
+#define DXGI_ERROR_MORE_DATA         ((HRESULT)0x887A0003)
+#define DXGI_ERROR_WAS_STILL_DRAWING ((HRESULT)0x887A000A)
+
+typedef enum DXGI_FORMAT {
+  DXGI_FORMAT_UNKNOWN                 = 0,
+  DXGI_FORMAT_R32G32B32A32_TYPELESS   = 1,
+  DXGI_FORMAT_R32G32B32A32_FLOAT      = 2,
+  DXGI_FORMAT_R32G32B32_FLOAT         = 6,
+  DXGI_FORMAT_R16G16B16A16_TYPELESS   = 9,
+  DXGI_FORMAT_R16G16B16A16_FLOAT      = 10,
+  DXGI_FORMAT_R32G32_FLOAT            = 16,
+  DXGI_FORMAT_R8G8B8A8_TYPELESS       = 27,
+  DXGI_FORMAT_R8G8B8A8_UNORM          = 28,
+  DXGI_FORMAT_R8G8B8A8_UNORM_SRGB     = 29,
+  DXGI_FORMAT_R16G16_FLOAT            = 34,
+  DXGI_FORMAT_R32_TYPELESS            = 39,
+  DXGI_FORMAT_D32_FLOAT               = 40,
+  DXGI_FORMAT_R32_FLOAT               = 41,
+  DXGI_FORMAT_R32_UINT                = 42,
+  DXGI_FORMAT_R8G8_UNORM              = 49,
+  DXGI_FORMAT_R16_FLOAT               = 54,
+  DXGI_FORMAT_R16_UNORM               = 56,
+  DXGI_FORMAT_R8_UNORM                = 61,
+  DXGI_FORMAT_A8_UNORM                = 65,
+  DXGI_FORMAT_BC1_UNORM               = 71,
+  DXGI_FORMAT_BC3_UNORM               = 77,
+  DXGI_FORMAT_B8G8R8A8_UNORM          = 87,
+  DXGI_FORMAT_B8G8R8X8_UNORM          = 88,
+  DXGI_FORMAT_B8G8R8A8_TYPELESS       = 90,
+  DXGI_FORMAT_B8G8R8A8_UNORM_SRGB     = 91,
+  DXGI_FORMAT_B8G8R8X8_TYPELESS       = 92,
+  DXGI_FORMAT_B8G8R8X8_UNORM_SRGB     = 93,
+  DXGI_FORMAT_FORCE_UINT              = 0xffffffff,
+} DXGI_FORMAT;
+
+typedef struct DXGI_SAMPLE_DESC {
+  UINT Count;
+  UINT Quality;
+} DXGI_SAMPLE_DESC;
+
+struct IDXGIAdapter;
+struct IDXGISwapChain;
+struct DXGI_SWAP_CHAIN_DESC;
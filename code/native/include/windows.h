@@ -0,0 +1,204 @@
+#pragma once
+
+/**
+ * \brief Minimal Win32 shim for native (non-Windows) builds
+ *
+ * Provides just enough of the Win32 API surface for the hook code
+ * in impl.cpp and trace.cpp to compile against the mock device on
+ * Linux. Synchronization primitives are backed by pthreads, virtual
+ * memory by mmap and vectored exception handlers by a SIGSEGV
+ * handler, see win32.cpp for the implementations.
+ */
+
+#include <pthread.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#define WINAPI
+#define CALLBACK
+#define STDMETHODCALLTYPE
+#define __stdcall
+
+#ifndef __declspec
+#define __declspec(x)
+#endif
+
+#define VOID void
+
+#define TRUE  1
+#define FALSE 0
+
+#define MAX_PATH 260
+#define INFINITE 0xffffffffu
+
+typedef uint8_t   BYTE;
+typedef uint16_t  WORD;
+typedef uint32_t  DWORD;
+typedef int32_t   INT;
+typedef uint32_t  UINT;
+typedef int32_t   LONG;
+typedef uint32_t  ULONG;
+typedef int64_t   LONGLONG;
+typedef uint64_t  ULONGLONG;
+typedef int       BOOL;
+typedef uint8_t   BOOLEAN;
+typedef int16_t   SHORT;
+typedef float     FLOAT;
+typedef size_t    SIZE_T;
+typedef uintptr_t ULONG_PTR;
+typedef int32_t   HRESULT;
+typedef DWORD*    PDWORD;
+
+typedef void*       PVOID;
+typedef void*       LPVOID;
+typedef const void* LPCVOID;
+typedef char*       LPSTR;
+typedef const char* LPCSTR;
+typedef const wchar_t* LPCWSTR;
+
+typedef void* HANDLE;
+typedef void* HMODULE;
+typedef void* HINSTANCE;
+typedef void* HWND;
+
+#define S_OK            ((HRESULT)0x00000000)
+#define S_FALSE         ((HRESULT)0x00000001)
+#define E_NOTIMPL       ((HRESULT)0x80004001)
+#define E_NOINTERFACE   ((HRESULT)0x80004002)
+#define E_POINTER       ((HRESULT)0x80004003)
+#define E_FAIL          ((HRESULT)0x80004005)
+#define E_OUTOFMEMORY   ((HRESULT)0x8007000E)
+#define E_INVALIDARG    ((HRESULT)0x80070057)
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)    (((HRESULT)(hr)) < 0)
+
+typedef union _LARGE_INTEGER {
+  struct {
+    DWORD LowPart;
+    LONG  HighPart;
+  };
+  LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+
+/* GUIDs and interface IDs */
+typedef struct _GUID {
+  uint32_t Data1;
+  uint16_t Data2;
+  uint16_t Data3;
+  uint8_t  Data4[8];
+} GUID;
+
+typedef GUID IID;
+typedef const GUID& REFGUID;
+typedef const IID&  REFIID;
+
+inline bool operator == (const GUID& a, const GUID& b) {
+  return !std::memcmp(&a, &b, sizeof(GUID));
+}
+
+inline bool operator != (const GUID& a, const GUID& b) {
+  return !(a == b);
+}
+
+template<typename T>
+const GUID& __mingw_uuidof();
+
+#define __CRT_UUID_DECL(type, l, w1, w2, b1, b2, b3, b4, b5, b6, b7, b8) \
+  template<> inline const GUID& __mingw_uuidof<type>() {                  \
+    static const GUID guid = { l, w1, w2, { b1, b2, b3, b4, b5, b6, b7, b8 } }; \
+    return guid;                                                          \
+  }
+
+#define __uuidof(type) __mingw_uuidof<__typeof__(type)>()
+
+#define IID_PPV_ARGS(pp) __uuidof(**(pp)), reinterpret_cast<void**>(pp)
+
+
+/* IUnknown */
+struct IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) = 0;
+  virtual ULONG   STDMETHODCALLTYPE AddRef() = 0;
+  virtual ULONG   STDMETHODCALLTYPE Release() = 0;
+};
+
+__CRT_UUID_DECL(IUnknown, 0x00000000, 0x0000, 0x0000, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46)
+
+
+/* Synchronization */
+typedef struct _RTL_SRWLOCK {
+  pthread_mutex_t Mutex;
+} SRWLOCK, *PSRWLOCK;
+
+#define SRWLOCK_INIT { PTHREAD_MUTEX_INITIALIZER }
+
+typedef struct _RTL_CRITICAL_SECTION {
+  pthread_mutex_t Mutex;
+} CRITICAL_SECTION, *PCRITICAL_SECTION, *LPCRITICAL_SECTION;
+
+typedef struct _RTL_CONDITION_VARIABLE {
+  pthread_cond_t Cond;
+} CONDITION_VARIABLE, *PCONDITION_VARIABLE;
+
+void    AcquireSRWLockExclusive(PSRWLOCK lock);
+void    ReleaseSRWLockExclusive(PSRWLOCK lock);
+BOOLEAN TryAcquireSRWLockExclusive(PSRWLOCK lock);
+
+void    InitializeCriticalSection(LPCRITICAL_SECTION cs);
+void    DeleteCriticalSection(LPCRITICAL_SECTION cs);
+void    EnterCriticalSection(LPCRITICAL_SECTION cs);
+void    LeaveCriticalSection(LPCRITICAL_SECTION cs);
+BOOL    TryEnterCriticalSection(LPCRITICAL_SECTION cs);
+
+void    InitializeConditionVariable(PCONDITION_VARIABLE cond);
+void    WakeConditionVariable(PCONDITION_VARIABLE cond);
+void    WakeAllConditionVariable(PCONDITION_VARIABLE cond);
+BOOL    SleepConditionVariableSRW(PCONDITION_VARIABLE cond, PSRWLOCK lock, DWORD ms, ULONG flags);
+
+
+/* Virtual memory */
+#define MEM_COMMIT      0x00001000u
+#define MEM_RESERVE     0x00002000u
+#define MEM_RELEASE     0x00008000u
+
+#define PAGE_NOACCESS   0x01u
+#define PAGE_READONLY   0x02u
+#define PAGE_READWRITE  0x04u
+
+LPVOID  VirtualAlloc(LPVOID address, SIZE_T size, DWORD type, DWORD protect);
+BOOL    VirtualFree(LPVOID address, SIZE_T size, DWORD type);
+BOOL    VirtualProtect(LPVOID address, SIZE_T size, DWORD protect, PDWORD oldProtect);
+
+
+/* Exceptions. Only access violations are reported, as SIGSEGV. */
+#define EXCEPTION_ACCESS_VIOLATION    ((DWORD)0xC0000005)
+#define EXCEPTION_MAXIMUM_PARAMETERS  15
+
+#define EXCEPTION_CONTINUE_EXECUTION  (-1)
+#define EXCEPTION_CONTINUE_SEARCH     0
+
+typedef struct _EXCEPTION_RECORD {
+  DWORD     ExceptionCode;
+  DWORD     ExceptionFlags;
+  struct _EXCEPTION_RECORD* ExceptionRecord;
+  PVOID     ExceptionAddress;
+  DWORD     NumberParameters;
+  ULONG_PTR ExceptionInformation[EXCEPTION_MAXIMUM_PARAMETERS];
+} EXCEPTION_RECORD, *PEXCEPTION_RECORD;
+
+typedef struct _EXCEPTION_POINTERS {
+  PEXCEPTION_RECORD ExceptionRecord;
+  PVOID             ContextRecord;
+} EXCEPTION_POINTERS, *PEXCEPTION_POINTERS;
+
+typedef LONG (WINAPI *PVECTORED_EXCEPTION_HANDLER)(PEXCEPTION_POINTERS);
+
+PVOID   AddVectoredExceptionHandler(ULONG first, PVECTORED_EXCEPTION_HANDLER handler);
+ULONG   RemoveVectoredExceptionHandler(PVOID handle);
+
+
+/* Input. There is no keyboard in native builds, so no key is ever pressed. */
+SHORT   GetAsyncKeyState(int vkey);
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "../minhook/include/MinHook.h"
+
+#include "minhook_shim.h"
+
+/**
+ * \brief MinHook replacement for native builds
+ *
+ * Real MinHook patches the prologue of the target function. Native
+ * builds only ever hook the mock device, whose vtables are writable
+ * and registered here, so hooks are applied by swapping every vtable
+ * slot that points to the target. This has the same effect as the
+ * inline patch: all objects sharing the implementation are hooked.
+ */
+namespace {
+
+struct HookEntry {
+  void* target  = nullptr;
+  void* detour  = nullptr;
+  bool  enabled = false;
+};
+
+struct VtableEntry {
+  void** slots  = nullptr;
+  size_t count  = 0;
+};
+
+std::mutex                g_mutex;
+bool                      g_initialized = false;
+std::vector<HookEntry>    g_hooks;
+std::vector<VtableEntry>  g_vtables;
+
+HookEntry* findHook(void* pTarget) {
+  auto entry = std::find_if(g_hooks.begin(), g_hooks.end(),
+    [pTarget] (const HookEntry& e) { return e.target == pTarget; });
+  return entry != g_hooks.end() ? &(*entry) : nullptr;
+}
+
+void patchSlots(void* pFrom, void* pTo) {
+  for (const auto& vtbl : g_vtables) {
+    for (size_t i = 0; i < vtbl.count; i++) {
+      if (vtbl.slots[i] == pFrom)
+        vtbl.slots[i] = pTo;
+    }
+  }
+}
+
+}
+
+namespace atfix::shim {
+
+void registerHookableVtable(void** pSlots, size_t count) {
+  std::lock_guard lock(g_mutex);
+  g_vtables.push_back({ pSlots, count });
+
+  /* Objects created after hooking must see enabled hooks as well */
+  for (const auto& hook : g_hooks) {
+    if (hook.enabled) {
+      for (size_t i = 0; i < count; i++) {
+        if (pSlots[i] == hook.target)
+          pSlots[i] = hook.detour;
+      }
+    }
+  }
+}
+
+}
+
+extern "C" {
+
+MH_STATUS WINAPI MH_Initialize(VOID) {
+  std::lock_guard lock(g_mutex);
+
+  if (g_initialized)
+    return MH_ERROR_ALREADY_INITIALIZED;
+
+  g_initialized = true;
+  return MH_OK;
+}
+
+MH_STATUS WINAPI MH_Uninitialize(VOID) {
+  std::lock_guard lock(g_mutex);
+
+  if (!g_initialized)
+    return MH_ERROR_NOT_INITIALIZED;
+
+  for (const auto& hook : g_hooks) {
+    if (hook.enabled)
+      patchSlots(hook.detour, hook.target);
+  }
+
+  g_hooks.clear();
+  g_initialized = false;
+  return MH_OK;
+}
+
+MH_STATUS WINAPI MH_CreateHook(LPVOID pTarget, LPVOID pDetour, LPVOID* ppOriginal) {
+  std::lock_guard lock(g_mutex);
+
+  if (!g_initialized)
+    return MH_ERROR_NOT_INITIALIZED;
+
+  if (findHook(pTarget))
+    return MH_ERROR_ALREADY_CREATED;
+
+  g_hooks.push_back({ pTarget, pDetour, false });
+
+  /* Slots are swapped rather than patched, so the
+   * original function remains directly callable */
+  if (ppOriginal)
+    *ppOriginal = pTarget;
+
+  return MH_OK;
+}
+
+MH_STATUS WINAPI MH_RemoveHook(LPVOID pTarget) {
+  std::lock_guard lock(g_mutex);
+  HookEntry* hook = findHook(pTarget);
+
+  if (!hook)
+    return MH_ERROR_NOT_CREATED;
+
+  if (hook->enabled)
+    patchSlots(hook->detour, hook->target);
+
+  g_hooks.erase(g_hooks.begin() + (hook - g_hooks.data()));
+  return MH_OK;
+}
+
+MH_STATUS WINAPI MH_EnableHook(LPVOID pTarget) {
+  std::lock_guard lock(g_mutex);
+  HookEntry* hook = findHook(pTarget);
+
+  if (!hook)
+    return MH_ERROR_NOT_CREATED;
+
+  if (hook->enabled)
+    return MH_ERROR_ENABLED;
+
+  patchSlots(hook->target, hook->detour);
+  hook->enabled = true;
+  return MH_OK;
+}
+
+MH_STATUS WINAPI MH_DisableHook(LPVOID pTarget) {
+  std::lock_guard lock(g_mutex);
+  HookEntry* hook = findHook(pTarget);
+
+  if (!hook)
+    return MH_ERROR_NOT_CREATED;
+
+  if (!hook->enabled)
+    return MH_ERROR_DISABLED;
+
+  patchSlots(hook->detour, hook->target);
+  hook->enabled = false;
+  return MH_OK;
+}
+
+const char* WINAPI MH_StatusToString(MH_STATUS status) {
+  switch (status) {
+    case MH_UNKNOWN:                    return "MH_UNKNOWN";
+    case MH_OK:                         return "MH_OK";
+    case MH_ERROR_ALREADY_INITIALIZED:  return "MH_ERROR_ALREADY_INITIALIZED";
+    case MH_ERROR_NOT_INITIALIZED:      return "MH_ERROR_NOT_INITIALIZED";
+    case MH_ERROR_ALREADY_CREATED:      return "MH_ERROR_ALREADY_CREATED";
+    case MH_ERROR_NOT_CREATED:          return "MH_ERROR_NOT_CREATED";
+    case MH_ERROR_ENABLED:              return "MH_ERROR_ENABLED";
+    case MH_ERROR_DISABLED:             return "MH_ERROR_DISABLED";
+    default:                            return "(unknown)";
+  }
+}
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+
+namespace atfix::shim {
+
+/**
+ * \brief Registers a writable vtable with the MinHook shim
+ *
+ * Native builds cannot patch function prologues, so hooks
+ * are installed by swapping the matching slots of every
+ * registered vtable instead.
+ * \param [in] pSlots Pointer to the first vtable slot
+ * \param [in] count Number of slots in the vtable
+ */
+void registerHookableVtable(void** pSlots, size_t count);
+
+}
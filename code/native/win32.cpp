@@ -0,0 +1,231 @@
+#include <windows.h>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+#include <atomic>
+#include <cerrno>
+#include <ctime>
+#include <map>
+#include <mutex>
+
+/** Win32 synchronization primitives on top of pthreads */
+
+void AcquireSRWLockExclusive(PSRWLOCK lock) {
+  pthread_mutex_lock(&lock->Mutex);
+}
+
+void ReleaseSRWLockExclusive(PSRWLOCK lock) {
+  pthread_mutex_unlock(&lock->Mutex);
+}
+
+BOOLEAN TryAcquireSRWLockExclusive(PSRWLOCK lock) {
+  return pthread_mutex_trylock(&lock->Mutex) == 0;
+}
+
+void InitializeCriticalSection(LPCRITICAL_SECTION cs) {
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&cs->Mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+void DeleteCriticalSection(LPCRITICAL_SECTION cs) {
+  pthread_mutex_destroy(&cs->Mutex);
+}
+
+void EnterCriticalSection(LPCRITICAL_SECTION cs) {
+  pthread_mutex_lock(&cs->Mutex);
+}
+
+void LeaveCriticalSection(LPCRITICAL_SECTION cs) {
+  pthread_mutex_unlock(&cs->Mutex);
+}
+
+BOOL TryEnterCriticalSection(LPCRITICAL_SECTION cs) {
+  return pthread_mutex_trylock(&cs->Mutex) == 0;
+}
+
+void InitializeConditionVariable(PCONDITION_VARIABLE cond) {
+  pthread_cond_init(&cond->Cond, nullptr);
+}
+
+void WakeConditionVariable(PCONDITION_VARIABLE cond) {
+  pthread_cond_signal(&cond->Cond);
+}
+
+void WakeAllConditionVariable(PCONDITION_VARIABLE cond) {
+  pthread_cond_broadcast(&cond->Cond);
+}
+
+BOOL SleepConditionVariableSRW(PCONDITION_VARIABLE cond, PSRWLOCK lock, DWORD ms, ULONG flags) {
+  if (ms == INFINITE)
+    return pthread_cond_wait(&cond->Cond, &lock->Mutex) == 0;
+
+  timespec deadline = { };
+  clock_gettime(CLOCK_REALTIME, &deadline);
+
+  deadline.tv_sec  += ms / 1000;
+  deadline.tv_nsec += long(ms % 1000) * 1000000l;
+
+  if (deadline.tv_nsec >= 1000000000l) {
+    deadline.tv_sec  += 1;
+    deadline.tv_nsec -= 1000000000l;
+  }
+
+  return pthread_cond_timedwait(&cond->Cond, &lock->Mutex, &deadline) == 0;
+}
+
+
+/** Virtual memory on top of mmap. VirtualFree needs the size of
+ *  the allocation, which Win32 does not pass, so it is recorded. */
+
+static std::mutex               g_allocMutex;
+static std::map<void*, size_t>  g_allocSizes;
+
+static int getProtection(DWORD protect) {
+  switch (protect) {
+    case PAGE_NOACCESS: return PROT_NONE;
+    case PAGE_READONLY: return PROT_READ;
+    default:            return PROT_READ | PROT_WRITE;
+  }
+}
+
+LPVOID VirtualAlloc(LPVOID address, SIZE_T size, DWORD type, DWORD protect) {
+  // Placement and reserve-only allocations are not supported
+  if (address || !(type & MEM_COMMIT))
+    return nullptr;
+
+  void* result = mmap(nullptr, size, getProtection(protect), MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (result == MAP_FAILED)
+    return nullptr;
+
+  std::lock_guard lock(g_allocMutex);
+  g_allocSizes.emplace(result, size);
+  return result;
+}
+
+BOOL VirtualFree(LPVOID address, SIZE_T size, DWORD type) {
+  if (type != MEM_RELEASE)
+    return FALSE;
+
+  std::lock_guard lock(g_allocMutex);
+  auto entry = g_allocSizes.find(address);
+
+  if (entry == g_allocSizes.end())
+    return FALSE;
+
+  munmap(entry->first, entry->second);
+  g_allocSizes.erase(entry);
+  return TRUE;
+}
+
+BOOL VirtualProtect(LPVOID address, SIZE_T size, DWORD protect, PDWORD oldProtect) {
+  // Previous protection is not tracked
+  if (oldProtect)
+    *oldProtect = PAGE_READWRITE;
+
+  return mprotect(address, size, getProtection(protect)) == 0;
+}
+
+
+/** Vectored exception handlers on top of a SIGSEGV handler. The
+ *  handler list is read from the signal handler, so it is a fixed
+ *  array of atomics rather than a locked container. */
+
+constexpr size_t MaxExceptionHandlers = 16;
+
+static std::mutex                               g_handlerMutex;
+static std::atomic<PVECTORED_EXCEPTION_HANDLER> g_handlers[MaxExceptionHandlers];
+static struct sigaction                         g_prevSegvAction;
+static bool                                     g_segvInstalled = false;
+
+static bool isWriteFault(void* context) {
+#if defined(__x86_64__)
+  // Bit 1 of the page fault error code is set for writes
+  auto uc = static_cast<ucontext_t*>(context);
+  return uc->uc_mcontext.gregs[REG_ERR] & 0x2;
+#else
+  return true;
+#endif
+}
+
+static void handleSegv(int sig, siginfo_t* info, void* context) {
+  EXCEPTION_RECORD record = { };
+  record.ExceptionCode = EXCEPTION_ACCESS_VIOLATION;
+  record.NumberParameters = 2;
+  record.ExceptionInformation[0] = isWriteFault(context) ? 1 : 0;
+  record.ExceptionInformation[1] = ULONG_PTR(info->si_addr);
+
+  EXCEPTION_POINTERS pointers = { &record, context };
+
+  for (auto& entry : g_handlers) {
+    PVECTORED_EXCEPTION_HANDLER handler = entry.load();
+
+    if (handler && handler(&pointers) == EXCEPTION_CONTINUE_EXECUTION)
+      return;
+  }
+
+  // Unhandled, restore the previous action so that
+  // the faulting instruction crashes as it would have
+  sigaction(SIGSEGV, &g_prevSegvAction, nullptr);
+}
+
+PVOID AddVectoredExceptionHandler(ULONG first, PVECTORED_EXCEPTION_HANDLER handler) {
+  std::lock_guard lock(g_handlerMutex);
+
+  if (!g_segvInstalled) {
+    struct sigaction action = { };
+    action.sa_sigaction = &handleSegv;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGSEGV, &action, &g_prevSegvAction))
+      return nullptr;
+
+    g_segvInstalled = true;
+  }
+
+  size_t count = 0;
+
+  while (count < MaxExceptionHandlers && g_handlers[count].load())
+    count += 1;
+
+  if (count == MaxExceptionHandlers)
+    return nullptr;
+
+  size_t index = first ? 0 : count;
+
+  for (size_t i = count; i > index; i--)
+    g_handlers[i].store(g_handlers[i - 1].load());
+
+  g_handlers[index].store(handler);
+  return reinterpret_cast<PVOID>(handler);
+}
+
+ULONG RemoveVectoredExceptionHandler(PVOID handle) {
+  std::lock_guard lock(g_handlerMutex);
+
+  for (size_t i = 0; i < MaxExceptionHandlers; i++) {
+    if (reinterpret_cast<PVOID>(g_handlers[i].load()) != handle)
+      continue;
+
+    for (size_t j = i; j + 1 < MaxExceptionHandlers; j++)
+      g_handlers[j].store(g_handlers[j + 1].load());
+
+    g_handlers[MaxExceptionHandlers - 1].store(nullptr);
+    return 1;
+  }
+
+  return 0;
+}
+
+
+/** Input */
+
+SHORT GetAsyncKeyState(int vkey) {
+  return 0;
+}
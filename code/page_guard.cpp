@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <vector>
+
+#include "page_guard.h"
+#include "util.h"
+
+namespace atfix {
+
+/** Armed buffers, searched by the exception handler */
+static mutex                        g_guardMutex;
+static std::vector<GuardedBuffer*>  g_guardedBuffers;
+static PVOID                        g_guardHandler = nullptr;
+
+GuardedBuffer::GuardedBuffer(size_t size)
+: m_pageCount((size + PageSize - 1) / PageSize) {
+  m_base = static_cast<uint8_t*>(VirtualAlloc(nullptr,
+    m_pageCount * PageSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+
+  if (!m_base) {
+    log("Failed to allocate ", m_pageCount * PageSize, " bytes of guarded memory");
+    m_pageCount = 0;
+  }
+
+  m_touched = std::make_unique<std::atomic<bool>[]>(m_pageCount);
+}
+
+
+GuardedBuffer::~GuardedBuffer() {
+  { std::lock_guard lock(g_guardMutex);
+    g_guardedBuffers.erase(std::remove(g_guardedBuffers.begin(),
+      g_guardedBuffers.end(), this), g_guardedBuffers.end());
+  }
+
+  if (m_base)
+    VirtualFree(m_base, 0, MEM_RELEASE);
+}
+
+
+bool GuardedBuffer::arm(bool guardReads, size_t spanPages) {
+  if (!m_base)
+    return false;
+
+  std::lock_guard lock(g_guardMutex);
+
+  if (!g_guardHandler) {
+    g_guardHandler = AddVectoredExceptionHandler(1, &handleException);
+
+    if (!g_guardHandler) {
+      log("Failed to install page guard exception handler");
+      return false;
+    }
+  }
+
+  DWORD oldProtect = 0;
+
+  if (!VirtualProtect(m_base, size(), guardReads ? PAGE_NOACCESS : PAGE_READONLY, &oldProtect))
+    return false;
+
+  for (size_t i = 0; i < m_pageCount; i++)
+    m_touched[i].store(false, std::memory_order_relaxed);
+
+  m_faults.store(0u, std::memory_order_relaxed);
+  m_guardReads = guardReads;
+  m_spanPages = std::max<size_t>(spanPages, 1u);
+
+  if (!m_armed)
+    g_guardedBuffers.push_back(this);
+
+  m_armed = true;
+  return true;
+}
+
+
+void GuardedBuffer::disarm() {
+  std::lock_guard lock(g_guardMutex);
+
+  if (!m_armed)
+    return;
+
+  g_guardedBuffers.erase(std::remove(g_guardedBuffers.begin(),
+    g_guardedBuffers.end(), this), g_guardedBuffers.end());
+
+  DWORD oldProtect = 0;
+  VirtualProtect(m_base, size(), PAGE_READWRITE, &oldProtect);
+
+  m_armed = false;
+}
+
+
+bool GuardedBuffer::handleFault(const uint8_t* pAddress, bool isWrite) {
+  if (!isWrite && !m_guardReads)
+    return false;
+
+  size_t firstPage = size_t(pAddress - m_base) / PageSize;
+  size_t pageCount = std::min(m_spanPages, m_pageCount - firstPage);
+
+  DWORD oldProtect = 0;
+
+  if (!VirtualProtect(m_base + firstPage * PageSize,
+      pageCount * PageSize, PAGE_READWRITE, &oldProtect))
+    return false;
+
+  for (size_t i = 0; i < pageCount; i++)
+    m_touched[firstPage + i].store(true, std::memory_order_relaxed);
+
+  m_faults.fetch_add(1u, std::memory_order_relaxed);
+  return true;
+}
+
+
+LONG WINAPI GuardedBuffer::handleException(PEXCEPTION_POINTERS pPointers) {
+  const EXCEPTION_RECORD* record = pPointers->ExceptionRecord;
+
+  // Only reads and writes can come from a guarded page
+  if (record->ExceptionCode != EXCEPTION_ACCESS_VIOLATION
+   || record->NumberParameters < 2 || record->ExceptionInformation[0] > 1)
+    return EXCEPTION_CONTINUE_SEARCH;
+
+  auto address = reinterpret_cast<const uint8_t*>(record->ExceptionInformation[1]);
+  bool isWrite = record->ExceptionInformation[0] == 1;
+
+  std::lock_guard lock(g_guardMutex);
+
+  for (GuardedBuffer* buffer : g_guardedBuffers) {
+    if (address < buffer->m_base || address >= buffer->m_base + buffer->size())
+      continue;
+
+    return buffer->handleFault(address, isWrite)
+      ? EXCEPTION_CONTINUE_EXECUTION
+      : EXCEPTION_CONTINUE_SEARCH;
+  }
+
+  return EXCEPTION_CONTINUE_SEARCH;
+}
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "impl.h"
+
+namespace atfix {
+
+/**
+ * \brief Page-aligned buffer that records accesses
+ *
+ * While armed, the pages of the buffer are protected, so that
+ * the first access to a page faults. A vectored exception handler
+ * shared by all guarded buffers then lifts the protection from
+ * that page and a number of following ones, and marks them as
+ * touched. Write guards leave pages readable, read guards fault
+ * on any access.
+ *
+ * Thread-safe, except that a buffer must not be accessed by the
+ * game while it is being armed or disarmed.
+ */
+class GuardedBuffer {
+
+public:
+
+  static constexpr size_t PageSize = 4096;
+
+  /**
+   * \brief Allocates a buffer
+   *
+   * \param [in] size Size in bytes, rounded up to pages
+   */
+  explicit GuardedBuffer(size_t size);
+
+  ~GuardedBuffer();
+
+  GuardedBuffer(const GuardedBuffer&) = delete;
+  GuardedBuffer& operator = (const GuardedBuffer&) = delete;
+
+  bool isValid() const {
+    return m_base != nullptr;
+  }
+
+  uint8_t* data() const {
+    return m_base;
+  }
+
+  size_t size() const {
+    return m_pageCount * PageSize;
+  }
+
+  size_t getPageCount() const {
+    return m_pageCount;
+  }
+
+  /**
+   * \brief Protects all pages and clears access records
+   *
+   * \param [in] guardReads Fault on reads as well as writes
+   * \param [in] spanPages Pages unprotected per fault
+   * \returns \c true on success
+   */
+  bool arm(bool guardReads, size_t spanPages);
+
+  /**
+   * \brief Stops recording and makes all pages writable
+   *
+   * Access records are kept until the next \c arm.
+   */
+  void disarm();
+
+  /**
+   * \brief Checks whether a page was accessed while armed
+   */
+  bool isTouched(size_t page) const {
+    return m_touched[page].load(std::memory_order_relaxed);
+  }
+
+  /**
+   * \brief Number of faults taken since the buffer was armed
+   */
+  uint32_t getFaultCount() const {
+    return m_faults.load(std::memory_order_relaxed);
+  }
+
+private:
+
+  uint8_t*                              m_base      = nullptr;
+  size_t                                m_pageCount = 0;
+
+  bool                                  m_armed       = false;
+  bool                                  m_guardReads  = false;
+  size_t                                m_spanPages   = 1;
+
+  std::unique_ptr<std::atomic<bool>[]>  m_touched;
+  std::atomic<uint32_t>                 m_faults = { 0u };
+
+  bool handleFault(const uint8_t* pAddress, bool isWrite);
+
+  static LONG WINAPI handleException(PEXCEPTION_POINTERS pPointers);
+
+};
+
+}
@@ -0,0 +1,107 @@
+#include <cctype>
+#include <cstring>
+#include <iterator>
+
+#include "profile.h"
+
+namespace atfix {
+
+/** Arland DX games read glyphs back from 512x512 DYNAMIC textures
+ *  through STAGING copies. Unlike the built-in rules, nothing else is
+ *  matched, so other readbacks are never hashed or cached and only
+ *  glyph copies keep their flushes while coalescing. */
+static const char g_arlandRules[] =
+  "[glyph-upload]\n"
+  "call = map\n"
+  "map = WRITE_DISCARD\n"
+  "usage = DYNAMIC\n"
+  "width = 512\n"
+  "height = 512\n"
+  "format = 90\n"
+  "actions = trace, shadow, cache\n"
+  "\n"
+  "[glyph-readback]\n"
+  "call = map\n"
+  "map = READ\n"
+  "usage = STAGING\n"
+  "width = 512\n"
+  "height = 512\n"
+  "format = 90\n"
+  "actions = trace, cache, profile\n"
+  "\n"
+  "[glyph-copy]\n"
+  "call = copy\n"
+  "src.usage = DYNAMIC\n"
+  "src.width = 512\n"
+  "src.height = 512\n"
+  "src.format = 90\n"
+  "dst.usage = STAGING\n"
+  "dst.width = 512\n"
+  "dst.height = 512\n"
+  "dst.format = 90\n"
+  "actions = trace, cache, profile, flush\n";
+
+/** Profiles in match order, the last one matches anything.
+ *  Speculation, dirty tracking and flush coalescing stay
+ *  opt-in until they are proven. */
+static const GameProfile g_gameProfiles[] = {
+  { "meruru-dx",  "A13V_",  0u, 0u, g_arlandRules, nullptr },
+  { "default",    nullptr,  0u, 0u, nullptr,       nullptr },
+};
+
+static ExecutableIdentity g_executableIdentity;
+
+
+static bool matchesPrefix(const std::string& str, const char* pPrefix) {
+  size_t length = std::strlen(pPrefix);
+
+  if (str.size() < length)
+    return false;
+
+  for (size_t i = 0; i < length; i++) {
+    if (std::tolower(uint8_t(str[i])) != std::tolower(uint8_t(pPrefix[i])))
+      return false;
+  }
+
+  return true;
+}
+
+
+static bool matchesProfile(const ExecutableIdentity& identity, const GameProfile& profile) {
+  if (profile.modulePrefix && !matchesPrefix(identity.moduleName, profile.modulePrefix))
+    return false;
+
+  if (profile.timestamp && profile.timestamp != identity.timestamp)
+    return false;
+
+  if (profile.checksum && profile.checksum != identity.checksum)
+    return false;
+
+  return true;
+}
+
+
+void setExecutableIdentity(const ExecutableIdentity& identity) {
+  g_executableIdentity = identity;
+}
+
+
+const ExecutableIdentity& getExecutableIdentity() {
+  return g_executableIdentity;
+}
+
+
+const GameProfile& selectGameProfile(const ExecutableIdentity& identity, const char* pName) {
+  for (const auto& profile : g_gameProfiles) {
+    bool isMatch = pName
+      ? !std::strcmp(pName, profile.name)
+      : matchesProfile(identity, profile);
+
+    if (isMatch)
+      return profile;
+  }
+
+  return g_gameProfiles[std::size(g_gameProfiles) - 1];
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "config.h"
+
+namespace atfix {
+
+/**
+ * \brief Identity of the host executable
+ *
+ * Taken from the module the DLL was loaded into. The PE
+ * timestamp and checksum tell game patches apart.
+ */
+struct ExecutableIdentity {
+  /** File name without directory, e.g. \c A13V_x64_Release_en.exe */
+  std::string moduleName;
+  uint32_t    timestamp = 0;
+  uint32_t    checksum  = 0;
+};
+
+/**
+ * \brief Built-in configuration for one game
+ */
+struct GameProfile {
+  /** Name used in the log and by \c ATFIX_PROFILE */
+  const char* name          = nullptr;
+  /** Case-insensitive module name prefix, so that all language
+   *  builds of a game match, \c nullptr for the fallback */
+  const char* modulePrefix  = nullptr;
+  /** PE timestamp and checksum to match, 0 for any build */
+  uint32_t    timestamp     = 0;
+  uint32_t    checksum      = 0;
+  /** Pattern rules used without a rules file, \c nullptr
+   *  for the built-in glyph rules */
+  const char* rules         = nullptr;
+  /** Sets the strategies and thresholds of this game, runs
+   *  before environment variables are applied */
+  void (*configure)(Config& config) = nullptr;
+};
+
+/**
+ * \brief Records the identity of the host executable
+ *
+ * Called once when the DLL is attached, before the config is
+ * first read. Without it, only the fallback profile or one
+ * forced through \c ATFIX_PROFILE can be selected.
+ * \param [in] identity Host executable
+ */
+void setExecutableIdentity(const ExecutableIdentity& identity);
+
+/**
+ * \brief Returns the recorded identity of the host executable
+ */
+const ExecutableIdentity& getExecutableIdentity();
+
+/**
+ * \brief Selects the profile for an executable
+ *
+ * \param [in] identity Host executable
+ * \param [in] pName Forced profile name, or \c nullptr to
+ *    select by identity. Unknown names select the fallback.
+ * \returns First matching profile of the built-in table
+ */
+const GameProfile& selectGameProfile(const ExecutableIdentity& identity, const char* pName);
+
+}
@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <cstring>
+
+#include "read_profile.h"
+
+namespace atfix {
+
+ReadProfiler::ReadProfiler(uint32_t stableMaps, bool shrinkCopies)
+: m_stableMaps(stableMaps), m_shrinkCopies(shrinkCopies) {
+
+}
+
+
+bool ReadProfiler::mapProfiled(
+  const core::ResourceKey&        Resource,
+  const void*                     pCallSite,
+        UINT                      RowSize,
+        UINT                      RowCount,
+        D3D11_MAPPED_SUBRESOURCE* pMappedResource) {
+  std::lock_guard lock(m_mutex);
+
+  UINT rowPitch = pMappedResource->RowPitch;
+  GuardedBuffer* buffer = getBuffer(Resource, size_t(rowPitch) * RowCount);
+
+  if (!buffer)
+    return false;
+
+  // Rows a shrunk copy did not write are stale in the
+  // texture, so there is no point in copying them either
+  RowRange rows = { 0u, RowCount };
+  auto shrunk = m_shrunk.find(Resource);
+
+  if (shrunk != m_shrunk.end())
+    rows = shrunk->second;
+
+  auto src = static_cast<const uint8_t*>(pMappedResource->pData);
+
+  for (UINT y = rows.begin; y < rows.end; y++)
+    std::memcpy(buffer->data() + size_t(y) * rowPitch, src + size_t(y) * rowPitch, RowSize);
+
+  if (!buffer->arm(true, 1))
+    return false;
+
+  CallSite& site = m_sites[pCallSite];
+  site.stats.callSite = pCallSite;
+
+  ActiveMap& map = m_maps[Resource];
+  map.site = &site;
+  map.buffer = buffer;
+  map.rowSize = RowSize;
+  map.rowPitch = rowPitch;
+  map.rowCount = RowCount;
+
+  pMappedResource->pData = buffer->data();
+  return true;
+}
+
+
+void ReadProfiler::unmapProfiled(const core::ResourceKey& Resource) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_maps.find(Resource);
+
+  if (entry == m_maps.end())
+    return;
+
+  ActiveMap map = entry->second;
+  m_maps.erase(entry);
+
+  map.buffer->disarm();
+
+  RowRange touched = { map.rowCount, 0u };
+  UINT touchedRows = 0;
+
+  for (UINT y = 0; y < map.rowCount; y++) {
+    size_t offset = size_t(y) * map.rowPitch;
+    size_t firstPage = offset / GuardedBuffer::PageSize;
+    size_t lastPage = (offset + map.rowSize - 1) / GuardedBuffer::PageSize;
+
+    bool isTouched = false;
+
+    for (size_t p = firstPage; p <= lastPage && !isTouched; p++)
+      isTouched = map.buffer->isTouched(p);
+
+    if (isTouched) {
+      touched.begin = std::min(touched.begin, y);
+      touched.end = y + 1;
+      touchedRows += 1;
+    }
+  }
+
+  m_stats.faults += map.buffer->getFaultCount();
+
+  CallSite& site = *map.site;
+  site.stats.maps += 1;
+  site.stats.touchedRows += touchedRows;
+  site.stats.totalRows += map.rowCount;
+
+  bool hasGrown = false;
+
+  if (touchedRows) {
+    if (!site.hasRows) {
+      site.stats.rowBegin = touched.begin;
+      site.stats.rowEnd = touched.end;
+      site.hasRows = true;
+      hasGrown = true;
+    } else if (touched.begin < site.stats.rowBegin || touched.end > site.stats.rowEnd) {
+      site.stats.rowBegin = std::min(site.stats.rowBegin, touched.begin);
+      site.stats.rowEnd = std::max(site.stats.rowEnd, touched.end);
+      hasGrown = true;
+    }
+  }
+
+  site.stableMaps = hasGrown ? 0u : site.stableMaps + 1u;
+
+  // The game read rows that the copy skipped and got stale data
+  auto shrunk = m_shrunk.find(Resource);
+
+  if (shrunk != m_shrunk.end() && touchedRows && m_shrinkCopies
+   && (touched.begin < shrunk->second.begin || touched.end > shrunk->second.end)) {
+    log("Copy shrinking disabled: call site 0x", std::hex, uintptr_t(site.stats.callSite), std::dec,
+      " read rows ", touched.begin, "-", touched.end,
+      " of a copy of rows ", shrunk->second.begin, "-", shrunk->second.end);
+    m_shrinkCopies = false;
+  }
+}
+
+
+bool ReadProfiler::shrinkCopy(
+  const core::ResourceKey&        DstResource,
+        UINT                      RowSize,
+        UINT                      RowCount,
+        UINT*                     pRowBegin,
+        UINT*                     pRowEnd) {
+  std::lock_guard lock(m_mutex);
+
+  RowRange rows;
+
+  if (!m_shrinkCopies || !getStableFootprint(RowCount, &rows)
+   || (rows.begin == 0 && rows.end == RowCount)) {
+    m_shrunk.erase(DstResource);
+    return false;
+  }
+
+  m_shrunk[DstResource] = rows;
+
+  m_stats.shrunkCopies += 1;
+  m_stats.savedBytes += uint64_t(RowCount - (rows.end - rows.begin)) * RowSize;
+
+  *pRowBegin = rows.begin;
+  *pRowEnd = rows.end;
+  return true;
+}
+
+
+void ReadProfiler::invalidate(const core::ResourceKey& Resource) {
+  std::lock_guard lock(m_mutex);
+
+  m_shrunk.erase(Resource);
+}
+
+
+void ReadProfiler::retire(const core::ResourceKey& Resource) {
+  std::lock_guard lock(m_mutex);
+
+  m_maps.erase(Resource);
+  m_shrunk.erase(Resource);
+  m_buffers.erase(Resource);
+}
+
+
+ReadProfileStats ReadProfiler::takeStats() {
+  std::lock_guard lock(m_mutex);
+
+  ReadProfileStats result = m_stats;
+  m_stats = ReadProfileStats();
+
+  for (auto& entry : m_sites) {
+    CallSite& site = entry.second;
+
+    if (!site.stats.maps)
+      continue;
+
+    site.stats.stable = site.stableMaps >= m_stableMaps;
+    result.sites.push_back(site.stats);
+
+    site.stats.maps = 0;
+    site.stats.touchedRows = 0;
+    site.stats.totalRows = 0;
+  }
+
+  return result;
+}
+
+
+GuardedBuffer* ReadProfiler::getBuffer(
+  const core::ResourceKey&        Resource,
+        size_t                    Size) {
+  auto& buffer = m_buffers[Resource];
+
+  if (buffer && buffer->size() >= Size)
+    return buffer.get();
+
+  buffer = std::make_unique<GuardedBuffer>(Size);
+
+  if (!buffer->isValid()) {
+    m_buffers.erase(Resource);
+    return nullptr;
+  }
+
+  return buffer.get();
+}
+
+
+bool ReadProfiler::getStableFootprint(
+        UINT                      RowCount,
+        RowRange*                 pRows) const {
+  if (m_sites.empty())
+    return false;
+
+  RowRange rows = { RowCount, 0u };
+
+  for (const auto& entry : m_sites) {
+    const CallSite& site = entry.second;
+
+    if (site.stableMaps < m_stableMaps)
+      return false;
+
+    if (site.hasRows) {
+      rows.begin = std::min<UINT>(rows.begin, site.stats.rowBegin);
+      rows.end = std::max<UINT>(rows.end, site.stats.rowEnd);
+    }
+  }
+
+  // Keep the copy non-empty even if nothing is ever read
+  if (rows.begin >= rows.end)
+    rows = { 0u, 1u };
+
+  rows.end = std::min(rows.end, RowCount);
+  *pRows = rows;
+  return rows.begin < rows.end;
+}
+
+}
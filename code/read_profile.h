@@ -0,0 +1,186 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "impl.h"
+#include "page_guard.h"
+#include "util.h"
+
+#include "core/types.h"
+
+namespace atfix {
+
+/**
+ * \brief Read footprint of one call site
+ */
+struct ReadSiteStats {
+  /** Return address of the hooked Map */
+  const void* callSite    = nullptr;
+  /** Profiled maps since the last report */
+  uint64_t    maps        = 0;
+  /** Rows read by those maps */
+  uint64_t    touchedRows = 0;
+  /** Rows of those maps */
+  uint64_t    totalRows   = 0;
+  /** Union of rows read by all maps so far */
+  uint32_t    rowBegin    = 0;
+  uint32_t    rowEnd      = 0;
+  /** Whether the union stopped growing */
+  bool        stable      = false;
+};
+
+/**
+ * \brief Read profiling counters
+ */
+struct ReadProfileStats {
+  /** Call sites that mapped since the last report */
+  std::vector<ReadSiteStats> sites;
+  /** Read faults taken on profiled maps */
+  uint64_t    faults       = 0;
+  /** Copies that only transferred the stable footprint */
+  uint64_t    shrunkCopies = 0;
+  /** Bytes those copies did not transfer */
+  uint64_t    savedBytes   = 0;
+};
+
+/**
+ * \brief Records which rows of STAGING readbacks the game reads
+ *
+ * Map(READ) returns a copy of the mapped data whose pages are
+ * inaccessible, so that the first read of each page faults and
+ * is recorded. At Unmap, the rows on touched pages are added to
+ * the footprint of the code that called Map. A footprint that has
+ * not grown for a number of maps is considered stable.
+ *
+ * If copy shrinking is enabled and all call sites are stable, glyph
+ * copies only transfer the union of their footprints, and only
+ * those rows are copied for the game. A read outside of the rows
+ * that were copied disables shrinking for good.
+ *
+ * Only immediate context calls may be passed in. Thread-safe.
+ */
+class ReadProfiler {
+
+public:
+
+  /**
+   * \brief Creates the profiler
+   *
+   * \param [in] stableMaps Maps without growth after which
+   *    a call site's footprint is stable
+   * \param [in] shrinkCopies Whether to shrink glyph copies
+   *    to stable footprints
+   */
+  ReadProfiler(uint32_t stableMaps, bool shrinkCopies);
+
+  ReadProfiler(const ReadProfiler&) = delete;
+  ReadProfiler& operator = (const ReadProfiler&) = delete;
+
+  /**
+   * \brief Replaces the mapping of a Map(READ)
+   *
+   * \param [in] Resource Mapped resource
+   * \param [in] pCallSite Return address of the hooked Map
+   * \param [in] RowSize Bytes per row
+   * \param [in] RowCount Number of rows
+   * \param [in,out] pMappedResource Driver mapping, replaced
+   *    with the guarded copy on success
+   * \returns \c true if the map is profiled
+   */
+  bool mapProfiled(
+    const core::ResourceKey&        Resource,
+    const void*                     pCallSite,
+          UINT                      RowSize,
+          UINT                      RowCount,
+          D3D11_MAPPED_SUBRESOURCE* pMappedResource);
+
+  /**
+   * \brief Records the footprint of a profiled map
+   *
+   * \param [in] Resource Unmapped resource
+   */
+  void unmapProfiled(const core::ResourceKey& Resource);
+
+  /**
+   * \brief Picks the rows a full glyph copy needs to transfer
+   *
+   * \param [in] DstResource Copy destination
+   * \param [in] RowSize Bytes per row
+   * \param [in] RowCount Number of rows
+   * \param [out] pRowBegin First row to copy
+   * \param [out] pRowEnd One past the last row to copy
+   * \returns \c true if the copy should be shrunk
+   */
+  bool shrinkCopy(
+    const core::ResourceKey&        DstResource,
+          UINT                      RowSize,
+          UINT                      RowCount,
+          UINT*                     pRowBegin,
+          UINT*                     pRowEnd);
+
+  /**
+   * \brief Marks a destination as fully written
+   *
+   * Must be called for copies that are not shrunk.
+   * \param [in] Resource Written resource
+   */
+  void invalidate(const core::ResourceKey& Resource);
+
+  /**
+   * \brief Frees the guarded copy of a destroyed resource
+   *
+   * \param [in] Resource Resource
+   */
+  void retire(const core::ResourceKey& Resource);
+
+  /**
+   * \brief Returns and resets counters
+   */
+  ReadProfileStats takeStats();
+
+private:
+
+  struct CallSite {
+    ReadSiteStats                       stats;
+    bool                                hasRows    = false;
+    uint32_t                            stableMaps = 0;
+  };
+
+  struct RowRange {
+    UINT                                begin = 0;
+    UINT                                end   = 0;
+  };
+
+  struct ActiveMap {
+    CallSite*                           site     = nullptr;
+    GuardedBuffer*                      buffer   = nullptr;
+    UINT                                rowSize  = 0;
+    UINT                                rowPitch = 0;
+    UINT                                rowCount = 0;
+  };
+
+  mutex                                 m_mutex;
+
+  uint32_t                              m_stableMaps;
+  bool                                  m_shrinkCopies;
+
+  std::unordered_map<const void*, CallSite> m_sites;
+  std::unordered_map<core::ResourceKey, std::unique_ptr<GuardedBuffer>, core::ResourceKeyHash> m_buffers;
+  std::unordered_map<core::ResourceKey, ActiveMap, core::ResourceKeyHash> m_maps;
+  std::unordered_map<core::ResourceKey, RowRange, core::ResourceKeyHash> m_shrunk;
+
+  ReadProfileStats                      m_stats;
+
+  GuardedBuffer* getBuffer(
+    const core::ResourceKey&        Resource,
+          size_t                    Size);
+
+  bool getStableFootprint(
+          UINT                      RowCount,
+          RowRange*                 pRows) const;
+
+};
+
+}
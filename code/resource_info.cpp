@@ -0,0 +1,204 @@
+#include <algorithm>
+
+#include "resource_info.h"
+#include "trace.h"
+
+namespace atfix {
+
+bool getResourceInfo(ID3D11Resource* pResource, ResourceInfo* pInfo) {
+  *pInfo = ResourceInfo();
+  pResource->GetType(&pInfo->dimension);
+
+  switch (pInfo->dimension) {
+    case D3D11_RESOURCE_DIMENSION_BUFFER: {
+      ID3D11Buffer* buffer = nullptr;
+
+      if (FAILED(pResource->QueryInterface(IID_PPV_ARGS(&buffer))))
+        return false;
+
+      D3D11_BUFFER_DESC desc = {};
+      buffer->GetDesc(&desc);
+      buffer->Release();
+
+      pInfo->width = desc.ByteWidth;
+      pInfo->height = 1;
+      pInfo->depth = 1;
+      pInfo->mipLevels = 1;
+      pInfo->arraySize = 1;
+      pInfo->usage = desc.Usage;
+      pInfo->bindFlags = desc.BindFlags;
+      pInfo->cpuAccessFlags = desc.CPUAccessFlags;
+    } return true;
+
+    case D3D11_RESOURCE_DIMENSION_TEXTURE1D: {
+      ID3D11Texture1D* tex = nullptr;
+
+      if (FAILED(pResource->QueryInterface(IID_PPV_ARGS(&tex))))
+        return false;
+
+      D3D11_TEXTURE1D_DESC desc = {};
+      tex->GetDesc(&desc);
+      tex->Release();
+
+      pInfo->width = desc.Width;
+      pInfo->height = 1;
+      pInfo->depth = 1;
+      pInfo->mipLevels = desc.MipLevels;
+      pInfo->arraySize = desc.ArraySize;
+      pInfo->format = desc.Format;
+      pInfo->usage = desc.Usage;
+      pInfo->bindFlags = desc.BindFlags;
+      pInfo->cpuAccessFlags = desc.CPUAccessFlags;
+    } return true;
+
+    case D3D11_RESOURCE_DIMENSION_TEXTURE2D: {
+      ID3D11Texture2D* tex = nullptr;
+
+      if (FAILED(pResource->QueryInterface(IID_PPV_ARGS(&tex))))
+        return false;
+
+      D3D11_TEXTURE2D_DESC desc = {};
+      tex->GetDesc(&desc);
+      tex->Release();
+
+      pInfo->width = desc.Width;
+      pInfo->height = desc.Height;
+      pInfo->depth = 1;
+      pInfo->mipLevels = desc.MipLevels;
+      pInfo->arraySize = desc.ArraySize;
+      pInfo->format = desc.Format;
+      pInfo->usage = desc.Usage;
+      pInfo->bindFlags = desc.BindFlags;
+      pInfo->cpuAccessFlags = desc.CPUAccessFlags;
+    } return true;
+
+    case D3D11_RESOURCE_DIMENSION_TEXTURE3D: {
+      ID3D11Texture3D* tex = nullptr;
+
+      if (FAILED(pResource->QueryInterface(IID_PPV_ARGS(&tex))))
+        return false;
+
+      D3D11_TEXTURE3D_DESC desc = {};
+      tex->GetDesc(&desc);
+      tex->Release();
+
+      pInfo->width = desc.Width;
+      pInfo->height = desc.Height;
+      pInfo->depth = desc.Depth;
+      pInfo->mipLevels = desc.MipLevels;
+      pInfo->arraySize = 1;
+      pInfo->format = desc.Format;
+      pInfo->usage = desc.Usage;
+      pInfo->bindFlags = desc.BindFlags;
+      pInfo->cpuAccessFlags = desc.CPUAccessFlags;
+    } return true;
+
+    default:
+      return false;
+  }
+}
+
+
+core::ResourceDesc getResourceDesc(const ResourceInfo& Info) {
+  core::ResourceDesc result;
+  result.width = Info.width;
+  result.height = Info.height;
+  result.usage = core::Usage(Info.usage);
+  result.cpuAccessFlags = Info.cpuAccessFlags;
+  result.bindFlags = Info.bindFlags;
+  result.format = uint32_t(Info.format);
+  return result;
+}
+
+
+bool getSubresourceLayout(const ResourceInfo& Info, UINT Subresource, SubresourceLayout* pLayout) {
+  UINT mipLevels = std::max(Info.mipLevels, 1u);
+
+  if (Info.dimension == D3D11_RESOURCE_DIMENSION_UNKNOWN
+   || Subresource >= mipLevels * std::max(Info.arraySize, 1u))
+    return false;
+
+  UINT mip = Subresource % mipLevels;
+
+  if (Info.dimension == D3D11_RESOURCE_DIMENSION_BUFFER) {
+    pLayout->rowSize = Info.width;
+    pLayout->rowCount = 1;
+    pLayout->sliceCount = 1;
+    return true;
+  }
+
+  pLayout->rowSize = std::max(Info.width >> mip, 1u) * getChecksumBytesPerPixel(Info.format);
+  pLayout->rowCount = std::max(Info.height >> mip, 1u);
+  pLayout->sliceCount = std::max(Info.depth >> mip, 1u);
+  return true;
+}
+
+
+HRESULT createStagingResource(ID3D11Device* pDevice, const ResourceInfo& Info, ID3D11Resource** ppResource) {
+  HRESULT hr = E_INVALIDARG;
+
+  switch (Info.dimension) {
+    case D3D11_RESOURCE_DIMENSION_BUFFER: {
+      D3D11_BUFFER_DESC desc = { };
+      desc.ByteWidth = Info.width;
+      desc.Usage = D3D11_USAGE_STAGING;
+      desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+      ID3D11Buffer* buffer = nullptr;
+      hr = pDevice->CreateBuffer(&desc, nullptr, &buffer);
+      *ppResource = buffer;
+    } break;
+
+    case D3D11_RESOURCE_DIMENSION_TEXTURE1D: {
+      D3D11_TEXTURE1D_DESC desc = { };
+      desc.Width = Info.width;
+      desc.MipLevels = 1;
+      desc.ArraySize = 1;
+      desc.Format = Info.format;
+      desc.Usage = D3D11_USAGE_STAGING;
+      desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+      ID3D11Texture1D* tex = nullptr;
+      hr = pDevice->CreateTexture1D(&desc, nullptr, &tex);
+      *ppResource = tex;
+    } break;
+
+    case D3D11_RESOURCE_DIMENSION_TEXTURE2D: {
+      D3D11_TEXTURE2D_DESC desc = { };
+      desc.Width = Info.width;
+      desc.Height = Info.height;
+      desc.MipLevels = 1;
+      desc.ArraySize = 1;
+      desc.Format = Info.format;
+      desc.SampleDesc = { 1, 0 };
+      desc.Usage = D3D11_USAGE_STAGING;
+      desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+      ID3D11Texture2D* tex = nullptr;
+      hr = pDevice->CreateTexture2D(&desc, nullptr, &tex);
+      *ppResource = tex;
+    } break;
+
+    case D3D11_RESOURCE_DIMENSION_TEXTURE3D: {
+      D3D11_TEXTURE3D_DESC desc = { };
+      desc.Width = Info.width;
+      desc.Height = Info.height;
+      desc.Depth = Info.depth;
+      desc.MipLevels = 1;
+      desc.Format = Info.format;
+      desc.Usage = D3D11_USAGE_STAGING;
+      desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+      ID3D11Texture3D* tex = nullptr;
+      hr = pDevice->CreateTexture3D(&desc, nullptr, &tex);
+      *ppResource = tex;
+    } break;
+
+    default:
+      break;
+  }
+
+  return hr;
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "impl.h"
+
+#include "core/types.h"
+
+namespace atfix {
+
+/**
+ * \brief Properties of a resource of any dimension
+ *
+ * Buffers are one row of \c ByteWidth bytes without a format,
+ * and all extents that a dimension lacks are 1.
+ */
+struct ResourceInfo {
+  D3D11_RESOURCE_DIMENSION  dimension       = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+  UINT                      width           = 0;
+  UINT                      height          = 0;
+  UINT                      depth           = 0;
+  UINT                      mipLevels       = 0;
+  UINT                      arraySize       = 0;
+  DXGI_FORMAT               format          = DXGI_FORMAT_UNKNOWN;
+  D3D11_USAGE               usage           = D3D11_USAGE_DEFAULT;
+  UINT                      bindFlags       = 0;
+  UINT                      cpuAccessFlags  = 0;
+};
+
+/**
+ * \brief Image layout of one subresource
+ *
+ * What checksums, hashes and CPU copies of the subresource
+ * cover. Only 3D textures have more than one slice, whose
+ * distance is the \c DepthPitch of the mapping.
+ */
+struct SubresourceLayout {
+  /** Bytes per row */
+  UINT rowSize     = 0;
+  /** Rows per slice */
+  UINT rowCount    = 0;
+  UINT sliceCount  = 0;
+};
+
+/**
+ * \brief Queries the properties of a resource
+ *
+ * \param [in] pResource Resource
+ * \param [out] pInfo Resource properties
+ * \returns \c false if the dimension is unknown
+ */
+bool getResourceInfo(ID3D11Resource* pResource, ResourceInfo* pInfo);
+
+/**
+ * \brief Describes a resource for rules and patterns
+ *
+ * The depth of 3D textures is not part of the description.
+ * \param [in] Info Resource properties
+ */
+core::ResourceDesc getResourceDesc(const ResourceInfo& Info);
+
+/**
+ * \brief Computes the layout of a subresource
+ *
+ * \param [in] Info Resource properties
+ * \param [in] Subresource Subresource index
+ * \param [out] pLayout Layout of the subresource
+ * \returns \c false if the subresource does not exist
+ */
+bool getSubresourceLayout(const ResourceInfo& Info, UINT Subresource, SubresourceLayout* pLayout);
+
+/**
+ * \brief Creates a CPU-readable copy target
+ *
+ * Creates a STAGING resource of the same dimension, extent
+ * and format, with one mip level and array layer.
+ * \param [in] pDevice Device
+ * \param [in] Info Properties of the resource to mirror
+ * \param [out] ppResource Created resource
+ */
+HRESULT createStagingResource(ID3D11Device* pDevice, const ResourceInfo& Info, ID3D11Resource** ppResource);
+
+}
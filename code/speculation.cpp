@@ -0,0 +1,232 @@
+#include <chrono>
+
+#include "speculation.h"
+#include "trace.h"
+
+namespace atfix {
+
+ReadbackSpeculator::ReadbackSpeculator(const Config& config, ReadbackValidator* pValidator)
+: m_validator     (pValidator),
+  m_enabled       (true),
+  m_maxMismatches (config.speculativeMaxMismatches),
+  m_cache         (uint64_t(config.speculativeCacheMiB) << 20) {
+
+}
+
+
+void ReadbackSpeculator::registerWrite(const core::ResourceKey& Resource, uint64_t payload) {
+  m_lineage.registerWrite(Resource, payload);
+}
+
+
+void ReadbackSpeculator::registerCopy(
+        ID3D11DeviceContext*      pContext,
+  const core::ResourceKey&        DstResource,
+        UINT                      DstSubresource,
+        UINT                      DstX,
+        UINT                      DstY,
+        UINT                      DstZ,
+  const core::ResourceKey&        SrcResource,
+        ID3D11Resource*           pSrcResource,
+        UINT                      SrcSubresource,
+  const D3D11_BOX*                pSrcBox,
+  const ResourceInfo&             DstDesc,
+  const ResourceInfo&             SrcDesc,
+        bool                      isServable) {
+  // The payload only determines the readback if the copy
+  // overwrites the entire destination
+  bool isFullCopy = !DstSubresource && !SrcSubresource && !DstX && !DstY && !DstZ
+    && DstDesc.dimension == SrcDesc.dimension
+    && DstDesc.width == SrcDesc.width && DstDesc.height == SrcDesc.height
+    && DstDesc.depth == SrcDesc.depth && DstDesc.format == SrcDesc.format
+    && DstDesc.mipLevels == 1;
+
+  if (isFullCopy && pSrcBox) {
+    isFullCopy = !pSrcBox->left && !pSrcBox->top && !pSrcBox->front
+      && pSrcBox->right == SrcDesc.width && pSrcBox->bottom == SrcDesc.height
+      && pSrcBox->back == SrcDesc.depth;
+  }
+
+  if (!isFullCopy) {
+    invalidate(DstResource);
+    return;
+  }
+
+  m_lineage.registerCopy(DstResource, SrcResource);
+
+  std::shared_ptr<const core::ReadbackImage> image;
+  uint64_t payload = 0;
+
+  { std::lock_guard lock(m_mutex);
+    m_planned.erase(DstResource);
+
+    if (!m_enabled || !isServable || !m_lineage.getPayload(DstResource, &payload))
+      return;
+
+    image = m_cache.lookup(payload);
+
+    if (!image)
+      return;
+  }
+
+  // Sampled hits are only served if they can be validated,
+  // so that the validation rate holds even under pressure.
+  // Submitting creates and releases resources, and releasing
+  // one calls back into retire, so it must run unlocked.
+  if (m_validator->sample()) {
+    ReadbackLineage lineage;
+    lineage.pStrategy = StrategyName;
+    lineage.srcResource = SrcResource;
+    lineage.dstResource = DstResource;
+    lineage.payload = payload;
+    lineage.servedHash = image->hash;
+    lineage.copyUs = getTimeUs();
+
+    if (!pSrcResource || !m_validator->submit(pContext, pSrcResource, SrcSubresource, pSrcBox, DstDesc, lineage)) {
+      std::lock_guard lock(m_mutex);
+      m_stats.skipped += 1;
+      return;
+    }
+  }
+
+  std::lock_guard lock(m_mutex);
+
+  if (m_enabled)
+    m_planned[DstResource] = std::move(image);
+}
+
+
+void ReadbackSpeculator::invalidate(const core::ResourceKey& Resource) {
+  m_lineage.registerCopy(Resource, core::ResourceKey());
+  m_lineage.registerWrite(Resource, 0u);
+
+  std::lock_guard lock(m_mutex);
+  m_planned.erase(Resource);
+}
+
+
+void ReadbackSpeculator::retire(const core::ResourceKey& Resource) {
+  m_lineage.retire(Resource);
+
+  std::lock_guard lock(m_mutex);
+  m_planned.erase(Resource);
+  m_mapped.erase(Resource);
+}
+
+
+bool ReadbackSpeculator::mapSpeculative(
+  const core::ResourceKey&        Resource,
+        UINT                      Subresource,
+        D3D11_MAPPED_SUBRESOURCE* pMappedResource) {
+  if (Subresource || !pMappedResource)
+    return false;
+
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_planned.find(Resource);
+
+  if (entry == m_planned.end())
+    return false;
+
+  auto image = std::move(entry->second);
+  m_planned.erase(entry);
+
+  // Buffers are recycled, so that their pages stay committed
+  std::vector<uint8_t> buffer;
+
+  if (!m_freeBuffers.empty()) {
+    buffer = std::move(m_freeBuffers.back());
+    m_freeBuffers.pop_back();
+  }
+
+  buffer.resize(image->getRawSize());
+
+  auto t0 = std::chrono::steady_clock::now();
+  core::decompressReadbackImage(*image, buffer.data(), image->rowSize);
+  auto t1 = std::chrono::steady_clock::now();
+
+  pMappedResource->pData = buffer.data();
+  pMappedResource->RowPitch = image->rowSize;
+  pMappedResource->DepthPitch = image->rowSize * (image->rowCount / image->sliceCount);
+
+  m_mapped[Resource] = std::move(buffer);
+
+  m_stats.hits += 1;
+  m_stats.decompressNs += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+  return true;
+}
+
+
+bool ReadbackSpeculator::unmapSpeculative(
+  const core::ResourceKey&        Resource,
+        UINT                      Subresource) {
+  if (Subresource)
+    return false;
+
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_mapped.find(Resource);
+
+  if (entry == m_mapped.end())
+    return false;
+
+  m_freeBuffers.push_back(std::move(entry->second));
+  m_mapped.erase(entry);
+  return true;
+}
+
+
+void ReadbackSpeculator::registerReadback(
+  const core::ResourceKey&        Resource,
+        UINT                      Subresource,
+  const D3D11_MAPPED_SUBRESOURCE& Mapped,
+  const SubresourceLayout&        Layout) {
+  uint64_t payload = 0;
+
+  if (Subresource || !m_lineage.getPayload(Resource, &payload))
+    return;
+
+  { std::lock_guard lock(m_mutex);
+
+    if (!m_enabled)
+      return;
+
+    m_stats.misses += 1;
+  }
+
+  m_cache.insert(payload, core::createReadbackImage(Mapped.pData, Mapped.RowPitch,
+    Mapped.DepthPitch, Layout.rowSize, Layout.rowCount, Layout.sliceCount));
+}
+
+
+void ReadbackSpeculator::registerFailure(const ReadbackValidation& Failure) {
+  std::lock_guard lock(m_mutex);
+
+  m_stats.mismatches += 1;
+  m_totalMismatches += 1;
+
+  m_cache.invalidate(Failure.lineage.payload);
+
+  if (m_enabled && m_totalMismatches >= m_maxMismatches)
+    disable();
+}
+
+
+SpeculationStats ReadbackSpeculator::takeStats() {
+  std::lock_guard lock(m_mutex);
+
+  SpeculationStats result = m_stats;
+  m_stats = SpeculationStats();
+  return result;
+}
+
+
+void ReadbackSpeculator::disable() {
+  log("Speculative readback disabled after ", m_totalMismatches, " mismatches");
+
+  m_enabled = false;
+  m_planned.clear();
+  m_cache.clear();
+}
+
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+#include "impl.h"
+#include "resource_info.h"
+#include "validator.h"
+
+#include "core/lineage.h"
+#include "core/readback_cache.h"
+
+namespace atfix {
+
+/**
+ * \brief Speculative readback counters
+ */
+struct SpeculationStats {
+  /** Readbacks served from the cache */
+  uint64_t hits         = 0;
+  /** Readbacks with a known payload that went to the GPU */
+  uint64_t misses       = 0;
+  /** Hits that failed validation */
+  uint64_t mismatches   = 0;
+  /** Predictable readbacks not served because they were picked
+   *  for validation but no validation texture was free, or the
+   *  copy could not be repeated */
+  uint64_t skipped      = 0;
+  /** Time spent decompressing hits, in nanoseconds */
+  uint64_t decompressNs = 0;
+};
+
+/**
+ * \brief Serves glyph readbacks from a CPU cache
+ *
+ * When a glyph copy goes to a STAGING resource and the payload
+ * of its source has been read back before, the following
+ * Map(READ) returns the cached image instead of waiting for the
+ * GPU. Images are cached compressed, and decompressed into a
+ * buffer that the game reads until Unmap. The copy is still
+ * executed, and the validator checks a sample of hits against
+ * the GPU. Buffers and textures of any dimension are served,
+ * the slices of 3D textures are cached as one image. A failed
+ * validation drops the image, and too many of them disable
+ * speculation for good.
+ *
+ * Only immediate context calls may be passed in. Thread-safe.
+ */
+class ReadbackSpeculator {
+
+public:
+
+  ReadbackSpeculator(const Config& config, ReadbackValidator* pValidator);
+
+  ReadbackSpeculator(const ReadbackSpeculator&) = delete;
+  ReadbackSpeculator& operator = (const ReadbackSpeculator&) = delete;
+
+  /**
+   * \brief Registers a write to a source texture
+   *
+   * \param [in] Resource Written resource
+   * \param [in] payload Hash of the written data, or 0
+   */
+  void registerWrite(const core::ResourceKey& Resource, uint64_t payload);
+
+  /**
+   * \brief Registers a glyph copy before it is executed
+   *
+   * Plans serving the destination from the cache, and submits
+   * the copy for validation if it is sampled. The source
+   * is passed both as key and as object, which validation
+   * needs to repeat the copy. Without the object, e.g. if the
+   * source was written again since the copy ran, sampled
+   * copies are not served. Copies whose readback is not
+   * going to be served only pass on the payload, so that no
+   * validation copy is submitted for them.
+   * \param [in] isServable Whether the following readback may
+   *    be served from the cache, i.e. the readback strategy of
+   *    the destination is speculation
+   */
+  void registerCopy(
+          ID3D11DeviceContext*      pContext,
+    const core::ResourceKey&        DstResource,
+          UINT                      DstSubresource,
+          UINT                      DstX,
+          UINT                      DstY,
+          UINT                      DstZ,
+    const core::ResourceKey&        SrcResource,
+          ID3D11Resource*           pSrcResource,
+          UINT                      SrcSubresource,
+    const D3D11_BOX*                pSrcBox,
+    const ResourceInfo&             DstDesc,
+    const ResourceInfo&             SrcDesc,
+          bool                      isServable);
+
+  /**
+   * \brief Forgets what a resource holds
+   *
+   * Used for any copy or write that is not a glyph copy. Drops
+   * both the payload copied into the resource and the payload
+   * uploaded to it, so later copies from it are unknown too.
+   * \param [in] Resource Resource
+   */
+  void invalidate(const core::ResourceKey& Resource);
+
+  /**
+   * \brief Forgets a destroyed resource
+   *
+   * \param [in] Resource Resource
+   */
+  void retire(const core::ResourceKey& Resource);
+
+  /**
+   * \brief Serves Map(READ) from the cache if possible
+   *
+   * \param [in] Resource Mapped resource
+   * \param [in] Subresource Mapped subresource
+   * \param [out] pMappedResource Cached image on success
+   * \returns \c true if the real Map must be skipped
+   */
+  bool mapSpeculative(
+    const core::ResourceKey&        Resource,
+          UINT                      Subresource,
+          D3D11_MAPPED_SUBRESOURCE* pMappedResource);
+
+  /**
+   * \brief Ends a speculative map
+   *
+   * \param [in] Resource Unmapped resource
+   * \param [in] Subresource Unmapped subresource
+   * \returns \c true if the real Unmap must be skipped
+   */
+  bool unmapSpeculative(
+    const core::ResourceKey&        Resource,
+          UINT                      Subresource);
+
+  /**
+   * \brief Caches the result of a real readback
+   *
+   * \param [in] Resource Read back resource
+   * \param [in] Subresource Mapped subresource
+   * \param [in] Mapped Mapped data
+   * \param [in] Layout Layout of the mapped subresource
+   */
+  void registerReadback(
+    const core::ResourceKey&        Resource,
+          UINT                      Subresource,
+    const D3D11_MAPPED_SUBRESOURCE& Mapped,
+    const SubresourceLayout&        Layout);
+
+  /**
+   * \brief Handles a failed validation of a hit
+   *
+   * \param [in] Failure Failed validation
+   */
+  void registerFailure(const ReadbackValidation& Failure);
+
+  /**
+   * \brief Returns and resets counters
+   */
+  SpeculationStats takeStats();
+
+  /**
+   * \brief Returns cache memory counters
+   */
+  core::ReadbackCacheStats getCacheStats() const {
+    return m_cache.getStats();
+  }
+
+  /**
+   * \brief Name used in validation reports
+   */
+  static constexpr const char* StrategyName = "speculative";
+
+private:
+
+  mutex                         m_mutex;
+
+  ReadbackValidator*            m_validator;
+
+  bool                          m_enabled;
+  uint32_t                      m_maxMismatches;
+
+  core::LineageTracker          m_lineage;
+  core::ReadbackCache           m_cache;
+
+  using ImageMap = std::unordered_map<core::ResourceKey,
+    std::shared_ptr<const core::ReadbackImage>, core::ResourceKeyHash>;
+
+  using BufferMap = std::unordered_map<core::ResourceKey,
+    std::vector<uint8_t>, core::ResourceKeyHash>;
+
+  ImageMap                      m_planned;
+  BufferMap                     m_mapped;
+
+  std::vector<std::vector<uint8_t>> m_freeBuffers;
+
+  SpeculationStats              m_stats;
+  uint64_t                      m_totalMismatches = 0;
+
+  void disable();
+
+};
+
+}
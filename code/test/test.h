@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdio>
+
+namespace atfix::test {
+
+/**
+ * \brief Failed checks of the running test executable
+ */
+inline unsigned g_failures = 0;
+
+/**
+ * \brief Records the outcome of a check
+ *
+ * Failures are printed with their location, and the test
+ * executable keeps going so that one run shows all of them.
+ */
+inline void check(bool condition, const char* pExpression, const char* pFile, int line) {
+  if (condition)
+    return;
+
+  std::fprintf(stderr, "%s:%d: check failed: %s\n", pFile, line, pExpression);
+  g_failures += 1;
+}
+
+/**
+ * \brief Runs one test case
+ */
+inline void run(const char* pName, void (*pTest)()) {
+  unsigned failures = g_failures;
+  pTest();
+
+  std::printf("%s %s\n", g_failures == failures ? "PASS" : "FAIL", pName);
+}
+
+/**
+ * \brief Returns the exit code for meson
+ */
+inline int finish() {
+  return g_failures ? 1 : 0;
+}
+
+}
+
+#define ATFIX_CHECK(expr) ::atfix::test::check(bool(expr), #expr, __FILE__, __LINE__)
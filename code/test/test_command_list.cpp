@@ -0,0 +1,155 @@
+#include "../command_list.h"
+
+#include "test.h"
+
+using namespace atfix;
+
+static core::ResourceKey key(uintptr_t pointer, uint64_t generation = 1) {
+  core::ResourceKey result;
+  result.pointer = reinterpret_cast<const void*>(pointer);
+  result.generation = generation;
+  return result;
+}
+
+
+static ID3D11Resource* resource(uintptr_t pointer) {
+  return reinterpret_cast<ID3D11Resource*>(pointer);
+}
+
+
+static DeferredOp write(uintptr_t dst, uint64_t payload) {
+  DeferredOp result;
+  result.type = DeferredOpType::Write;
+  result.pDstResource = resource(dst);
+  result.payload = payload;
+  return result;
+}
+
+
+static DeferredOp copy(uintptr_t dst, uintptr_t src) {
+  DeferredOp result;
+  result.type = DeferredOpType::CopyResource;
+  result.pDstResource = resource(dst);
+  result.pSrcResource = resource(src);
+  return result;
+}
+
+
+static void testExecute() {
+  CommandListTracker tracker;
+
+  tracker.record(key(1), write(0x100, 42));
+  tracker.record(key(1), copy(0x200, 0x100));
+
+  // Nothing is executed before the list is finished
+  ATFIX_CHECK(!tracker.execute(key(2)));
+
+  tracker.finish(key(1), key(2));
+
+  // A list can be executed any number of times
+  for (uint32_t i = 0; i < 2; i++) {
+    auto ops = tracker.execute(key(2));
+    ATFIX_CHECK(ops && ops->size() == 2);
+
+    if (ops && ops->size() == 2) {
+      ATFIX_CHECK((*ops)[0].type == DeferredOpType::Write);
+      ATFIX_CHECK((*ops)[0].payload == 42);
+      ATFIX_CHECK((*ops)[1].type == DeferredOpType::CopyResource);
+      ATFIX_CHECK((*ops)[1].pSrcResource == resource(0x100));
+    }
+  }
+
+  CommandListStats stats = tracker.takeStats();
+  ATFIX_CHECK(stats.recordedOps == 2);
+  ATFIX_CHECK(stats.finishedLists == 1);
+  ATFIX_CHECK(stats.executedLists == 2);
+  ATFIX_CHECK(stats.mergedOps == 4);
+
+  ATFIX_CHECK(tracker.takeStats().executedLists == 0);
+}
+
+
+static void testFinishResetsContext() {
+  CommandListTracker tracker;
+
+  tracker.record(key(1), write(0x100, 1));
+  tracker.finish(key(1), key(2));
+
+  tracker.record(key(1), write(0x100, 2));
+  tracker.finish(key(1), key(3));
+
+  auto first = tracker.execute(key(2));
+  auto second = tracker.execute(key(3));
+  ATFIX_CHECK(first && first->size() == 1 && (*first)[0].payload == 1);
+  ATFIX_CHECK(second && second->size() == 1 && (*second)[0].payload == 2);
+
+  // Lists without tracked work are not kept
+  tracker.finish(key(1), key(4));
+  ATFIX_CHECK(!tracker.execute(key(4)));
+}
+
+
+static void testFailedFinish() {
+  CommandListTracker tracker;
+
+  tracker.record(key(1), write(0x100, 1));
+  tracker.finish(key(1), core::ResourceKey());
+
+  tracker.finish(key(1), key(2));
+  ATFIX_CHECK(!tracker.execute(key(2)));
+  ATFIX_CHECK(tracker.takeStats().finishedLists == 0);
+}
+
+
+static void testNestedList() {
+  CommandListTracker tracker;
+
+  tracker.record(key(1), write(0x100, 1));
+  tracker.finish(key(1), key(2));
+
+  // A list executed on another deferred context is inlined
+  tracker.record(key(3), copy(0x200, 0x300));
+  tracker.recordCommandList(key(3), key(2));
+  tracker.record(key(3), write(0x400, 2));
+  tracker.finish(key(3), key(4));
+
+  auto ops = tracker.execute(key(4));
+  ATFIX_CHECK(ops && ops->size() == 3);
+
+  if (ops && ops->size() == 3) {
+    ATFIX_CHECK((*ops)[0].type == DeferredOpType::CopyResource);
+    ATFIX_CHECK((*ops)[1].payload == 1);
+    ATFIX_CHECK((*ops)[2].payload == 2);
+  }
+}
+
+
+static void testRetire() {
+  CommandListTracker tracker;
+
+  tracker.record(key(1), write(0x100, 1));
+  tracker.finish(key(1), key(2));
+
+  auto ops = tracker.execute(key(2));
+  tracker.retire(key(2));
+  ATFIX_CHECK(!tracker.execute(key(2)));
+
+  // Ops already handed out stay valid
+  ATFIX_CHECK(ops && ops->size() == 1);
+
+  // Work recorded on a destroyed context is dropped
+  tracker.record(key(1), write(0x100, 1));
+  tracker.retire(key(1));
+  tracker.finish(key(1), key(3));
+  ATFIX_CHECK(!tracker.execute(key(3)));
+}
+
+
+int main() {
+  test::run("command_list/execute", &testExecute);
+  test::run("command_list/finish-resets-context", &testFinishResetsContext);
+  test::run("command_list/failed-finish", &testFailedFinish);
+  test::run("command_list/nested-list", &testNestedList);
+  test::run("command_list/retire", &testRetire);
+  return test::finish();
+}
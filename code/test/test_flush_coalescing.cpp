@@ -0,0 +1,104 @@
+#include "../flush_coalescing.h"
+
+#include "test.h"
+
+using namespace atfix;
+
+static core::ResourceKey key(uintptr_t pointer, uint64_t generation = 1) {
+  core::ResourceKey result;
+  result.pointer = reinterpret_cast<const void*>(pointer);
+  result.generation = generation;
+  return result;
+}
+
+
+static void testIdleFlush() {
+  FlushCoalescer coalescer(1000);
+
+  // No readback yet, and a burst that has ended
+  ATFIX_CHECK(coalescer.forwardFlush(100));
+  coalescer.registerReadback(key(1), 200);
+  ATFIX_CHECK(coalescer.forwardFlush(1200));
+
+  FlushStats stats = coalescer.takeStats();
+  ATFIX_CHECK(stats.idle == 2);
+  ATFIX_CHECK(stats.forwarded == 0);
+  ATFIX_CHECK(stats.suppressed == 0);
+}
+
+
+static void testBurst() {
+  FlushCoalescer coalescer(1000);
+
+  coalescer.registerReadback(key(1), 100);
+
+  // Nothing to submit, the second flush still goes through
+  ATFIX_CHECK(!coalescer.forwardFlush(200));
+  ATFIX_CHECK(coalescer.forwardFlush(300));
+  ATFIX_CHECK(!coalescer.forwardFlush(400));
+
+  FlushStats stats = coalescer.takeStats();
+  ATFIX_CHECK(stats.suppressed == 2);
+  ATFIX_CHECK(stats.forwarded == 1);
+  ATFIX_CHECK(stats.idle == 0);
+
+  ATFIX_CHECK(coalescer.takeStats().suppressed == 0);
+}
+
+
+static void testPendingCopy() {
+  FlushCoalescer coalescer(1000);
+
+  coalescer.registerReadback(key(1), 100);
+  coalescer.registerCopy(key(2));
+  ATFIX_CHECK(coalescer.forwardFlush(200));
+  ATFIX_CHECK(!coalescer.forwardFlush(300));
+
+  // The real Map submits the copy, nothing is left to flush
+  coalescer.forwardDroppedFlush();
+  coalescer.registerCopy(key(2));
+  coalescer.registerReadback(key(2), 400);
+  ATFIX_CHECK(!coalescer.forwardFlush(500));
+
+  // Copies into destroyed resources are never waited for
+  coalescer.forwardDroppedFlush();
+  coalescer.registerCopy(key(3));
+  coalescer.retire(key(3));
+  ATFIX_CHECK(!coalescer.forwardFlush(600));
+}
+
+
+static void testQueryEnd() {
+  FlushCoalescer coalescer(1000);
+
+  coalescer.registerReadback(key(1), 100);
+  coalescer.registerQueryEnd();
+  ATFIX_CHECK(coalescer.forwardFlush(200));
+  ATFIX_CHECK(!coalescer.forwardFlush(300));
+}
+
+
+static void testDroppedFlush() {
+  FlushCoalescer coalescer(1000);
+
+  ATFIX_CHECK(!coalescer.forwardDroppedFlush());
+
+  coalescer.registerReadback(key(1), 100);
+  ATFIX_CHECK(!coalescer.forwardFlush(200));
+  ATFIX_CHECK(coalescer.forwardDroppedFlush());
+  ATFIX_CHECK(!coalescer.forwardDroppedFlush());
+
+  FlushStats stats = coalescer.takeStats();
+  ATFIX_CHECK(stats.suppressed == 1);
+  ATFIX_CHECK(stats.forwarded == 1);
+}
+
+
+int main() {
+  test::run("flush_coalescing/idle", &testIdleFlush);
+  test::run("flush_coalescing/burst", &testBurst);
+  test::run("flush_coalescing/pending-copy", &testPendingCopy);
+  test::run("flush_coalescing/query-end", &testQueryEnd);
+  test::run("flush_coalescing/dropped-flush", &testDroppedFlush);
+  return test::finish();
+}
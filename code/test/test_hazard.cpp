@@ -0,0 +1,193 @@
+#include "core/hazard.h"
+
+#include "test.h"
+
+using namespace atfix;
+
+static core::ResourceKey key(uintptr_t pointer, uint64_t generation = 1) {
+  core::ResourceKey result;
+  result.pointer = reinterpret_cast<const void*>(pointer);
+  result.generation = generation;
+  return result;
+}
+
+
+static core::ResourceDesc desc(core::Usage usage, uint32_t width) {
+  core::ResourceDesc result;
+  result.width = width;
+  result.height = width;
+  result.usage = usage;
+  result.format = 90;
+  return result;
+}
+
+
+static void testCopyChain() {
+  core::HazardDetector detector;
+
+  core::ResourceDesc srcDesc = desc(core::Usage::Dynamic, 512);
+  core::ResourceDesc dstDesc = desc(core::Usage::Staging, 512);
+
+  detector.registerWrite(key(1), core::WriteKind::CpuWrite);
+  detector.registerCopy(key(2), key(1), core::WriteKind::Copy, core::Dimension::Texture2D, srcDesc);
+  detector.registerReadback(key(2), core::Dimension::Texture2D, dstDesc, core::MapType::Read, 100);
+  detector.registerReadback(key(2), core::Dimension::Texture2D, dstDesc, core::MapType::Read, 300);
+
+  auto top = detector.takeTop(5);
+  ATFIX_CHECK(top.size() == 1);
+
+  if (top.size() == 1) {
+    const core::HazardStats& stats = top[0];
+    ATFIX_CHECK(stats.readbacks == 2);
+    ATFIX_CHECK(stats.stallUs == 400);
+    ATFIX_CHECK(stats.maxStallUs == 300);
+    ATFIX_CHECK(stats.signature.producer == core::WriteKind::Copy);
+    ATFIX_CHECK(stats.signature.srcProducer == core::WriteKind::CpuWrite);
+    ATFIX_CHECK(stats.signature.srcDesc == srcDesc);
+    ATFIX_CHECK(stats.signature.desc == dstDesc);
+  }
+
+  // Counters are reset, producers are kept
+  ATFIX_CHECK(detector.takeTop(5).empty());
+}
+
+
+static void testProducerKinds() {
+  core::HazardDetector detector;
+
+  core::ResourceDesc srcDesc = desc(core::Usage::Default, 256);
+  core::ResourceDesc dstDesc = desc(core::Usage::Staging, 256);
+
+  detector.registerWrite(key(1), core::WriteKind::Update);
+  detector.registerCopy(key(2), key(1), core::WriteKind::Resolve, core::Dimension::Texture2D, srcDesc);
+  detector.registerReadback(key(2), core::Dimension::Texture2D, dstDesc, core::MapType::Read, 10);
+
+  // Never written by a hooked call
+  detector.registerReadback(key(3), core::Dimension::Texture2D, dstDesc, core::MapType::Read, 10);
+
+  auto top = detector.takeTop(5);
+  ATFIX_CHECK(top.size() == 2);
+
+  bool hasResolve = false;
+  bool hasUnobserved = false;
+
+  for (const auto& stats : top) {
+    if (stats.signature.producer == core::WriteKind::Resolve) {
+      hasResolve = true;
+      ATFIX_CHECK(stats.signature.srcProducer == core::WriteKind::Update);
+      ATFIX_CHECK(core::formatHazardSignature(stats.signature).find("<- RESOLVE from") != std::string::npos);
+    }
+
+    if (stats.signature.producer == core::WriteKind::Unobserved)
+      hasUnobserved = true;
+  }
+
+  ATFIX_CHECK(hasResolve);
+  ATFIX_CHECK(hasUnobserved);
+}
+
+
+static void testRanking() {
+  core::HazardDetector detector;
+
+  for (uint32_t i = 1; i <= 4; i++) {
+    core::ResourceDesc dstDesc = desc(core::Usage::Staging, 64 * i);
+    detector.registerReadback(key(i), core::Dimension::Texture2D, dstDesc, core::MapType::Read, 100 * i);
+  }
+
+  auto top = detector.takeTop(2);
+  ATFIX_CHECK(top.size() == 2);
+
+  if (top.size() == 2) {
+    ATFIX_CHECK(top[0].stallUs == 400);
+    ATFIX_CHECK(top[1].stallUs == 300);
+  }
+}
+
+
+static void testGenerations() {
+  core::HazardDetector detector;
+
+  core::ResourceDesc dstDesc = desc(core::Usage::Staging, 512);
+
+  // A new resource at a reused address starts out unobserved
+  detector.registerWrite(key(1, 1), core::WriteKind::CpuWrite);
+  detector.retire(key(1, 1));
+  detector.registerReadback(key(1, 2), core::Dimension::Texture2D, dstDesc, core::MapType::ReadWrite, 10);
+
+  auto top = detector.takeTop(5);
+  ATFIX_CHECK(top.size() == 1);
+  ATFIX_CHECK(top.size() == 1 && top[0].signature.producer == core::WriteKind::Unobserved);
+}
+
+
+static void testSignatureSplit() {
+  core::HazardDetector detector;
+
+  core::ResourceDesc bufferDesc = desc(core::Usage::Staging, 4096);
+  bufferDesc.height = 1;
+  bufferDesc.format = 0;
+
+  core::ResourceDesc textureDesc = desc(core::Usage::Staging, 64);
+
+  // Dimension and map type each make a pattern of their own
+  detector.registerReadback(key(1), core::Dimension::Buffer, bufferDesc, core::MapType::Read, 10);
+  detector.registerReadback(key(2), core::Dimension::Buffer, bufferDesc, core::MapType::Read, 20);
+  detector.registerReadback(key(3), core::Dimension::Texture2D, textureDesc, core::MapType::Read, 30);
+  detector.registerReadback(key(4), core::Dimension::Texture2D, textureDesc, core::MapType::ReadWrite, 40);
+
+  auto top = detector.takeTop(5);
+  ATFIX_CHECK(top.size() == 3);
+
+  uint64_t bufferReadbacks = 0;
+
+  for (const auto& stats : top) {
+    if (stats.signature.dimension == core::Dimension::Buffer) {
+      bufferReadbacks = stats.readbacks;
+      ATFIX_CHECK(stats.stallUs == 30);
+      ATFIX_CHECK(stats.maxStallUs == 20);
+    }
+  }
+
+  ATFIX_CHECK(bufferReadbacks == 2);
+}
+
+
+static void testOverwrite() {
+  core::HazardDetector detector;
+
+  core::ResourceDesc srcDesc = desc(core::Usage::Default, 128);
+  core::ResourceDesc dstDesc = desc(core::Usage::Staging, 128);
+
+  // A copy of a copy only knows the last producer of its source
+  detector.registerWrite(key(1), core::WriteKind::CpuWrite);
+  detector.registerCopy(key(2), key(1), core::WriteKind::Copy, core::Dimension::Texture2D, srcDesc);
+  detector.registerCopy(key(3), key(2), core::WriteKind::Copy, core::Dimension::Texture2D, srcDesc);
+  detector.registerReadback(key(3), core::Dimension::Texture2D, dstDesc, core::MapType::Read, 10);
+
+  // The latest write to the mapped resource wins
+  detector.registerCopy(key(4), key(1), core::WriteKind::Copy, core::Dimension::Texture2D, srcDesc);
+  detector.registerWrite(key(4), core::WriteKind::Update);
+  detector.registerReadback(key(4), core::Dimension::Texture2D, dstDesc, core::MapType::Read, 20);
+
+  auto top = detector.takeTop(5);
+  ATFIX_CHECK(top.size() == 2);
+
+  if (top.size() == 2) {
+    ATFIX_CHECK(top[0].signature.producer == core::WriteKind::Update);
+    ATFIX_CHECK(top[0].signature.srcProducer == core::WriteKind::Unobserved);
+    ATFIX_CHECK(top[1].signature.producer == core::WriteKind::Copy);
+    ATFIX_CHECK(top[1].signature.srcProducer == core::WriteKind::Copy);
+  }
+}
+
+
+int main() {
+  test::run("hazard/copy-chain", &testCopyChain);
+  test::run("hazard/producer-kinds", &testProducerKinds);
+  test::run("hazard/ranking", &testRanking);
+  test::run("hazard/generations", &testGenerations);
+  test::run("hazard/signature-split", &testSignatureSplit);
+  test::run("hazard/overwrite", &testOverwrite);
+  return test::finish();
+}
@@ -0,0 +1,95 @@
+#include "core/lineage.h"
+
+#include "test.h"
+
+using namespace atfix;
+
+static core::ResourceKey key(uintptr_t pointer, uint64_t generation = 1) {
+  core::ResourceKey result;
+  result.pointer = reinterpret_cast<const void*>(pointer);
+  result.generation = generation;
+  return result;
+}
+
+
+static void testCopyInheritsPayload() {
+  core::LineageTracker lineage;
+  uint64_t payload = 0;
+
+  lineage.registerWrite(key(1), 0x1234);
+  ATFIX_CHECK(!lineage.getPayload(key(1), &payload));
+
+  lineage.registerCopy(key(2), key(1));
+  ATFIX_CHECK(lineage.getPayload(key(2), &payload) && payload == 0x1234);
+
+  // Later uploads do not change what was already copied
+  lineage.registerWrite(key(1), 0x5678);
+  ATFIX_CHECK(lineage.getPayload(key(2), &payload) && payload == 0x1234);
+
+  lineage.registerCopy(key(2), key(1));
+  ATFIX_CHECK(lineage.getPayload(key(2), &payload) && payload == 0x5678);
+}
+
+
+static void testUnknownSources() {
+  core::LineageTracker lineage;
+  uint64_t payload = 0;
+
+  lineage.registerWrite(key(1), 0x1234);
+  lineage.registerCopy(key(2), key(1));
+
+  // Copies of unknown or unrelated data forget the payload
+  lineage.registerCopy(key(2), core::ResourceKey());
+  ATFIX_CHECK(!lineage.getPayload(key(2), &payload));
+
+  lineage.registerCopy(key(2), key(1));
+  lineage.registerCopy(key(2), key(3));
+  ATFIX_CHECK(!lineage.getPayload(key(2), &payload));
+
+  // As do uploads of unknown data
+  lineage.registerWrite(key(1), 0);
+  lineage.registerCopy(key(2), key(1));
+  ATFIX_CHECK(!lineage.getPayload(key(2), &payload));
+}
+
+
+static void testRetire() {
+  core::LineageTracker lineage;
+  uint64_t payload = 0;
+
+  lineage.registerWrite(key(1), 0x1234);
+  lineage.registerCopy(key(2), key(1));
+
+  lineage.retire(key(1));
+  lineage.registerCopy(key(3), key(1));
+  ATFIX_CHECK(!lineage.getPayload(key(3), &payload));
+
+  lineage.retire(key(2));
+  ATFIX_CHECK(!lineage.getPayload(key(2), &payload));
+}
+
+
+static void testGenerations() {
+  core::LineageTracker lineage;
+  uint64_t payload = 0;
+
+  // A new resource at a reused address starts out unknown
+  lineage.registerWrite(key(1, 1), 0x1234);
+  lineage.registerCopy(key(2, 1), key(1, 1));
+
+  lineage.registerCopy(key(3), key(1, 2));
+  ATFIX_CHECK(!lineage.getPayload(key(3), &payload));
+  ATFIX_CHECK(!lineage.getPayload(key(2, 2), &payload));
+
+  lineage.clear();
+  ATFIX_CHECK(!lineage.getPayload(key(2, 1), &payload));
+}
+
+
+int main() {
+  test::run("lineage/copy-inherits-payload", &testCopyInheritsPayload);
+  test::run("lineage/unknown-sources", &testUnknownSources);
+  test::run("lineage/retire", &testRetire);
+  test::run("lineage/generations", &testGenerations);
+  return test::finish();
+}
@@ -0,0 +1,165 @@
+#include <vector>
+
+#include "../read_profile.h"
+
+#include "test.h"
+
+using namespace atfix;
+
+static core::ResourceKey key(uintptr_t pointer, uint64_t generation = 1) {
+  core::ResourceKey result;
+  result.pointer = reinterpret_cast<const void*>(pointer);
+  result.generation = generation;
+  return result;
+}
+
+
+/** One row per page, so that rows and faults line up */
+constexpr UINT RowSize = GuardedBuffer::PageSize;
+constexpr UINT RowCount = 16;
+
+static const void* const CallSiteA = reinterpret_cast<const void*>(uintptr_t(0x1000));
+static const void* const CallSiteB = reinterpret_cast<const void*>(uintptr_t(0x2000));
+
+
+/** Maps a readback and reads the given rows, returns the values read */
+static std::vector<uint8_t> readRows(ReadProfiler& profiler, std::vector<uint8_t>& real,
+    const void* pCallSite, UINT rowBegin, UINT rowEnd) {
+  D3D11_MAPPED_SUBRESOURCE mapped = { };
+  mapped.pData = real.data();
+  mapped.RowPitch = RowSize;
+  mapped.DepthPitch = RowSize * RowCount;
+
+  std::vector<uint8_t> result;
+
+  bool isProfiled = profiler.mapProfiled(key(1), pCallSite, RowSize, RowCount, &mapped);
+  ATFIX_CHECK(isProfiled);
+  ATFIX_CHECK(mapped.pData != real.data());
+
+  auto data = static_cast<const volatile uint8_t*>(mapped.pData);
+
+  for (UINT y = rowBegin; y < rowEnd; y++)
+    result.push_back(uint8_t(data[y * mapped.RowPitch]));
+
+  profiler.unmapProfiled(key(1));
+  return result;
+}
+
+
+static std::vector<uint8_t> texture() {
+  std::vector<uint8_t> result(RowSize * RowCount);
+
+  for (UINT y = 0; y < RowCount; y++)
+    result[y * RowSize] = uint8_t(y + 1);
+
+  return result;
+}
+
+
+static void testFootprint() {
+  ReadProfiler profiler(2, false);
+  std::vector<uint8_t> real = texture();
+
+  std::vector<uint8_t> values = readRows(profiler, real, CallSiteA, 4, 8);
+  ATFIX_CHECK(values.size() == 4 && values[0] == 5 && values[3] == 8);
+
+  readRows(profiler, real, CallSiteA, 2, 6);
+
+  ReadProfileStats stats = profiler.takeStats();
+  ATFIX_CHECK(stats.faults == 8);
+  ATFIX_CHECK(stats.sites.size() == 1);
+
+  if (stats.sites.size() == 1) {
+    const ReadSiteStats& site = stats.sites[0];
+    ATFIX_CHECK(site.callSite == CallSiteA);
+    ATFIX_CHECK(site.maps == 2);
+    ATFIX_CHECK(site.touchedRows == 8);
+    ATFIX_CHECK(site.totalRows == 2 * RowCount);
+    ATFIX_CHECK(site.rowBegin == 2);
+    ATFIX_CHECK(site.rowEnd == 8);
+    ATFIX_CHECK(!site.stable);
+  }
+
+  // The footprint stays, counters are reset
+  readRows(profiler, real, CallSiteA, 3, 5);
+  readRows(profiler, real, CallSiteA, 6, 7);
+
+  stats = profiler.takeStats();
+  ATFIX_CHECK(stats.sites.size() == 1);
+
+  if (stats.sites.size() == 1) {
+    ATFIX_CHECK(stats.sites[0].maps == 2);
+    ATFIX_CHECK(stats.sites[0].rowBegin == 2);
+    ATFIX_CHECK(stats.sites[0].rowEnd == 8);
+    ATFIX_CHECK(stats.sites[0].stable);
+  }
+
+  ATFIX_CHECK(profiler.takeStats().sites.empty());
+}
+
+
+static void testShrinkCopy() {
+  ReadProfiler profiler(1, true);
+  std::vector<uint8_t> real = texture();
+
+  UINT rowBegin = 0;
+  UINT rowEnd = 0;
+
+  // No call site has mapped, nothing is known to be unused
+  ATFIX_CHECK(!profiler.shrinkCopy(key(1), RowSize, RowCount, &rowBegin, &rowEnd));
+
+  readRows(profiler, real, CallSiteA, 4, 6);
+  readRows(profiler, real, CallSiteB, 8, 10);
+  ATFIX_CHECK(!profiler.shrinkCopy(key(1), RowSize, RowCount, &rowBegin, &rowEnd));
+
+  readRows(profiler, real, CallSiteA, 4, 6);
+  readRows(profiler, real, CallSiteB, 8, 10);
+  ATFIX_CHECK(profiler.shrinkCopy(key(1), RowSize, RowCount, &rowBegin, &rowEnd));
+  ATFIX_CHECK(rowBegin == 4);
+  ATFIX_CHECK(rowEnd == 10);
+
+  // Only the copied rows reach the game
+  real[4 * RowSize] = 0x80;
+  real[2 * RowSize] = 0x80;
+
+  std::vector<uint8_t> values = readRows(profiler, real, CallSiteA, 4, 5);
+  ATFIX_CHECK(values.size() == 1 && values[0] == 0x80);
+
+  ReadProfileStats stats = profiler.takeStats();
+  ATFIX_CHECK(stats.shrunkCopies == 1);
+  ATFIX_CHECK(stats.savedBytes == uint64_t(RowCount - 6) * RowSize);
+
+  // A full copy makes every row valid again
+  profiler.invalidate(key(1));
+  values = readRows(profiler, real, CallSiteA, 2, 3);
+  ATFIX_CHECK(values.size() == 1 && values[0] == 0x80);
+}
+
+
+static void testStaleRead() {
+  ReadProfiler profiler(1, true);
+  std::vector<uint8_t> real = texture();
+
+  readRows(profiler, real, CallSiteA, 4, 6);
+  readRows(profiler, real, CallSiteA, 4, 6);
+
+  UINT rowBegin = 0;
+  UINT rowEnd = 0;
+
+  ATFIX_CHECK(profiler.shrinkCopy(key(1), RowSize, RowCount, &rowBegin, &rowEnd));
+
+  // Reading outside of the copied rows turns shrinking off for good
+  readRows(profiler, real, CallSiteA, 12, 13);
+  readRows(profiler, real, CallSiteA, 4, 13);
+  readRows(profiler, real, CallSiteA, 4, 13);
+
+  ATFIX_CHECK(!profiler.shrinkCopy(key(1), RowSize, RowCount, &rowBegin, &rowEnd));
+}
+
+
+int main() {
+  test::run("read_profile/footprint", &testFootprint);
+  test::run("read_profile/shrink-copy", &testShrinkCopy);
+  test::run("read_profile/stale-read", &testStaleRead);
+  return test::finish();
+}
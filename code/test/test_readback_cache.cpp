@@ -0,0 +1,249 @@
+#include <cstring>
+#include <vector>
+
+#include "core/checksum.h"
+#include "core/readback_cache.h"
+
+#include "test.h"
+
+using namespace atfix;
+
+/** Mostly transparent image with a few glyph-like rows, some of
+ *  them ending at unaligned offsets, inside a padded pitch */
+static std::vector<uint8_t> createGlyphData(uint32_t rowPitch, uint32_t rowSize, uint32_t rowCount, uint8_t seed) {
+  std::vector<uint8_t> data(size_t(rowPitch) * rowCount, 0xcc);
+
+  for (uint32_t y = 0; y < rowCount; y++) {
+    uint8_t* pRow = &data[size_t(y) * rowPitch];
+    std::memset(pRow, 0, rowSize);
+
+    if (y < rowCount / 4 || y >= rowCount / 2)
+      continue;
+
+    for (uint32_t x = 37; x < rowSize - 21; x += 3)
+      pRow[x] = uint8_t(seed + x * 7 + y);
+  }
+
+  return data;
+}
+
+
+static void testRoundTrip() {
+  const uint32_t rowSize = 512 * 4;
+  const uint32_t rowPitch = rowSize + 64;
+  const uint32_t rowCount = 64;
+
+  auto data = createGlyphData(rowPitch, rowSize, rowCount, 1);
+  auto image = core::createReadbackImage(data.data(), rowPitch, rowSize, rowCount);
+
+  ATFIX_CHECK(image->rowSize == rowSize);
+  ATFIX_CHECK(image->rowCount == rowCount);
+  ATFIX_CHECK(image->hash == core::calculateHash(data.data(), rowPitch, rowSize, rowCount));
+  ATFIX_CHECK(image->getStoredSize() < image->getRawSize());
+
+  // Padding between rows must be left alone
+  std::vector<uint8_t> result(data.size(), 0xcc);
+  core::decompressReadbackImage(*image, result.data(), rowPitch);
+
+  ATFIX_CHECK(result == data);
+}
+
+
+static void testRoundTripEmpty() {
+  const uint32_t rowSize = 256;
+  const uint32_t rowCount = 16;
+
+  std::vector<uint8_t> data(size_t(rowSize) * rowCount, 0);
+  auto image = core::createReadbackImage(data.data(), rowSize, rowSize, rowCount);
+
+  std::vector<uint8_t> result(data.size(), 0xff);
+  core::decompressReadbackImage(*image, result.data(), rowSize);
+
+  ATFIX_CHECK(result == data);
+}
+
+
+static void testRoundTripSlices() {
+  const uint32_t rowSize = 128;
+  const uint32_t rowPitch = 192;
+  const uint32_t rowCount = 16;
+  const uint32_t sliceCount = 3;
+  const uint32_t depthPitch = rowPitch * rowCount + 256;
+
+  std::vector<uint8_t> data(size_t(depthPitch) * sliceCount, 0);
+
+  for (uint32_t z = 0; z < sliceCount; z++) {
+    auto slice = createGlyphData(rowPitch, rowSize, rowCount, uint8_t(z * 50));
+    std::memcpy(&data[size_t(z) * depthPitch], slice.data(), slice.size());
+  }
+
+  auto image = core::createReadbackImage(data.data(), rowPitch, depthPitch, rowSize, rowCount, sliceCount);
+
+  ATFIX_CHECK(image->sliceCount == sliceCount);
+  ATFIX_CHECK(image->hash == core::calculateHash(data.data(), rowPitch, depthPitch, rowSize, rowCount, sliceCount));
+
+  // Slices come out packed
+  std::vector<uint8_t> result(size_t(rowPitch) * rowCount * sliceCount, 0);
+  core::decompressReadbackImage(*image, result.data(), rowPitch);
+
+  for (uint32_t z = 0; z < sliceCount; z++) {
+    for (uint32_t y = 0; y < rowCount; y++) {
+      ATFIX_CHECK(!std::memcmp(&result[(size_t(z) * rowCount + y) * rowPitch],
+        &data[size_t(z) * depthPitch + size_t(y) * rowPitch], rowSize));
+    }
+  }
+}
+
+
+static void testRoundTripDense() {
+  const uint32_t rowSize = 300;
+  const uint32_t rowPitch = 320;
+  const uint32_t rowCount = 8;
+
+  // Data without zero runs only stores literals
+  std::vector<uint8_t> data(size_t(rowPitch) * rowCount, 0xcc);
+
+  for (uint32_t y = 0; y < rowCount; y++) {
+    for (uint32_t x = 0; x < rowSize; x++)
+      data[size_t(y) * rowPitch + x] = uint8_t(1 + (x * 13 + y * 5) % 255);
+  }
+
+  auto image = core::createReadbackImage(data.data(), rowPitch, rowSize, rowCount);
+
+  std::vector<uint8_t> result(data.size(), 0xcc);
+  core::decompressReadbackImage(*image, result.data(), rowPitch);
+
+  ATFIX_CHECK(result == data);
+}
+
+
+static void testRoundTripEdges() {
+  const uint32_t rowSize = 61;
+  const uint32_t rowCount = 5;
+
+  // Single bytes in the first and last column, at unaligned
+  // offsets, and in the first and last row
+  std::vector<uint8_t> data(size_t(rowSize) * rowCount, 0);
+  data[0] = 1;
+  data[rowSize - 1] = 2;
+  data[2 * rowSize + 9] = 3;
+  data[rowCount * rowSize - 1] = 4;
+
+  auto image = core::createReadbackImage(data.data(), rowSize, rowSize, rowCount);
+
+  ATFIX_CHECK(image->rowBegin == 0);
+  ATFIX_CHECK(image->rowEnd == rowCount);
+  ATFIX_CHECK(image->colEnd <= rowSize);
+
+  std::vector<uint8_t> result(data.size(), 0xff);
+  core::decompressReadbackImage(*image, result.data(), rowSize);
+
+  ATFIX_CHECK(result == data);
+}
+
+
+static void testLruBudget() {
+  const uint32_t rowSize = 512;
+  const uint32_t rowCount = 32;
+
+  std::vector<std::shared_ptr<const core::ReadbackImage>> images;
+
+  for (uint32_t i = 0; i < 4; i++) {
+    auto data = createGlyphData(rowSize, rowSize, rowCount, uint8_t(i * 31));
+    images.push_back(core::createReadbackImage(data.data(), rowSize, rowSize, rowCount));
+  }
+
+  // Room for three images of about the same size
+  size_t size = images[0]->getStoredSize();
+  core::ReadbackCache cache(size * 3 + size / 2);
+
+  cache.insert(1, images[0]);
+  cache.insert(2, images[1]);
+  cache.insert(3, images[2]);
+
+  ATFIX_CHECK(cache.getStats().entries == 3);
+
+  // Using the oldest entry makes the second one the LRU entry
+  ATFIX_CHECK(cache.lookup(1) == images[0]);
+
+  cache.insert(4, images[3]);
+
+  core::ReadbackCacheStats stats = cache.getStats();
+  ATFIX_CHECK(stats.entries == 3);
+  ATFIX_CHECK(stats.evictions == 1);
+  ATFIX_CHECK(stats.storedBytes <= size * 3 + size / 2);
+
+  ATFIX_CHECK(cache.lookup(1) == images[0]);
+  ATFIX_CHECK(cache.lookup(2) == nullptr);
+  ATFIX_CHECK(cache.lookup(3) == images[2]);
+  ATFIX_CHECK(cache.lookup(4) == images[3]);
+
+  cache.invalidate(3);
+  ATFIX_CHECK(cache.lookup(3) == nullptr);
+  ATFIX_CHECK(cache.getStats().entries == 2);
+}
+
+
+static void testOversizedImage() {
+  const uint32_t rowSize = 512;
+  const uint32_t rowCount = 32;
+
+  auto data = createGlyphData(rowSize, rowSize, rowCount, 7);
+  auto image = core::createReadbackImage(data.data(), rowSize, rowSize, rowCount);
+
+  core::ReadbackCache cache(image->getStoredSize() - 1);
+  cache.insert(1, image);
+
+  ATFIX_CHECK(cache.lookup(1) == nullptr);
+  ATFIX_CHECK(cache.getStats().entries == 0);
+  ATFIX_CHECK(cache.getStats().storedBytes == 0);
+}
+
+
+static void testReplaceAndClear() {
+  const uint32_t rowSize = 512;
+  const uint32_t rowCount = 32;
+
+  auto dataA = createGlyphData(rowSize, rowSize, rowCount, 3);
+  auto dataB = createGlyphData(rowSize, rowSize, rowCount, 5);
+  auto imageA = core::createReadbackImage(dataA.data(), rowSize, rowSize, rowCount);
+  auto imageB = core::createReadbackImage(dataB.data(), rowSize, rowSize, rowCount);
+
+  core::ReadbackCache cache(1u << 20);
+
+  // Replacing an image does not count it twice
+  cache.insert(1, imageA);
+  cache.insert(1, imageB);
+  ATFIX_CHECK(cache.lookup(1) == imageB);
+
+  core::ReadbackCacheStats stats = cache.getStats();
+  ATFIX_CHECK(stats.entries == 1);
+  ATFIX_CHECK(stats.storedBytes == imageB->getStoredSize());
+  ATFIX_CHECK(stats.rawBytes == imageB->getRawSize());
+  ATFIX_CHECK(stats.evictions == 0);
+
+  // Images handed out stay usable after they leave the cache
+  auto image = cache.lookup(1);
+  cache.clear();
+
+  ATFIX_CHECK(cache.lookup(1) == nullptr);
+  ATFIX_CHECK(cache.getStats().entries == 0);
+  ATFIX_CHECK(cache.getStats().storedBytes == 0);
+
+  std::vector<uint8_t> result(dataB.size());
+  core::decompressReadbackImage(*image, result.data(), rowSize);
+  ATFIX_CHECK(result == dataB);
+}
+
+
+int main() {
+  test::run("readback_cache/round-trip", &testRoundTrip);
+  test::run("readback_cache/round-trip-empty", &testRoundTripEmpty);
+  test::run("readback_cache/round-trip-slices", &testRoundTripSlices);
+  test::run("readback_cache/round-trip-dense", &testRoundTripDense);
+  test::run("readback_cache/round-trip-edges", &testRoundTripEdges);
+  test::run("readback_cache/lru-budget", &testLruBudget);
+  test::run("readback_cache/oversized-image", &testOversizedImage);
+  test::run("readback_cache/replace-and-clear", &testReplaceAndClear);
+  return test::finish();
+}
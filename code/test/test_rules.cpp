@@ -0,0 +1,293 @@
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/rules.h"
+
+#include "test.h"
+
+using namespace atfix;
+
+static std::unique_ptr<core::RuleSet> buildRules(const char* pText, std::vector<std::string>* pErrors) {
+  std::istringstream stream(pText);
+  std::vector<core::Rule> rules;
+  core::parseRules(stream, &rules, pErrors);
+
+  auto result = std::make_unique<core::RuleSet>();
+
+  for (const auto& rule : rules)
+    ATFIX_CHECK(result->addRule(rule));
+
+  return result;
+}
+
+
+static core::ResourceDesc glyphDesc(core::Usage usage, uint32_t cpu) {
+  core::ResourceDesc desc;
+  desc.width = 512;
+  desc.height = 512;
+  desc.usage = usage;
+  desc.cpuAccessFlags = cpu;
+  desc.format = 90;
+  return desc;
+}
+
+
+static void testDefaultRules() {
+  std::vector<std::string> errors;
+  auto rules = buildRules(core::getDefaultRulesText(), &errors);
+
+  ATFIX_CHECK(errors.empty());
+  ATFIX_CHECK(rules->getRules().size() == 5);
+
+  core::ResourceDesc upload = glyphDesc(core::Usage::Dynamic, 0x10000);
+  core::ResourceDesc readback = glyphDesc(core::Usage::Staging, 0x20000);
+
+  uint32_t uploadClass = rules->classify(upload);
+  uint32_t readbackClass = rules->classify(readback);
+
+  ATFIX_CHECK(rules->getMapActions(uploadClass, core::MapType::WriteDiscard)
+    == (core::RuleActionTrace | core::RuleActionShadow | core::RuleActionCache));
+  ATFIX_CHECK(rules->getMapActions(uploadClass, core::MapType::Read) == 0);
+
+  ATFIX_CHECK(rules->getMapActions(readbackClass, core::MapType::Read)
+    == (core::RuleActionTrace | core::RuleActionCache | core::RuleActionProfile));
+  ATFIX_CHECK(rules->getCopyActions(readbackClass, uploadClass)
+    == (core::RuleActionTrace | core::RuleActionCache | core::RuleActionProfile | core::RuleActionFlush));
+
+  // Other readbacks fall through to the generic rules
+  core::ResourceDesc other = readback;
+  other.width = 256;
+
+  uint32_t otherClass = rules->classify(other);
+
+  ATFIX_CHECK(rules->getMapActions(otherClass, core::MapType::Read)
+    == (core::RuleActionTrace | core::RuleActionCache));
+  ATFIX_CHECK(rules->getMapActions(otherClass, core::MapType::ReadWrite)
+    == (core::RuleActionTrace | core::RuleActionCache));
+  ATFIX_CHECK(rules->getCopyActions(otherClass, uploadClass)
+    == (core::RuleActionTrace | core::RuleActionCache | core::RuleActionProfile | core::RuleActionFlush));
+
+  // Glyph copies need a read-only destination
+  core::ResourceDesc readWrite = readback;
+  readWrite.cpuAccessFlags = 0x30000;
+
+  ATFIX_CHECK(rules->getCopyActions(rules->classify(readWrite), uploadClass) == core::RuleActionFlush);
+  ATFIX_CHECK(rules->getCopyActions(uploadClass, readbackClass) == 0);
+}
+
+
+static void testFirstMatchWins() {
+  std::vector<std::string> errors;
+  auto rules = buildRules(
+    "[small]\n"
+    "map = READ\n"
+    "width = 1-64\n"
+    "actions = pass\n"
+    "\n"
+    "[any]\n"
+    "map = READ\n"
+    "usage = STAGING, DEFAULT\n"
+    "format = 28, 87\n"
+    "actions = trace\n", &errors);
+
+  ATFIX_CHECK(errors.empty());
+
+  core::ResourceDesc desc;
+  desc.width = 32;
+  desc.height = 32;
+  desc.usage = core::Usage::Staging;
+  desc.format = 28;
+
+  ATFIX_CHECK(rules->getMapActions(rules->classify(desc), core::MapType::Read) == 0);
+
+  desc.width = 128;
+  ATFIX_CHECK(rules->getMapActions(rules->classify(desc), core::MapType::Read) == core::RuleActionTrace);
+
+  desc.format = 90;
+  ATFIX_CHECK(rules->getMapActions(rules->classify(desc), core::MapType::Read) == 0);
+
+  desc.format = 87;
+  desc.usage = core::Usage::Dynamic;
+  ATFIX_CHECK(rules->getMapActions(rules->classify(desc), core::MapType::Read) == 0);
+}
+
+
+static void testInvalidRules() {
+  std::vector<std::string> errors;
+  auto rules = buildRules(
+    "stray = 1\n"
+    "[bad-usage]\n"
+    "usage = SOMETIMES\n"
+    "actions = trace\n"
+    "\n"
+    "[bad-line]\n"
+    "width 512\n"
+    "actions = trace\n"
+    "\n"
+    "[src-on-map]\n"
+    "call = map\n"
+    "src.usage = DYNAMIC\n"
+    "actions = trace\n"
+    "\n"
+    "[good]\n"
+    "call = copy ; comment\n"
+    "dst.usage = STAGING\n"
+    "actions = flush # comment\n", &errors);
+
+  ATFIX_CHECK(rules->getRules().size() == 1);
+  ATFIX_CHECK(rules->getRules().size() == 1 && rules->getRules()[0].name == "good");
+
+  // One message per invalid line, and one per dropped rule
+  ATFIX_CHECK(errors.size() == 7);
+
+  core::ResourceDesc staging;
+  staging.usage = core::Usage::Staging;
+
+  core::ResourceDesc source;
+
+  ATFIX_CHECK(rules->getCopyActions(rules->classify(staging), rules->classify(source)) == core::RuleActionFlush);
+  ATFIX_CHECK(rules->getMapActions(rules->classify(staging), core::MapType::Read) == 0);
+}
+
+
+static void testConditionLimit() {
+  core::RuleSet rules;
+
+  for (uint32_t i = 0; i < core::RuleSet::MaxConditions; i++) {
+    core::Rule rule;
+    rule.name = std::to_string(i);
+    rule.dst.minWidth = i + 1;
+    rule.dst.maxWidth = i + 1;
+    ATFIX_CHECK(rules.addRule(rule));
+  }
+
+  core::Rule rule;
+  rule.dst.minWidth = 1000;
+  ATFIX_CHECK(!rules.addRule(rule));
+
+  // Rules that reuse existing conditions still fit
+  rule.dst.minWidth = 1;
+  rule.dst.maxWidth = 1;
+  ATFIX_CHECK(rules.addRule(rule));
+}
+
+
+static void testClassCache() {
+  core::Rule rule;
+  rule.name = "wide";
+  rule.dst.minWidth = 256;
+  rule.actions = core::RuleActionTrace;
+
+  core::RuleSet rules;
+  ATFIX_CHECK(rules.addRule(rule));
+
+  core::ResourceDesc desc;
+  desc.width = 512;
+  desc.usage = core::Usage::Staging;
+
+  uint32_t wideClass = rules.classify(desc);
+  ATFIX_CHECK(rules.classify(desc) == wideClass);
+  ATFIX_CHECK(rules.getMapActions(wideClass, core::MapType::Read) == core::RuleActionTrace);
+
+  // A new condition must show up in cached classes
+  rule.name = "staging";
+  rule.dst = core::RuleDescMatch();
+  rule.dst.usages = 1u << uint32_t(core::Usage::Staging);
+  rule.actions = core::RuleActionCache;
+  ATFIX_CHECK(rules.addRule(rule));
+
+  uint32_t stagingClass = rules.classify(desc);
+  ATFIX_CHECK(stagingClass != wideClass);
+
+  desc.width = 128;
+  ATFIX_CHECK(rules.getMapActions(rules.classify(desc), core::MapType::Read) == core::RuleActionCache);
+
+  // Eviction keeps results correct
+  for (uint32_t i = 0; i < core::RuleSet::MaxCachedClasses + 16; i++) {
+    desc.width = i;
+    ATFIX_CHECK(rules.getMapActions(rules.classify(desc), core::MapType::Read)
+      == (i >= 256 ? core::RuleActionTrace : core::RuleActionCache));
+  }
+}
+
+
+static void testFlagsAndRanges() {
+  std::vector<std::string> errors;
+  auto rules = buildRules(
+    "[tall-readback]\n"
+    "map = read, READ_WRITE\n"
+    "height = 256 - 1024\n"
+    "cpu = 0x20000\n"
+    "bind = 0\n"
+    "actions = trace, profile\n"
+    "\n"
+    "[shader-copy]\n"
+    "call = copy\n"
+    "src.bind = 8\n"
+    "dst.cpu = 0x20000\n"
+    "actions = cache\n", &errors);
+
+  ATFIX_CHECK(errors.empty());
+
+  core::ResourceDesc readback;
+  readback.width = 16;
+  readback.height = 512;
+  readback.usage = core::Usage::Staging;
+  readback.cpuAccessFlags = 0x20000;
+
+  uint32_t readbackClass = rules->classify(readback);
+
+  ATFIX_CHECK(rules->getMapActions(readbackClass, core::MapType::Read)
+    == (core::RuleActionTrace | core::RuleActionProfile));
+  ATFIX_CHECK(rules->getMapActions(readbackClass, core::MapType::ReadWrite)
+    == (core::RuleActionTrace | core::RuleActionProfile));
+  ATFIX_CHECK(rules->getMapActions(readbackClass, core::MapType::WriteDiscard) == 0);
+
+  // Flags must match exactly, not just overlap
+  core::ResourceDesc other = readback;
+  other.cpuAccessFlags = 0x30000;
+  ATFIX_CHECK(rules->getMapActions(rules->classify(other), core::MapType::Read) == 0);
+
+  other = readback;
+  other.height = 1025;
+  ATFIX_CHECK(rules->getMapActions(rules->classify(other), core::MapType::Read) == 0);
+
+  core::ResourceDesc source;
+  source.bindFlags = 8;
+
+  ATFIX_CHECK(rules->getCopyActions(readbackClass, rules->classify(source)) == core::RuleActionCache);
+
+  source.bindFlags = 9;
+  ATFIX_CHECK(rules->getCopyActions(readbackClass, rules->classify(source)) == 0);
+}
+
+
+static void testFormatActions() {
+  ATFIX_CHECK(core::formatRuleActions(0) == "pass");
+  ATFIX_CHECK(core::formatRuleActions(core::RuleActionFlush) == "flush");
+  ATFIX_CHECK(core::formatRuleActions(core::RuleActionCache | core::RuleActionTrace) == "trace, cache");
+
+  // Formatted actions parse back to the same mask
+  core::RuleActions actions = core::RuleActionShadow | core::RuleActionProfile | core::RuleActionFlush;
+  std::string text = "[r]\nactions = " + core::formatRuleActions(actions) + "\n";
+
+  std::vector<std::string> errors;
+  auto rules = buildRules(text.c_str(), &errors);
+
+  ATFIX_CHECK(errors.empty());
+  ATFIX_CHECK(rules->getRules().size() == 1 && rules->getRules()[0].actions == actions);
+}
+
+
+int main() {
+  test::run("rules/default-rules", &testDefaultRules);
+  test::run("rules/first-match-wins", &testFirstMatchWins);
+  test::run("rules/invalid-rules", &testInvalidRules);
+  test::run("rules/condition-limit", &testConditionLimit);
+  test::run("rules/class-cache", &testClassCache);
+  test::run("rules/flags-and-ranges", &testFlagsAndRanges);
+  test::run("rules/format-actions", &testFormatActions);
+  return test::finish();
+}
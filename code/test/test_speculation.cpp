@@ -0,0 +1,290 @@
+#include <cstring>
+#include <vector>
+
+#include "../speculation.h"
+#include "../trace.h"
+
+#include "../mock/mock_d3d11.h"
+
+#include "test.h"
+
+using namespace atfix;
+
+static ID3D11Device* g_device = nullptr;
+static ID3D11DeviceContext* g_context = nullptr;
+
+constexpr UINT Size = 16;
+
+
+static core::ResourceKey key(uintptr_t pointer, uint64_t generation = 1) {
+  core::ResourceKey result;
+  result.pointer = reinterpret_cast<const void*>(pointer);
+  result.generation = generation;
+  return result;
+}
+
+
+static ResourceInfo glyphInfo() {
+  ResourceInfo result;
+  result.dimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
+  result.width = Size;
+  result.height = Size;
+  result.depth = 1;
+  result.mipLevels = 1;
+  result.arraySize = 1;
+  result.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+  result.usage = D3D11_USAGE_STAGING;
+  result.cpuAccessFlags = D3D11_CPU_ACCESS_READ;
+  return result;
+}
+
+
+static std::vector<uint8_t> glyph(uint8_t seed) {
+  std::vector<uint8_t> result(Size * Size * 4);
+
+  for (size_t i = 0; i < result.size(); i++)
+    result[i] = uint8_t(i * 7u + seed);
+
+  return result;
+}
+
+
+/** Passes a readback that reached the GPU to the speculator */
+static void readBack(ReadbackSpeculator& speculator, const core::ResourceKey& Resource, std::vector<uint8_t>& data) {
+  SubresourceLayout layout;
+  getSubresourceLayout(glyphInfo(), 0, &layout);
+
+  D3D11_MAPPED_SUBRESOURCE mapped = { };
+  mapped.pData = data.data();
+  mapped.RowPitch = Size * 4;
+  mapped.DepthPitch = Size * Size * 4;
+
+  speculator.registerReadback(Resource, 0, mapped, layout);
+}
+
+
+static void copy(ReadbackSpeculator& speculator, const core::ResourceKey& Dst, const core::ResourceKey& Src,
+    ID3D11Resource* pSrc = nullptr, UINT DstX = 0, bool isServable = true) {
+  ResourceInfo info = glyphInfo();
+  speculator.registerCopy(g_context, Dst, 0, DstX, 0, 0, Src, pSrc, 0, nullptr, info, info, isServable);
+}
+
+
+/** Maps a resource and checks whether it was served with the given data */
+static bool isServed(ReadbackSpeculator& speculator, const core::ResourceKey& Resource, const std::vector<uint8_t>& data) {
+  D3D11_MAPPED_SUBRESOURCE mapped = { };
+
+  if (!speculator.mapSpeculative(Resource, 0, &mapped))
+    return false;
+
+  ATFIX_CHECK(mapped.RowPitch == Size * 4);
+  ATFIX_CHECK(!std::memcmp(mapped.pData, data.data(), data.size()));
+  ATFIX_CHECK(speculator.unmapSpeculative(Resource, 0));
+  return true;
+}
+
+
+static Config config() {
+  Config result;
+  result.speculativeReadback = true;
+  result.speculativeMaxMismatches = 2;
+  return result;
+}
+
+
+static void testHit() {
+  ReadbackValidator validator(4, 0.0);
+  ReadbackSpeculator speculator(config(), &validator);
+
+  std::vector<uint8_t> data = glyph(1);
+
+  // The first readback of a payload goes to the GPU
+  speculator.registerWrite(key(1), 42);
+  copy(speculator, key(2), key(1));
+  ATFIX_CHECK(!isServed(speculator, key(2), data));
+  readBack(speculator, key(2), data);
+
+  // Later copies of the same payload are served, once each
+  speculator.registerWrite(key(1), 42);
+  copy(speculator, key(3), key(1));
+  ATFIX_CHECK(isServed(speculator, key(3), data));
+  ATFIX_CHECK(!isServed(speculator, key(3), data));
+  ATFIX_CHECK(!speculator.unmapSpeculative(key(3), 0));
+
+  SpeculationStats stats = speculator.takeStats();
+  ATFIX_CHECK(stats.hits == 1);
+  ATFIX_CHECK(stats.misses == 1);
+  ATFIX_CHECK(stats.mismatches == 0);
+}
+
+
+static void testUnknownPayload() {
+  ReadbackValidator validator(4, 0.0);
+  ReadbackSpeculator speculator(config(), &validator);
+
+  std::vector<uint8_t> data = glyph(2);
+
+  speculator.registerWrite(key(1), 42);
+  copy(speculator, key(2), key(1));
+  readBack(speculator, key(2), data);
+
+  // A new upload, and a write that is not a glyph upload
+  speculator.registerWrite(key(1), 43);
+  copy(speculator, key(2), key(1));
+  ATFIX_CHECK(!isServed(speculator, key(2), data));
+
+  speculator.registerWrite(key(1), 42);
+  speculator.invalidate(key(1));
+  copy(speculator, key(2), key(1));
+  ATFIX_CHECK(!isServed(speculator, key(2), data));
+
+  // Writing the destination after the copy drops the plan
+  speculator.registerWrite(key(1), 42);
+  copy(speculator, key(2), key(1));
+  speculator.invalidate(key(2));
+  ATFIX_CHECK(!isServed(speculator, key(2), data));
+
+  // So does destroying it
+  copy(speculator, key(2), key(1));
+  speculator.retire(key(2));
+  ATFIX_CHECK(!isServed(speculator, key(2), data));
+}
+
+
+static void testPartialCopy() {
+  ReadbackValidator validator(4, 0.0);
+  ReadbackSpeculator speculator(config(), &validator);
+
+  std::vector<uint8_t> data = glyph(3);
+
+  speculator.registerWrite(key(1), 42);
+  copy(speculator, key(2), key(1));
+  readBack(speculator, key(2), data);
+
+  // Only copies that overwrite the whole destination are served
+  copy(speculator, key(2), key(1), nullptr, 4);
+  ATFIX_CHECK(!isServed(speculator, key(2), data));
+
+  // Nor are destinations whose strategy is not speculation
+  copy(speculator, key(2), key(1), nullptr, 0, false);
+  ATFIX_CHECK(!isServed(speculator, key(2), data));
+
+  copy(speculator, key(2), key(1));
+  ATFIX_CHECK(isServed(speculator, key(2), data));
+}
+
+
+static void testFailure() {
+  ReadbackValidator validator(4, 0.0);
+  ReadbackSpeculator speculator(config(), &validator);
+
+  std::vector<uint8_t> data = glyph(4);
+
+  speculator.registerWrite(key(1), 42);
+  copy(speculator, key(2), key(1));
+  readBack(speculator, key(2), data);
+
+  // A failed validation drops the cached image
+  ReadbackValidation failure;
+  failure.lineage.payload = 42;
+  speculator.registerFailure(failure);
+
+  copy(speculator, key(2), key(1));
+  ATFIX_CHECK(!isServed(speculator, key(2), data));
+  readBack(speculator, key(2), data);
+
+  copy(speculator, key(2), key(1));
+  ATFIX_CHECK(isServed(speculator, key(2), data));
+
+  // Too many failures turn speculation off
+  speculator.registerFailure(failure);
+
+  copy(speculator, key(2), key(1));
+  readBack(speculator, key(2), data);
+  copy(speculator, key(2), key(1));
+  ATFIX_CHECK(!isServed(speculator, key(2), data));
+
+  SpeculationStats stats = speculator.takeStats();
+  ATFIX_CHECK(stats.mismatches == 2);
+  ATFIX_CHECK(stats.hits == 1);
+  ATFIX_CHECK(stats.misses == 2);
+}
+
+
+static void testSampled() {
+  ReadbackValidator validator(4, 1.0);
+  ReadbackSpeculator speculator(config(), &validator);
+
+  std::vector<uint8_t> data = glyph(5);
+
+  D3D11_TEXTURE2D_DESC desc = { };
+  desc.Width = Size;
+  desc.Height = Size;
+  desc.MipLevels = 1;
+  desc.ArraySize = 1;
+  desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+  desc.SampleDesc = { 1, 0 };
+  desc.Usage = D3D11_USAGE_DEFAULT;
+  desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+  ID3D11Texture2D* texture = nullptr;
+  ATFIX_CHECK(SUCCEEDED(g_device->CreateTexture2D(&desc, nullptr, &texture)));
+
+  if (!texture)
+    return;
+
+  getContextProcs(g_context)->UpdateSubresource(g_context, texture, 0, nullptr, data.data(), Size * 4, 0);
+
+  speculator.registerWrite(key(1), 42);
+  copy(speculator, key(2), key(1), texture);
+  readBack(speculator, key(2), data);
+
+  // Sampled hits whose copy cannot be repeated are not served
+  copy(speculator, key(2), key(1));
+  ATFIX_CHECK(!isServed(speculator, key(2), data));
+
+  // The others are served and checked against the GPU
+  copy(speculator, key(2), key(1), texture);
+  ATFIX_CHECK(isServed(speculator, key(2), data));
+
+  getContextProcs(g_context)->Flush(g_context);
+  mock::waitForMockIdle(g_device);
+
+  std::vector<ReadbackValidation> failures;
+  validator.poll(g_context, &failures);
+  ATFIX_CHECK(failures.empty());
+
+  SpeculationStats stats = speculator.takeStats();
+  ATFIX_CHECK(stats.skipped == 1);
+  ATFIX_CHECK(stats.hits == 1);
+
+  ValidationStats validation = validator.takeStats();
+  ATFIX_CHECK(validation.passed == 1);
+
+  texture->Release();
+}
+
+
+int main() {
+  MH_Initialize();
+
+  if (FAILED(mock::createMockDevice(mock::MockConfig(), &g_device, &g_context))) {
+    std::fprintf(stderr, "Failed to create mock device\n");
+    return 1;
+  }
+
+  hookContext(g_context);
+
+  test::run("speculation/hit", &testHit);
+  test::run("speculation/unknown-payload", &testUnknownPayload);
+  test::run("speculation/partial-copy", &testPartialCopy);
+  test::run("speculation/failure", &testFailure);
+  test::run("speculation/sampled", &testSampled);
+
+  g_context->Release();
+  g_device->Release();
+
+  shutdownTraceLogging();
+  MH_Uninitialize();
+  return test::finish();
+}
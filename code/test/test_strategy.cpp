@@ -0,0 +1,227 @@
+#include <array>
+
+#include "core/strategy.h"
+
+#include "test.h"
+
+using namespace atfix;
+
+static const uint32_t AvailableStrategies =
+    (1u << uint32_t(core::Strategy::Driver))
+  | (1u << uint32_t(core::Strategy::EarlyFlush))
+  | (1u << uint32_t(core::Strategy::SpinWait));
+
+/** Measured latency per readback of each strategy */
+struct Workload {
+  std::array<uint64_t, core::StrategyCount> stallUs = { };
+  std::array<uint64_t, core::StrategyCount> costUs  = { };
+};
+
+
+static core::ResourceDesc pattern() {
+  core::ResourceDesc result;
+  result.width = 512;
+  result.height = 512;
+  result.usage = core::Usage::Staging;
+  result.cpuAccessFlags = 0x20000;
+  result.format = 90;
+  return result;
+}
+
+
+/** Runs one episode of readbacks and returns its decision */
+static core::StrategyDecision runEpisode(core::StrategyController& controller, const Workload& workload) {
+  core::ResourceDesc desc = pattern();
+
+  for (uint32_t i = 0; i < 10; i++) {
+    core::Strategy strategy = controller.selectStrategy(desc, AvailableStrategies);
+    controller.registerCost(desc, workload.costUs[uint32_t(strategy)]);
+    controller.registerReadback(desc, workload.stallUs[uint32_t(strategy)]);
+  }
+
+  auto decisions = controller.endEpisode();
+  ATFIX_CHECK(decisions.size() == 1);
+
+  return decisions.empty() ? core::StrategyDecision() : decisions[0];
+}
+
+
+/** Runs episodes until the controller commits */
+static core::StrategyDecision runUntilCommit(core::StrategyController& controller, const Workload& workload, uint32_t* pTried) {
+  core::StrategyDecision decision;
+
+  for (uint32_t i = 0; i < 32; i++) {
+    decision = runEpisode(controller, workload);
+    *pTried |= 1u << uint32_t(decision.measured);
+
+    if (decision.event == core::StrategyEvent::Commit)
+      break;
+  }
+
+  return decision;
+}
+
+
+static void testCommitsToFastest() {
+  core::StrategyController controller(4, 1.5, 200);
+
+  Workload workload;
+  workload.stallUs = { 1000, 300, 600, 0 };
+
+  uint32_t tried = 0;
+  core::StrategyDecision decision = runUntilCommit(controller, workload, &tried);
+
+  ATFIX_CHECK(tried == AvailableStrategies);
+  ATFIX_CHECK(decision.event == core::StrategyEvent::Commit);
+  ATFIX_CHECK(decision.next == core::Strategy::EarlyFlush);
+  ATFIX_CHECK(decision.driverMeanUs == 1000);
+  ATFIX_CHECK(controller.getStrategy(pattern()) == core::Strategy::EarlyFlush);
+
+  decision = runEpisode(controller, workload);
+  ATFIX_CHECK(decision.event == core::StrategyEvent::Hold);
+  ATFIX_CHECK(decision.latencyUs == 300);
+}
+
+
+static void testCostCounts() {
+  core::StrategyController controller(4, 1.5, 200);
+
+  // Early flushes stall least inside Map but cost the most overall
+  Workload workload;
+  workload.stallUs = { 500, 100, 600, 0 };
+  workload.costUs  = { 0, 600, 0, 0 };
+
+  uint32_t tried = 0;
+  core::StrategyDecision decision = runUntilCommit(controller, workload, &tried);
+
+  ATFIX_CHECK(decision.event == core::StrategyEvent::Commit);
+  ATFIX_CHECK(decision.next == core::Strategy::Driver);
+}
+
+
+static void testRegressionFloor() {
+  core::StrategyController controller(4, 1.5, 200);
+
+  Workload workload;
+  workload.stallUs = { 1000, 100, 600, 0 };
+
+  uint32_t tried = 0;
+  runUntilCommit(controller, workload, &tried);
+
+  // Slower by the factor, but not by the floor
+  workload.stallUs[uint32_t(core::Strategy::EarlyFlush)] = 250;
+  ATFIX_CHECK(runEpisode(controller, workload).event == core::StrategyEvent::Hold);
+
+  // Slower by both
+  workload.stallUs[uint32_t(core::Strategy::EarlyFlush)] = 1000;
+  core::StrategyDecision decision = runEpisode(controller, workload);
+
+  ATFIX_CHECK(decision.event == core::StrategyEvent::Regress);
+  ATFIX_CHECK(decision.next == core::Strategy::Driver);
+  ATFIX_CHECK(decision.nextEpisodes == 0);
+}
+
+
+static void testUnavailableStrategy() {
+  core::StrategyController controller(4, 1.5, 200);
+  core::ResourceDesc desc = pattern();
+
+  // The pattern explores speculation first, which only some maps allow
+  uint32_t speculative = 1u << uint32_t(core::Strategy::Speculative);
+  ATFIX_CHECK(controller.selectStrategy(desc, speculative) == core::Strategy::Speculative);
+  ATFIX_CHECK(controller.selectStrategy(desc, AvailableStrategies) == core::Strategy::Driver);
+
+  // Episodes without readbacks are not decided
+  ATFIX_CHECK(controller.endEpisode().empty());
+
+  core::ResourceDesc other = desc;
+  other.width = 256;
+  ATFIX_CHECK(controller.getStrategy(other) == core::Strategy::Driver);
+}
+
+
+static void testRecommitAfterRegression() {
+  core::StrategyController controller(4, 1.5, 200);
+
+  Workload workload;
+  workload.stallUs = { 1000, 100, 600, 0 };
+
+  uint32_t tried = 0;
+  ATFIX_CHECK(runUntilCommit(controller, workload, &tried).next == core::Strategy::EarlyFlush);
+
+  // Fresh measurements decide, not the ones from before
+  workload.stallUs = { 1000, 2000, 300, 0 };
+  ATFIX_CHECK(runEpisode(controller, workload).event == core::StrategyEvent::Regress);
+
+  tried = 0;
+  core::StrategyDecision decision = runUntilCommit(controller, workload, &tried);
+
+  ATFIX_CHECK(tried == AvailableStrategies);
+  ATFIX_CHECK(decision.event == core::StrategyEvent::Commit);
+  ATFIX_CHECK(decision.next == core::Strategy::SpinWait);
+  ATFIX_CHECK(decision.nextMeanUs == 300);
+}
+
+
+static void testIndependentPatterns() {
+  core::StrategyController controller(4, 1.5, 200);
+
+  core::ResourceDesc small = pattern();
+  small.width = 64;
+  small.height = 64;
+
+  core::ResourceDesc large = pattern();
+
+  // Early flushes only help the large pattern
+  Workload smallWorkload;
+  smallWorkload.stallUs = { 100, 400, 300, 0 };
+
+  Workload largeWorkload;
+  largeWorkload.stallUs = { 1000, 200, 600, 0 };
+
+  core::Strategy smallNext = core::Strategy::Driver;
+  core::Strategy largeNext = core::Strategy::Driver;
+  uint32_t commits = 0;
+
+  for (uint32_t i = 0; i < 32 && commits < 2; i++) {
+    core::Strategy smallStrategy = controller.selectStrategy(small, AvailableStrategies);
+    core::Strategy largeStrategy = controller.selectStrategy(large, AvailableStrategies);
+
+    // The strategy only changes between episodes
+    for (uint32_t j = 0; j < 4; j++) {
+      ATFIX_CHECK(controller.selectStrategy(small, AvailableStrategies) == smallStrategy);
+      controller.registerReadback(small, smallWorkload.stallUs[uint32_t(smallStrategy)]);
+      controller.registerReadback(large, largeWorkload.stallUs[uint32_t(largeStrategy)]);
+    }
+
+    auto decisions = controller.endEpisode();
+    ATFIX_CHECK(decisions.size() == 2);
+
+    for (const auto& decision : decisions) {
+      if (decision.event != core::StrategyEvent::Commit)
+        continue;
+
+      commits += 1;
+
+      if (decision.pattern == small)
+        smallNext = decision.next;
+      else
+        largeNext = decision.next;
+    }
+  }
+
+  ATFIX_CHECK(commits == 2);
+  ATFIX_CHECK(smallNext == core::Strategy::Driver);
+  ATFIX_CHECK(largeNext == core::Strategy::EarlyFlush);
+}
+
+
+int main() {
+  test::run("strategy/commits-to-fastest", &testCommitsToFastest);
+  test::run("strategy/cost-counts", &testCostCounts);
+  test::run("strategy/regression-floor", &testRegressionFloor);
+  test::run("strategy/unavailable-strategy", &testUnavailableStrategy);
+  test::run("strategy/recommit-after-regression", &testRecommitAfterRegression);
+  test::run("strategy/independent-patterns", &testIndependentPatterns);
+  return test::finish();
+}
@@ -0,0 +1,107 @@
+#include <vector>
+
+#include "core/checksum.h"
+#include "core/shadow_cache.h"
+#include "core/tracker.h"
+
+#include "test.h"
+
+using namespace atfix;
+
+static core::ResourceKey key(uintptr_t pointer, uint64_t generation = 1) {
+  core::ResourceKey result;
+  result.pointer = reinterpret_cast<const void*>(pointer);
+  result.generation = generation;
+  return result;
+}
+
+
+static void testTrackedGenerations() {
+  core::ResourceTracker tracker;
+
+  tracker.track(key(1, 1));
+  ATFIX_CHECK(tracker.isTracked(key(1, 1)));
+
+  // A resource created at the address of a destroyed one is new
+  ATFIX_CHECK(!tracker.isTracked(key(1, 2)));
+
+  tracker.track(key(1, 2));
+  tracker.untrack(key(1, 1));
+  ATFIX_CHECK(!tracker.isTracked(key(1, 1)));
+  ATFIX_CHECK(tracker.isTracked(key(1, 2)));
+
+  tracker.retire(key(1, 2));
+  ATFIX_CHECK(!tracker.isTracked(key(1, 2)));
+}
+
+
+static void testMappedData() {
+  core::ResourceTracker tracker;
+
+  std::vector<uint8_t> data(64 * 4);
+
+  for (size_t i = 0; i < data.size(); i++)
+    data[i] = uint8_t(i * 3u + 1u);
+
+  core::MappedData mapped;
+  mapped.pData = data.data();
+  mapped.rowPitch = 64;
+  mapped.depthPitch = 64 * 4;
+  mapped.rowSize = 48;
+  mapped.rowCount = 4;
+
+  tracker.trackMappedData(key(1, 1), mapped);
+  ATFIX_CHECK(!tracker.takeMappedChecksum(key(1, 2)));
+
+  uint32_t checksum = tracker.takeMappedChecksum(key(1, 1));
+  ATFIX_CHECK(checksum && checksum == core::calculateChecksum(data.data(), 64, 48, 4));
+
+  // Mapped data is only returned once
+  core::MappedData result;
+  ATFIX_CHECK(!tracker.takeMappedData(key(1, 1), &result));
+
+  tracker.trackMappedData(key(1, 1), mapped);
+  ATFIX_CHECK(tracker.takeMappedData(key(1, 1), &result) && result.pData == data.data());
+
+  tracker.trackMappedData(key(1, 1), mapped);
+  tracker.retire(key(1, 1));
+  ATFIX_CHECK(!tracker.takeMappedData(key(1, 1), &result));
+
+  tracker.track(key(2));
+  tracker.trackMappedData(key(2), mapped);
+  tracker.clear();
+  ATFIX_CHECK(!tracker.isTracked(key(2)));
+  ATFIX_CHECK(!tracker.takeMappedData(key(2), &result));
+}
+
+
+static void testShadowCacheGenerations() {
+  core::ShadowCache cache(4);
+
+  cache.registerWrite(key(1, 1), 0x1234);
+  cache.registerCopy(key(2, 1), key(1, 1));
+  cache.registerReadback(key(2, 1), 0xaa, 100);
+
+  cache.registerCopy(key(2, 1), key(1, 1));
+  cache.registerReadback(key(2, 1), 0xaa, 200);
+
+  // Copies from a new resource at the same address are unknown
+  cache.registerCopy(key(2, 1), key(1, 2));
+  cache.registerReadback(key(2, 1), 0xaa, 300);
+
+  core::ShadowCacheStats stats = cache.takeStats();
+  ATFIX_CHECK(stats.readbacks == 3);
+  ATFIX_CHECK(stats.keyed == 2);
+  ATFIX_CHECK(stats.hits == 1);
+  ATFIX_CHECK(stats.correctHits == 1);
+  ATFIX_CHECK(stats.savedUs == 200);
+  ATFIX_CHECK(stats.waitUs == 600);
+}
+
+
+int main() {
+  test::run("tracker/tracked-generations", &testTrackedGenerations);
+  test::run("tracker/mapped-data", &testMappedData);
+  test::run("tracker/shadow-cache-generations", &testShadowCacheGenerations);
+  return test::finish();
+}
@@ -0,0 +1,271 @@
+#include <vector>
+
+#include "../trace.h"
+#include "../validator.h"
+
+#include "../mock/mock_d3d11.h"
+
+#include "test.h"
+
+using namespace atfix;
+
+static ID3D11Device* g_device = nullptr;
+static ID3D11DeviceContext* g_context = nullptr;
+
+
+static ID3D11Texture2D* createTexture(UINT width, UINT height, D3D11_USAGE usage) {
+  D3D11_TEXTURE2D_DESC desc = { };
+  desc.Width = width;
+  desc.Height = height;
+  desc.MipLevels = 1;
+  desc.ArraySize = 1;
+  desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+  desc.SampleDesc = { 1, 0 };
+  desc.Usage = usage;
+
+  if (usage == D3D11_USAGE_STAGING)
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+  else
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+  ID3D11Texture2D* texture = nullptr;
+  ATFIX_CHECK(SUCCEEDED(g_device->CreateTexture2D(&desc, nullptr, &texture)));
+  return texture;
+}
+
+
+/** Fills a texture with a pattern and returns the hash that
+ *  a readback of it has */
+static uint64_t fillTexture(ID3D11Texture2D* pTexture, UINT width, UINT height, uint8_t seed) {
+  auto procs = getContextProcs(g_context);
+
+  std::vector<uint8_t> data(width * height * 4);
+
+  for (size_t i = 0; i < data.size(); i++)
+    data[i] = uint8_t(i * 7u + seed);
+
+  procs->UpdateSubresource(g_context, pTexture, 0, nullptr, data.data(), width * 4, 0);
+
+  ID3D11Texture2D* staging = createTexture(width, height, D3D11_USAGE_STAGING);
+  procs->CopyResource(g_context, staging, pTexture);
+
+  ResourceInfo info;
+  getResourceInfo(staging, &info);
+
+  SubresourceLayout layout;
+  getSubresourceLayout(info, 0, &layout);
+
+  uint64_t hash = 0;
+  D3D11_MAPPED_SUBRESOURCE mapped = { };
+
+  if (SUCCEEDED(procs->Map(g_context, staging, 0, D3D11_MAP_READ, 0, &mapped))) {
+    hash = calculateTextureHash(mapped, layout);
+    procs->Unmap(g_context, staging, 0);
+  }
+
+  staging->Release();
+  return hash;
+}
+
+
+static ResourceInfo stagingInfo(UINT width, UINT height) {
+  ID3D11Texture2D* staging = createTexture(width, height, D3D11_USAGE_STAGING);
+
+  ResourceInfo info;
+  getResourceInfo(staging, &info);
+
+  staging->Release();
+  return info;
+}
+
+
+static ReadbackLineage lineage(uint64_t servedHash) {
+  ReadbackLineage result;
+  result.pStrategy = "test";
+  result.servedHash = servedHash;
+  result.copyUs = getTimeUs();
+  return result;
+}
+
+
+static void completeValidations(ReadbackValidator& validator, std::vector<ReadbackValidation>* pFailures) {
+  getContextProcs(g_context)->Flush(g_context);
+  mock::waitForMockIdle(g_device);
+  validator.poll(g_context, pFailures);
+}
+
+
+static void testSample() {
+  ReadbackValidator validator(4, 0.25);
+
+  uint32_t sampled = 0;
+
+  for (uint32_t i = 0; i < 16; i++) {
+    bool isSampled = validator.sample();
+    ATFIX_CHECK(isSampled == ((i & 3) == 3));
+    sampled += isSampled ? 1 : 0;
+  }
+
+  ATFIX_CHECK(sampled == 4);
+  ATFIX_CHECK(validator.takeStats().sampled == 4);
+
+  ReadbackValidator none(4, 0.0);
+  ATFIX_CHECK(!none.sample());
+}
+
+
+static void testPassAndFail() {
+  ReadbackValidator validator(4, 1.0);
+
+  ID3D11Texture2D* texture = createTexture(64, 32, D3D11_USAGE_DEFAULT);
+  uint64_t hash = fillTexture(texture, 64, 32, 1);
+  ResourceInfo info = stagingInfo(64, 32);
+
+  ATFIX_CHECK(validator.submit(g_context, texture, 0, nullptr, info, lineage(hash)));
+  ATFIX_CHECK(validator.submit(g_context, texture, 0, nullptr, info, lineage(hash ^ 1)));
+
+  std::vector<ReadbackValidation> failures;
+  completeValidations(validator, &failures);
+
+  ATFIX_CHECK(failures.size() == 1);
+
+  if (failures.size() == 1) {
+    ATFIX_CHECK(failures[0].gpuHash == hash);
+    ATFIX_CHECK(failures[0].lineage.servedHash == (hash ^ 1));
+  }
+
+  ValidationStats stats = validator.takeStats();
+  ATFIX_CHECK(stats.passed == 1);
+  ATFIX_CHECK(stats.failed == 1);
+  ATFIX_CHECK(stats.dropped == 0);
+
+  texture->Release();
+}
+
+
+static void testSubregion() {
+  ReadbackValidator validator(4, 1.0);
+
+  ID3D11Texture2D* texture = createTexture(64, 32, D3D11_USAGE_DEFAULT);
+  ID3D11Texture2D* glyph = createTexture(16, 16, D3D11_USAGE_DEFAULT);
+  fillTexture(texture, 64, 32, 2);
+
+  // The validation copy uses the game's source region
+  D3D11_BOX box = { 16, 8, 0, 32, 24, 1 };
+  getContextProcs(g_context)->CopySubresourceRegion(g_context, glyph, 0, 0, 0, 0, texture, 0, &box);
+
+  ID3D11Texture2D* staging = createTexture(16, 16, D3D11_USAGE_STAGING);
+  getContextProcs(g_context)->CopyResource(g_context, staging, glyph);
+
+  ResourceInfo info;
+  getResourceInfo(staging, &info);
+
+  SubresourceLayout layout;
+  getSubresourceLayout(info, 0, &layout);
+
+  uint64_t hash = 0;
+  D3D11_MAPPED_SUBRESOURCE mapped = { };
+
+  if (SUCCEEDED(getContextProcs(g_context)->Map(g_context, staging, 0, D3D11_MAP_READ, 0, &mapped))) {
+    hash = calculateTextureHash(mapped, layout);
+    getContextProcs(g_context)->Unmap(g_context, staging, 0);
+  }
+
+  ATFIX_CHECK(validator.submit(g_context, texture, 0, &box, info, lineage(hash)));
+
+  std::vector<ReadbackValidation> failures;
+  completeValidations(validator, &failures);
+
+  ATFIX_CHECK(failures.empty());
+  ATFIX_CHECK(validator.takeStats().passed == 1);
+
+  staging->Release();
+  glyph->Release();
+  texture->Release();
+}
+
+
+static void testNoWait() {
+  ReadbackValidator validator(4, 1.0);
+
+  ID3D11Texture2D* texture = createTexture(64, 32, D3D11_USAGE_DEFAULT);
+  uint64_t hash = fillTexture(texture, 64, 32, 3);
+  ResourceInfo info = stagingInfo(64, 32);
+
+  mock::MockConfig config;
+  config.gpuCopyNs = 200000000;
+  mock::setMockConfig(g_device, config);
+
+  // A copy that is still running is left for a later poll
+  std::vector<ReadbackValidation> failures;
+  ATFIX_CHECK(validator.submit(g_context, texture, 0, nullptr, info, lineage(hash)));
+  getContextProcs(g_context)->Flush(g_context);
+
+  uint64_t startUs = getTimeUs();
+  validator.poll(g_context, &failures);
+  ATFIX_CHECK(getTimeUs() - startUs < 100000);
+  ATFIX_CHECK(validator.takeStats().passed == 0);
+
+  mock::setMockConfig(g_device, mock::MockConfig());
+  completeValidations(validator, &failures);
+
+  ATFIX_CHECK(failures.empty());
+  ATFIX_CHECK(validator.takeStats().passed == 1);
+
+  texture->Release();
+}
+
+
+static void testPool() {
+  ReadbackValidator validator(1, 1.0);
+
+  ID3D11Texture2D* small = createTexture(16, 16, D3D11_USAGE_DEFAULT);
+  ID3D11Texture2D* large = createTexture(64, 32, D3D11_USAGE_DEFAULT);
+  uint64_t smallHash = fillTexture(small, 16, 16, 4);
+  uint64_t largeHash = fillTexture(large, 64, 32, 5);
+
+  // The only staging resource is busy until polled
+  ATFIX_CHECK(validator.submit(g_context, small, 0, nullptr, stagingInfo(16, 16), lineage(smallHash)));
+  ATFIX_CHECK(!validator.submit(g_context, large, 0, nullptr, stagingInfo(64, 32), lineage(largeHash)));
+
+  std::vector<ReadbackValidation> failures;
+  completeValidations(validator, &failures);
+
+  // An idle resource of another size is replaced
+  ATFIX_CHECK(validator.submit(g_context, large, 0, nullptr, stagingInfo(64, 32), lineage(largeHash)));
+  completeValidations(validator, &failures);
+
+  ATFIX_CHECK(failures.empty());
+
+  ValidationStats stats = validator.takeStats();
+  ATFIX_CHECK(stats.passed == 2);
+  ATFIX_CHECK(stats.dropped == 1);
+
+  large->Release();
+  small->Release();
+}
+
+
+int main() {
+  MH_Initialize();
+
+  if (FAILED(mock::createMockDevice(mock::MockConfig(), &g_device, &g_context))) {
+    std::fprintf(stderr, "Failed to create mock device\n");
+    return 1;
+  }
+
+  hookContext(g_context);
+
+  test::run("validator/sample", &testSample);
+  test::run("validator/pass-and-fail", &testPassAndFail);
+  test::run("validator/subregion", &testSubregion);
+  test::run("validator/no-wait", &testNoWait);
+  test::run("validator/pool", &testPool);
+
+  g_context->Release();
+  g_device->Release();
+
+  shutdownTraceLogging();
+  MH_Uninitialize();
+  return test::finish();
+}
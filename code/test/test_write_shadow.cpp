@@ -0,0 +1,177 @@
+#include <cstring>
+#include <vector>
+
+#include "../write_shadow.h"
+
+#include "test.h"
+
+using namespace atfix;
+
+static core::ResourceKey key(uintptr_t pointer, uint64_t generation = 1) {
+  core::ResourceKey result;
+  result.pointer = reinterpret_cast<const void*>(pointer);
+  result.generation = generation;
+  return result;
+}
+
+
+static D3D11_MAPPED_SUBRESOURCE mapping(std::vector<uint8_t>& data, UINT rowPitch, UINT depthPitch) {
+  D3D11_MAPPED_SUBRESOURCE result = { };
+  result.pData = data.data();
+  result.RowPitch = rowPitch;
+  result.DepthPitch = depthPitch;
+  return result;
+}
+
+
+/** One row per page, so that rows and fault spans line up */
+constexpr UINT RowSize = GuardedBuffer::PageSize;
+
+
+static void testDirtyRows() {
+  WriteShadowTracker tracker(0);
+
+  std::vector<uint8_t> real(RowSize * 32, 0xaa);
+  D3D11_MAPPED_SUBRESOURCE mapped = mapping(real, RowSize, RowSize * 32);
+
+  ATFIX_CHECK(tracker.mapShadow(key(1), RowSize, 32, 1, getTimeUs(), &mapped));
+  ATFIX_CHECK(mapped.pData != real.data());
+  ATFIX_CHECK(mapped.RowPitch >= RowSize);
+
+  // One write makes a span of pages dirty
+  auto shadow = static_cast<uint8_t*>(mapped.pData);
+  std::memset(shadow + 20 * mapped.RowPitch, 0x55, RowSize);
+
+  bool complete = true;
+  ATFIX_CHECK(tracker.unmapShadow(key(1), &complete));
+  ATFIX_CHECK(!complete);
+  tracker.endMap(key(1));
+
+  ATFIX_CHECK(real[20 * RowSize] == 0x55);
+  ATFIX_CHECK(real[21 * RowSize - 1] == 0x55);
+  ATFIX_CHECK(real[0] == 0xaa);
+  ATFIX_CHECK(real[19 * RowSize] == 0xaa);
+
+  WriteShadowStats stats = tracker.takeStats();
+  ATFIX_CHECK(stats.shadowMaps == 1);
+  ATFIX_CHECK(stats.directMaps == 0);
+  ATFIX_CHECK(stats.faults == 1);
+  ATFIX_CHECK(stats.totalRows == 32);
+  ATFIX_CHECK(stats.copiedRows > 1 && stats.copiedRows < 32);
+}
+
+
+static void testCompleteWrite() {
+  WriteShadowTracker tracker(0);
+
+  std::vector<uint8_t> real(RowSize * 16, 0xaa);
+  D3D11_MAPPED_SUBRESOURCE mapped = mapping(real, RowSize, RowSize * 16);
+
+  ATFIX_CHECK(tracker.mapShadow(key(1), RowSize, 16, 1, getTimeUs(), &mapped));
+
+  for (UINT y = 0; y < 16; y++)
+    std::memset(static_cast<uint8_t*>(mapped.pData) + y * mapped.RowPitch, int(y), RowSize);
+
+  bool complete = false;
+  ATFIX_CHECK(tracker.unmapShadow(key(1), &complete));
+  ATFIX_CHECK(complete);
+  tracker.endMap(key(1));
+
+  for (UINT y = 0; y < 16; y++)
+    ATFIX_CHECK(real[y * RowSize] == y);
+
+  // The shadow is reused and armed again
+  mapped = mapping(real, RowSize, RowSize * 16);
+  ATFIX_CHECK(tracker.mapShadow(key(1), RowSize, 16, 1, getTimeUs(), &mapped));
+  ATFIX_CHECK(tracker.unmapShadow(key(1), &complete));
+  ATFIX_CHECK(!complete);
+  tracker.endMap(key(1));
+
+  ATFIX_CHECK(tracker.takeStats().copiedRows == 16);
+}
+
+
+static void testSlices() {
+  WriteShadowTracker tracker(0);
+
+  // Driver rows and slices are padded, the shadow packs slices
+  std::vector<uint8_t> real(RowSize * 16, 0xaa);
+  D3D11_MAPPED_SUBRESOURCE mapped = mapping(real, RowSize * 2, RowSize * 8);
+
+  ATFIX_CHECK(tracker.mapShadow(key(1), RowSize, 2, 2, getTimeUs(), &mapped));
+  ATFIX_CHECK(mapped.DepthPitch == mapped.RowPitch * 2);
+
+  auto shadow = static_cast<uint8_t*>(mapped.pData);
+
+  for (UINT y = 0; y < 4; y++)
+    std::memset(shadow + y * mapped.RowPitch, int(y + 1), RowSize);
+
+  bool complete = false;
+  ATFIX_CHECK(tracker.unmapShadow(key(1), &complete));
+  ATFIX_CHECK(complete);
+  tracker.endMap(key(1));
+
+  ATFIX_CHECK(real[0] == 1);
+  ATFIX_CHECK(real[RowSize * 2] == 2);
+  ATFIX_CHECK(real[RowSize * 8] == 3);
+  ATFIX_CHECK(real[RowSize * 10] == 4);
+  ATFIX_CHECK(real[RowSize] == 0xaa);
+  ATFIX_CHECK(real[RowSize * 4] == 0xaa);
+}
+
+
+static bool mapTimed(WriteShadowTracker& tracker, std::vector<uint8_t>& real, uint64_t us) {
+  D3D11_MAPPED_SUBRESOURCE mapped = mapping(real, RowSize, RowSize * 4);
+  bool isShadowed = tracker.mapShadow(key(1), RowSize, 4, 1, getTimeUs() - us, &mapped);
+
+  bool complete = false;
+  tracker.unmapShadow(key(1), &complete);
+  tracker.endMap(key(1));
+  return isShadowed;
+}
+
+
+static void testCalibration() {
+  std::vector<uint8_t> real(RowSize * 4, 0xaa);
+
+  // Maps alternate, starting with a direct one
+  WriteShadowTracker slow(2);
+  ATFIX_CHECK(!mapTimed(slow, real, 0));
+  ATFIX_CHECK(mapTimed(slow, real, 100000));
+  ATFIX_CHECK(!mapTimed(slow, real, 0));
+  ATFIX_CHECK(!mapTimed(slow, real, 0));
+
+  WriteShadowTracker fast(2);
+  ATFIX_CHECK(!mapTimed(fast, real, 100000));
+  ATFIX_CHECK(mapTimed(fast, real, 0));
+  ATFIX_CHECK(mapTimed(fast, real, 0));
+
+  WriteShadowStats stats = fast.takeStats();
+  ATFIX_CHECK(stats.shadowMaps == 2);
+  ATFIX_CHECK(stats.directMaps == 1);
+}
+
+
+static void testRetire() {
+  WriteShadowTracker tracker(0);
+
+  std::vector<uint8_t> real(RowSize * 4, 0xaa);
+  D3D11_MAPPED_SUBRESOURCE mapped = mapping(real, RowSize, RowSize * 4);
+
+  ATFIX_CHECK(tracker.mapShadow(key(1), RowSize, 4, 1, getTimeUs(), &mapped));
+  tracker.retire(key(1));
+
+  bool complete = false;
+  ATFIX_CHECK(!tracker.unmapShadow(key(1), &complete));
+  ATFIX_CHECK(!tracker.unmapShadow(key(2), &complete));
+}
+
+
+int main() {
+  test::run("write_shadow/dirty-rows", &testDirtyRows);
+  test::run("write_shadow/complete-write", &testCompleteWrite);
+  test::run("write_shadow/slices", &testSlices);
+  test::run("write_shadow/calibration", &testCalibration);
+  test::run("write_shadow/retire", &testRetire);
+  return test::finish();
+}
@@ -2,12 +2,15 @@
 #include <chrono>
 #include <fstream>
 #include <thread>
-#include <unordered_map>
 
 #include "trace.h"
 #include "util.h"
 #include "log.h"
 
+#include "core/checksum.h"
+#include "core/types.h"
+#include "core/tracker.h"
+
 namespace atfix {
 
 extern Log log;
@@ -18,50 +21,34 @@ static mutex g_logMutex;
 static std::ofstream g_traceLog;
 static auto g_logStartTime = std::chrono::high_resolution_clock::now();
 
-// Track which textures we're interested in (STAGING for reads, DYNAMIC for writes)
-static mutex g_stagingTexMutex;
-static std::unordered_map<void*, bool> g_trackedStagingTextures;
-
-// Track mapped data for Unmap checksum calculation (for WRITE operations)
-struct MappedTextureData {
-  void* pData;
-  UINT rowPitch;
-  UINT width;
-  UINT height;
-  DXGI_FORMAT format;
-};
-static mutex g_mappedDataMutex;
-static std::unordered_map<void*, MappedTextureData> g_trackedMappedData;
+// Track which textures we're interested in (STAGING for reads, DYNAMIC for writes),
+// and mapped data for Unmap checksum calculation (for WRITE operations)
+static core::ResourceTracker g_tracker;
 
 // Background thread for F9 polling
 static std::atomic<bool> g_shutdownThread = false;
 static std::thread g_hotkeyThread;
 
+UINT getChecksumBytesPerPixel(DXGI_FORMAT format) {
+  // For now, handle common formats (format 90 is likely DXGI_FORMAT_B8G8R8A8_UNORM = 4 bytes/pixel)
+  return 4;  // Default assumption for most common formats
+}
+
 const char* usageToString(D3D11_USAGE Usage) {
-  switch (Usage) {
-    case D3D11_USAGE_DEFAULT:   return "DEFAULT";
-    case D3D11_USAGE_IMMUTABLE: return "IMMUTABLE";
-    case D3D11_USAGE_DYNAMIC:   return "DYNAMIC";
-    case D3D11_USAGE_STAGING:   return "STAGING";
-    default:                    return "UNKNOWN";
-  }
+  return core::usageToString(core::Usage(Usage));
 }
 
 const char* mapTypeToString(D3D11_MAP MapType) {
-  switch (MapType) {
-    case D3D11_MAP_READ:                return "READ";
-    case D3D11_MAP_WRITE:               return "WRITE";
-    case D3D11_MAP_READ_WRITE:          return "READ_WRITE";
-    case D3D11_MAP_WRITE_DISCARD:       return "WRITE_DISCARD";
-    case D3D11_MAP_WRITE_NO_OVERWRITE:  return "WRITE_NO_OVERWRITE";
-    default:                            return "UNKNOWN";
-  }
+  return core::mapTypeToString(core::MapType(MapType));
 }
 
-std::string getLogTimestamp() {
+uint64_t getLogTimestampUs() {
   auto now = std::chrono::high_resolution_clock::now();
-  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(now - g_logStartTime);
-  return std::to_string(duration.count());
+  return std::chrono::duration_cast<std::chrono::microseconds>(now - g_logStartTime).count();
+}
+
+std::string getLogTimestamp() {
+  return std::to_string(getLogTimestampUs());
 }
 
 void writeTraceLog(const std::string& line) {
@@ -76,36 +63,89 @@ bool isTraceLoggingActive() {
   return g_loggingActive;
 }
 
-void trackStagingTexture(void* pResource) {
-  std::lock_guard lock(g_stagingTexMutex);
-  g_trackedStagingTextures[pResource] = true;
+void trackStagingTexture(const core::ResourceKey& resource) {
+  g_tracker.track(resource);
 }
 
-void untrackStagingTexture(void* pResource) {
-  std::lock_guard lock(g_stagingTexMutex);
-  g_trackedStagingTextures.erase(pResource);
+void untrackStagingTexture(const core::ResourceKey& resource) {
+  g_tracker.untrack(resource);
 }
 
-bool isStagingTextureTracked(void* pResource) {
-  std::lock_guard lock(g_stagingTexMutex);
-  return g_trackedStagingTextures.find(pResource) != g_trackedStagingTextures.end();
+bool isStagingTextureTracked(const core::ResourceKey& resource) {
+  return g_tracker.isTracked(resource);
+}
+
+void trackMappedTextureData(const core::ResourceKey& resource, const D3D11_MAPPED_SUBRESOURCE& mapped, const SubresourceLayout& layout) {
+  core::MappedData data;
+  data.pData = mapped.pData;
+  data.rowPitch = mapped.RowPitch;
+  data.depthPitch = mapped.DepthPitch;
+  data.rowSize = layout.rowSize;
+  data.rowCount = layout.rowCount;
+  data.sliceCount = layout.sliceCount;
+
+  g_tracker.trackMappedData(resource, data);
 }
 
-void trackMappedTextureData(void* pResource, const void* pData, UINT rowPitch, UINT width, UINT height, DXGI_FORMAT format) {
-  std::lock_guard lock(g_mappedDataMutex);
-  g_trackedMappedData[pResource] = {const_cast<void*>(pData), rowPitch, width, height, format};
+uint32_t getAndClearMappedChecksum(const core::ResourceKey& resource) {
+  // Remove after checksum (Unmap completes the pair)
+  return g_tracker.takeMappedChecksum(resource);
+}
+
+bool takeMappedTextureData(const core::ResourceKey& resource, core::MappedData* pData) {
+  return g_tracker.takeMappedData(resource, pData);
+}
+
+void retireTrackedTexture(const core::ResourceKey& resource) {
+  g_tracker.retire(resource);
+}
+
+bool startTraceLogging(const char* pFilename) {
+  std::lock_guard lock(g_logMutex);
+
+  if (g_loggingActive)
+    return true;
+
+  // Close existing log if open
+  if (g_traceLog.is_open()) {
+    g_traceLog.close();
+  }
+
+  // Open fresh log file (truncate mode)
+  g_traceLog.open(pFilename, std::ios::out | std::ios::trunc);
+  if (!g_traceLog.is_open()) {
+    log("ERROR: Failed to open ", pFilename);
+    return false;
+  }
+
+  // Reset timestamp reference
+  g_logStartTime = std::chrono::high_resolution_clock::now();
+
+  // Clear tracked textures
+  g_tracker.clear();
+
+  g_loggingActive = true;
+  log(">>> LOGGING STARTED - trace written to ", pFilename, " <<<");
+
+  // Write header
+  g_traceLog << "# atfix trace log - timestamps in microseconds" << std::endl;
+  g_traceLog << "# Format: [timestamp_us] CallType key=value ..." << std::endl;
+  g_traceLog.flush();
+  return true;
 }
 
-uint32_t getAndClearMappedChecksum(void* pResource) {
-  std::lock_guard lock(g_mappedDataMutex);
-  auto it = g_trackedMappedData.find(pResource);
-  if (it != g_trackedMappedData.end()) {
-    auto& data = it->second;
-    uint32_t checksum = calculateTextureChecksum(data.pData, data.rowPitch, data.width, data.height, data.format);
-    g_trackedMappedData.erase(it);  // Remove after checksum (Unmap completes the pair)
-    return checksum;
+void stopTraceLogging() {
+  std::lock_guard lock(g_logMutex);
+
+  if (!g_loggingActive)
+    return;
+
+  g_loggingActive = false;
+
+  if (g_traceLog.is_open()) {
+    g_traceLog.close();
+    log(">>> LOGGING STOPPED - trace saved <<<");
   }
-  return 0;
 }
 
 void hotkeyPollingThread() {
@@ -119,53 +159,12 @@ void hotkeyPollingThread() {
 
     // Detect rising edge (key just pressed)
     if (f9Pressed && !lastF9State) {
-      std::lock_guard lock(g_logMutex);
-
       if (!g_loggingActive) {
-        // START logging
         log("=== F9 PRESSED - STARTING TRACE LOGGING ===");
-
-        // Close existing log if open
-        if (g_traceLog.is_open()) {
-          g_traceLog.close();
-        }
-
-        // Open fresh log file (truncate mode)
-        g_traceLog.open("atfix_trace.log", std::ios::out | std::ios::trunc);
-        if (!g_traceLog.is_open()) {
-          log("ERROR: Failed to open atfix_trace.log");
-        } else {
-          // Reset timestamp reference
-          g_logStartTime = std::chrono::high_resolution_clock::now();
-
-          // Clear tracked textures
-          {
-            std::lock_guard texLock(g_stagingTexMutex);
-            g_trackedStagingTextures.clear();
-          }
-          {
-            std::lock_guard dataLock(g_mappedDataMutex);
-            g_trackedMappedData.clear();
-          }
-
-          g_loggingActive = true;
-          log(">>> LOGGING STARTED - trace written to atfix_trace.log <<<");
-
-          // Write header
-          g_traceLog << "# atfix trace log - timestamps in microseconds" << std::endl;
-          g_traceLog << "# Format: [timestamp_us] CallType key=value ..." << std::endl;
-          g_traceLog.flush();
-        }
-
+        startTraceLogging("atfix_trace.log");
       } else {
-        // STOP logging
         log("=== F9 PRESSED - STOPPING TRACE LOGGING ===");
-        g_loggingActive = false;
-
-        if (g_traceLog.is_open()) {
-          g_traceLog.close();
-          log(">>> LOGGING STOPPED - trace saved to atfix_trace.log <<<");
-        }
+        stopTraceLogging();
       }
     }
 
@@ -197,30 +196,14 @@ void shutdownTraceLogging() {
   }
 }
 
-uint32_t calculateTextureChecksum(const void* pData, UINT rowPitch, UINT width, UINT height, DXGI_FORMAT format) {
-  if (!pData) return 0;
-
-  // Simple CRC32-like checksum using XOR and rotation
-  uint32_t checksum = 0x12345678;
-  const uint8_t* bytes = static_cast<const uint8_t*>(pData);
-
-  // Determine bytes per pixel based on format
-  // For now, handle common formats (format 90 is likely DXGI_FORMAT_B8G8R8A8_UNORM = 4 bytes/pixel)
-  UINT bytesPerPixel = 4;  // Default assumption for most common formats
-
-  // Calculate how many bytes to read per row (minimum of actual data and pitch)
-  UINT bytesPerRow = width * bytesPerPixel;
-
-  for (UINT row = 0; row < height; row++) {
-    const uint8_t* rowData = bytes + (row * rowPitch);
-
-    for (UINT col = 0; col < bytesPerRow; col++) {
-      // Simple hash: rotate left and XOR
-      checksum = ((checksum << 5) | (checksum >> 27)) ^ rowData[col];
-    }
-  }
+uint32_t calculateTextureChecksum(const D3D11_MAPPED_SUBRESOURCE& mapped, const SubresourceLayout& layout) {
+  return core::calculateChecksum(mapped.pData, mapped.RowPitch, mapped.DepthPitch,
+    layout.rowSize, layout.rowCount, layout.sliceCount);
+}
 
-  return checksum;
+uint64_t calculateTextureHash(const D3D11_MAPPED_SUBRESOURCE& mapped, const SubresourceLayout& layout) {
+  return core::calculateHash(mapped.pData, mapped.RowPitch, mapped.DepthPitch,
+    layout.rowSize, layout.rowCount, layout.sliceCount);
 }
 
 }
@@ -3,6 +3,10 @@
 #include <string>
 #include <d3d11.h>
 
+#include "resource_info.h"
+
+#include "core/tracker.h"
+
 namespace atfix {
 
 // Initialize trace logging subsystem (starts F9 hotkey polling thread)
@@ -11,13 +15,20 @@ void initTraceLogging();
 // Shutdown trace logging subsystem (stops hotkey thread)
 void shutdownTraceLogging();
 
+// Start writing the trace log to the given file, as if F9 was pressed
+bool startTraceLogging(const char* pFilename);
+
+// Stop writing the trace log
+void stopTraceLogging();
+
 // Check if trace logging is currently active
 bool isTraceLoggingActive();
 
 // Write a line to the trace log (only if logging is active)
 void writeTraceLog(const std::string& line);
 
-// Get timestamp string for trace log entries (microseconds since logging started)
+// Get timestamp for trace log entries (microseconds since logging started)
+uint64_t getLogTimestampUs();
 std::string getLogTimestamp();
 
 // Helper functions for converting D3D11 enums to strings
@@ -25,15 +36,25 @@ const char* usageToString(D3D11_USAGE Usage);
 const char* mapTypeToString(D3D11_MAP MapType);
 
 // Track staging textures for Map/Unmap correlation
-void trackStagingTexture(void* pResource);
-void untrackStagingTexture(void* pResource);
-bool isStagingTextureTracked(void* pResource);
+void trackStagingTexture(const core::ResourceKey& resource);
+void untrackStagingTexture(const core::ResourceKey& resource);
+bool isStagingTextureTracked(const core::ResourceKey& resource);
 
 // Track mapped texture data for Unmap checksum calculation (for WRITE operations)
-void trackMappedTextureData(void* pResource, const void* pData, UINT rowPitch, UINT width, UINT height, DXGI_FORMAT format);
-uint32_t getAndClearMappedChecksum(void* pResource);
+void trackMappedTextureData(const core::ResourceKey& resource, const D3D11_MAPPED_SUBRESOURCE& mapped, const SubresourceLayout& layout);
+uint32_t getAndClearMappedChecksum(const core::ResourceKey& resource);
+bool takeMappedTextureData(const core::ResourceKey& resource, core::MappedData* pData);
+
+// Forget a destroyed resource
+void retireTrackedTexture(const core::ResourceKey& resource);
+
+// Bytes per pixel that checksums and image copies cover
+UINT getChecksumBytesPerPixel(DXGI_FORMAT format);
+
+// Calculate checksum of a mapped subresource of any dimension
+uint32_t calculateTextureChecksum(const D3D11_MAPPED_SUBRESOURCE& mapped, const SubresourceLayout& layout);
 
-// Calculate checksum of mapped texture data
-uint32_t calculateTextureChecksum(const void* pData, UINT rowPitch, UINT width, UINT height, DXGI_FORMAT format);
+// Calculate content hash of a mapped subresource of any dimension, used as cache key
+uint64_t calculateTextureHash(const D3D11_MAPPED_SUBRESOURCE& mapped, const SubresourceLayout& layout);
 
 }
@@ -0,0 +1,188 @@
+#include "trace.h"
+#include "validator.h"
+
+namespace atfix {
+
+ReadbackValidator::ReadbackValidator(uint32_t depth, double rate)
+: m_depth(depth), m_rate(rate) {
+
+}
+
+
+ReadbackValidator::~ReadbackValidator() {
+  for (const auto& resource : m_resources)
+    resource.resource->Release();
+}
+
+
+bool ReadbackValidator::sample() {
+  std::lock_guard lock(m_mutex);
+
+  m_sampleCredit += m_rate;
+
+  if (m_sampleCredit < 1.0)
+    return false;
+
+  m_sampleCredit -= 1.0;
+  m_stats.sampled += 1;
+  return true;
+}
+
+
+bool ReadbackValidator::submit(
+        ID3D11DeviceContext*      pContext,
+        ID3D11Resource*           pSrcResource,
+        UINT                      SrcSubresource,
+  const D3D11_BOX*                pSrcBox,
+  const ResourceInfo&             Desc,
+  const ReadbackLineage&          Lineage) {
+  std::lock_guard lock(m_mutex);
+
+  size_t resourceIndex = 0;
+
+  if (!getStagingResource(pContext, Desc, &resourceIndex)) {
+    m_stats.dropped += 1;
+    return false;
+  }
+
+  auto procs = getContextProcs(pContext);
+  procs->CopySubresourceRegion(pContext, m_resources[resourceIndex].resource,
+    0, 0, 0, 0, pSrcResource, SrcSubresource, pSrcBox);
+
+  PendingValidation validation;
+  validation.resourceIndex = resourceIndex;
+  validation.lineage = Lineage;
+
+  m_pending.push_back(validation);
+  return true;
+}
+
+
+void ReadbackValidator::poll(
+        ID3D11DeviceContext*      pContext,
+        std::vector<ReadbackValidation>* pFailures) {
+  std::lock_guard lock(m_mutex);
+
+  auto procs = getContextProcs(pContext);
+
+  while (!m_pending.empty()) {
+    PendingValidation& validation = m_pending.front();
+    StagingResource& resource = m_resources[validation.resourceIndex];
+
+    D3D11_MAPPED_SUBRESOURCE mapped = { };
+    HRESULT hr = procs->Map(pContext, resource.resource, 0,
+      D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+
+    if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+      break;
+
+    if (SUCCEEDED(hr)) {
+      SubresourceLayout layout;
+      getSubresourceLayout(resource.desc, 0, &layout);
+
+      uint64_t hash = calculateTextureHash(mapped, layout);
+      procs->Unmap(pContext, resource.resource, 0);
+
+      const ReadbackLineage& lineage = validation.lineage;
+
+      if (hash == lineage.servedHash) {
+        m_stats.passed += 1;
+      } else {
+        m_stats.failed += 1;
+
+        log("Readback validation failed (", lineage.pStrategy, "):",
+          " src 0x", std::hex, lineage.srcResource.pointer, std::dec,
+          " gen ", lineage.srcResource.generation,
+          " dst 0x", std::hex, lineage.dstResource.pointer, std::dec,
+          " gen ", lineage.dstResource.generation, std::hex,
+          " payload 0x", lineage.payload,
+          " served 0x", lineage.servedHash,
+          " gpu 0x", hash, std::dec,
+          " copied ", getTimeUs() - lineage.copyUs, " us ago");
+
+        ReadbackValidation failure;
+        failure.lineage = lineage;
+        failure.gpuHash = hash;
+        pFailures->push_back(failure);
+      }
+    } else {
+      log("Failed to map validation resource, hr 0x", std::hex, hr, std::dec);
+    }
+
+    resource.busy = false;
+    m_pending.pop_front();
+  }
+}
+
+
+ValidationStats ReadbackValidator::takeStats() {
+  std::lock_guard lock(m_mutex);
+
+  ValidationStats result = m_stats;
+  m_stats = ValidationStats();
+  return result;
+}
+
+
+bool ReadbackValidator::getStagingResource(
+        ID3D11DeviceContext*      pContext,
+  const ResourceInfo&             Desc,
+        size_t*                   pIndex) {
+  size_t lruIndex = m_resources.size();
+
+  for (size_t i = 0; i < m_resources.size(); i++) {
+    auto& resource = m_resources[i];
+
+    if (resource.busy)
+      continue;
+
+    if (resource.desc.dimension == Desc.dimension
+     && resource.desc.width == Desc.width && resource.desc.height == Desc.height
+     && resource.desc.depth == Desc.depth && resource.desc.format == Desc.format) {
+      resource.busy = true;
+      resource.lastUse = ++m_useCounter;
+      *pIndex = i;
+      return true;
+    }
+
+    if (lruIndex == m_resources.size() || resource.lastUse < m_resources[lruIndex].lastUse)
+      lruIndex = i;
+  }
+
+  // Replace the least recently used idle resource once the pool
+  // is full, so that a change in readback sizes does not leave
+  // the pool stuck with resources that never match again.
+  if (m_resources.size() >= m_depth && lruIndex == m_resources.size())
+    return false;
+
+  StagingResource resource;
+
+  ID3D11Device* device = nullptr;
+  pContext->GetDevice(&device);
+
+  HRESULT hr = createStagingResource(device, Desc, &resource.resource);
+  device->Release();
+
+  if (FAILED(hr)) {
+    log("Failed to create validation resource, hr 0x", std::hex, hr, std::dec);
+    return false;
+  }
+
+  getResourceInfo(resource.resource, &resource.desc);
+
+  resource.busy = true;
+  resource.lastUse = ++m_useCounter;
+
+  if (m_resources.size() >= m_depth) {
+    m_resources[lruIndex].resource->Release();
+    m_resources[lruIndex] = resource;
+    *pIndex = lruIndex;
+  } else {
+    *pIndex = m_resources.size();
+    m_resources.push_back(resource);
+  }
+
+  return true;
+}
+
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "impl.h"
+#include "resource_info.h"
+
+#include "core/types.h"
+
+namespace atfix {
+
+/**
+ * \brief Where a fast-path readback came from
+ *
+ * Logged in full when validation fails.
+ */
+struct ReadbackLineage {
+  /** Fast path that served the readback */
+  const char*       pStrategy     = "";
+  /** Source texture the game copied from */
+  core::ResourceKey srcResource;
+  /** STAGING texture the game read back */
+  core::ResourceKey dstResource;
+  /** Hash of the payload uploaded to the source */
+  uint64_t          payload       = 0;
+  /** Hash of the data that was served */
+  uint64_t          servedHash    = 0;
+  /** Time of the copy, in microseconds */
+  uint64_t          copyUs        = 0;
+};
+
+/**
+ * \brief Result of a completed validation
+ */
+struct ReadbackValidation {
+  ReadbackLineage   lineage;
+  /** Hash of what the GPU actually copied */
+  uint64_t          gpuHash       = 0;
+};
+
+/**
+ * \brief Validation counters
+ */
+struct ValidationStats {
+  /** Fast-path readbacks picked for validation */
+  uint64_t sampled      = 0;
+  /** Validations that agreed with the served data */
+  uint64_t passed       = 0;
+  /** Validations that disagreed with the served data */
+  uint64_t failed       = 0;
+  /** Samples dropped for lack of a free staging resource */
+  uint64_t dropped      = 0;
+};
+
+/**
+ * \brief Checks fast-path readbacks against the GPU
+ *
+ * Any strategy that serves Map(READ) from CPU data can submit
+ * a sample of its readbacks here. The game's copy is repeated
+ * into a hidden STAGING resource and read back with DO_NOT_WAIT
+ * on later calls, so that the check never stalls the game, and
+ * the result is compared with what was served. Up to \c depth
+ * staging resources are kept, and once the pool is full, the
+ * least recently used idle one is replaced.
+ *
+ * Only immediate context calls may be passed in. Thread-safe.
+ */
+class ReadbackValidator {
+
+public:
+
+  /**
+   * \brief Creates a validator
+   *
+   * \param [in] depth Maximum number of validations in flight
+   * \param [in] rate Fraction of fast-path hits to validate
+   */
+  ReadbackValidator(uint32_t depth, double rate);
+
+  ~ReadbackValidator();
+
+  ReadbackValidator(const ReadbackValidator&) = delete;
+  ReadbackValidator& operator = (const ReadbackValidator&) = delete;
+
+  /**
+   * \brief Decides whether to validate the next hit
+   *
+   * Samples are spread evenly rather than randomly, so that
+   * a rate of 0.25 validates exactly every fourth hit.
+   * \returns \c true if the hit should be validated
+   */
+  bool sample();
+
+  /**
+   * \brief Issues a validation copy
+   *
+   * \param [in] pContext Immediate context
+   * \param [in] pSrcResource Copy source
+   * \param [in] SrcSubresource Source subresource
+   * \param [in] pSrcBox Source region
+   * \param [in] Desc Properties of the game's destination,
+   *    which may be of any dimension
+   * \param [in] Lineage Lineage of the served data
+   * \returns \c false if no staging resource was available
+   */
+  bool submit(
+          ID3D11DeviceContext*      pContext,
+          ID3D11Resource*           pSrcResource,
+          UINT                      SrcSubresource,
+    const D3D11_BOX*                pSrcBox,
+    const ResourceInfo&             Desc,
+    const ReadbackLineage&          Lineage);
+
+  /**
+   * \brief Checks completed validation copies
+   *
+   * Never waits for the GPU. Failures are logged.
+   * \param [in] pContext Immediate context
+   * \param [out] pFailures Appended failed validations
+   */
+  void poll(
+          ID3D11DeviceContext*      pContext,
+          std::vector<ReadbackValidation>* pFailures);
+
+  /**
+   * \brief Returns and resets counters
+   */
+  ValidationStats takeStats();
+
+private:
+
+  struct StagingResource {
+    ID3D11Resource*       resource = nullptr;
+    ResourceInfo          desc;
+    bool                  busy     = false;
+    uint64_t              lastUse  = 0;
+  };
+
+  struct PendingValidation {
+    size_t                resourceIndex = 0;
+    ReadbackLineage       lineage;
+  };
+
+  mutex                           m_mutex;
+
+  uint32_t                        m_depth;
+  double                          m_rate;
+  double                          m_sampleCredit = 0.0;
+
+  std::vector<StagingResource>    m_resources;
+  uint64_t                        m_useCounter = 0;
+  std::deque<PendingValidation>   m_pending;
+
+  ValidationStats                 m_stats;
+
+  bool getStagingResource(
+          ID3D11DeviceContext*      pContext,
+    const ResourceInfo&             Desc,
+          size_t*                   pIndex);
+
+};
+
+}
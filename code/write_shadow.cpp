@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cstring>
+
+#include "write_shadow.h"
+
+namespace atfix {
+
+/** Pages made writable per fault. Sequential writers take one
+ *  fault per span instead of one per page, at the cost of
+ *  copying a few rows the game did not write. */
+constexpr size_t FaultSpanPages = 8;
+
+/** Shadow rows are aligned for vector stores */
+constexpr UINT RowAlignment = 64;
+
+WriteShadowTracker::WriteShadowTracker(uint32_t calibrationMaps)
+: m_calibrationMaps(calibrationMaps) {
+
+}
+
+
+bool WriteShadowTracker::mapShadow(
+  const core::ResourceKey&        Resource,
+        UINT                      RowSize,
+        UINT                      RowCount,
+        UINT                      SliceCount,
+        uint64_t                  MapStartUs,
+        D3D11_MAPPED_SUBRESOURCE* pMappedResource) {
+  std::lock_guard lock(m_mutex);
+
+  ActiveMap& map = m_maps[Resource];
+  map = ActiveMap();
+  map.startUs = MapStartUs;
+
+  // Alternate while calibrating, starting with a direct map
+  bool useShadow = m_enabled
+    && (m_calibrationIndex >= m_calibrationMaps || (m_calibrationIndex & 1));
+
+  if (m_calibrationIndex < m_calibrationMaps)
+    m_calibrationIndex += 1;
+
+  ShadowRegion* region = useShadow ? getRegion(Resource, RowSize, RowCount, SliceCount) : nullptr;
+
+  if (region && !region->buffer->arm(false, FaultSpanPages))
+    region = nullptr;
+
+  if (!region) {
+    m_stats.directMaps += 1;
+    return false;
+  }
+
+  map.region = region;
+  map.pRealData = static_cast<uint8_t*>(pMappedResource->pData);
+  map.realPitch = pMappedResource->RowPitch;
+  map.realDepthPitch = pMappedResource->DepthPitch;
+
+  pMappedResource->pData = region->buffer->data();
+  pMappedResource->RowPitch = region->rowPitch;
+  pMappedResource->DepthPitch = region->rowPitch * region->sliceRows;
+
+  m_stats.shadowMaps += 1;
+  m_stats.totalRows += region->rowCount;
+  return true;
+}
+
+
+bool WriteShadowTracker::unmapShadow(
+  const core::ResourceKey&        Resource,
+        bool*                     pComplete) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_maps.find(Resource);
+
+  if (entry == m_maps.end() || !entry->second.region)
+    return false;
+
+  const ActiveMap& map = entry->second;
+  GuardedBuffer* buffer = map.region->buffer.get();
+  buffer->disarm();
+
+  UINT rowSize = map.region->rowSize;
+  UINT rowPitch = map.region->rowPitch;
+  UINT rowCount = map.region->rowCount;
+  UINT sliceRows = map.region->sliceRows;
+
+  UINT copiedRows = 0;
+
+  for (UINT y = 0; y < rowCount; y++) {
+    size_t offset = size_t(y) * rowPitch;
+    size_t firstPage = offset / GuardedBuffer::PageSize;
+    size_t lastPage = (offset + rowSize - 1) / GuardedBuffer::PageSize;
+
+    bool isDirty = false;
+
+    for (size_t p = firstPage; p <= lastPage && !isDirty; p++)
+      isDirty = buffer->isTouched(p);
+
+    if (isDirty) {
+      size_t realOffset = size_t(y / sliceRows) * map.realDepthPitch + size_t(y % sliceRows) * map.realPitch;
+      std::memcpy(map.pRealData + realOffset, buffer->data() + offset, rowSize);
+      copiedRows += 1;
+    }
+  }
+
+  m_stats.faults += buffer->getFaultCount();
+  m_stats.copiedRows += copiedRows;
+
+  *pComplete = copiedRows == rowCount;
+  return true;
+}
+
+
+void WriteShadowTracker::endMap(const core::ResourceKey& Resource) {
+  std::lock_guard lock(m_mutex);
+
+  auto entry = m_maps.find(Resource);
+
+  if (entry == m_maps.end())
+    return;
+
+  uint64_t us = getTimeUs() - entry->second.startUs;
+  bool isShadowed = entry->second.region != nullptr;
+
+  m_maps.erase(entry);
+
+  if (isShadowed)
+    m_stats.shadowUs += us;
+  else
+    m_stats.directUs += us;
+
+  if (m_enabled && m_calibrationCount[0] + m_calibrationCount[1] < m_calibrationMaps) {
+    m_calibrationUs[isShadowed] += us;
+    m_calibrationCount[isShadowed] += 1;
+
+    if (m_calibrationCount[0] + m_calibrationCount[1] == m_calibrationMaps)
+      finishCalibration();
+  }
+}
+
+
+void WriteShadowTracker::retire(const core::ResourceKey& Resource) {
+  std::lock_guard lock(m_mutex);
+
+  m_maps.erase(Resource);
+
+  m_regions.erase(Resource);
+}
+
+
+WriteShadowStats WriteShadowTracker::takeStats() {
+  std::lock_guard lock(m_mutex);
+
+  WriteShadowStats result = m_stats;
+  m_stats = WriteShadowStats();
+  return result;
+}
+
+
+WriteShadowTracker::ShadowRegion* WriteShadowTracker::getRegion(
+  const core::ResourceKey&        Resource,
+        UINT                      RowSize,
+        UINT                      RowCount,
+        UINT                      SliceCount) {
+  auto& region = m_regions[Resource];
+
+  if (region && region->rowSize == RowSize && region->sliceRows == RowCount
+   && region->rowCount == RowCount * SliceCount)
+    return region.get();
+
+  region = std::make_unique<ShadowRegion>();
+  region->rowSize = RowSize;
+  region->rowPitch = (RowSize + RowAlignment - 1) & ~(RowAlignment - 1);
+  region->rowCount = RowCount * SliceCount;
+  region->sliceRows = RowCount;
+  region->buffer = std::make_unique<GuardedBuffer>(size_t(region->rowPitch) * region->rowCount);
+
+  if (!region->buffer->isValid()) {
+    m_regions.erase(Resource);
+    return nullptr;
+  }
+
+  return region.get();
+}
+
+
+void WriteShadowTracker::finishCalibration() {
+  uint64_t directUs = m_calibrationUs[0] / std::max(m_calibrationCount[0], 1u);
+  uint64_t shadowUs = m_calibrationUs[1] / std::max(m_calibrationCount[1], 1u);
+
+  if (shadowUs <= directUs) {
+    log("Dirty tracking kept: ", shadowUs, " us per shadowed map, ", directUs, " us per direct map");
+    return;
+  }
+
+  log("Dirty tracking disabled: ", shadowUs, " us per shadowed map, ", directUs, " us per direct map");
+  m_enabled = false;
+}
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+
+#include "impl.h"
+#include "page_guard.h"
+#include "util.h"
+
+#include "core/types.h"
+
+namespace atfix {
+
+/**
+ * \brief Dirty page tracking counters
+ */
+struct WriteShadowStats {
+  /** WRITE_DISCARD maps served from a shadow */
+  uint64_t shadowMaps   = 0;
+  /** WRITE_DISCARD maps passed through to the driver */
+  uint64_t directMaps   = 0;
+  /** Write faults taken on shadows */
+  uint64_t faults       = 0;
+  /** Rows copied to the driver mapping at Unmap */
+  uint64_t copiedRows   = 0;
+  /** Rows of all shadowed maps */
+  uint64_t totalRows    = 0;
+  /** Time from Map to the end of Unmap of shadowed maps, in microseconds */
+  uint64_t shadowUs     = 0;
+  /** Time from Map to the end of Unmap of direct maps, in microseconds */
+  uint64_t directUs     = 0;
+};
+
+/**
+ * \brief Tracks writes to DYNAMIC resources through page faults
+ *
+ * Instead of the driver's write-combined pointer, WRITE_DISCARD
+ * maps get a CPU shadow of the subresource whose pages are
+ * read-only. The slices of 3D textures are laid out one after
+ * another in the shadow.
+ * The first write to a page faults, which makes the page and
+ * its neighbours writable and marks them dirty. At Unmap only
+ * rows on dirty pages are copied to the driver mapping, and the
+ * data can be hashed from cached memory instead of reading back
+ * write-combined memory.
+ *
+ * Rows on clean pages are left as the driver returned them,
+ * which WRITE_DISCARD leaves undefined, so the shadow only
+ * describes the texture if every row was copied.
+ *
+ * Whether faults cost more than they save depends on the driver
+ * and on how the game writes, so the first maps alternate between
+ * shadowed and direct maps, and shadowing is turned off for good
+ * if it turns out slower.
+ *
+ * Only immediate context calls may be passed in. Thread-safe.
+ */
+class WriteShadowTracker {
+
+public:
+
+  /**
+   * \brief Creates the tracker
+   *
+   * \param [in] calibrationMaps Number of maps to compare
+   *    shadowed and direct maps on, or 0 to always shadow
+   */
+  explicit WriteShadowTracker(uint32_t calibrationMaps);
+
+  WriteShadowTracker(const WriteShadowTracker&) = delete;
+  WriteShadowTracker& operator = (const WriteShadowTracker&) = delete;
+
+  /**
+   * \brief Replaces the mapping of a WRITE_DISCARD map
+   *
+   * Must be called for every tracked map, whether it ends up
+   * shadowed or not, so that both can be timed.
+   * \param [in] Resource Mapped resource
+   * \param [in] RowSize Bytes per row the game writes
+   * \param [in] RowCount Number of rows per slice
+   * \param [in] SliceCount Number of slices
+   * \param [in] MapStartUs Time the hooked Map was entered
+   * \param [in,out] pMappedResource Driver mapping, replaced
+   *    with the shadow on success
+   * \returns \c true if the game got a shadow
+   */
+  bool mapShadow(
+    const core::ResourceKey&        Resource,
+          UINT                      RowSize,
+          UINT                      RowCount,
+          UINT                      SliceCount,
+          uint64_t                  MapStartUs,
+          D3D11_MAPPED_SUBRESOURCE* pMappedResource);
+
+  /**
+   * \brief Copies dirty rows to the driver mapping
+   *
+   * Must be called before the real Unmap.
+   * \param [in] Resource Unmapped resource
+   * \param [out] pComplete Set to \c true if every row
+   *    was copied, i.e. the shadow matches the texture
+   * \returns \c true if the resource had a shadow
+   */
+  bool unmapShadow(
+    const core::ResourceKey&        Resource,
+          bool*                     pComplete);
+
+  /**
+   * \brief Ends timing of a map
+   *
+   * Must be called after the real Unmap.
+   * \param [in] Resource Unmapped resource
+   */
+  void endMap(const core::ResourceKey& Resource);
+
+  /**
+   * \brief Frees the shadow of a destroyed resource
+   *
+   * \param [in] Resource Resource
+   */
+  void retire(const core::ResourceKey& Resource);
+
+  /**
+   * \brief Returns and resets counters
+   */
+  WriteShadowStats takeStats();
+
+private:
+
+  struct ShadowRegion {
+    std::unique_ptr<GuardedBuffer>      buffer;
+    UINT                                rowSize   = 0;
+    UINT                                rowPitch  = 0;
+    /** Rows of all slices, and rows per slice */
+    UINT                                rowCount  = 0;
+    UINT                                sliceRows = 0;
+  };
+
+  struct ActiveMap {
+    uint64_t                            startUs   = 0;
+    ShadowRegion*                       region    = nullptr;
+    uint8_t*                            pRealData = nullptr;
+    UINT                                realPitch = 0;
+    UINT                                realDepthPitch = 0;
+  };
+
+  mutex                                 m_mutex;
+
+  bool                                  m_enabled = true;
+  uint32_t                              m_calibrationMaps;
+  uint32_t                              m_calibrationIndex = 0;
+  uint64_t                              m_calibrationUs[2] = { };
+  uint32_t                              m_calibrationCount[2] = { };
+
+  std::unordered_map<core::ResourceKey, std::unique_ptr<ShadowRegion>, core::ResourceKeyHash> m_regions;
+  std::unordered_map<core::ResourceKey, ActiveMap, core::ResourceKeyHash> m_maps;
+
+  WriteShadowStats                      m_stats;
+
+  ShadowRegion* getRegion(
+    const core::ResourceKey&        Resource,
+          UINT                      RowSize,
+          UINT                      RowCount,
+          UINT                      SliceCount);
+
+  void finishCalibration();
+
+};
+
+}
@@ -0,0 +1,68 @@
+#!/bin/bash
+
+# pgo_build.sh - Profile-guided release build with LTO
+#
+# Builds a plain release baseline, an instrumented LTO build, trains the
+# instrumented build on the replay workload, rebuilds it with the profile
+# and writes a benchmark report comparing both builds.
+#
+# Usage: ./pgo_build.sh [--native]
+#
+# Without --native, the Windows DLL is built and trained by running
+# atfix_e2e.exe under wine against the fake d3d11_proxy.dll backend.
+
+set -e
+
+MODE=win64
+if [ "$1" = "--native" ]; then
+    MODE=native
+fi
+
+cd code
+
+BASE_DIR="build-$MODE-release"
+PGO_DIR="build-$MODE-pgo"
+
+if [ "$MODE" = "native" ]; then
+    SETUP_ARGS=()
+    RUN=()
+    REPLAY=./atfix_replay
+else
+    SETUP_ARGS=(--cross-file ../build-win64.txt)
+    RUN=(env WINEDLLOVERRIDES=d3d11=n WINEDEBUG=-all wine)
+    REPLAY=./atfix_e2e.exe
+fi
+
+TRAINING_ARGS=(--synthetic --episodes 3 --repeat 3 ../../trace_with_checksums.log)
+REPORT_ARGS=(--synthetic --repeat 9 ../../trace_with_checksums.log)
+
+echo "Building baseline in $BASE_DIR..."
+rm -rf "$BASE_DIR"
+meson setup "${SETUP_ARGS[@]}" --buildtype=release "$BASE_DIR"
+ninja -C "$BASE_DIR"
+
+echo "Building instrumented binaries in $PGO_DIR..."
+rm -rf "$PGO_DIR"
+meson setup "${SETUP_ARGS[@]}" --buildtype=release -Db_lto=true -Db_pgo=generate "$PGO_DIR"
+ninja -C "$PGO_DIR"
+
+# The profile is written next to the object files. Under wine, the
+# instrumented DLL resolves these absolute paths through drive Z:.
+echo "Training..."
+(cd "$PGO_DIR" && "${RUN[@]}" "$REPLAY" "${TRAINING_ARGS[@]}" > /dev/null)
+
+echo "Rebuilding with profile..."
+meson configure "$PGO_DIR" -Db_pgo=use
+ninja -C "$PGO_DIR"
+
+echo "Benchmarking..."
+for dir in "$BASE_DIR" "$PGO_DIR"; do
+    (cd "$dir" && "${RUN[@]}" "$REPLAY" "${REPORT_ARGS[@]}" --json replay.json > /dev/null)
+
+    if [ "$MODE" = "native" ]; then
+        (cd "$dir" && ./atfix_microbench --json > microbench.json)
+    fi
+done
+
+python3 ../bench_report.py "$BASE_DIR" "$PGO_DIR" | tee "$PGO_DIR/report.md"
+echo "Done! Report written to code/$PGO_DIR/report.md"
@@ -0,0 +1,40 @@
+#!/bin/bash
+
+# sanitize_build.sh - Native build with AddressSanitizer and UBSan
+#
+# Builds the native tools with sanitizers, runs the unit tests, and
+# replays the synthetic workload with every mode enabled, so that a
+# memory or undefined behaviour error fails the script. Meant for CI.
+#
+# Usage: ./sanitize_build.sh
+
+set -e
+
+cd code
+
+BUILD_DIR="build-native-sanitize"
+
+# The mock device uses hand-written COM vtables, which the
+# UBSan vptr check does not understand
+echo "Building in $BUILD_DIR..."
+rm -rf "$BUILD_DIR"
+meson setup --buildtype=debugoptimized -Db_sanitize=address,undefined \
+    -Dcpp_args=-fno-sanitize=vptr "$BUILD_DIR"
+ninja -C "$BUILD_DIR"
+
+echo "Running unit tests..."
+meson test -C "$BUILD_DIR" --print-errorlogs
+
+export ASAN_OPTIONS=halt_on_error=1:abort_on_error=1
+export UBSAN_OPTIONS=halt_on_error=1:print_stacktrace=1
+
+echo "Replaying synthetic workload..."
+for args in "" "--deferred" "--upload update" "--upload update1" "--dimension 3d"; do
+    (cd "$BUILD_DIR" && env \
+        ATFIX_SHADOW_CACHE=1 ATFIX_SPECULATIVE_READBACK=1 ATFIX_DIRTY_TRACKING=1 \
+        ATFIX_READ_PROFILING=1 ATFIX_FLUSH_COALESCING=1 ATFIX_HAZARD_DETECTION=1 \
+        ATFIX_STRATEGY_CONTROL=1 \
+        ./atfix_replay --synthetic --episodes 3 --readbacks 100 --verify $args > /dev/null)
+done
+
+echo "Done, no sanitizer errors"
@@ -0,0 +1,318 @@
+#!/usr/bin/env python3
+"""What-if scheduling simulator for the glyph readback loop.
+
+Replays the write -> copy -> readback lineage of atfix traces through a
+discrete-event model of the CPU and GPU timelines, and predicts menu-open
+latency under alternative strategies:
+
+  baseline          copies are submitted when Map(READ) has to wait
+  flush-after-copy  every copy is submitted right away
+  rename-N          N-deep staging renaming, a readback may return the data
+                    copied N readbacks earlier if it has not changed
+  prefetch          every write to a DYNAMIC texture is copied and submitted
+                    at Unmap, before the game asks for it
+  spin / hybrid     like baseline, but waiting spins instead of blocking
+                    (hybrid spins up to a threshold, then blocks)
+
+CPU time between calls is taken from the trace. The GPU model has a fixed
+submission latency, a per-copy execution time and a wake-up penalty for
+blocking waits. The time between a readback and the call before it is
+split into CPU time and the stall the baseline model predicts, and the CPU
+time is kept for every strategy. The submission latency is calibrated so
+that the baseline reproduces the measured latency of each trace; if it
+cannot even without submission latency, the per-copy costs are scaled
+down instead.
+
+Usage: schedule_sim.py [options] trace...
+"""
+import argparse
+import sys
+
+from atfix_trace import parse_trace, split_episodes, is_readback
+
+
+class Event:
+    __slots__ = ('kind', 'gap', 'res', 'src', 'payload')
+
+    def __init__(self, kind, gap, res=None, src=None, payload=None):
+        self.kind = kind
+        self.gap = gap
+        self.res = res
+        self.src = src
+        self.payload = payload
+
+
+def extract_events(episode):
+    """Reduces an episode to writes, copies and readbacks. The gap is the
+    time since the previous event. For readbacks, which are logged when
+    Map returns, it includes the stall, and the copy -> readback gaps
+    bound the measured stall."""
+    events = []
+    last_ts = episode[0].ts
+    written = {}
+    holds = {}
+    stalls = []
+    copy_ts = {}
+
+    for call in episode:
+        args = call.args
+        if call.kind == 'Unmap' and 'checksum' in args:
+            written[args['res']] = args['checksum']
+            events.append(Event('write', call.ts - last_ts, res=args['res']))
+        elif call.kind == 'CopySubresourceRegion':
+            holds[args['dst']] = written.get(args['src'])
+            copy_ts[args['dst']] = call.ts
+            events.append(Event('copy', call.ts - last_ts, res=args['dst'], src=args['src']))
+        elif is_readback(call):
+            res = args['res']
+            if res in copy_ts:
+                stalls.append(call.ts - copy_ts.pop(res))
+            events.append(Event('read', call.ts - last_ts, res=res, payload=holds.get(res)))
+        else:
+            continue
+        last_ts = call.ts
+
+    return events, episode[-1].ts - episode[0].ts, sum(stalls)
+
+
+class Model:
+    def __init__(self, args, submit_delay_us):
+        self.gpu_copy = args.gpu_copy_us
+        self.flush_cost = args.flush_cost_us
+        self.wake = args.wake_us
+        self.spin_threshold = args.spin_threshold_us
+        self.submit_delay = submit_delay_us
+
+
+def simulate(events, model, strategy, depth=0, cpu=None):
+    """Returns (latency_us, stall_us, gpu_copies, stale_reads, cpu).
+
+    cpu holds the CPU time before each readback's Map. The baseline
+    computes it if it is not given: the largest that still lets the Map
+    return when the trace says it did, or if the model cannot return
+    that early, the largest that returns as early as possible. Slack of
+    later readbacks then absorbs the delay. Other strategies need it
+    from the baseline."""
+    plan = cpu is None
+    if plan:
+        assert strategy == 'baseline'
+        cpu = []
+    t = 0.0
+    gpu_free = 0.0
+    pending = []          # copy ids recorded but not submitted
+    ready = {}            # copy id -> completion time
+    dst_copy = {}         # staging texture -> last copy id into it
+    src_prefetch = {}     # dynamic texture -> completion of prefetch copy
+    copy_src = {}
+    reads = []            # (copy id, payload) of every readback so far
+    stall = 0.0
+    copies = 0
+    stale = 0
+    reads_seen = 0
+    trace_t = 0.0
+
+    def submit(now):
+        nonlocal gpu_free, pending
+        if not pending:
+            return now
+        now += model.flush_cost
+        start = max(gpu_free, now + model.submit_delay)
+        for cid in pending:
+            start += model.gpu_copy
+            ready[cid] = start
+        gpu_free = start
+        pending = []
+        return now
+
+    def wait(now, until):
+        if until <= now:
+            return now, 0.0
+        w = until - now
+        if strategy == 'spin':
+            pass
+        elif strategy == 'hybrid' and w <= model.spin_threshold:
+            pass
+        else:
+            w += model.wake
+        return now + w, w
+
+    for event in events:
+        trace_t += event.gap
+        if event.kind != 'read':
+            t += event.gap
+
+        if event.kind == 'write':
+            if strategy == 'prefetch':
+                cid = ('prefetch', copies)
+                copies += 1
+                pending.append(cid)
+                t = submit(t)
+                src_prefetch[event.res] = cid
+
+        elif event.kind == 'copy':
+            cid = copies
+            copies += 1
+            pending.append(cid)
+            dst_copy[event.res] = cid
+            copy_src[cid] = event.src
+            if strategy == 'flush-after-copy':
+                t = submit(t)
+
+        elif event.kind == 'read':
+            if plan:
+                cpu.append(plan_cpu(event, model, t, trace_t, gpu_free, pending, ready, dst_copy))
+            t += cpu[reads_seen]
+            reads_seen += 1
+
+            cid = dst_copy.get(event.res)
+            if cid is None:
+                continue
+            target = cid
+
+            if strategy == 'prefetch':
+                # Served from the prefetched copy of the source, if any
+                target = src_prefetch.get(copy_src[cid], cid)
+            elif strategy == 'rename' and len(reads) >= depth:
+                old_cid, old_payload = reads[-depth]
+                if event.payload is not None and old_payload == event.payload:
+                    target = old_cid
+                else:
+                    stale += 1
+
+            reads.append((cid, event.payload))
+
+            if target not in ready:
+                t = submit(t)
+            elif pending and strategy == 'rename':
+                # Keep the pipeline moving without waiting for it
+                t = submit(t)
+
+            t, w = wait(t, ready[target])
+            stall += w
+
+    return t, stall, copies, stale, cpu
+
+
+def plan_cpu(event, model, now, returns, gpu_free, pending, ready, dst_copy):
+    """CPU time before a baseline readback's Map that returns at the
+    trace time returns, see simulate()."""
+    cid = dst_copy.get(event.res)
+
+    if cid is None:
+        return max(0.0, returns - now)
+
+    if cid in ready:
+        # Submitted earlier, a Map after completion does not stall
+        return max(0.0, max(returns, ready[cid]) - now)
+
+    # The Map submits everything pending and waits for the copy
+    wait = (pending.index(cid) + 1) * model.gpu_copy + model.wake
+    if gpu_free + wait <= returns:
+        issue = returns - wait - model.flush_cost - model.submit_delay
+    else:
+        issue = gpu_free - model.flush_cost - model.submit_delay
+    return max(0.0, issue - now)
+
+
+def baseline_latency(episodes, model):
+    return sum(simulate(e[0], model, 'baseline')[0] for e in episodes)
+
+
+def calibrate(episodes, args):
+    """Finds the largest submission latency for which the simulated
+    baseline does not exceed the measured latency summed over all
+    episodes. Below that, readbacks absorb the difference as CPU time.
+    If the baseline is too slow without submission latency, the GPU
+    copy time and wake-up penalty are scaled down by the same factor.
+    Returns (model, cost scale)."""
+    measured = sum(e[1] for e in episodes)
+    lo, hi = 0.0, max(1.0, max(e[2] for e in episodes))
+    for _ in range(60):
+        mid = 0.5 * (lo + hi)
+        if baseline_latency(episodes, Model(args, mid)) <= measured:
+            lo = mid
+        else:
+            hi = mid
+    model = Model(args, lo)
+
+    if lo > 0.0 or baseline_latency(episodes, model) <= measured:
+        return model, 1.0
+
+    lo, hi = 0.0, 1.0
+    for _ in range(60):
+        mid = 0.5 * (lo + hi)
+        model.gpu_copy = args.gpu_copy_us * mid
+        model.wake = args.wake_us * mid
+        if baseline_latency(episodes, model) <= measured:
+            lo = mid
+        else:
+            hi = mid
+    model.gpu_copy = args.gpu_copy_us * lo
+    model.wake = args.wake_us * lo
+    return model, lo
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__.strip().split('\n')[0],
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('traces', nargs='+', metavar='trace')
+    parser.add_argument('--episode-gap-ms', type=float, default=500.0, help='gap that separates episodes (default 500)')
+    parser.add_argument('--gpu-copy-us', type=float, default=20.0, help='GPU time per copy (default 20)')
+    parser.add_argument('--flush-cost-us', type=float, default=5.0, help='CPU cost of a submission (default 5)')
+    parser.add_argument('--wake-us', type=float, default=50.0, help='wake-up penalty of a blocking wait (default 50)')
+    parser.add_argument('--spin-threshold-us', type=float, default=200.0, help='hybrid wait spin limit (default 200)')
+    parser.add_argument('--rename-depth', default='1,2,4', help='comma-separated renaming depths (default 1,2,4)')
+    args = parser.parse_args()
+
+    strategies = [('baseline', 0), ('flush-after-copy', 0), ('prefetch', 0), ('spin', 0), ('hybrid', 0)]
+    strategies += [('rename', int(d)) for d in args.rename_depth.split(',')]
+
+    for path in args.traces:
+        episodes = [extract_events(e) for e in split_episodes(parse_trace(path), args.episode_gap_ms * 1000.0)]
+        episodes = [e for e in episodes if e[0]]
+        if not episodes:
+            print("%s: no readback episodes" % path)
+            continue
+
+        model, scale = calibrate(episodes, args)
+        print("%s: %d episode(s), calibrated submission latency %.1f us" % (
+            path, len(episodes), model.submit_delay))
+        if scale < 1.0:
+            print("  baseline too slow without submission latency, GPU copy %.1f us and wake-up %.1f us"
+                  " (%.0f%% of the given costs)" % (model.gpu_copy, model.wake, 100.0 * scale))
+
+        plans = []
+        for i, (events, measured, measured_stall) in enumerate(episodes):
+            simulated, stall, _, _, cpu = simulate(events, model, 'baseline')
+            plans.append(cpu)
+            print("  episode %d: measured %.1f ms (stall at most %.1f ms), baseline model %.1f ms (stall %.1f ms, error %+.1f%%)" % (
+                i, measured / 1000.0, measured_stall / 1000.0, simulated / 1000.0, stall / 1000.0,
+                100.0 * (simulated - measured) / measured if measured else 0.0))
+
+        results = []
+        for strategy, depth in strategies:
+            latency = stall = copies = stale = 0
+            for (events, _, _), cpu in zip(episodes, plans):
+                l, s, c, st, _ = simulate(events, model, strategy, depth, cpu)
+                latency += l
+                stall += s
+                copies += c
+                stale += st
+            name = "%s-%d" % (strategy, depth) if strategy == 'rename' else strategy
+            results.append((latency, name, stall, copies, stale))
+
+        base = next(r for r in results if r[1] == 'baseline')
+        print("\n| rank | strategy | latency ms | change | stall ms | GPU copies | unsafe reads |")
+        print("|---:|---|---:|---:|---:|---:|---:|")
+        for rank, (latency, name, stall, copies, stale) in enumerate(sorted(results), 1):
+            print("| %d | %s | %.1f | %+.1f%% | %.1f | %d | %d |" % (
+                rank, name, latency / 1000.0, 100.0 * (latency - base[0]) / base[0] if base[0] else 0.0,
+                stall / 1000.0, copies, stale))
+        print()
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())